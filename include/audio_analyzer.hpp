@@ -0,0 +1,53 @@
+#ifndef __AUDIO_ANALYZER_HPP
+#define __AUDIO_ANALYZER_HPP
+
+#include <cstdint>
+#include <vector>
+#include <audio_mixer.hpp>
+#include <lang/primtypes.hpp>
+#include <xm_module.hpp>
+
+sky::uint const ANALYSIS_WINDOW = 1024; /* frames per FFT */
+sky::uint const ANALYSIS_HOP    = 512;  /* frames between two analyses */
+sky::uint const ANALYSIS_BANDS  = 16;
+
+/* What the music sounds like over one hop. Everything is in [0;1]. */
+struct AudioFeatures {
+  std::uint64_t end;                   /* frames analysed so far */
+  float level[ANALYSIS_BANDS];   /* loudness of each band */
+  float onset[ANALYSIS_BANDS];   /* rises of level, decaying */
+  float average[ANALYSIS_BANDS]; /* level over about half a second */
+  float loudness;                /* mean level of all bands */
+  float beat;                    /* rises of loudness, decaying */
+};
+
+/* In-place FFT of n/2 complex values packed from n real ones (even
+ * samples in re, odd ones in im), n being ANALYSIS_WINDOW; then power of
+ * bins 0 to n/2 - 1 into power. Butterflies run four at a time on SSE. */
+void real_fft_power(float *re, float *im, float *power);
+
+/* Spectrum of a sliding Hann window over the mono mix, split into
+ * logarithmic bands from 40 Hz to 16 kHz. Results only depend on the
+ * frames fed so far: the audio thread and offline analysis of the same
+ * song get the same features, hop for hop. */
+class AudioAnalyzer {
+  std::vector<float> _window;  /* last ANALYSIS_WINDOW mono samples */
+  std::vector<float> _hann;
+  std::vector<float> _re, _im, _power;
+  sky::uint _edges[ANALYSIS_BANDS + 1]; /* first bin of each band */
+  AudioFeatures _last;
+
+public :
+  explicit AudioAnalyzer(sky::uint rate);
+  ~AudioAnalyzer(void) = default;
+
+  /* hop holds ANALYSIS_HOP frames */
+  void analyze(AudioFrame const *hop, AudioFeatures &out);
+};
+
+/* Features of every hop of the song played once from its start, for runs
+ * without an audio device; hop i ends at frame (i + 1) * ANALYSIS_HOP. */
+std::vector<AudioFeatures> analyze_song(XMModule const &module, sky::uint rate);
+
+#endif /* guard */
+
@@ -0,0 +1,24 @@
+#ifndef __AUDIO_MIXER_HPP
+#define __AUDIO_MIXER_HPP
+
+#include <cstdint>
+#include <lang/primtypes.hpp>
+
+/* one interleaved 16-bit stereo frame, as sent to the device */
+struct AudioFrame {
+  std::int16_t l, r;
+};
+
+/* Accumulates n resampled frames of src into the interleaved stereo out.
+ * The source position pos and its per frame step are 32.32 fixed point,
+ * samples are linearly interpolated, so src must be readable up to one
+ * sample past the last position reached. Left and right gains start at
+ * l and r and move by dl and dr every frame. Returns the new position.
+ * Vectorized with AVX2 gathers when available, SSE2 otherwise. */
+std::uint64_t mix_resample(float const *src, std::uint64_t pos, std::uint64_t step, sky::uint n, float l, float r, float dl, float dr, float *out);
+
+/* n interleaved float stereo frames to saturated 16-bit ones */
+void mix_to_frames(float const *mix, sky::uint n, AudioFrame *out);
+
+#endif /* guard */
+
@@ -0,0 +1,27 @@
+#ifndef __AUDIO_TEXTURE_HPP
+#define __AUDIO_TEXTURE_HPP
+
+#include <audio_analyzer.hpp>
+#include <core/texture.hpp>
+#include <lang/primtypes.hpp>
+
+/* texture unit the features stay bound to, out of the way of the parts */
+sky::uint const AUDIO_UNIT = 7;
+
+/* The latest audio features as a (ANALYSIS_BANDS + 1) x 1 RGBA32F
+ * texture, for any shader to read with texelFetch: texel b holds the
+ * level, onset and average of band b, the last texel the loudness and
+ * beat. Sampler uniforms read unit AUDIO_UNIT. */
+class AudioTexture {
+  sky::core::Texture _texture;
+
+public :
+  AudioTexture(void);
+  ~AudioTexture(void) = default;
+
+  /* upload and leave bound on AUDIO_UNIT */
+  void update(AudioFeatures const &features);
+};
+
+#endif /* guard */
+
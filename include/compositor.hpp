@@ -0,0 +1,58 @@
+#ifndef __COMPOSITOR_HPP
+#define __COMPOSITOR_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <core/shader.hpp>
+#include <core/vertex_array.hpp>
+#include <lang/primtypes.hpp>
+
+/* Per-pixel operations on full-screen inputs, fused into one fragment
+ * shader so that the output is written once and each input read once.
+ * Stages are GLSL statements run in order on vec3 color, starting black;
+ * they see the inputs as s0, s1... and their parameter, if any, as p.
+ * Stages may be conditional: a program is generated and linked for every
+ * combination by compile(), and apply() draws the one of the stages
+ * enabled for the frame. Input i is sampled from texture unit i, the way
+ * the render graph binds what a pass reads. */
+class Compositor {
+public :
+  typedef std::function<float (void)> Parameter;
+  typedef std::function<bool (void)> Condition;
+
+private :
+  struct Stage {
+    std::string code;
+    Parameter parameter;
+    Condition condition;
+  };
+
+  struct Variant {
+    sky::core::Program sp;
+    std::vector<sky::core::Program::Uniform> parameters; /* per stage */
+  };
+
+  std::string _name;
+  sky::uint _inputs;
+  std::vector<Stage> _stages;
+  std::vector<sky::uint> _conditional; /* stages */
+  std::deque<Variant> _variants;       /* by mask of the conditional stages */
+  sky::core::VertexArray _va;
+
+  std::string _source(std::uint64_t enabled) const;
+
+public :
+  Compositor(char const *name, sky::uint inputs);
+  ~Compositor(void) = default;
+
+  /* left out, with an error, past 64 stages or 8 conditional ones */
+  void stage(char const *code, Parameter const &parameter = nullptr, Condition const &condition = nullptr);
+  /* all the variants, once the stages are known */
+  void compile(void);
+  void apply(void) const;
+};
+
+#endif /* guard */
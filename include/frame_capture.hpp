@@ -0,0 +1,41 @@
+#ifndef __FRAME_CAPTURE_HPP
+#define __FRAME_CAPTURE_HPP
+
+#include <gl_trace.hpp>
+#include <lang/primtypes.hpp>
+#include <options.hpp>
+
+/* The GL calls of the frames drawn, for the replay tool to issue again
+ * without the intro: a trace, as gl_trace.hpp has it, written by the
+ * recorder (libgltrace.so) the intro runs with once preload() is done.
+ *
+ * Everything from the start is kept, the frames needing what was set up
+ * before them; it's replayed once, then the frames captured in a loop.
+ * Offline, --render-at with a few --warmup frames keeps that short. */
+class FrameCapture {
+  TraceOpen _open;
+  TraceFrame _frame;
+  TraceClose _close;
+  float _from, _to;
+  bool _recording;
+  sky::uint _frames;
+
+  void _stop(void);
+
+public :
+  /* to options.capture, frames from options.captureFrom to captureTo */
+  FrameCapture(Options const &options, sky::ushort width, sky::ushort height);
+  ~FrameCapture(void);
+  FrameCapture(FrameCapture const &) = delete;
+  FrameCapture & operator=(FrameCapture const &) = delete;
+
+  bool ok(void) const;
+  /* before each frame is drawn; the trace ends at the first past range */
+  void frame(float time);
+
+  /* runs the intro again with the recorder preloaded, from next to it,
+   * unless it is already; argv as main() got it. False if that fails. */
+  static bool preload(char **argv);
+};
+
+#endif /* guard */
@@ -0,0 +1,110 @@
+#ifndef __FRAME_PIPELINE_HPP
+#define __FRAME_PIPELINE_HPP
+
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <frame_worker.hpp>
+
+/* Immutable frame packets built one frame ahead on the frame worker. The
+ * render thread draws from front() while the worker fills the back packet
+ * for the time the next frame is expected at; update() swaps them if the
+ * worker is done with it, which it polls without waiting. The packets
+ * themselves are swapped, not pointers to them, so that front() keeps its
+ * address and passes can hold on to it. A packet built for a time too far
+ * from the actual one (first frame of a part, seeks, stalls), or before
+ * the worker was invalidated, is rebuilt on the spot instead.
+ *
+ * A worker still busy with the back packet is left to it: the front one is
+ * drawn again if close enough to the time, else rebuilt on the render
+ * thread, and nothing new is posted until the worker is done. In lockstep,
+ * the render thread waits for it instead, so that frames don't depend on
+ * timing.
+ *
+ * prepare runs on the worker: it must not touch GL, nor anything the render
+ * thread writes. */
+template <typename Packet>
+class FramePipeline {
+public :
+  typedef std::function<void (float time, Packet &packet)> Prepare;
+
+private :
+  static constexpr float MAX_STEP = 0.1f;  /* longer frames are jumps, in s */
+  static constexpr float MAX_SKEW = 0.05f; /* farthest packet drawn, in s */
+
+  FrameWorker &_worker;
+  Prepare _prepare;
+  Packet _front, _back;
+  FrameWorker::Job _job; /* fills _back for _next */
+  bool _ahead;           /* _back was posted */
+  float _last, _next;
+  float _frontTime;
+  unsigned _epoch;       /* of the worker when _back was posted */
+  unsigned _frontEpoch;
+
+  /* on the render thread, into front() */
+  void _build(float time) {
+    _prepare(time, _front);
+    _frontTime = time;
+    _frontEpoch = _worker.epoch();
+  }
+
+public :
+  FramePipeline(FrameWorker &worker, Prepare const &prepare) :
+      _worker(worker)
+    , _prepare(prepare)
+    , _front()
+    , _back()
+    , _job([this]() { _prepare(_next, _back); })
+    , _ahead(false)
+    , _last(0.f)
+    , _next(0.f)
+    , _frontTime(0.f)
+    , _epoch(0)
+    , _frontEpoch(0) {
+  }
+
+  ~FramePipeline(void) {
+    if (_ahead)
+      _worker.wait();
+  }
+
+  /* render thread, once per frame: front() is the packet of time, or one
+   * close to it, then the next one is posted if the worker is free */
+  void update(float time) {
+    float step = time - _last;
+    bool ready = _worker.lockstep() ? (_worker.wait(), true) : _worker.done();
+
+    if (_ahead && ready) {
+      _ahead = false;
+      if (std::fabs(_next - time) <= MAX_SKEW && _epoch == _worker.epoch()) {
+        std::swap(_front, _back);
+        _frontTime = _next;
+        _frontEpoch = _epoch;
+      } else {
+        _build(time);
+      }
+    } else if (!_ahead || std::fabs(_frontTime - time) > MAX_SKEW || _frontEpoch != _worker.epoch()) {
+      _build(time);
+    }
+
+    _last = time;
+    if (!_ahead) {
+      _next = step < 0.f || step > MAX_STEP ? time : time + step;
+      _epoch = _worker.epoch();
+      _worker.post(_job);
+      _ahead = true;
+    }
+  }
+
+  Packet const & front(void) const {
+    return _front;
+  }
+};
+
+template <typename Packet>
+constexpr float FramePipeline<Packet>::MAX_STEP;
+template <typename Packet>
+constexpr float FramePipeline<Packet>::MAX_SKEW;
+
+#endif /* guard */
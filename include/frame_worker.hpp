@@ -0,0 +1,48 @@
+#ifndef __FRAME_WORKER_HPP
+#define __FRAME_WORKER_HPP
+
+#include <functional>
+#include <semaphore.h>
+#include <thread>
+
+/* A thread preparing the next frame while the render thread submits the
+ * current one. Only the render thread posts and waits, one job at a time;
+ * the semaphores merely park the threads and order their memory accesses,
+ * frame data itself is handed over by FramePipeline without lock nor copy.
+ * done() polls without waiting, so that a late job never stalls a frame,
+ * unless in lockstep, for frames that must not depend on timing. */
+class FrameWorker {
+public :
+  typedef std::function<void (void)> Job;
+
+private :
+  sem_t _posted, _done;
+  Job const *_job;    /* must outlive its run */
+  bool _pending;      /* render thread side */
+  unsigned _epoch;    /* render thread side */
+  bool _lockstep;     /* render thread side */
+  bool _quit;
+  std::thread _thread;
+
+  void _loop(void);
+
+public :
+  FrameWorker(void);
+  ~FrameWorker(void);
+
+  /* waits for the previous job first */
+  void post(Job const &job);
+  /* until the last job posted is done */
+  void wait(void);
+  /* whether the last job posted is done, without waiting */
+  bool done(void);
+  /* what jobs read besides the time changed, e.g. the tile drawn: waits
+   * for the job in flight, and what jobs built so far is stale */
+  void invalidate(void);
+  unsigned epoch(void) const;
+  /* late jobs are waited for rather than done without, e.g. offline */
+  void lockstep(bool on);
+  bool lockstep(void) const;
+};
+
+#endif /* guard */
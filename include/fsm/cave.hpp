@@ -1,28 +1,54 @@
 #ifndef __FSM_CAVE_HPP
 #define __FSM_CAVE_HPP
 
+#include <vector>
+#include <gl.hpp>
 #include <core/shader.hpp>
 #include <core/texture.hpp>
-#include <data/subplane.hpp>
+#include <fsm/terrain.hpp>
 #include <lang/primtypes.hpp>
 
+/* The cave, drawn into the G-buffer. Its fragment shader also outputs the
+ * screen motion since the last camera and the view depth (RGB), at the
+ * G-buffer output VELOCITY_OUTPUT: between begin_velocity() and
+ * end_velocity(), with the G-buffer bound, they go to a texture attached
+ * past the G-buffer's own, in the same geometry pass. */
 class Cave {
-  sky::data::SubPlane _plane;
-  sky::core::Texture *_pTexture[2];
+public :
+  static GLint const VELOCITY_OUTPUT = 2;
+
+private :
+  Terrain _terrain;
+  sky::core::Texture _heightmap[2]; /* height, x and z derivatives */
   sky::core::Program _sp;
   sky::core::Program::Uniform _projIndex;
   sky::core::Program::Uniform _viewIndex;
-  sky::core::Program::Uniform _timeIndex;
+  sky::core::Program::Uniform _lastViewIndex;
+  sky::core::Program::Uniform _mixingIndex;
+  sky::core::Program::Uniform _nodeIndex;
+  sky::core::Program::Uniform _morphIndex;
+  sky::core::Program::Uniform _eyeIndex;
+  /* the G-buffer's draw buffers, then the velocities' */
+  GLenum _outputs[VELOCITY_OUTPUT+1];
+  int _attachment; /* of the velocities: -2 until looked up, -1 if none */
 
   void _init_textures(sky::uint width, sky::uint height);
   void _init_program(void);
   void _init_uniforms(void);
+  bool _find_attachment(void);
 
 public :
-  Cave(void);
-  ~Cave(void);
+  /* heightmaps resolution */
+  Cave(sky::uint texWidth, sky::uint texHeight);
+  ~Cave(void) = default;
 
-  void render(float time, sky::math::Mat44 const &proj, sky::math::Mat44 const &view) const;
+  /* terrain nodes to draw from view, off the render thread */
+  void select(sky::math::Mat44 const &proj, sky::math::Mat44 const &view, std::vector<Terrain::Node> &nodes) const;
+  /* velocities are relative to lastView */
+  void render(float mixing, sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::math::Mat44 const &lastView, std::vector<Terrain::Node> const &nodes) const;
+  /* the G-buffer bound: velocities go to velocity, until end_velocity() */
+  void begin_velocity(sky::core::Texture const &velocity);
+  void end_velocity(void) const;
 };
 
 #endif
@@ -0,0 +1,37 @@
+#ifndef __FSM_CHECKERBOARD_HPP
+#define __FSM_CHECKERBOARD_HPP
+
+#include <core/shader.hpp>
+#include <core/vertex_array.hpp>
+#include <lang/primtypes.hpp>
+#include <math/matrix.hpp>
+
+/* Fills in the blocks of the checkerboard that weren't lit this frame.
+ * Lighting goes by 2x2 blocks, whole pixel quads, so that the skipped ones
+ * cost the GPU nothing; parity names the color of the blocks lit. A
+ * skipped pixel takes the four lit blocks around, weighted by how close
+ * their depths and normals are to its own, with normals derived from the
+ * depths. When the last frame is usable, that is averaged with the pixel
+ * reprojected from it, kept only if its depth is consistent. Reads this
+ * frame's lighting, this frame's velocities, the last frame's colors and
+ * its velocities, from texture units 0 to 3. */
+class Checkerboard {
+  sky::core::VertexArray _va;
+  sky::core::Program _sp;
+  sky::core::Program::Uniform _projIndex;
+  sky::core::Program::Uniform _viewIndex;
+  sky::core::Program::Uniform _lastViewIndex;
+  sky::core::Program::Uniform _parityIndex;
+  sky::core::Program::Uniform _temporalIndex;
+
+  void _init_program(void);
+  void _init_uniforms(sky::ushort width, sky::ushort height);
+
+public :
+  Checkerboard(sky::ushort width, sky::ushort height);
+  ~Checkerboard(void) = default;
+
+  void render(sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::math::Mat44 const &lastView, int parity, bool temporal) const;
+};
+
+#endif /* guard */
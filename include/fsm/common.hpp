@@ -1,8 +1,13 @@
 #ifndef __FSM_COMMON_HPP
 #define __FSM_COMMON_HPP
 
-#include <glyph/string_renderer.hpp>
+#include <audio_texture.hpp>
+#include <frame_worker.hpp>
+#include <quality.hpp>
+#include <text_renderer.hpp>
+#include <timeline.hpp>
 #include <math/common.hpp>
+#include <math/matrix.hpp>
 #include <scene/material_manager.hpp>
 #include <tech/deferred_renderer.hpp>
 
@@ -10,10 +15,36 @@ float  const FOVY             = sky::math::PI*70.f/180.f; /* 90 degrees */
 float  const ZNEAR            = 0.0001f;
 float  const ZFAR             = 10.f;
 
+/* camera of a frame packet, what most passes draw from */
+struct FrameView {
+  float time;
+  sky::math::Mat44 proj, view;
+};
+
+/* Part of the image a frame draws, for images larger than the context:
+ * NDC of the whole image are scaled, then offset into those of the part.
+ * By default, the whole image at the size of the context. */
+struct Tile {
+  float aspect; /* of the whole image */
+  float scale[2], offset[2];
+
+  Tile(sky::ushort width, sky::ushort height);
+  ~Tile(void) = default;
+
+  /* the camera's; the frame packets take it on the worker, which must be
+   * invalidated when it changes */
+  sky::math::Mat44 projection(void) const;
+};
+
 struct Common {
+  Tile tile;
+  Quality quality;    /* parts built from then on; high by default */
   sky::tech::DeferredRenderer drenderer;
   sky::scene::MaterialManager matmgr;
-  sky::glyph::StringRenderer stringRenderer;
+  TextRenderer stringRenderer;
+  Timeline timeline;
+  AudioTexture audio;
+  FrameWorker worker; /* builds the parts' next frame packets */
 
   Common(sky::ushort width, sky::ushort height);
   ~Common(void) = default;
@@ -1,10 +1,15 @@
 #ifndef __FSM_CUBE_ROOM_HPP
 #define __FSM_CUBE_ROOM_HPP
 
+#include <compositor.hpp>
+#include <frame_pipeline.hpp>
 #include <fsm/common.hpp>
 #include <fsm/laser.hpp>
 #include <fsm/liquid.hpp>
 #include <fsm/slab.hpp>
+#include <render_graph.hpp>
+#include <sample_query.hpp>
+#include <text_batch.hpp>
 
 #include <core/buffer.hpp>
 #include <core/framebuffer.hpp>
@@ -15,39 +20,55 @@
 #include <lang/primtypes.hpp>
 #include <scene/freefly.hpp>
 #include <sync/parts_fsm.hpp>
-#include <tech/framebuffer_copy.hpp>
 #include <tech/post_process.hpp>
 #include <tech/deferred_renderer.hpp>
 
 class CubeRoom : public sky::sync::PartState {
+  struct Frame {
+    FrameView view;
+    float fade;            /* negative when not fading */
+    sky::uint walls[Slab::WALLS]; /* front to back */
+    bool liquidFirst;      /* in front of the nearest wall */
+    TextBatch::Span texts;
+  };
+
   /* common */
   sky::ushort _width, _height;
-  sky::tech::DefaultFramebufferCopy _fbCopier;
   sky::scene::Freefly const &_freefly;
+  Tile const &_tile;
+  Quality const _quality;
   sky::tech::DeferredRenderer &_drenderer;
   sky::scene::MaterialManager &_matmgr;
-  sky::glyph::StringRenderer &_stringRenderer;
+  CameraTrack const &_camera;
+  ScalarTrack const &_fade;
+  EventTrack const &_textCues;
   sky::core::Program::Uniform _matmgrProjIndex;
   sky::core::Program::Uniform _matmgrViewIndex;
   sky::core::Program::Uniform _matmgrLColorIndex;
   sky::core::Program::Uniform _matmgrLPosIndex;
   sky::scene::Material _matPlastic;
 
-  sky::core::Texture _offTex;
-  sky::core::Framebuffer _offFB;
-  sky::core::Renderbuffer _offRB;
-  sky::tech::TemporalPostProcess _fadePP;
+  Compositor _compositor;
+  bool _prepass;                /* depths first, G-buffer written once per pixel */
+  SampleQuery _prepassSamples;
+  SampleQuery _geometrySamples;
+  RenderGraph _graph;
 
   Slab _slab;
   Liquid _liquid;
   Laser _laser;
+  TextBatch _texts;
+  FramePipeline<Frame> _pipeline; /* last: waits for the worker before the rest goes */
 
   void _init_materials(sky::ushort width, sky::ushort height);
-  void _init_offscreen(sky::ushort width, sky::ushort height);
-  void _draw_texts(float t) const;
+  void _init_compositor(void);
+  void _init_graph(void);
+  void _init_texts(void);
+  void _prepare(float time, Frame &frame) const;
+  void _draw_texts(Frame const &frame) const;
 
 public :
-  CubeRoom(sky::ushort width, sky::ushort height, Common &common, sky::scene::Freefly const &freefly);
+  CubeRoom(sky::ushort width, sky::ushort height, Common &common, sky::scene::Freefly const &freefly, bool prepass);
   ~CubeRoom(void) = default;
 
   void run(float time) override;
@@ -1,36 +1,58 @@
 #ifndef __FSM_FIREFLIES_HPP
 #define __FSM_FIREFLIES_HPP
 
+#include <gl.hpp>
 #include <core/buffer.hpp>
 #include <core/shader.hpp>
 #include <core/vertex_array.hpp>
+#include <fsm/firefly_lights.hpp>
+#include <lang/primtypes.hpp>
 #include <math/matrix.hpp>
 #include <scene/common.hpp>
 
+/* Fireflies are simulated on the GPU with transform feedback, at a fixed
+ * timestep, from a counter-based hash of (firefly, update window). The
+ * first FIREFLIES_LIGHTS ones also light the scene: their positions are
+ * integrated on the CPU by FireflyLights, so nothing is read back nor
+ * uploaded per frame. Both sides keep their own step count: the CPU
+ * one runs ahead of the frame, off the render thread, the GPU one on it. */
 class Fireflies {
 public :
-  static int const FIREFLIES_NB = 20;
+  static int const FIREFLIES_LIGHTS = FireflyLights::NB;
 
 private :
-  sky::scene::Position _pos[FIREFLIES_NB];
-  sky::math::Vec3<float> _colors[FIREFLIES_NB];
-  sky::core::Buffer _vbo;
-  sky::core::VertexArray _va;
+  sky::uint _nb;
+  sky::uint _step;   /* simulated steps, GPU side */
+  sky::ushort _front; /* buffer holding the current positions */
+  sky::core::Buffer _pos[2]; /* double-buffered positions (SoA) */
+  sky::core::Buffer _colors;
+  sky::core::Program _simProgram;
+  sky::core::Program::Uniform _simFirstIndex;
+  sky::core::Program::Uniform _simLastIndex;
+  sky::core::VertexArray _simVA[2];
+  sky::core::VertexArray _va[2];
+  FireflyLights _lightsSim; /* CPU side */
+  sky::math::Vec3<float> _colorsLights[FIREFLIES_LIGHTS];
   sky::core::Program _sp;
   sky::core::Program::Uniform _projIndex;
   sky::core::Program::Uniform _viewIndex;
 
   void _init_fireflies(void);
+  void _init_va(void);
+  void _init_simulation(void);
   void _init_shader(void);
   void _init_uniforms(void);
+  void _reset(void);
 
 public :
-  Fireflies(void);
+  Fireflies(sky::uint nb);
   ~Fireflies(void) = default;
 
-  sky::scene::Position const * positions(void) const;
   sky::math::Vec3<float> const * colors(void) const;
+  /* CPU side, no GL: the lighting fireflies at time, into lights */
+  void simulate(float time, sky::scene::Position *lights);
   void render(sky::math::Mat44 const &proj, sky::math::Mat44 const &view) const;
+  /* GPU side, up to time */
   void animate(float time);
 };
 
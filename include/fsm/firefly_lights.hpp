@@ -0,0 +1,35 @@
+#ifndef __FSM_FIREFLY_LIGHTS_HPP
+#define __FSM_FIREFLY_LIGHTS_HPP
+
+#include <lang/primtypes.hpp>
+#include <scene/common.hpp>
+
+/* The lighting fireflies, integrated on the CPU at the fixed timestep of
+ * the GPU simulation and with its very hash, so that both agree without
+ * any read back. No GL: it runs on the frame worker, and in the
+ * microbenchmarks. */
+class FireflyLights {
+public :
+  static int const NB = 20;
+
+private :
+  sky::uint _nb;   /* lighting ones, at most NB */
+  sky::uint _step; /* simulated steps */
+  sky::scene::Position _lights[NB];
+
+public :
+  explicit FireflyLights(sky::uint nb);
+  ~FireflyLights(void) = default;
+
+  void reset(void);
+  /* up to time, into lights (NB of them) */
+  void simulate(float time, sky::scene::Position *lights);
+
+  /* shared with the GPU side: hash of x in [-0.5;0.5[, starting position
+   * of the i-th lighting firefly, and steps simulated up to time */
+  static float unit(sky::uint x);
+  static sky::scene::Position origin(sky::uint i);
+  static sky::uint steps(float time);
+};
+
+#endif /* guard */
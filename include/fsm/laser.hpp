@@ -6,7 +6,8 @@
 #include <core/shader.hpp>
 #include <core/texture.hpp>
 #include <core/vertex_array.hpp>
-#include <tech/framebuffer_copy.hpp>
+#include <fsm/common.hpp>
+#include <render_graph.hpp>
 #include <tech/post_process.hpp>
 
 class Laser {
@@ -15,24 +16,23 @@ class Laser {
   sky::core::Program::Uniform _projIndex;
   sky::core::Program::Uniform _viewIndex;
   sky::core::Program::Uniform _timeIndex;
-  sky::core::Texture _offtexture[2];
   sky::core::Texture _laserTexture;
-  sky::core::Framebuffer _pingpong[2];
-  sky::core::Renderbuffer _rb;
-  sky::tech::DefaultFramebufferCopy _fbCopier; /* TODO: to move away from here */
   sky::tech::PostProcess _hblur;
   sky::tech::PostProcess _vblur;
+  sky::ushort _blurPasses;
 
   void _init_va(void);
   void _init_program(void);
   void _init_uniforms(sky::ushort tessLvl, float hheight);
-  void _init_texture(sky::ushort width, sky::ushort height);
+  void _init_texture(void);
 
 public :
-  Laser(sky::ushort width, sky::ushort height, sky::ushort tessLvl, float hheight);
+  Laser(sky::ushort width, sky::ushort height, sky::ushort tessLvl, float hheight, sky::ushort blurPasses);
   ~Laser(void) = default;
 
-  void render(float time, sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::ushort n) const;
+  /* lines into a transient target, blurred; returns that target, to be
+   * added onto the scene */
+  RenderGraph::Target add_passes(RenderGraph &graph, FrameView const &frame, sky::ushort n);
 };
 
 #endif /* guard */
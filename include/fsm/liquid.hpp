@@ -10,15 +10,25 @@ class Liquid {
   sky::core::Program::Uniform _projIndex;
   sky::core::Program::Uniform _viewIndex;
   sky::core::Program::Uniform _timeIndex;
+  /* depth pre-pass: position only */
+  sky::core::Program _depthSp;
+  sky::core::Program::Uniform _depthProjIndex;
+  sky::core::Program::Uniform _depthViewIndex;
+  sky::core::Program::Uniform _depthTimeIndex;
 
   void _init_program(void);
   void _init_uniforms(void);
+  void _init_depth_program(void);
 
 public :
   Liquid(sky::uint width, sky::uint height, sky::uint twidth, sky::uint theight);
   ~Liquid(void) = default;
 
   void render(float time, sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::uint n) const;
+  void render_depth(float time, sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::uint n) const;
+
+  /* from eye to the rest level of the surface */
+  float distance(float const *eye) const;
 };
 
 #endif /* guard */
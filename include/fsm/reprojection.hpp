@@ -0,0 +1,34 @@
+#ifndef __FSM_REPROJECTION_HPP
+#define __FSM_REPROJECTION_HPP
+
+#include <core/shader.hpp>
+#include <core/vertex_array.hpp>
+#include <lang/primtypes.hpp>
+#include <math/matrix.hpp>
+
+/* Fills the pixels a frame didn't shade from the last frame: each one is
+ * looked up where the velocity buffer says it was, and kept only if the
+ * depth seen there by the last frame is the one expected from its motion,
+ * and the surface there moved as it does. Rejected pixels average the
+ * matching texels around, up to 4 texels out, and failing that blend the
+ * nearest ones by depth. Reads
+ * the last frame's colors, this frame's velocities and the last frame's,
+ * from texture units 0, 1 and 2. */
+class Reprojection {
+  sky::core::VertexArray _va;
+  sky::core::Program _sp;
+  sky::core::Program::Uniform _projIndex;
+  sky::core::Program::Uniform _viewIndex;
+  sky::core::Program::Uniform _lastViewIndex;
+
+  void _init_program(void);
+  void _init_uniforms(sky::ushort width, sky::ushort height);
+
+public :
+  Reprojection(sky::ushort width, sky::ushort height);
+  ~Reprojection(void) = default;
+
+  void render(sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::math::Mat44 const &lastView) const;
+};
+
+#endif /* guard */
@@ -6,7 +6,9 @@
 #include <core/texture.hpp>
 #include <core/vertex_array.hpp>
 
+/* Six walls of 100 slabs each, around the cube room. */
 class Slab {
+  float _size;
   sky::core::Buffer _ibo;
   sky::core::VertexArray _va;
   sky::core::Texture _texture;
@@ -14,18 +16,33 @@ class Slab {
   sky::core::Program::Uniform _projIndex;
   sky::core::Program::Uniform _viewIndex;
   sky::core::Program::Uniform _timeIndex;
+  /* depth pre-pass: position only, no geometry shader */
+  sky::core::Program _depthSp;
+  sky::core::Program::Uniform _depthProjIndex;
+  sky::core::Program::Uniform _depthViewIndex;
+  sky::core::Program::Uniform _depthWallsIndex;
 
   void _init_ibo(void);
   void _init_va(void);
   void _init_texture(uint width, uint height);
   void _init_program(void);
   void _init_uniforms(float size, float thickness);
+  void _init_depth_program(float size, float thickness);
 
 public :
+  static sky::uint const WALLS = 6;
+
   Slab(uint width, uint height, float size, float thickness);
   ~Slab(void) = default;
 
   void render(float time, sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::uint n) const;
+  /* walls in the given order, front to back for the pre-pass to pay off */
+  void render_depth(sky::math::Mat44 const &proj, sky::math::Mat44 const &view, sky::uint const *walls, sky::uint n) const;
+
+  /* distance from eye to the plane of a wall */
+  float wall_distance(float const *eye, sky::uint wall) const;
+  /* WALLS indices, nearest first */
+  void sort_walls(float const *eye, sky::uint *walls) const;
 };
 
 #endif /* guard */
@@ -1,36 +1,76 @@
 #ifndef __FSM_STAIRWAY_HPP
 #define __FSM_STAIRWAY_HPP
 
+#include <vector>
 #include <core/shader.hpp>
 #include <core/texture.hpp>
+#include <frame_pipeline.hpp>
 #include <fsm/cave.hpp>
+#include <fsm/checkerboard.hpp>
 #include <fsm/common.hpp>
 #include <fsm/fireflies.hpp>
+#include <fsm/reprojection.hpp>
+#include <render_graph.hpp>
 #include <scene/freefly.hpp>
 #include <scene/material_manager.hpp>
 #include <sync/parts_fsm.hpp>
+#include <text_batch.hpp>
 #include <tech/deferred_renderer.hpp>
 #include <tech/post_process.hpp>
 
 class Stairway : public sky::sync::FinalPartState {
+  struct Frame {
+    FrameView view;
+    float caveMorph;
+    std::vector<Terrain::Node> caveNodes;
+    float firefliesTime; /* simulation epoch */
+    sky::scene::Position lights[Fireflies::FIREFLIES_LIGHTS];
+    TextBatch::Span texts;
+  };
+
   sky::ushort _width, _height;
   sky::scene::Freefly const &_freefly;
+  Tile const &_tile;
   sky::tech::DeferredRenderer &_drenderer;
   sky::scene::MaterialManager &_matmgr;
-  sky::glyph::StringRenderer &_stringRenderer;
+  EventTrack const &_start;
+  CameraTrack const &_camera;
+  ScalarTrack const &_caveMorph;
+  EventTrack const &_textCues;
   sky::core::Program::Uniform _matmgrProjIndex;
   sky::core::Program::Uniform _matmgrViewIndex;
   sky::core::Program::Uniform _matmgrLColorIndex;
   sky::core::Program::Uniform _matmgrLPosIndex;
+  sky::core::Program::Uniform _matmgrCheckerIndex;
 
   Cave _cave;
   Fireflies _fireflies;
+  TextBatch _texts;
+  /* reprojection: the cave is shaded by halves, alternating every frame */
+  bool _reproject;
+  Reprojection _reprojection;
+  /* checkerboard: lights go to half of the pixels, alternating every frame */
+  bool _checkerboard;
+  Checkerboard _checker;
+  int _half;                   /* shaded this frame, or FULL */
+  int _parity;                 /* of the checkerboard blocks lit this frame */
+  bool _drawn;                 /* the last frame was drawn */
+  bool _continuous;            /* and is close enough to reproject from */
+  float _lastTime;
+  sky::math::Mat44 _lastView;
+  RenderGraph _graph;
+  FramePipeline<Frame> _pipeline; /* last: waits for the worker before the rest goes */
 
   void _init_materials(void);
-  void _draw_texts(float t) const;
+  void _init_texts(void);
+  void _init_graph(void);
+  void _prepare(float time, Frame &frame);
+  void _draw_texts(Frame const &frame) const;
+  void _scissor(int half) const;
+  void _unscissor(void) const;
 
 public :
-  Stairway(sky::ushort width, sky::ushort height, Common &common, sky::scene::Freefly const &freefly);
+  Stairway(sky::ushort width, sky::ushort height, Common &common, sky::scene::Freefly const &freefly, bool reproject, bool checkerboard);
   ~Stairway(void) = default;
 
   void run(float time) override;
@@ -0,0 +1,13 @@
+#ifndef __FSM_SYNC_HPP
+#define __FSM_SYNC_HPP
+
+#include <timeline.hpp>
+
+char const * const SYNC_FILE = "evoke2013.sync";
+
+/* (Re)build the tracks of the intro: the built-in ones first, then those
+ * overridden by SYNC_FILE when there is one. The song must be set. */
+void init_timeline(Timeline &timeline);
+
+#endif /* guard */
+
@@ -0,0 +1,61 @@
+#ifndef __FSM_TERRAIN_HPP
+#define __FSM_TERRAIN_HPP
+
+#include <vector>
+#include <core/buffer.hpp>
+#include <core/shader.hpp>
+#include <core/vertex_array.hpp>
+#include <lang/primtypes.hpp>
+#include <math/matrix.hpp>
+
+/* CDLOD terrain: a quadtree of square nodes selected against the eye
+ * distance and the view frustum, all drawn with a single shared grid patch.
+ * Nodes that straddle two LOD ranges are drawn by quarter, and the vertex
+ * shader morphs each vertex toward the coarser grid as it gets farther,
+ * so that adjacent levels always meet without cracks. */
+class Terrain {
+public :
+  /* parts of the shared patch; QUARTERS first, then the full patch */
+  static sky::ushort const QUARTERS = 4;
+  static sky::ushort const FULL     = 4;
+
+  struct Node {
+    float x, z;        /* lower corner */
+    float size;        /* size of the full node */
+    sky::ushort level; /* LOD level, 0 being the finest */
+    sky::ushort part;  /* quarter index, or FULL */
+  };
+
+private :
+  float _size;
+  sky::ushort _gridRes;
+  sky::ushort _levels;
+  std::vector<float> _ranges;   /* visibility range per level */
+  std::vector<float> _morphs;   /* morph start, 1 / (end - start) per level */
+  sky::core::Buffer _vbo;
+  sky::core::Buffer _ibo[FULL+1];
+  sky::core::VertexArray _va[FULL+1];
+  sky::uint _indicesNb[FULL+1];
+
+  void _init_ranges(float lodRange);
+  void _init_patch(void);
+  bool _select(float x, float z, float size, sky::ushort level, float const *eye, float const (*planes)[4], float ymin, float ymax, std::vector<Node> &selection) const;
+
+public :
+  Terrain(float size, sky::ushort gridRes, sky::ushort levels, float lodRange);
+  ~Terrain(void) = default;
+
+  /* select the nodes visible from view; ymin and ymax bound the heights.
+   * No GL involved: safe off the render thread */
+  void select(sky::math::Mat44 const &proj, sky::math::Mat44 const &view, float ymin, float ymax, std::vector<Node> &selection) const;
+  /* draw a selection, pushing per-node node/morph uniforms */
+  void render(std::vector<Node> const &selection, sky::core::Program::Uniform const &nodeIndex, sky::core::Program::Uniform const &morphIndex, sky::uint inst) const;
+
+  sky::ushort grid_res(void) const;
+  static void eye_position(sky::math::Mat44 const &view, float *eye);
+  /* shared patch geometry: (res+1)^2 xz vertices in [0;1] and indices per part */
+  static void gen_patch(sky::ushort res, std::vector<float> &vertices, std::vector<sky::uint> (&indices)[FULL+1]);
+};
+
+#endif /* guard */
+
@@ -0,0 +1,12 @@
+#ifndef __GL_HPP
+#define __GL_HPP
+
+/* raw GL entry points, for what the skyoralis wrappers don't expose */
+#ifndef GL_GLEXT_PROTOTYPES
+# define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#endif /* guard */
+
@@ -0,0 +1,80 @@
+#ifndef __GL_STATS_HPP
+#define __GL_STATS_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include <lang/primtypes.hpp>
+
+/* GL work issued by the intro's own code, counted by the state cache it
+ * goes through (gSC). Draws by skyoralis helpers are counted once per call
+ * to them. */
+struct GLCounters {
+  sky::uint draws;
+  sky::uint programs;     /* program switches */
+  sky::uint textures;     /* texture binds */
+  sky::uint framebuffers; /* framebuffer binds */
+  sky::uint uniforms;     /* uniform pushes */
+  sky::uint elided;       /* state changes dropped by the state cache */
+  sky::uint samples;      /* passing the depth test, a few frames late (SampleQuery) */
+  std::size_t uploaded;   /* bytes sent to buffers and textures */
+};
+
+/* Counters of the current frame, as a whole and per render graph pass.
+ * Work done outside passes only shows in the frame's. */
+class GLStats {
+public :
+  /* told the name of each pass begun, none when it ends */
+  typedef void (*PassMarker)(char const *name);
+
+private :
+  struct PassCounters {
+    char const *name;
+    GLCounters counters;
+  };
+
+  GLCounters _frame;
+  std::vector<PassCounters> _passes;
+  bool _inPass;
+  bool _sampling;      /* SampleQuery counts */
+  PassMarker _marker;  /* e.g. the GL recorder's, see FrameCapture */
+
+  void _add(sky::uint GLCounters::*counter, sky::uint n);
+
+public :
+  GLStats(void);
+  ~GLStats(void) = default;
+
+  void mark_passes(PassMarker marker);
+  /* occlusion queries cost a little even unread: off unless shown */
+  void count_samples(bool on);
+  bool counting_samples(void) const;
+
+  void begin_frame(void);
+  /* until the next pass, or the end of the frame */
+  void begin_pass(char const *name);
+  void end_pass(void);
+
+  void draw(sky::uint n = 1);
+  void program(void);
+  void texture(void);
+  void framebuffer(void);
+  void uniform(void);
+  void elided(void);
+  void samples(sky::uint n);
+  void upload(std::size_t bytes);
+
+  GLCounters const & frame(void) const;
+  sky::uint passes(void) const;
+  char const * pass_name(sky::uint i) const;
+  GLCounters const & pass(sky::uint i) const;
+
+  /* one row per pass, then one for the whole frame */
+  static void csv_header(std::ostream &out);
+  void csv(std::ostream &out, float time) const;
+};
+
+extern GLStats gStats;
+
+#endif /* guard */
+
@@ -0,0 +1,220 @@
+#ifndef __GL_TRACE_HPP
+#define __GL_TRACE_HPP
+
+#include <cstdint>
+
+/* GL call streams, as the recorder (libgltrace.so, preloaded into the
+ * intro) writes them and the replay tool reads them back.
+ *
+ * The recorder stands in for the GL entry points below: the intro's and
+ * skyoralis' calls go through it to libGL, and it writes down each one
+ * with its arguments and the data it reads, textures and buffers uploaded
+ * included. Calls not listed go to libGL unrecorded: getters, and what
+ * neither the intro nor skyoralis calls. Recording starts with the
+ * process, since the frames need what was set up before them; the intro
+ * (FrameCapture) names the file, marks frames and passes, and stops it
+ * after the last frame captured.
+ *
+ * The file is a TraceHeader then one record per call: its TraceCall as a
+ * 16-bit word, then its arguments, by kind:
+ *
+ *   i          32 bits: enums, ints, sizes, booleans, bitfields
+ *   f, d       float, double
+ *   p          64 bits: pointer-sized ints, buffer offsets as pointers
+ *   B T F R V  buffer, texture, framebuffer, renderbuffer, vertex array,
+ *   Q S P H    query, sampler, program or shader name, 32 bits
+ *   L          uniform location, in the program in use, 32 bits
+ *   K          uniform block index, in the program passed, 32 bits
+ *   Y          sync object, 64 bits
+ *   [x         array of names of kind x: a count then the names
+ *   *          data read: a byte, 0 for none, 1 for a buffer offset then
+ *              64 bits, 2 for bytes then a 32-bit size and them
+ *   >          data written: as *, but its size without the bytes
+ *   z          NUL-terminated string: its 32-bit size, NUL included, then it
+ *
+ * A '=' is followed by the kind of what the call returns, written after
+ * the arguments. Kinds starting with '!' are those of calls doing GPU work
+ * (draws, clears, blits), which the replay tool times and can skip; with
+ * '+', the array holds names the call generates.
+ *
+ * Names are the ones the recorded process got; the replay tool maps them
+ * to its own. Everything is as laid out in memory: a trace is read back
+ * on the same machine. */
+#define GL_TRACE_CALLS(X) \
+  X(glActiveTexture,               "i") \
+  X(glAttachShader,                "PH") \
+  X(glBeginConditionalRender,      "Qi") \
+  X(glBeginQuery,                  "iQ") \
+  X(glBeginTransformFeedback,      "i") \
+  X(glBindAttribLocation,          "Piz") \
+  X(glBindBuffer,                  "iB") \
+  X(glBindBufferBase,              "iiB") \
+  X(glBindBufferRange,             "iiBpp") \
+  X(glBindFragDataLocation,        "Piz") \
+  X(glBindFramebuffer,             "iF") \
+  X(glBindRenderbuffer,            "iR") \
+  X(glBindSampler,                 "iS") \
+  X(glBindTexture,                 "iT") \
+  X(glBindVertexArray,             "V") \
+  X(glBlendColor,                  "ffff") \
+  X(glBlendEquation,               "i") \
+  X(glBlendEquationSeparate,       "ii") \
+  X(glBlendFunc,                   "ii") \
+  X(glBlendFuncSeparate,           "iiii") \
+  X(glBlitFramebuffer,             "!iiiiiiiiii") \
+  X(glBufferData,                  "ip*i") \
+  X(glBufferSubData,               "ipp*") \
+  X(glClear,                       "!i") \
+  X(glClearBufferfi,               "!iifi") \
+  X(glClearBufferfv,               "!ii*") \
+  X(glClearBufferiv,               "!ii*") \
+  X(glClearBufferuiv,              "!ii*") \
+  X(glClearColor,                  "ffff") \
+  X(glClearDepth,                  "d") \
+  X(glClearStencil,                "i") \
+  X(glClientWaitSync,              "Yip=i") \
+  X(glColorMask,                   "iiii") \
+  X(glCompileShader,               "H") \
+  X(glCopyBufferSubData,           "iippp") \
+  X(glCopyTexSubImage2D,           "!iiiiiiii") \
+  X(glCreateProgram,               "=P") \
+  X(glCreateShader,                "i=H") \
+  X(glCullFace,                    "i") \
+  X(glDeleteBuffers,               "i[B") \
+  X(glDeleteFramebuffers,          "i[F") \
+  X(glDeleteProgram,               "P") \
+  X(glDeleteQueries,               "i[Q") \
+  X(glDeleteRenderbuffers,         "i[R") \
+  X(glDeleteSamplers,              "i[S") \
+  X(glDeleteShader,                "H") \
+  X(glDeleteSync,                  "Y") \
+  X(glDeleteTextures,              "i[T") \
+  X(glDeleteVertexArrays,          "i[V") \
+  X(glDepthFunc,                   "i") \
+  X(glDepthMask,                   "i") \
+  X(glDepthRange,                  "dd") \
+  X(glDetachShader,                "PH") \
+  X(glDisable,                     "i") \
+  X(glDisableVertexAttribArray,    "i") \
+  X(glDrawArrays,                  "!iii") \
+  X(glDrawArraysInstanced,         "!iiii") \
+  X(glDrawBuffer,                  "i") \
+  X(glDrawBuffers,                 "i*") \
+  X(glDrawElements,                "!iiip") \
+  X(glDrawElementsBaseVertex,      "!iiipi") \
+  X(glDrawElementsInstanced,       "!iiipi") \
+  X(glDrawRangeElements,           "!iiiiip") \
+  X(glEnable,                      "i") \
+  X(glEnableVertexAttribArray,     "i") \
+  X(glEndConditionalRender,        "") \
+  X(glEndQuery,                    "i") \
+  X(glEndTransformFeedback,        "") \
+  X(glFenceSync,                   "ii=Y") \
+  X(glFinish,                      "") \
+  X(glFlush,                       "") \
+  X(glFlushMappedBufferRange,      "ipp") \
+  X(glFramebufferRenderbuffer,     "iiiR") \
+  X(glFramebufferTexture,          "iiTi") \
+  X(glFramebufferTexture2D,        "iiiTi") \
+  X(glFramebufferTextureLayer,     "iiTii") \
+  X(glFrontFace,                   "i") \
+  X(glGenBuffers,                  "+i[B") \
+  X(glGenFramebuffers,             "+i[F") \
+  X(glGenQueries,                  "+i[Q") \
+  X(glGenRenderbuffers,            "+i[R") \
+  X(glGenSamplers,                 "+i[S") \
+  X(glGenTextures,                 "+i[T") \
+  X(glGenVertexArrays,             "+i[V") \
+  X(glGenerateMipmap,              "!i") \
+  X(glGetUniformBlockIndex,        "Pz=K") \
+  X(glGetUniformLocation,          "Pz=L") \
+  X(glHint,                        "ii") \
+  X(glLineWidth,                   "f") \
+  X(glLinkProgram,                 "P") \
+  X(glMapBuffer,                   "ii") \
+  X(glMapBufferRange,              "ippi") \
+  X(glPixelStorei,                 "ii") \
+  X(glPointSize,                   "f") \
+  X(glPolygonMode,                 "ii") \
+  X(glPolygonOffset,               "ff") \
+  X(glPrimitiveRestartIndex,       "i") \
+  X(glProvokingVertex,             "i") \
+  X(glQueryCounter,                "Qi") \
+  X(glReadBuffer,                  "i") \
+  X(glReadPixels,                  "!iiiiii>") \
+  X(glRenderbufferStorage,         "iiii") \
+  X(glRenderbufferStorageMultisample, "iiiii") \
+  X(glSamplerParameterf,           "Sif") \
+  X(glSamplerParameteri,           "Sii") \
+  X(glScissor,                     "iiii") \
+  X(glShaderSource,                "Hz") \
+  X(glStencilFunc,                 "iii") \
+  X(glStencilMask,                 "i") \
+  X(glStencilOp,                   "iii") \
+  X(glTexBuffer,                   "iiB") \
+  X(glTexImage1D,                  "iiiiiii*") \
+  X(glTexImage2D,                  "iiiiiiii*") \
+  X(glTexImage2DMultisample,       "iiiiii") \
+  X(glTexImage3D,                  "iiiiiiiii*") \
+  X(glTexParameterf,               "iif") \
+  X(glTexParameterfv,              "ii*") \
+  X(glTexParameteri,               "iii") \
+  X(glTexParameteriv,              "ii*") \
+  X(glTexSubImage2D,               "iiiiiiii*") \
+  X(glTexSubImage3D,               "iiiiiiiiii*") \
+  X(glTransformFeedbackVaryings,   "Pi*i") \
+  X(glUniform1f,                   "Lf") \
+  X(glUniform1fv,                  "Li*") \
+  X(glUniform1i,                   "Li") \
+  X(glUniform1iv,                  "Li*") \
+  X(glUniform1ui,                  "Li") \
+  X(glUniform2f,                   "Lff") \
+  X(glUniform2fv,                  "Li*") \
+  X(glUniform2i,                   "Lii") \
+  X(glUniform2iv,                  "Li*") \
+  X(glUniform3f,                   "Lfff") \
+  X(glUniform3fv,                  "Li*") \
+  X(glUniform3i,                   "Liii") \
+  X(glUniform3iv,                  "Li*") \
+  X(glUniform4f,                   "Lffff") \
+  X(glUniform4fv,                  "Li*") \
+  X(glUniform4i,                   "Liiii") \
+  X(glUniform4iv,                  "Li*") \
+  X(glUniformBlockBinding,         "PKi") \
+  X(glUniformMatrix2fv,            "Lii*") \
+  X(glUniformMatrix3fv,            "Lii*") \
+  X(glUniformMatrix4fv,            "Lii*") \
+  X(glUnmapBuffer,                 "i*") \
+  X(glUseProgram,                  "P") \
+  X(glVertexAttribDivisor,         "ii") \
+  X(glVertexAttribIPointer,        "iiiip") \
+  X(glVertexAttribPointer,         "iiiiip") \
+  X(glViewport,                    "iiii") \
+  X(glWaitSync,                    "Yip")
+
+enum TraceCall : std::uint16_t {
+#define TRACE_CALL(name, kinds) CALL_##name,
+  GL_TRACE_CALLS(TRACE_CALL)
+#undef TRACE_CALL
+  CALL_FRAME, /* a frame begins: its time, "f" */
+  CALL_PASS,  /* a render graph pass begins: its name, "z" */
+  TRACE_CALLS
+};
+
+struct TraceHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint16_t width, height;
+};
+
+char const TRACE_MAGIC[4]          = { 'E', 'V', 'G', 'T' };
+std::uint32_t const TRACE_VERSION = 1;
+
+/* what the recorder exports, for FrameCapture to look up; none is there
+ * when it isn't preloaded */
+typedef bool (*TraceOpen)(char const *path, std::uint16_t width, std::uint16_t height);
+typedef void (*TraceFrame)(float time);
+typedef void (*TracePass)(char const *name);
+typedef void (*TraceClose)(void);
+
+#endif /* guard */
@@ -0,0 +1,34 @@
+#ifndef __GLYPH_ATLAS_HPP
+#define __GLYPH_ATLAS_HPP
+
+#include <vector>
+#include <lang/primtypes.hpp>
+
+/* Signed distance field atlas of the packed glyphs of font.hpp. Each glyph
+ * is unpacked, turned into an exact euclidean SDF with a spread-pixel
+ * border, and packed in shelves into a single 8-bit texture image where
+ * 0.5 is the glyph edge. Glyphs are processed in parallel. */
+struct GlyphAtlas {
+  struct Glyph {
+    sky::ushort x, y; /* lower left corner of the cell, border included */
+    sky::ushort w, h; /* bitmap size, border excluded; 0 if missing */
+  };
+
+  sky::ushort width, height;
+  sky::ushort spread;
+  std::vector<sky::ubyte> pixels;
+  std::vector<Glyph> glyphs; /* one per entry of the glyphs index */
+
+  GlyphAtlas(sky::ubyte const * const *index, sky::ushort nb, sky::ushort spread, sky::ushort width = 512);
+  ~GlyphAtlas(void) = default;
+};
+
+/* unpack a glyph bitstream into one byte per pixel (0 or 0xFF), rows of
+ * width pixels; dst must hold width*height + 15 bytes */
+void unpack_glyph(sky::ubyte const *packed, sky::ubyte *dst);
+
+/* SDF of an unpacked w*h glyph, into a (w+2*spread)*(h+2*spread) image */
+void glyph_sdf(sky::ubyte const *bitmap, sky::ushort w, sky::ushort h, sky::ushort spread, sky::ubyte *dst);
+
+#endif /* guard */
+
@@ -1,26 +1,48 @@
 #ifndef __INTRO_HPP
 #define __INTRO_HPP
 
+#include <fstream>
+#include <vector>
+#include <audio_analyzer.hpp>
 #include <core/context.hpp>
+#include <frame_capture.hpp>
 #include <fsm/common.hpp>
 #include <lang/primtypes.hpp>
+#include <options.hpp>
 #include <scene/freefly.hpp>
 #include <sync/parts_fsm.hpp>
-#include <track/synthesizer.hpp>
+#include <tiled_image.hpp>
+#include <xm_synthesizer.hpp>
 
 class Intro {
+  Options _options;
+  std::ofstream _bench;
+  TiledImage _image; /* offline output */
   sky::core::Context _cntxt;
-  sky::track::Synthesizer _synth;
+  XMSynthesizer _synth;
   Common  _com;
   /* debug part */
   sky::scene::Freefly _freefly;
   /* fsm part */
   sky::sync::PartsFSM *_pFSM;
+  FrameCapture *_capture;
 
   void _init_materials(sky::ushort width, sky::ushort height);
+  void _load_song(void);
+  void _draw_stats(void) const;
+  void _place_tile(sky::uint i);
+  int _calibrate(sky::ushort width, sky::ushort height);
+  double _time_tier(sky::ushort width, sky::ushort height, float const *times, std::vector<AudioFeatures> const &song);
+  double _time_frames(sky::sync::PartState &part, float time, std::vector<AudioFeatures> const &song);
+  int _first_frame(void) const;
+  int _last_frame(void);
+  void _offline_frame(int frame, std::vector<AudioFeatures> const &song);
+  bool _render_range(int first, int last, std::vector<AudioFeatures> const &song, bool stream);
+  void _render(void);
+  void _export(void);
 
 public :
-  Intro(sky::ushort width, sky::ushort height, bool full, char const *title);
+  Intro(sky::ushort width, sky::ushort height, bool full, char const *title, Options const &options);
   ~Intro(void);
 
   void run(void);
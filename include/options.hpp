@@ -0,0 +1,80 @@
+#ifndef __OPTIONS_HPP
+#define __OPTIONS_HPP
+
+#include <lang/primtypes.hpp>
+
+/* Switches of the intro itself. They are taken out of the command line
+ * before the rest goes to skyoralis:
+ *
+ *   --stats          overlay of the GL counters of the frame and its passes
+ *   --bench <file>   same counters, every frame, as CSV
+ *   --reproject      cave shaded by alternating halves, the other half
+ *                    reprojected from the last frame
+ *   --checkerboard   cave lit on half of its pixels, alternating every
+ *                    frame, the others reconstructed
+ *   --prepass        depth pre-pass before the cube room's G-buffer, with
+ *                    the overdraw it saves in the stats' samples
+ *   --capture <file> GL calls of the frames drawn, with their arguments
+ *                    and uploads, for the replay tool to issue again; the
+ *                    intro runs itself again with the recorder preloaded
+ *                    (FrameCapture), in a single process
+ *   --capture-at <from>[:<to>]
+ *                    frames captured, in s: the first one from on only
+ *                    when to is missing; all of them by default
+ *   --render <file>  offline: frames drawn at a fixed step, not shown but
+ *                    written as binary PPM; a printf pattern in the name,
+ *                    e.g. frame%05d.ppm, numbers them, else they follow
+ *                    each other in the file, - being stdout
+ *   --render-at <from>[:<to>]
+ *                    frames rendered, in s, as for --capture-at
+ *   --render-feed    with --render: frames rendered by ranges read from
+ *                    stdin instead, "<first> <last>" frame numbers a line,
+ *                    in order, until its end; how RenderFarm feeds workers
+ *   --fps <n>        step of the offline clock, 60 by default
+ *   --tiles <c>x<r>  offline image c by r times the size given, drawn in
+ *                    tiles of that size plus a guard band, with bounded
+ *                    memory; no reprojection nor checkerboard then
+ *   --warmup <n>     offline: frames drawn, not written, before the first
+ *                    one, for what needs a last frame
+ *   --workers <n>    offline: frames spread over n processes (RenderFarm)
+ *   --video <file>   offline, as --render, but the frames as a Y4M stream,
+ *                    or raw 4:2:0 planes to a .yuv file; no tiles then
+ *   --audio <file>   with --video: the song under the frames, as WAV
+ *   --quality <tier> low, medium, high (default) or ultra, see Quality;
+ *                    auto: the highest whose frames fit --refresh, timed
+ *                    at startup; offline, high
+ *   --refresh <hz>   what auto quality aims at, 60 by default */
+struct Options {
+  bool stats;
+  char const *bench;
+  bool reproject;
+  bool checkerboard;
+  bool prepass;
+  char const *capture;
+  float captureFrom, captureTo;
+  char const *render;
+  float renderFrom, renderTo;
+  bool renderFeed;
+  int fps;
+  sky::uint columns, rows; /* tiles */
+  int warmup;
+  int workers;
+  char const *video;
+  char const *audio;
+  int quality;             /* tier */
+  float refresh;
+
+  Options(void);
+  ~Options(void) = default;
+};
+
+/* false on a switch missing its argument */
+bool parse_options(int &argc, char **argv, Options &options);
+
+/* offline frame at or after time (side 1), or at or before it (side -1);
+ * a thousandth of a frame off still counts as on it, for times printed
+ * from frame numbers */
+int frame_at(float time, int fps, int side);
+
+#endif /* guard */
+
@@ -0,0 +1,24 @@
+#ifndef __PAYLOAD_HPP
+#define __PAYLOAD_HPP
+
+#include <cstdint>
+
+/* Layout of a packed release: the loader, then one xz stream holding a
+ * PayloadHeader, the intro binary and the song, then a PayloadTrailer.
+ * The loader unpacks into memory only and tells the intro where its song
+ * is with the PAYLOAD_SONG_FD environment variable. */
+char const PAYLOAD_MAGIC[8] = { 'E', 'V', 'K', '2', '0', '1', '3', '\0' };
+char const * const PAYLOAD_SONG_FD = "EVOKE2013_SONG_FD";
+
+struct PayloadHeader {
+  std::uint64_t binarySize;
+  std::uint64_t songSize;
+};
+
+struct PayloadTrailer {
+  std::uint64_t size; /* of the xz stream */
+  char magic[8];
+};
+
+#endif /* guard */
+
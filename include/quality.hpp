@@ -0,0 +1,32 @@
+#ifndef __QUALITY_HPP
+#define __QUALITY_HPP
+
+#include <lang/primtypes.hpp>
+
+/* What the parts scale their cost with, by tier: from a laptop's GPU up
+ * to more than the party machine needs. High is what the intro shipped
+ * with. The cube room always has its 600 slabs: fewer would leave holes in
+ * its walls. */
+struct Quality {
+  sky::ushort laserTessLevel;
+  sky::ushort laserBlur;       /* passes */
+  sky::ushort liquidTess;      /* quads per side */
+  sky::uint caveTex;           /* heightmaps side */
+  sky::uint fireflies;         /* no less than the lighting ones */
+};
+
+enum QualityTier {
+  QUALITY_LOW,
+  QUALITY_MEDIUM,
+  QUALITY_HIGH,
+  QUALITY_ULTRA,
+  QUALITY_TIERS,
+  QUALITY_AUTO = -1            /* picked at startup, see Intro */
+};
+
+Quality const & quality_tier(int tier);
+char const * quality_name(int tier);
+/* QUALITY_AUTO for auto, QUALITY_TIERS if unknown */
+int quality_from_name(char const *name);
+
+#endif /* guard */
@@ -0,0 +1,65 @@
+#ifndef __RENDER_FARM_HPP
+#define __RENDER_FARM_HPP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <lang/primtypes.hpp>
+#include <options.hpp>
+
+/* Offline rendering (--render) spread over local processes. --workers
+ * workers are started once, each the intro run again with its own context
+ * and fixed-step clock, drawing to one file a frame in a scratch
+ * directory. Frames are cut into chunks of consecutive ones, dealt round
+ * the workers in turn and fed to them over a pipe (--render-feed): no
+ * worker gets further ahead of the output than two chunks, so that the
+ * scratch directory stays bound, and one that has nothing to draw waits
+ * on its pipe. Frames go to the output in order as soon as they are
+ * whole, then are removed.
+ *
+ * What a frame draws only depends on its time, but for what reprojection
+ * keeps of the last frame: workers draw WARMUP frames before each chunk
+ * for it. Which half the cave shades still alternates from there, so the
+ * frames match those of one process up to the phase of the alternation.
+ *
+ * The song unpacked by the loader is taken from the environment at once;
+ * only workers get its descriptor back, each explicitly before its exec. */
+class RenderFarm {
+  struct Worker {
+    pid_t pid;       /* -1 once done */
+    int feed;        /* its stdin, -1 once closed */
+  };
+
+  struct Chunk {
+    int first, last;
+  };
+
+  Options const &_options;
+  std::vector<std::string> _args; /* for skyoralis, passed on to workers */
+  std::vector<Worker> _workers;
+  std::vector<Chunk> _chunks;     /* the i-th one to worker i % workers */
+  std::string _dir;               /* scratch */
+  std::FILE *_out;                /* stream output, if no pattern */
+  int _song;                      /* the loader's song, or -1 */
+
+  float _song_end(void) const;
+  bool _start(Worker &worker);
+  void _feed(sky::uint chunk);
+  bool _reap(void);
+  bool _ready(int frame) const;
+  bool _emit(int frame);
+  void _stop(void);
+
+public :
+  /* argv as left by parse_options */
+  RenderFarm(Options const &options, int argc, char **argv);
+  ~RenderFarm(void);
+  RenderFarm(RenderFarm const &) = delete;
+  RenderFarm & operator=(RenderFarm const &) = delete;
+
+  /* false if a worker failed */
+  bool run(void);
+};
+
+#endif /* guard */
@@ -0,0 +1,161 @@
+#ifndef __RENDER_GRAPH_HPP
+#define __RENDER_GRAPH_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <core/framebuffer.hpp>
+#include <core/renderbuffer.hpp>
+#include <core/texture.hpp>
+#include <lang/primtypes.hpp>
+#include <tech/framebuffer_copy.hpp>
+
+/* A frame as a list of passes, each drawing into one target and sampling
+ * others. Parts declare their passes once, in submission order; the graph
+ * then works out the GL traffic of every combination of enabled passes:
+ *
+ *   - passes whose output nobody uses are culled;
+ *   - a clear is only issued if what it clears is used afterwards, and
+ *     color and depth clears of a pass go out as one;
+ *   - transient targets get textures from a pool, and targets whose
+ *     lifetimes don't overlap share them;
+ *   - if the frame ends with a plain copy of a full-size transient target
+ *     to the backbuffer, the passes drawing that target draw into the
+ *     backbuffer instead and the copy goes away;
+ *   - consecutive passes into the same target share one bind.
+ *
+ * Transient targets are RGB32F textures with an optional DEPTH32F plane;
+ * their contents are undefined at the beginning of a frame. History
+ * targets are the same, but keep what they got from one frame to the
+ * next: each has its own two textures, which swap roles at every frame,
+ * and previous() names the one holding the last frame's contents. External
+ * targets, such as the G-buffer, are bound through callbacks. Passes set
+ * their own blending and depth state; the graph leaves it alone, except
+ * for additive copies. */
+class RenderGraph {
+public :
+  typedef sky::uint Target;
+  typedef std::function<void (void)> Callback;
+  typedef std::function<bool (void)> Condition;
+
+  /* what a pass needs of a plane of its output before drawing */
+  enum Load {
+      LOAD    /* previous contents, e.g. blending over them */
+    , CLEAR   /* cleared */
+    , DISCARD /* nothing, the pass covers or clears it itself */
+  };
+
+  static Target const BACKBUFFER = 0;
+
+private :
+  enum Kind { DRAW, COPY, ADD };
+
+  struct TargetDesc {
+    std::string name;
+    sky::ushort width, height;
+    bool external;
+    Callback begin, end;
+    int slot;      /* own slot of a history target, -1 otherwise */
+    bool previous; /* last frame of a history target */
+  };
+
+  struct PassDesc {
+    std::string name;
+    Kind kind;
+    Callback execute;
+    Condition condition;
+    std::vector<Target> reads;
+    Target output;
+    Load color;
+    bool hasDepth;
+    Load depth;
+  };
+
+  struct Slot {
+    sky::ushort width, height;
+    bool hasDepth;
+    int pair;      /* other slot of a history target, -1 otherwise */
+    sky::core::Texture color;
+    sky::core::Renderbuffer depth;
+    sky::core::Framebuffer fb;
+  };
+
+  struct Step {
+    sky::uint pass;
+    Target output;  /* after aliasing */
+    int slot;       /* -1 for the backbuffer and external targets */
+    int clear;      /* state:: buffer bits */
+    std::vector<int> inputs;
+  };
+
+  typedef std::vector<Step> Plan;
+
+  sky::ushort _width, _height;
+  std::vector<TargetDesc> _targets;
+  std::vector<PassDesc> _passes;
+  std::deque<Slot> _slots;
+  std::map<std::uint64_t, Plan> _plans; /* by enabled passes */
+  sky::tech::DefaultFramebufferCopy _copier;
+  bool _flipped; /* history slots swapped */
+
+  Plan _compile(std::uint64_t enabled);
+  int _new_slot(sky::ushort width, sky::ushort height, bool hasDepth);
+  int _slot(sky::ushort width, sky::ushort height, bool hasDepth, std::vector<int> &busyUntil, int first, int last);
+  Slot const & _resolve(int slot) const;
+  void _switch(Step const *from, Step const *to) const;
+  void _run(Plan const &plan) const;
+
+public :
+  /* passes declaration */
+  class Pass {
+    RenderGraph &_graph;
+    sky::uint _index;   /* past the passes if the pass was dropped */
+
+    PassDesc * _desc(void) const;
+
+  public :
+    Pass(RenderGraph &graph, sky::uint index);
+    ~Pass(void) = default;
+
+    /* sampled; the n-th target read is bound to texture unit n, unless
+     * it is external */
+    Pass & reads(Target target);
+    Pass & draws(Target target, Load color);
+    /* depth tested or written */
+    Pass & depth(Load depth);
+    /* evaluated every frame; the pass is skipped when false */
+    Pass & when(Condition const &condition);
+  };
+
+  /* width and height of the backbuffer */
+  RenderGraph(sky::ushort width, sky::ushort height);
+  ~RenderGraph(void) = default;
+
+  /* full-size when no size is given */
+  Target transient(char const *name);
+  Target transient(char const *name, sky::ushort width, sky::ushort height);
+  Target external(char const *name, Callback const &begin, Callback const &end);
+  /* full-size, kept across frames; drawn into as this frame's contents */
+  Target history(char const *name, bool hasDepth = false);
+  /* what history drew in the last frame, for reading only */
+  Target previous(Target history) const;
+  /* what history draws into this frame, for a pass to attach as one more
+   * output of its own target; valid while the graph executes */
+  sky::core::Texture const & texture(Target history) const;
+
+  Pass pass(char const *name, Callback const &execute);
+  /* full-screen copy; an additive one blends onto dst */
+  Pass copy(char const *name, Target src, Target dst, bool additive = false);
+
+  /* compile every combination of conditional passes up front, so that no
+   * texture gets allocated while the intro runs */
+  void prepare(void);
+  /* once per frame: history targets move on */
+  void execute(void);
+};
+
+#endif /* guard */
+
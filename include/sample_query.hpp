@@ -0,0 +1,32 @@
+#ifndef __SAMPLE_QUERY_HPP
+#define __SAMPLE_QUERY_HPP
+
+#include <gl.hpp>
+#include <lang/primtypes.hpp>
+
+/* Samples passing the depth test between begin() and end(), counted by an
+ * occlusion query; divided by the pixels of the target, that's the pass'
+ * overdraw. Only issued while gStats counts samples. Queries go round a
+ * ring of RING, and a result is only read once available, so that reading
+ * it never stalls on the GPU: end() adds the newest count there is to the
+ * current pass of gStats, the same again if none came in since. */
+class SampleQuery {
+  static sky::uint const RING = 4;
+
+  GLuint _queries[RING];
+  bool _issued[RING];  /* and not read yet */
+  sky::uint _current;
+  bool _begun;
+  GLuint _samples;
+
+public :
+  SampleQuery(void);
+  ~SampleQuery(void);
+  SampleQuery(SampleQuery const &) = delete;
+  SampleQuery & operator=(SampleQuery const &) = delete;
+
+  void begin(void);
+  void end(void);
+};
+
+#endif /* guard */
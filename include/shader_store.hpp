@@ -0,0 +1,34 @@
+#ifndef __SHADER_STORE_HPP
+#define __SHADER_STORE_HPP
+
+#include <lang/primtypes.hpp>
+#include <shader_ids.hpp> /* generated by shaderc */
+
+/* The GLSL sources under src/ are the only copy of the shaders: shaderc
+ * minifies them at build time and packs them into one blob, each program
+ * compressed on its own against a dictionary shared by all of them.
+ *
+ * A program is a sequence of LZ blocks: a token byte holding the number
+ * of literals (high nibble) and the match length minus 4 (low nibble),
+ * 15 meaning more follows as bytes added until one is under 255; the
+ * literals; then the little endian 16-bit distance of the match, counted
+ * back through the output preceded by the dictionary. The last block has
+ * literals only. */
+struct ShaderEntry {
+  sky::uint offset, size; /* of the packed program in SHADER_DATA */
+  sky::uint rawSize;
+  sky::uint hash; /* FNV-1a of the minified source */
+};
+
+extern sky::uint const SHADER_DICT_SIZE;
+extern sky::ubyte const SHADER_DICT[];
+extern sky::ubyte const SHADER_DATA[];
+extern ShaderEntry const SHADER_ENTRIES[];
+
+/* expanded on first use, then kept until exit */
+char const * shader_source(ShaderId id);
+/* stable across reformatting of the sources, for caching binaries */
+sky::uint shader_hash(ShaderId id);
+
+#endif /* guard */
+
@@ -0,0 +1,82 @@
+#ifndef __SPSC_RING_HPP
+#define __SPSC_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/* Lock-free single producer, single consumer ring of trivially copyable
+ * items. The capacity is rounded up to a power of two; indices grow
+ * freely and are masked on access. Each side only ever writes its own
+ * index, so neither blocks nor allocates: safe from a real-time thread. */
+template <typename T>
+class SPSCRing {
+  std::vector<T> _items;
+  std::size_t _mask;
+  alignas(64) std::atomic<std::size_t> _head; /* written by the producer */
+  alignas(64) std::atomic<std::size_t> _tail; /* written by the consumer */
+
+  /* copy n items between the ring at index and flat memory */
+  template <typename Copy>
+  void _span(std::size_t index, std::size_t n, Copy copy) const {
+    std::size_t at = index & _mask;
+    std::size_t first = std::min(n, _items.size() - at);
+
+    copy(at, 0, first);
+    copy(0, first, n - first);
+  }
+
+public :
+  explicit SPSCRing(std::size_t capacity) :
+      _mask(0)
+    , _head(0)
+    , _tail(0) {
+    std::size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+    _items.resize(size);
+    _mask = size - 1;
+  }
+
+  std::size_t capacity(void) const {
+    return _items.size();
+  }
+
+  /* producer side */
+  std::size_t writable(void) const {
+    return _items.size() - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire));
+  }
+
+  std::size_t write(T const *src, std::size_t n) {
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    n = std::min(n, _items.size() - (head - _tail.load(std::memory_order_acquire)));
+
+    T *items = _items.data();
+    _span(head, n, [&](std::size_t at, std::size_t from, std::size_t k) {
+      std::copy(src + from, src + from + k, items + at);
+    });
+    _head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  /* consumer side */
+  std::size_t readable(void) const {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+  }
+
+  std::size_t read(T *dst, std::size_t n) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    n = std::min(n, _head.load(std::memory_order_acquire) - tail);
+
+    T const *items = _items.data();
+    _span(tail, n, [&](std::size_t at, std::size_t from, std::size_t k) {
+      std::copy(items + at, items + at + k, dst + from);
+    });
+    _tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+};
+
+#endif /* guard */
+
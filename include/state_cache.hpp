@@ -0,0 +1,119 @@
+#ifndef __STATE_CACHE_HPP
+#define __STATE_CACHE_HPP
+
+#include <cstddef>
+#include <core/buffer.hpp>
+#include <core/framebuffer.hpp>
+#include <core/shader.hpp>
+#include <core/state.hpp>
+#include <core/texture.hpp>
+#include <core/vertex_array.hpp>
+#include <gl.hpp>
+#include <gl_stats.hpp>
+#include <lang/primtypes.hpp>
+
+/* Shadow of the GL state the per-frame code sets: capabilities, blend
+ * function, program, active texture unit and textures per unit. Calls
+ * that would not change anything never reach skyoralis, and are counted.
+ * Unbinding is lazy: a program or texture stays bound until another one
+ * takes its place, so use/unuse pairs around the draws of a pass cost one
+ * call as long as the program doesn't change. A lazy unbind only counts as
+ * dropped once the next bind in its place shows it was not needed.
+ *
+ * Skyoralis helpers that draw on their own (post-processes, the deferred
+ * renderer, the material manager, framebuffer copies) change state behind
+ * the shadow's back: forget() after them, before relying on the shadow
+ * again. The render graph forgets before every pass, so savings don't
+ * carry from a pass to the next, and really unbinds the targets a pass
+ * read once it is done, so that none stays bound while drawn into.
+ * Framebuffers are left to the render graph, which already binds each
+ * target once per run of passes drawing into it.
+ *
+ * Issued program and texture binds, dropped calls and uniform pushes are
+ * counted in gStats, and so are draws and uploads, which the intro's code
+ * issues through here too, raw GL ones included. */
+class StateCache {
+  static sky::uint const MAX_CAPS  = 8;
+  static sky::uint const MAX_UNITS = 16;
+
+  struct CapState {
+    sky::core::state::Cap cap;
+    bool on;
+  };
+
+  CapState _caps[MAX_CAPS];
+  sky::uint _capsNb;          /* known capabilities */
+  bool _blendKnown;
+  sky::core::blending::Func _blendSrc, _blendDst;
+  bool _programKnown;
+  sky::core::Program const *_program;
+  bool _unusePending;         /* unuse() not issued yet */
+  int _unit;                  /* -1 if unknown */
+  bool _textureKnown[MAX_UNITS];
+  sky::core::Texture const *_texture[MAX_UNITS];
+  bool _unbindPending[MAX_UNITS];
+  sky::uint _issued, _elided;
+
+  void _cap(sky::core::state::Cap cap, bool on);
+  bool _count(bool redundant);
+
+public :
+  StateCache(void);
+  ~StateCache(void) = default;
+
+  void enable(sky::core::state::Cap cap);
+  void disable(sky::core::state::Cap cap);
+  void blend_func(sky::core::blending::Func src, sky::core::blending::Func dst);
+
+  void use(sky::core::Program const &program);
+  void unuse(void);
+  /* to the program in use; never dropped, uniforms aren't shadowed */
+  template <typename... Values>
+  void push(sky::core::Program::Uniform const &uniform, Values const &... values);
+
+  void unit(sky::uint unit);
+  /* to the active unit */
+  void bind(sky::core::Texture::Target target, sky::core::Texture const &texture);
+  void unbind(void);
+  /* unbinds the active unit now, not lazily */
+  void release(void);
+
+  /* everything is unknown again */
+  void forget(void);
+
+  /* draws of the bound vertex array */
+  void render(sky::core::VertexArray const &va, sky::core::primitive::Primitive primitive, int first, int count);
+  void indexed_render(sky::core::VertexArray const &va, sky::core::primitive::Primitive primitive, int count, GLT type);
+  void inst_indexed_render(sky::core::VertexArray const &va, sky::core::primitive::Primitive primitive, int count, GLT type, int inst);
+  void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei inst);
+  /* a skyoralis helper drawing on its own: one draw, then forget() */
+  template <typename Helper>
+  void helper(Helper const &draw);
+
+  /* to the buffer bound to ARRAY */
+  void data(std::size_t size, sky::core::Buffer::Usage usage, void const *data);
+  /* a width by height corner of the texture bound to T_2D */
+  void subimage_2D(GLsizei width, GLsizei height, GLenum format, GLenum type, void const *texels, std::size_t size);
+
+  /* calls forwarded and dropped so far */
+  sky::uint issued(void) const;
+  sky::uint elided(void) const;
+};
+
+extern StateCache gSC;
+
+template <typename... Values>
+void StateCache::push(sky::core::Program::Uniform const &uniform, Values const &... values) {
+  uniform.push(values...);
+  gStats.uniform();
+}
+
+template <typename Helper>
+void StateCache::helper(Helper const &draw) {
+  draw();
+  gStats.draw();
+  forget();
+}
+
+#endif /* guard */
+
@@ -0,0 +1,61 @@
+#ifndef __TEXT_BATCH_HPP
+#define __TEXT_BATCH_HPP
+
+#include <vector>
+#include <gl.hpp>
+#include <text_renderer.hpp>
+#include <core/shader.hpp>
+#include <core/vertex_array.hpp>
+#include <lang/primtypes.hpp>
+
+/* Static strings laid out once into a single glyph instance buffer. Each
+ * string scrolls left at its own speed and is only shown in its own time
+ * window; both are resolved in the vertex shader from the time alone, so
+ * rendering is a CPU cull of the strings plus one instanced draw. The cull
+ * needs no GL, so that it can be done ahead of the frame. */
+class TextBatch {
+public :
+  /* glyph instances of the visible strings, empty if first >= last */
+  struct Span {
+    sky::uint first, last;
+  };
+
+private :
+  struct Instance {
+    TextRenderer::GlyphInstance glyph;
+    float t0, speed, start, end; /* scrolling origin and speed, shown in [start;end[ */
+  };
+
+  struct Entry {
+    float x, y, size, width;
+    float t0, speed, start, end;
+    sky::uint first, count; /* glyph instances */
+  };
+
+  TextRenderer const &_renderer;
+  std::vector<Entry> _entries;
+  std::vector<Instance> _instances;
+  sky::core::Buffer _vbo;
+  sky::core::VertexArray _va;
+  sky::core::Program _sp;
+  sky::core::Program::Uniform _timeIndex;
+  sky::core::Program::Uniform _windowIndex;
+
+  void _init_va(void);
+  void _init_program(void);
+  void _point_instances(sky::uint first) const;
+
+public :
+  TextBatch(TextRenderer const &renderer);
+  ~TextBatch(void) = default;
+
+  /* str at x - (t - t0) * speed, shown when t is in [start;end[ */
+  void add(char const *str, float x, float y, float size, float t0, float speed, float start, float end);
+  /* upload the strings added so far */
+  void commit(void);
+  Span cull(float time) const;
+  void render(float time, Span const &span) const;
+};
+
+#endif /* guard */
+
@@ -0,0 +1,59 @@
+#ifndef __TEXT_RENDERER_HPP
+#define __TEXT_RENDERER_HPP
+
+#include <vector>
+#include <gl.hpp>
+#include <glyph_atlas.hpp>
+#include <core/buffer.hpp>
+#include <core/shader.hpp>
+#include <core/texture.hpp>
+#include <core/vertex_array.hpp>
+#include <lang/primtypes.hpp>
+
+/* Draws strings out of a signed distance field atlas of the packed font,
+ * so that glyphs stay sharp at any size. Positions and sizes are in NDC:
+ * (x, y) is the left end of the baseline, size the capitals height. When
+ * the image is drawn in tiles, the window maps its NDC to the tile's. */
+class TextRenderer {
+public :
+  /* one glyph quad: rect in NDC, then its atlas UV rect */
+  struct GlyphInstance {
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+  };
+
+private :
+  float _aspect;    /* of the image */
+  float _window[4]; /* scale, then offset */
+  char _first;
+  GlyphAtlas _atlas;
+  sky::core::Texture _texture;
+  sky::core::Buffer _vbo;
+  sky::core::VertexArray _va;
+  sky::core::Program _sp;
+  sky::core::Program::Uniform _windowIndex;
+  mutable std::vector<GlyphInstance> _instances;
+
+  void _init_texture(void);
+  void _init_va(void);
+  void _init_program(void);
+
+public :
+  TextRenderer(sky::ushort width, sky::ushort height, sky::ubyte const * const *index, sky::ushort nb, char first);
+  ~TextRenderer(void) = default;
+
+  /* aspect before any layout; scale and offset before drawing */
+  void window(float aspect, float const *scale, float const *offset);
+  float const * window(void) const;
+
+  /* append the glyphs of str to instances; returns the string width */
+  float layout(char const *str, float x, float y, float size, std::vector<GlyphInstance> &instances) const;
+  sky::core::Texture const & atlas(void) const;
+
+  void start_draw(void) const;
+  void draw_string(char const *str, float x, float y, float size) const;
+  void end_draw(void) const;
+};
+
+#endif /* guard */
+
@@ -0,0 +1,50 @@
+#ifndef __TILED_IMAGE_HPP
+#define __TILED_IMAGE_HPP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fsm/common.hpp>
+#include <lang/primtypes.hpp>
+
+/* An image of columns by rows tiles, each drawn in the whole backbuffer
+ * then read back from it. A tile is drawn with a guard band around it, so
+ * that what spreads over pixels (blurs) gets what lies past its edges;
+ * only its inside is kept. A row of tiles goes to a binary PPM as soon as
+ * it is read: memory stays bound by a row of tiles, whatever the size of
+ * the image. One tile without guard is a plain frame.
+ *
+ * Images either go to a file each, which only gets its name once whole,
+ * or follow each other in one (- being stdout), as a stream of PPMs. */
+class TiledImage {
+  sky::ushort _tileWidth, _tileHeight; /* kept of a tile */
+  sky::ushort _guard;
+  sky::uint _columns, _rows;
+  std::vector<sky::ubyte> _strip;      /* a row of tiles, bottom up */
+  std::FILE *_file;
+  std::string _path;                   /* once whole; empty for stdout */
+
+public :
+  TiledImage(sky::ushort tileWidth, sky::ushort tileHeight, sky::ushort guard, sky::uint columns, sky::uint rows);
+  ~TiledImage(void);
+  TiledImage(TiledImage const &) = delete;
+  TiledImage & operator=(TiledImage const &) = delete;
+
+  /* backbuffer size a tile is drawn at */
+  sky::ushort drawn_width(void) const;
+  sky::ushort drawn_height(void) const;
+  sky::uint width(void) const;
+  sky::uint height(void) const;
+  sky::uint tiles(void) const;
+
+  /* tile i, from the top left, row after row */
+  void place(sky::uint i, Tile &tile) const;
+
+  /* images read up to close() go to path */
+  bool open(char const *path);
+  /* the backbuffer holds tile i; tiles come in order, from 0 */
+  void read(sky::uint i);
+  void close(void);
+};
+
+#endif /* guard */
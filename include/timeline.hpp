@@ -0,0 +1,136 @@
+#ifndef __TIMELINE_HPP
+#define __TIMELINE_HPP
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <lang/primtypes.hpp>
+#include <math/matrix.hpp>
+#include <scene/common.hpp>
+#include <xm_module.hpp>
+
+/* Start time of every row the song plays, from its orders, speed and
+ * tempo changes, jumps, breaks and pattern delays, up to where the song
+ * loops. Rows the song never reaches have no time (-1). */
+class SongMap {
+  std::vector<std::vector<float>> _rows; /* by order, then row */
+
+public :
+  SongMap(void) = default;
+  explicit SongMap(XMModule const &module);
+  ~SongMap(void) = default;
+
+  float time(sky::ushort order, sky::ushort row) const;
+};
+
+/* Keyed scalar; each key tells how to reach the next one. Lookups are a
+ * binary search over the keys. */
+class ScalarTrack {
+public :
+  enum Interp { STEP, LINEAR, SMOOTH };
+
+private :
+  struct Key {
+    float time, value;
+    Interp interp;
+  };
+
+  std::vector<Key> _keys;
+
+public :
+  void clear(void);
+  /* keys with the same time are kept in insertion order */
+  void key(float time, float value, Interp interp = LINEAR);
+  /* value of the last key before the first one */
+  float at(float time) const;
+};
+
+/* Sorted event times */
+class EventTrack {
+  std::vector<float> _times;
+
+public :
+  void clear(void);
+  void key(float time);
+  /* index of the last event at or before time, -1 if none */
+  int index(float time) const;
+  /* time of the i-th event; events past the last one never happen */
+  float time(sky::uint i) const;
+  sky::uint size(void) const;
+};
+
+/* camera position and yaw, pitch and roll in radians; cut keys hold until
+ * the next key instead of moving smoothly toward it */
+struct CameraKey {
+  float time;
+  sky::scene::Position pos;
+  float yaw, pitch, roll;
+  bool cut;
+};
+
+/* View matrices sampled at a fixed rate, segment by segment, so that a
+ * lookup is a binary search over the few segments and a lerp between two
+ * samples; cuts are segments of their own so they stay sharp. The last
+ * lookup is cached: several lookups of the same frame cost nothing. */
+class CameraTrack {
+public :
+  typedef std::function<sky::math::Mat44 (float)> Path;
+
+private :
+  struct Segment {
+    float start, rate;
+    std::vector<sky::math::Mat44> views;
+  };
+
+  std::vector<Segment> _segments;
+  mutable float _cachedTime;
+  mutable bool _cacheValid;
+  mutable sky::math::Mat44 _cached;
+
+public :
+  CameraTrack(void);
+  ~CameraTrack(void) = default;
+
+  /* view matrix of a key: translation, then yaw, pitch and roll */
+  static sky::math::Mat44 key_view(CameraKey const &key);
+
+  void clear(void);
+  /* fixed view from start on */
+  void hold(float start, sky::math::Mat44 const &view);
+  /* path sampled over [start;end] */
+  void bake(float start, float end, float rate, Path const &path);
+  /* Catmull-Rom spline through keys, sampled at rate */
+  void keys(std::vector<CameraKey> const &keys, float rate);
+  sky::math::Mat44 const & at(float time) const;
+};
+
+/* Named tracks of the intro. Parts look their tracks up once and keep the
+ * references. A sync file can override whole tracks without rebuilding;
+ * one key per line, times in seconds or as order:row of the song:
+ *
+ *   scalar <track> <time> <value> [step|linear|smooth]
+ *   event <track> <time>
+ *   camera <track> <time> <x> <y> <z> <yaw> <pitch> <roll> [cut|smooth]
+ *
+ * Angles are in degrees, and # starts a comment. */
+class Timeline {
+  std::map<std::string, ScalarTrack> _scalars;
+  std::map<std::string, EventTrack> _events;
+  std::map<std::string, CameraTrack> _cameras;
+  SongMap _song;
+
+public :
+  void song(XMModule const &module);
+  float row_time(sky::ushort order, sky::ushort row) const;
+
+  ScalarTrack & scalar(char const *name);
+  EventTrack & event(char const *name);
+  CameraTrack & camera(char const *name);
+
+  /* override the tracks the file has keys for; false if unreadable */
+  bool load(char const *path);
+};
+
+#endif /* guard */
+
@@ -0,0 +1,52 @@
+#ifndef __TRIPLE_BUFFER_HPP
+#define __TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <lang/primtypes.hpp>
+
+/* Wait-free single writer, single reader hand-over of the latest value.
+ * Each side owns a slot; the third one is swapped in and out of a shared
+ * word along with a fresh flag, so publishing never waits on the reader
+ * and reading never waits on the writer, and neither copies under a lock.
+ * The reader only sees whole values, skipping the ones it missed. */
+template <typename T>
+class TripleBuffer {
+  static sky::uint const FRESH = 4; /* the middle slot holds an unread value */
+
+  T _slots[3];
+  alignas(64) std::atomic<sky::uint> _middle;
+  alignas(64) sky::uint _back;  /* owned by the writer */
+  alignas(64) sky::uint _front; /* owned by the reader */
+
+public :
+  TripleBuffer(void) :
+      _slots()
+    , _middle(1)
+    , _back(0)
+    , _front(2) {
+  }
+
+  /* writer side: fill back(), then publish() it */
+  T & back(void) {
+    return _slots[_back];
+  }
+
+  void publish(void) {
+    _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+  }
+
+  /* reader side: true if front() changed */
+  bool update(void) {
+    if (!(_middle.load(std::memory_order_relaxed) & FRESH))
+      return false;
+    _front = _middle.exchange(_front, std::memory_order_acq_rel) & ~FRESH;
+    return true;
+  }
+
+  T const & front(void) const {
+    return _slots[_front];
+  }
+};
+
+#endif /* guard */
+
@@ -0,0 +1,68 @@
+#ifndef __VIDEO_EXPORT_HPP
+#define __VIDEO_EXPORT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <audio_mixer.hpp>
+#include <frame_worker.hpp>
+#include <gl.hpp>
+#include <lang/primtypes.hpp>
+#include <options.hpp>
+#include <wav_writer.hpp>
+#include <xm_module.hpp>
+#include <xm_player.hpp>
+
+/* Offline frames (--video) as a Y4M stream, or raw 4:2:0 planes for a .yuv
+ * file, and the song under the same frames as WAV (--audio). The frame
+ * loop never waits on them: a frame is read back into the next of a ring
+ * of pixel buffers, with a fence after it. LAG frames later, the fence has
+ * long passed and the buffer is mapped, then handed to a worker thread
+ * that converts and writes it while the next frames are drawn. Only a GPU
+ * more than LAG frames behind slows the loop down. */
+class VideoExport {
+  struct Slot {
+    GLuint pbo;
+    GLsync fence;
+    void *mapped;  /* while the worker may read it */
+    int frame;
+  };
+
+  sky::ushort _width, _height;
+  int _fps;
+  bool _raw;
+  std::FILE *_video;
+  WavWriter *_audio;
+  std::vector<Slot> _slots;
+  std::uint64_t _read;     /* frames read back */
+  std::uint64_t _posted;   /* frames handed to the worker */
+  bool _failed;            /* a frame was lost */
+  /* worker side */
+  XMPlayer _player;
+  std::uint64_t _samples;  /* of the song, up to the last frame written */
+  std::vector<sky::ubyte> _planes;
+  std::vector<AudioFrame> _pcm;
+  Slot const *_slot;
+  FrameWorker::Job _job;
+  FrameWorker _worker;
+
+  void _post(Slot &slot);
+  void _release(Slot &slot);
+  void _write(void);
+
+public :
+  /* frames from first on, in order */
+  VideoExport(Options const &options, sky::ushort width, sky::ushort height, XMModule const &module, int first);
+  ~VideoExport(void);
+  VideoExport(VideoExport const &) = delete;
+  VideoExport & operator=(VideoExport const &) = delete;
+
+  /* false as well once a frame couldn't be read back */
+  bool ok(void) const;
+  /* the backbuffer holds frame */
+  void read(int frame);
+  /* writes the frames still in the ring */
+  void finish(void);
+};
+
+#endif /* guard */
@@ -0,0 +1,27 @@
+#ifndef __WAV_WRITER_HPP
+#define __WAV_WRITER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <audio_mixer.hpp>
+#include <lang/primtypes.hpp>
+
+/* Streams 16-bit stereo frames to a RIFF WAVE file. The header sizes are
+ * patched once the file is closed, so any number of frames can follow. */
+class WavWriter {
+  std::FILE *_file;
+  sky::uint _rate;
+  std::uint64_t _frames;
+
+  void _header(void);
+
+public :
+  WavWriter(char const *path, sky::uint rate);
+  ~WavWriter(void);
+
+  bool ok(void) const;
+  void write(AudioFrame const *frames, sky::uint n);
+};
+
+#endif /* guard */
+
@@ -0,0 +1,68 @@
+#ifndef __XM_MODULE_HPP
+#define __XM_MODULE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <lang/primtypes.hpp>
+
+/* FastTracker II extended module, decoded for playback: patterns are
+ * unpacked to one cell per row and channel, and delta-encoded samples to
+ * floats in [-1;1]. Ping-pong loops are unrolled into forward ones, and
+ * each sample is followed by guard samples so that the mixer can always
+ * read one sample past the current one. */
+struct XMCell {
+  sky::ubyte note; /* 1-96, 97 is key off, 0 is none */
+  sky::ubyte instrument;
+  sky::ubyte volume;
+  sky::ubyte effect;
+  sky::ubyte param;
+};
+
+struct XMPattern {
+  sky::ushort rows;
+  std::vector<XMCell> cells; /* rows * channels */
+};
+
+struct XMEnvelope {
+  enum { ON = 1, SUSTAIN = 2, LOOP = 4 };
+
+  sky::ushort x[12], y[12];
+  sky::ubyte nb;
+  sky::ubyte sustain, loopStart, loopEnd;
+  sky::ubyte flags;
+};
+
+struct XMSample {
+  std::vector<float> data; /* length samples, plus guard samples */
+  sky::uint length;
+  sky::uint loopStart, loopLength; /* no loop if loopLength is 0 */
+  sky::ubyte volume, panning;
+  std::int8_t finetune, relativeNote;
+};
+
+struct XMInstrument {
+  sky::ubyte keymap[96]; /* sample of each note */
+  XMEnvelope volEnv, panEnv;
+  sky::ubyte vibType, vibSweep, vibDepth, vibRate;
+  sky::ushort fadeout;
+  std::vector<XMSample> samples;
+};
+
+struct XMModule {
+  enum { LINEAR_FREQUENCIES = 1 };
+
+  sky::ushort songLength, restart;
+  sky::ushort channels;
+  sky::ushort flags;
+  sky::ushort tempo, bpm;
+  sky::ubyte orders[256];
+  std::vector<XMPattern> patterns;
+  std::vector<XMInstrument> instruments;
+
+  bool load(char const *path);
+  bool load(sky::ubyte const *data, std::size_t size);
+};
+
+#endif /* guard */
+
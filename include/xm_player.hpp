@@ -0,0 +1,96 @@
+#ifndef __XM_PLAYER_HPP
+#define __XM_PLAYER_HPP
+
+#include <cstdint>
+#include <vector>
+#include <audio_mixer.hpp>
+#include <lang/primtypes.hpp>
+#include <xm_module.hpp>
+
+/* FastTracker II replayer: sequences the orders and patterns of a module
+ * tick by tick, applies the effects, volume column, envelopes and auto
+ * vibrato, and mixes the channels into 16-bit stereo at any rate. Only
+ * linear frequency tables are supported. Rendering is deterministic and
+ * does no I/O, so the same player drives the audio thread and offline
+ * rendering. The song loops from its restart position. */
+class XMPlayer {
+  struct Channel {
+    XMCell cell;
+    XMInstrument const *instrument;
+    XMSample const *sample;
+    bool active;
+    bool keyOn;
+    std::uint64_t pos, step; /* 32.32 fixed point, in samples */
+    int period, portaTarget;
+    int volume, panning;
+    int finetune;
+    int fadeout;
+    sky::uint volEnvTick, panEnvTick;
+    int volEnv, panEnv;
+    int vibDelta, tremDelta, arpDelta;
+    sky::ubyte vibPos, vibSpeed, vibDepth, vibWave;
+    sky::ubyte tremPos, tremSpeed, tremDepth, tremWave;
+    sky::uint autoVibPos, autoVibAmp;
+    sky::ubyte portaUp, portaDown, portaSpeed;
+    sky::ubyte volSlide, panSlide, fineUp, fineDown, fineVolUp, fineVolDown;
+    sky::ubyte xfineUp, xfineDown, retrig, offset;
+    sky::ubyte loopRow, loopCount;
+    float gainL, gainR; /* current gains, ramping to the targets */
+    float targetL, targetR;
+    sky::uint rampLeft;
+  };
+
+  XMModule const &_module;
+  sky::uint _rate;
+  std::vector<Channel> _channels;
+  XMPattern _blank; /* stands for missing patterns */
+  sky::ushort _order, _row;
+  sky::ushort _speed, _bpm;
+  sky::ushort _tick;
+  int _globalVolume;
+  sky::ubyte _globalSlide;
+  sky::ubyte _patternDelay;
+  bool _delaying;
+  bool _jump;
+  bool _breakSet;
+  sky::ushort _jumpOrder, _breakRow;
+  sky::uint _tickLeft; /* frames left in the current tick */
+  sky::uint _tickFrac; /* fraction of frames carried over ticks, in 1/bpm */
+  std::uint64_t _frames;
+  sky::uint _loops;
+  std::vector<float> _mix;
+
+  XMPattern const * _pattern(void) const;
+  void _start_tick(void);
+  void _next_row(void);
+  void _row_channel(Channel &ch, XMCell const &cell);
+  void _trigger(Channel &ch, XMCell const &cell);
+  void _volume_row(Channel &ch, sky::ubyte v);
+  void _effect_row(Channel &ch);
+  void _effect_tick(Channel &ch);
+  void _volume_tick(Channel &ch, sky::ubyte v);
+  void _tone_porta(Channel &ch);
+  void _vibrato(Channel &ch);
+  void _volume_slide(Channel &ch, sky::ubyte param);
+  void _key_off(Channel &ch);
+  void _update(Channel &ch);
+  void _play(Channel &ch, float *out, sky::uint n);
+  void _frames_loop(AudioFrame *out, sky::uint frames);
+
+public :
+  XMPlayer(XMModule const &module, sky::uint rate);
+  ~XMPlayer(void) = default;
+
+  /* next frames of the song */
+  void render(AudioFrame *out, sky::uint frames);
+  /* advance the song without mixing, much faster than rendering */
+  void skip(sky::uint frames);
+  /* frames rendered or skipped so far */
+  std::uint64_t frames(void) const;
+  sky::uint rate(void) const;
+  /* times the song went back to an earlier order */
+  sky::uint loops(void) const;
+};
+
+#endif /* guard */
+
@@ -0,0 +1,73 @@
+#ifndef __XM_SYNTHESIZER_HPP
+#define __XM_SYNTHESIZER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <audio_analyzer.hpp>
+#include <lang/primtypes.hpp>
+#include <spsc_ring.hpp>
+#include <triple_buffer.hpp>
+#include <xm_module.hpp>
+#include <xm_player.hpp>
+
+typedef struct _snd_pcm snd_pcm_t;
+
+/* Plays a module on the default ALSA device. A mixer thread renders the
+ * song ahead into a lock-free ring; a real-time thread drains the ring
+ * into the device, so that mixing hiccups never reach the device. The
+ * cursor is the song time being heard, extrapolated between device
+ * writes. Without a device, the cursor follows the wall clock instead so
+ * that the intro still runs.
+ *
+ * The mixer thread also analyses each chunk it mixes; the device thread
+ * forwards the features of what is being heard through a triple buffer,
+ * so that neither the render loop nor the device ever waits on them.
+ * Without a device, the song is analysed once up front with the same
+ * analyzer and the features follow the cursor. */
+class XMSynthesizer {
+  XMModule _module;
+  XMPlayer *_player;
+  snd_pcm_t *_pcm;
+  SPSCRing<AudioFrame> _ring;
+  AudioAnalyzer _analyzer;                /* mixer side */
+  SPSCRing<AudioFeatures> _featureRing;   /* in step with _ring */
+  TripleBuffer<AudioFeatures> _features;  /* heard features */
+  std::vector<AudioFeatures> _songFeatures; /* without device */
+  std::thread _mixer;
+  std::thread _device;
+  std::atomic<bool> _quit;
+  std::atomic<sky::uint> _seek;        /* frames to skip, for the mixer */
+  std::atomic<std::uint64_t> _skipped; /* frames skipped so far */
+  /* frames heard at a clock stamp, published under a sequence lock */
+  std::atomic<sky::uint> _clockSeq;
+  std::atomic<std::uint64_t> _clockFrames;
+  std::atomic<std::int64_t> _clockStamp;
+  mutable float _last; /* last cursor returned */
+  std::chrono::steady_clock::time_point _start;
+
+  void _mix_loop(void);
+  void _device_loop(void);
+  std::int64_t _now(void) const;
+  void _mix_chunk(AudioFrame *chunk);
+
+public :
+  XMSynthesizer(void);
+  ~XMSynthesizer(void);
+
+  bool load(char const *path);
+  bool load(sky::ubyte const *data, std::size_t size);
+  XMModule const & module(void) const;
+  void play(void);
+  /* song time being heard, in seconds */
+  float cursor(void) const;
+  void advance_cursor(float seconds);
+  /* features of the music being heard, from the render thread */
+  AudioFeatures const & features(void);
+};
+
+#endif /* guard */
+
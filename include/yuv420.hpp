@@ -0,0 +1,14 @@
+#ifndef __YUV420_HPP
+#define __YUV420_HPP
+
+#include <lang/primtypes.hpp>
+
+/* width by height BGRA pixels, rows going up as GL reads them back, to
+ * planar 4:2:0 with rows going down: BT.601 video range, one chroma sample
+ * per 2x2 block, odd sizes rounded up. u and v hold (width+1)/2 by
+ * (height+1)/2 samples. Vectorized with SSE2 when available. */
+void bgra_to_yuv420(sky::ubyte const *bgra, sky::uint width, sky::uint height, sky::ubyte *y, sky::ubyte *u, sky::ubyte *v);
+/* the same without SIMD, which the vectorized one matches to the bit */
+void bgra_to_yuv420_scalar(sky::ubyte const *bgra, sky::uint width, sky::uint height, sky::ubyte *y, sky::ubyte *u, sky::ubyte *v);
+
+#endif /* guard */
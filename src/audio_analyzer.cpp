@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <audio_analyzer.hpp>
+#include <xm_player.hpp>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace sky;
+
+namespace {
+  uint  const HALF         = ANALYSIS_WINDOW / 2; /* complex points */
+  float const PI2          = 6.28318531f;
+  float const LOW_HZ       = 40.f;
+  float const HIGH_HZ      = 16000.f;
+  float const RANGE_DB     = 60.f;  /* levels span [-RANGE_DB;0] dB full scale */
+  float const AVERAGE_RATE = 0.025f; /* per hop: about half a second */
+  float const ONSET_GAIN   = 4.f;
+  float const ONSET_DECAY  = 0.85f;  /* per hop */
+
+  /* twiddles of the butterflies of half size h start at h */
+  struct Twiddles {
+    float re[HALF], im[HALF];
+    float splitRe[HALF], splitIm[HALF]; /* exp(-i.pi.k/HALF) */
+    uint reversed[HALF];
+
+    Twiddles(void) {
+      for (uint h = 1; h < HALF; h <<= 1) {
+        for (uint j = 0; j < h; ++j) {
+          re[h + j] = cosf(-PI2 * j / (2 * h));
+          im[h + j] = sinf(-PI2 * j / (2 * h));
+        }
+      }
+      for (uint k = 0; k < HALF; ++k) {
+        splitRe[k] = cosf(-PI2 * k / ANALYSIS_WINDOW);
+        splitIm[k] = sinf(-PI2 * k / ANALYSIS_WINDOW);
+      }
+
+      uint bits = 0;
+      while ((1u << bits) < HALF)
+        ++bits;
+      for (uint i = 0; i < HALF; ++i) {
+        uint r = 0;
+        for (uint b = 0; b < bits; ++b)
+          r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed[i] = r;
+      }
+    }
+  };
+
+  Twiddles const TWIDDLES;
+
+  /* one stage of butterflies of half size h */
+  void butterflies(float *re, float *im, uint h) {
+    float const *wr = TWIDDLES.re + h;
+    float const *wi = TWIDDLES.im + h;
+
+    for (uint base = 0; base < HALF; base += 2 * h) {
+      float *ar = re + base, *ai = im + base;
+      float *br = ar + h, *bi = ai + h;
+      uint j = 0;
+
+#if defined(__SSE2__)
+      for (; j + 4 <= h; j += 4) {
+        __m128 xr = _mm_loadu_ps(br + j), xi = _mm_loadu_ps(bi + j);
+        __m128 cr = _mm_loadu_ps(wr + j), ci = _mm_loadu_ps(wi + j);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+        __m128 yr = _mm_loadu_ps(ar + j), yi = _mm_loadu_ps(ai + j);
+
+        _mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+        _mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+        _mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+        _mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+      }
+#endif
+      for (; j < h; ++j) {
+        float tr = br[j] * wr[j] - bi[j] * wi[j];
+        float ti = br[j] * wi[j] + bi[j] * wr[j];
+
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] += tr;
+        ai[j] += ti;
+      }
+    }
+  }
+}
+
+void real_fft_power(float *re, float *im, float *power) {
+  for (uint i = 0; i < HALF; ++i) {
+    uint r = TWIDDLES.reversed[i];
+    if (r > i) {
+      swap(re[i], re[r]);
+      swap(im[i], im[r]);
+    }
+  }
+  for (uint h = 1; h < HALF; h <<= 1)
+    butterflies(re, im, h);
+
+  /* untangle the spectra of the even and odd samples */
+  power[0] = (re[0] + im[0]) * (re[0] + im[0]);
+  for (uint k = 1; k < HALF; ++k) {
+    uint m = HALF - k;
+    float er = 0.5f * (re[k] + re[m]), ei = 0.5f * (im[k] - im[m]);
+    float or_ = 0.5f * (im[k] + im[m]), oi = 0.5f * (re[m] - re[k]);
+    float xr = er + or_ * TWIDDLES.splitRe[k] - oi * TWIDDLES.splitIm[k];
+    float xi = ei + or_ * TWIDDLES.splitIm[k] + oi * TWIDDLES.splitRe[k];
+
+    power[k] = xr * xr + xi * xi;
+  }
+}
+
+AudioAnalyzer::AudioAnalyzer(uint rate) :
+    _window(ANALYSIS_WINDOW, 0.f)
+  , _hann(ANALYSIS_WINDOW)
+  , _re(HALF)
+  , _im(HALF)
+  , _power(HALF)
+  , _last() {
+  for (uint i = 0; i < ANALYSIS_WINDOW; ++i)
+    _hann[i] = 0.5f - 0.5f * cosf(PI2 * i / ANALYSIS_WINDOW);
+
+  /* logarithmic bands, at least one bin each */
+  float binHz = static_cast<float>(rate) / ANALYSIS_WINDOW;
+  _edges[0] = max(1u, static_cast<uint>(LOW_HZ / binHz));
+  for (uint b = 1; b <= ANALYSIS_BANDS; ++b) {
+    float hz = LOW_HZ * powf(HIGH_HZ / LOW_HZ, static_cast<float>(b) / ANALYSIS_BANDS);
+    _edges[b] = min(HALF, max(_edges[b-1] + 1, static_cast<uint>(hz / binHz + 0.5f)));
+  }
+}
+
+void AudioAnalyzer::analyze(AudioFrame const *hop, AudioFeatures &out) {
+  /* a full-scale sine peaks at a power of (ANALYSIS_WINDOW / 4)^2 under the window */
+  float const norm = 16.f / (static_cast<float>(ANALYSIS_WINDOW) * ANALYSIS_WINDOW);
+
+  memmove(_window.data(), _window.data() + ANALYSIS_HOP, (ANALYSIS_WINDOW - ANALYSIS_HOP) * sizeof(float));
+  float *tail = _window.data() + ANALYSIS_WINDOW - ANALYSIS_HOP;
+  for (uint i = 0; i < ANALYSIS_HOP; ++i)
+    tail[i] = (hop[i].l + hop[i].r) * (0.5f / 32768.f);
+
+  for (uint i = 0; i < HALF; ++i) {
+    _re[i] = _window[2*i] * _hann[2*i];
+    _im[i] = _window[2*i+1] * _hann[2*i+1];
+  }
+  real_fft_power(_re.data(), _im.data(), _power.data());
+
+  float loudness = 0.f;
+  for (uint b = 0; b < ANALYSIS_BANDS; ++b) {
+    float p = 0.f;
+    for (uint k = _edges[b]; k < _edges[b+1]; ++k)
+      p += _power[k];
+    p *= norm / (_edges[b+1] - _edges[b]);
+
+    float db = 10.f * log10f(p + 1e-12f);
+    float level = min(max(db / RANGE_DB + 1.f, 0.f), 1.f);
+
+    out.level[b] = level;
+    out.onset[b] = max(ONSET_GAIN * (level - _last.level[b]), _last.onset[b] * ONSET_DECAY);
+    out.onset[b] = min(out.onset[b], 1.f);
+    out.average[b] = _last.average[b] + (level - _last.average[b]) * AVERAGE_RATE;
+    loudness += level;
+  }
+
+  out.loudness = loudness / ANALYSIS_BANDS;
+  out.beat = min(max(ONSET_GAIN * (out.loudness - _last.loudness), _last.beat * ONSET_DECAY), 1.f);
+  out.end = _last.end + ANALYSIS_HOP;
+  _last = out;
+}
+
+vector<AudioFeatures> analyze_song(XMModule const &module, uint rate) {
+  vector<AudioFeatures> features;
+  vector<AudioFrame> hop(ANALYSIS_HOP);
+  XMPlayer player(module, rate);
+  AudioAnalyzer analyzer(rate);
+
+  while (!player.loops()) {
+    player.render(hop.data(), ANALYSIS_HOP);
+    features.emplace_back();
+    analyzer.analyze(hop.data(), features.back());
+  }
+
+  return features;
+}
+
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cmath>
+#include <audio_mixer.hpp>
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace sky;
+
+namespace {
+  float const FRAC_SCALE = 1.f / 16777216.f; /* 24 fraction bits are plenty for a float lerp */
+}
+
+uint64_t mix_resample(float const *src, uint64_t pos, uint64_t step, uint n, float l, float r, float dl, float dr, float *out) {
+  uint i = 0;
+
+#if defined(__AVX2__)
+  /* 8 frames at once: gather both neighbours of 8 positions */
+  __m256i const evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  __m256 const ramp   = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+  __m256i const step4 = _mm256_set1_epi64x(4*step);
+  __m256i p0 = _mm256_setr_epi64x(pos, pos + step, pos + 2*step, pos + 3*step);
+  __m256i p1 = _mm256_add_epi64(p0, step4);
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i i0 = _mm256_srli_epi64(p0, 32);
+    __m256i i1 = _mm256_srli_epi64(p1, 32);
+    __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_i64gather_ps(src, i0, 4)), _mm256_i64gather_ps(src, i1, 4), 1);
+    __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_i64gather_ps(src+1, i0, 4)), _mm256_i64gather_ps(src+1, i1, 4), 1);
+    __m256i f0 = _mm256_permutevar8x32_epi32(_mm256_srli_epi64(_mm256_slli_epi64(p0, 32), 40), evens);
+    __m256i f1 = _mm256_permutevar8x32_epi32(_mm256_srli_epi64(_mm256_slli_epi64(p1, 32), 40), evens);
+    __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_permute2x128_si256(f0, f1, 0x20)), _mm256_set1_ps(FRAC_SCALE));
+    __m256 s = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+
+    __m256 vl = _mm256_mul_ps(s, _mm256_add_ps(_mm256_set1_ps(l), _mm256_mul_ps(ramp, _mm256_set1_ps(dl))));
+    __m256 vr = _mm256_mul_ps(s, _mm256_add_ps(_mm256_set1_ps(r), _mm256_mul_ps(ramp, _mm256_set1_ps(dr))));
+    __m256 lo = _mm256_unpacklo_ps(vl, vr);
+    __m256 hi = _mm256_unpackhi_ps(vl, vr);
+    _mm256_storeu_ps(out + 2*i,     _mm256_add_ps(_mm256_loadu_ps(out + 2*i),     _mm256_permute2f128_ps(lo, hi, 0x20)));
+    _mm256_storeu_ps(out + 2*i + 8, _mm256_add_ps(_mm256_loadu_ps(out + 2*i + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+
+    p0 = _mm256_add_epi64(p1, step4);
+    p1 = _mm256_add_epi64(p0, step4);
+    pos += 8*step;
+    l += 8*dl;
+    r += 8*dr;
+  }
+#elif defined(__SSE2__)
+  /* 4 frames at once: scalar fetches, vector interpolation and panning */
+  __m128 const ramp = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+
+  for (; i + 4 <= n; i += 4) {
+    float a[4], b[4], t[4];
+
+    for (uint j = 0; j < 4; ++j) {
+      uint64_t p = pos + j*step;
+      a[j] = src[p >> 32];
+      b[j] = src[(p >> 32) + 1];
+      t[j] = static_cast<float>(static_cast<uint32_t>(p) >> 8) * FRAC_SCALE;
+    }
+
+    __m128 va = _mm_loadu_ps(a);
+    __m128 s = _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b), va), _mm_loadu_ps(t)));
+    __m128 vl = _mm_mul_ps(s, _mm_add_ps(_mm_set1_ps(l), _mm_mul_ps(ramp, _mm_set1_ps(dl))));
+    __m128 vr = _mm_mul_ps(s, _mm_add_ps(_mm_set1_ps(r), _mm_mul_ps(ramp, _mm_set1_ps(dr))));
+    _mm_storeu_ps(out + 2*i,     _mm_add_ps(_mm_loadu_ps(out + 2*i),     _mm_unpacklo_ps(vl, vr)));
+    _mm_storeu_ps(out + 2*i + 4, _mm_add_ps(_mm_loadu_ps(out + 2*i + 4), _mm_unpackhi_ps(vl, vr)));
+
+    pos += 4*step;
+    l += 4*dl;
+    r += 4*dr;
+  }
+#endif
+
+  for (; i < n; ++i) {
+    float a = src[pos >> 32];
+    float b = src[(pos >> 32) + 1];
+    float s = a + (b - a) * (static_cast<float>(static_cast<uint32_t>(pos) >> 8) * FRAC_SCALE);
+
+    out[2*i]   += s * l;
+    out[2*i+1] += s * r;
+    pos += step;
+    l += dl;
+    r += dr;
+  }
+
+  return pos;
+}
+
+void mix_to_frames(float const *mix, uint n, AudioFrame *out) {
+  uint i = 0;
+
+#if defined(__SSE2__)
+  /* 4 frames at once, saturated by the pack */
+  __m128 const scale = _mm_set1_ps(32767.f);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(mix + 2*i), scale));
+    __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(mix + 2*i + 4), scale));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(a, b));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    out[i].l = static_cast<int16_t>(lrintf(min(max(mix[2*i],   -1.f), 1.f) * 32767.f));
+    out[i].r = static_cast<int16_t>(lrintf(min(max(mix[2*i+1], -1.f), 1.f) * 32767.f));
+  }
+}
+
@@ -0,0 +1,37 @@
+#include <gl.hpp>
+#include <audio_texture.hpp>
+#include <state_cache.hpp>
+
+using namespace sky;
+using namespace core;
+
+AudioTexture::AudioTexture() {
+  gTH.bind(Texture::T_2D, _texture);
+  gTH.parameter(Texture::P_WRAP_S, Texture::PV_CLAMP_TO_EDGE);
+  gTH.parameter(Texture::P_WRAP_T, Texture::PV_CLAMP_TO_EDGE);
+  gTH.parameter(Texture::P_MIN_FILTER, Texture::PV_NEAREST);
+  gTH.parameter(Texture::P_MAG_FILTER, Texture::PV_NEAREST);
+  gTH.image_2D(ANALYSIS_BANDS + 1, 1, 0, Texture::F_RGBA, Texture::IF_RGBA32F, GLT_FLOAT, 0, nullptr);
+  gTH.unbind();
+}
+
+void AudioTexture::update(AudioFeatures const &features) {
+  float texels[ANALYSIS_BANDS + 1][4];
+
+  for (uint b = 0; b < ANALYSIS_BANDS; ++b) {
+    texels[b][0] = features.level[b];
+    texels[b][1] = features.onset[b];
+    texels[b][2] = features.average[b];
+    texels[b][3] = 0.f;
+  }
+  texels[ANALYSIS_BANDS][0] = features.loudness;
+  texels[ANALYSIS_BANDS][1] = features.beat;
+  texels[ANALYSIS_BANDS][2] = 0.f;
+  texels[ANALYSIS_BANDS][3] = 0.f;
+
+  gTH.unit(AUDIO_UNIT);
+  gTH.bind(Texture::T_2D, _texture);
+  gSC.subimage_2D(ANALYSIS_BANDS + 1, 1, GL_RGBA, GL_FLOAT, texels, sizeof(texels));
+  gTH.unit(0);
+}
+
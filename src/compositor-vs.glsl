@@ -0,0 +1,6 @@
+#version 330 core
+
+/* one triangle covering the screen */
+void main() {
+  gl_Position = vec4(float(gl_VertexID / 2) * 4. - 1., float(gl_VertexID % 2) * 4. - 1., 0., 1.);
+}
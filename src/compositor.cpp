@@ -0,0 +1,129 @@
+#include <compositor.hpp>
+#include <misc/log.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+using namespace misc;
+
+namespace {
+  uint const MAX_STAGES      = 64; /* enabled stages are a 64-bit mask */
+  uint const MAX_CONDITIONAL = 8;  /* 256 variants */
+}
+
+Compositor::Compositor(char const *name, uint inputs) :
+    _name(name)
+  , _inputs(inputs) {
+}
+
+void Compositor::stage(char const *code, Parameter const &parameter, Condition const &condition) {
+  if (_stages.size() == MAX_STAGES) {
+    misc::log << error << _name << ": more than " << MAX_STAGES << " stages" << endl;
+    return;
+  }
+  if (condition) {
+    if (_conditional.size() == MAX_CONDITIONAL) {
+      misc::log << error << _name << ": more than " << MAX_CONDITIONAL << " conditional stages" << endl;
+      return;
+    }
+    _conditional.push_back(_stages.size());
+  }
+  _stages.push_back({ code, parameter, condition });
+}
+
+string Compositor::_source(uint64_t enabled) const {
+  string src = "#version 330 core\nout vec4 frag;\n";
+
+  for (uint i = 0; i < _inputs; ++i)
+    src += "uniform sampler2D src" + to_string(i) + ";\n";
+  for (uint i = 0; i < _stages.size(); ++i) {
+    if (((enabled >> i) & 1) && _stages[i].parameter)
+      src += "uniform float p" + to_string(i) + ";\n";
+  }
+
+  src += "void main() {\nivec2 px = ivec2(gl_FragCoord.xy);\nvec3 color = vec3(0.);\n";
+  for (uint i = 0; i < _inputs; ++i)
+    src += "vec3 s" + to_string(i) + " = texelFetch(src" + to_string(i) + ", px, 0).rgb;\n";
+  for (uint i = 0; i < _stages.size(); ++i) {
+    if (!((enabled >> i) & 1))
+      continue;
+    src += "{\n";
+    if (_stages[i].parameter)
+      src += "float p = p" + to_string(i) + ";\n";
+    src += _stages[i].code + "\n}\n";
+  }
+  src += "frag = vec4(color, 1.);\n}\n";
+
+  return src;
+}
+
+void Compositor::compile() {
+  uint64_t always = 0;
+
+  for (uint i = 0; i < _stages.size(); ++i) {
+    if (!_stages[i].condition)
+      always |= uint64_t(1) << i;
+  }
+
+  _variants.clear();
+  for (uint64_t c = 0; c < (uint64_t(1) << _conditional.size()); ++c) {
+    uint64_t enabled = always;
+    for (uint j = 0; j < _conditional.size(); ++j) {
+      if ((c >> j) & 1)
+        enabled |= uint64_t(1) << _conditional[j];
+    }
+
+    Shader vs(Shader::VERTEX);
+    Shader fs(Shader::FRAGMENT);
+    string src = _source(enabled);
+
+    vs.source(shader_source(SHADER_COMPOSITOR_VS));
+    vs.compile((_name + " vertex shader").c_str());
+    fs.source(src.c_str());
+    fs.compile((_name + " fragment shader").c_str());
+
+    _variants.emplace_back();
+    Variant &v = _variants.back();
+    v.sp.attach(vs);
+    v.sp.attach(fs);
+    v.sp.link();
+
+    v.parameters.resize(_stages.size());
+    v.sp.use();
+    for (uint i = 0; i < _inputs; ++i)
+      v.sp.map_uniform(("src" + to_string(i)).c_str()).push(static_cast<int>(i));
+    for (uint i = 0; i < _stages.size(); ++i) {
+      if (((enabled >> i) & 1) && _stages[i].parameter)
+        v.parameters[i] = v.sp.map_uniform(("p" + to_string(i)).c_str());
+    }
+    v.sp.unuse();
+  }
+}
+
+void Compositor::apply() const {
+  uint64_t c = 0;
+
+  for (uint j = 0; j < _conditional.size(); ++j) {
+    if (_stages[_conditional[j]].condition())
+      c |= uint64_t(1) << j;
+  }
+
+  auto const &v = _variants[c];
+  gSC.use(v.sp);
+  for (uint i = 0, j = 0; i < _stages.size(); ++i) {
+    bool enabled = true;
+
+    if (_stages[i].condition)
+      enabled = (c >> j++) & 1;
+    if (enabled && _stages[i].parameter)
+      gSC.push(v.parameters[i], _stages[i].parameter());
+  }
+
+  _va.bind();
+  gSC.render(_va, primitive::TRIANGLE, 0, 3);
+  _va.unbind();
+
+  gSC.unuse();
+}
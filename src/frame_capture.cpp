@@ -0,0 +1,106 @@
+#include <dlfcn.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <frame_capture.hpp>
+#include <gl_stats.hpp>
+#include <misc/log.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  char const SELF[]     = "/proc/self/exe";
+  char const RECORDER[] = "libgltrace.so";
+  char const PRELOAD[]  = "LD_PRELOAD";
+
+  /* null unless the recorder is preloaded */
+  template <typename F> F recorder(char const *name) {
+    return reinterpret_cast<F>(dlsym(RTLD_DEFAULT, name));
+  }
+}
+
+FrameCapture::FrameCapture(Options const &options, ushort width, ushort height) :
+    _open(recorder<TraceOpen>("gl_trace_open"))
+  , _frame(recorder<TraceFrame>("gl_trace_frame"))
+  , _close(recorder<TraceClose>("gl_trace_close"))
+  , _from(options.captureFrom)
+  , _to(options.captureTo)
+  , _recording(false)
+  , _frames(0) {
+  if (!_open || !_frame || !_close) {
+    misc::log << error << "no GL recorder: " << RECORDER << " isn't preloaded" << endl;
+    return;
+  }
+  if (!_open(options.capture, width, height)) {
+    misc::log << error << "unable to open " << options.capture << endl;
+    return;
+  }
+  gStats.mark_passes(recorder<TracePass>("gl_trace_pass"));
+  _recording = true;
+}
+
+FrameCapture::~FrameCapture() {
+  _stop();
+}
+
+void FrameCapture::_stop() {
+  if (!_recording)
+    return;
+
+  gStats.mark_passes(nullptr);
+  _close();
+  _recording = false;
+  misc::log << debug << _frames << " frames captured" << endl;
+}
+
+bool FrameCapture::ok() const {
+  return _recording || _frames > 0;
+}
+
+/* a single time gets the first frame from it on; frames before the range
+ * are recorded too, unmarked, as what the range needs */
+void FrameCapture::frame(float time) {
+  if (!_recording || time < _from)
+    return;
+
+  if (_from == _to ? _frames > 0 : time > _to) {
+    _stop();
+    return;
+  }
+  _frame(time);
+  ++_frames;
+}
+
+bool FrameCapture::preload(char **argv) {
+  char self[PATH_MAX];
+  ssize_t n = readlink(SELF, self, sizeof(self) - 1);
+  char const *preloaded = getenv(PRELOAD);
+  string path, preload;
+
+  if (recorder<TraceOpen>("gl_trace_open"))
+    return true;
+  if (n <= 0) {
+    misc::log << error << "unable to find the intro's directory" << endl;
+    return false;
+  }
+  self[n] = '\0';
+  path = string(self, strrchr(self, '/') + 1) + RECORDER;
+  if (access(path.c_str(), R_OK)) {
+    misc::log << error << "no GL recorder at " << path << ": make gltrace" << endl;
+    return false;
+  }
+  if (preloaded && strstr(preloaded, path.c_str())) {
+    misc::log << error << path << " preloaded but not loaded" << endl;
+    return false;
+  }
+
+  preload = preloaded && *preloaded ? path + ':' + preloaded : path;
+  setenv(PRELOAD, preload.c_str(), 1);
+  execv(SELF, argv);
+  misc::log << error << "unable to run the intro again with " << path << endl;
+  return false;
+}
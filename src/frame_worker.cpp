@@ -0,0 +1,72 @@
+#include <frame_worker.hpp>
+
+using namespace std;
+
+FrameWorker::FrameWorker() :
+    _job(nullptr)
+  , _pending(false)
+  , _epoch(0)
+  , _lockstep(false)
+  , _quit(false) {
+  sem_init(&_posted, 0, 0);
+  sem_init(&_done, 0, 0);
+  _thread = thread(&FrameWorker::_loop, this);
+}
+
+FrameWorker::~FrameWorker() {
+  wait();
+  _quit = true;
+  sem_post(&_posted);
+  _thread.join();
+
+  sem_destroy(&_posted);
+  sem_destroy(&_done);
+}
+
+void FrameWorker::_loop() {
+  for (;;) {
+    while (sem_wait(&_posted) < 0); /* interrupted */
+    if (_quit)
+      break;
+    (*_job)();
+    sem_post(&_done);
+  }
+}
+
+void FrameWorker::post(Job const &job) {
+  wait();
+  _job = &job;
+  _pending = true;
+  sem_post(&_posted);
+}
+
+void FrameWorker::wait() {
+  if (!_pending)
+    return;
+
+  while (sem_wait(&_done) < 0);
+  _pending = false;
+}
+
+bool FrameWorker::done() {
+  if (_pending && sem_trywait(&_done) == 0)
+    _pending = false;
+  return !_pending;
+}
+
+void FrameWorker::invalidate() {
+  wait();
+  ++_epoch;
+}
+
+unsigned FrameWorker::epoch() const {
+  return _epoch;
+}
+
+void FrameWorker::lockstep(bool on) {
+  _lockstep = on;
+}
+
+bool FrameWorker::lockstep() const {
+  return _lockstep;
+}
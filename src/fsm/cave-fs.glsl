@@ -1,9 +1,12 @@
 #version 330 core
 
 in vec3 vno;
+in vec4 vcur;
+in vec4 vlast;
 
 layout (location = 0) out vec3 nofrag;
 layout (location = 1) out ivec2 matfrag;
+layout (location = 2) out vec3 velfrag; /* Cave::VELOCITY_OUTPUT */
 
 uniform sampler2D heightmap;
 uniform vec4 pres;
@@ -11,4 +14,6 @@ uniform vec4 pres;
 void main() {
   nofrag = vno;
   matfrag = ivec2(2u, 2u);
+  /* screen motion since the last frame, in uv; then the view depth */
+  velfrag = vec3((vcur.xy / vcur.w - vlast.xy / vlast.w) * 0.5, vcur.w);
 }
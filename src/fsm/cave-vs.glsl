@@ -1,59 +1,55 @@
 #version 330 core
 
-in vec3 co;
+in vec2 co;
 out vec3 vno;
+out vec4 vcur;  /* clip position, for velocities */
+out vec4 vlast; /* same, seen from the last frame's camera */
 
-uniform sampler2D heightmap;
+uniform sampler2D heightmap; /* baked height and derivatives */
 uniform sampler2D heightmap2;
 uniform mat4 proj;
 uniform mat4 view;
-uniform vec4 pres;
-uniform float t;
+uniform mat4 lastView;
+uniform vec4 node;  /* node corner, node size, grid resolution */
+uniform vec2 morph; /* morph start, 1 / morph length */
+uniform vec3 eye;
+uniform float mixing; /* from the first heightmap to the second one */
 
-vec2 h = vec2(1. / 512.);
-float maxAmp = 4.;//4.*sin(t*0.1); /* max amplitude */
-
-float height(vec2 uv) {
-  return texture(heightmap, uv).r * maxAmp;
-}
-
-float height2(vec2 uv) {
-  return texture(heightmap2, uv).r * maxAmp;
-}
-
-vec3 deriv_no(vec2 xz, float first) {
-  float wxz = first;
-  float dx = height(vec2(xz.x+h.x, xz.y)) - wxz;
-  float dz = height(vec2(xz.x, xz.y+h.y)) - wxz;
-
-  return normalize(vec3(-dx, h.y, -dz));
-}
-
-vec3 deriv_no2(vec2 xz, float first) {
-  float wxz = first;
-  float dx = height2(vec2(xz.x+h.x, xz.y)) - wxz;
-  float dz = height2(vec2(xz.x, xz.y+h.y)) - wxz;
-
-  return normalize(vec3(-dx, h.y, -dz));
-}
+const float h = 1. / 512.;
 
 float mixer(float a) {
   return a;
   return clamp(pow(a, 2.)*pow(-a+0.5, 2.), 0., 1.);
 }
 
+/* only fetch both heightmaps while morphing from one to the other */
+vec4 terrain(vec2 uv, float mixed) {
+  if (mixed <= 0.)
+    return texture(heightmap, uv);
+  if (mixed >= 1.)
+    return texture(heightmap2, uv);
+  return mix(texture(heightmap, uv), texture(heightmap2, uv), mixed);
+}
+
 void main() {
-  /* compute space coordinates */
-  vec3 pos = co.xxy;
-  vec2 lookup = (co.xy+pres.xy*0.5)*pres.zw;
-  lookup = co.xy*0.1;
+  float side = (gl_InstanceID == 0 ? 1. : -1.);
+  float mixed = mixer(clamp(mixing, 0., 1.));
+
+  /* morph toward the coarser grid with the distance to the eye */
+  vec2 xz = node.xy + co*node.z;
+  vec4 s = terrain(xz*0.1, mixed);
+  float k = clamp((distance(eye, vec3(xz.x, s.x + 4.*side, xz.y)) - morph.x) * morph.y, 0., 1.);
+  vec2 d = fract(co*node.w*0.5) * 2. / node.w * node.z * k;
+  if (d != vec2(0.)) {
+    xz -= d;
+    s = terrain(xz*0.1, mixed);
+  }
 
-  float mixed = mixer(clamp(t-112., 0., 1.));
-  pos.y = mix(height(lookup), height2(lookup), mixed);
-  vno = mix(deriv_no(lookup, pos.y), deriv_no2(lookup, pos.y), mixed);
-  vno *= (gl_InstanceID == 0 ? 1 : -1);
-  pos.y += 4. * (gl_InstanceID == 0 ? 1 : -1);
+  /* compute space coordinates */
+  vec3 pos = vec3(xz.x, s.x + 4.*side, xz.y);
+  vno = normalize(vec3(-s.y, h, -s.z)) * side;
 
-  gl_Position = proj * view * vec4(pos, 1.);
+  vcur = proj * view * vec4(pos, 1.);
+  vlast = proj * lastView * vec4(pos, 1.);
+  gl_Position = vcur;
 }
-
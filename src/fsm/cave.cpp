@@ -1,105 +1,35 @@
+#include <core/framebuffer.hpp>
 #include <fsm/cave.hpp>
+#include <misc/log.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
 #include <tech/perlin_noise_generator.hpp>
+#include <tech/post_process.hpp>
 
+using namespace std;
 using namespace sky;
 using namespace core;
-using namespace data;
 using namespace math;
+using namespace misc;
 using namespace tech;
 
 namespace {
-  float const CAVE_W    = 100.f;
-  float const CAVE_H    = 100.f;
-  float const CAVE_TW   = 600.f;
-  float const CAVE_TH   = 600.f;
-  float const CAVE_TRES = CAVE_TW * CAVE_TH;
-  char const *CAVE_VS_SRC =
-"#version 330 core\n"
-
-"in vec3 co;"
-"out vec3 vno;"
-
-"uniform sampler2D heightmap;"
-"uniform sampler2D heightmap2;"
-"uniform mat4 proj;"
-"uniform mat4 view;"
-"uniform vec4 pres;"
-"uniform float t;"
-
-"vec2 h=vec2(1./512.);"
-"float maxAmp=4.;" //4.*sin(t*0.1); /* max amplitude */
-
-"float height(vec2 uv){"
-  "return texture(heightmap,uv).r*maxAmp;"
-"}"
-
-"float height2(vec2 uv){"
-  "return texture(heightmap2,uv).r*maxAmp;"
-"}"
-
-"vec3 deriv_no(vec2 xz,float first){"
-  "float wxz=first;"
-  "float dx=height(vec2(xz.x+h.x,xz.y))-wxz;"
-  "float dz=height(vec2(xz.x,xz.y+h.y))-wxz;"
-
-  "return normalize(vec3(-dx,h.y,-dz));"
-"}"
-
-"vec3 deriv_no2(vec2 xz,float first){"
-  "float wxz=first;"
-  "float dx=height2(vec2(xz.x+h.x,xz.y))-wxz;"
-  "float dz=height2(vec2(xz.x,xz.y+h.y))-wxz;"
-
-  "return normalize(vec3(-dx,h.y,-dz));"
-"}"
-
-"float mixer(float a){"
-  "return a;"
-  "return clamp(pow(a,2.)*pow(-a+0.5,2.),0.,1.);"
-"}"
-
-"void main(){"
-  /* compute space coordinates */
-  "vec3 pos=co.xxy;"
-  "vec2 lookup=(co.xy+pres.xy*0.5)*pres.zw;"
-  "lookup=co.xy*0.1;"
-
-  "float mixed=mixer(clamp(t-112.,0.,1.));"
-  "pos.y=mix(height(lookup),height2(lookup),mixed);"
-  "vno=mix(deriv_no(lookup,pos.y),deriv_no2(lookup,pos.y),mixed);"
-  "vno*=(gl_InstanceID==0?1:-1);"
-  "pos.y+= 4*(gl_InstanceID==0?1:-1);"
-
-  "gl_Position=proj*view*vec4(pos,1.);"
-"}";
-  char const *CAVE_FS_SRC =
-"#version 330 core\n"
-
-"in vec3 vno;"
-
-"layout(location=0)out vec3 nofrag;"
-"layout(location=1)out ivec2 matfrag;"
-
-"uniform sampler2D heightmap;"
-"uniform vec4 pres;"
-
-"void main(){"
-  "nofrag=vno;"
-  "matfrag=ivec2(2u,2u);"
-"}";
+  float  const CAVE_W          = 100.f;
+  float  const CAVE_YMIN       = -12.f; /* conservative bounds of the floor and ceiling */
+  float  const CAVE_YMAX       = 12.f;
+  ushort const TERRAIN_GRID    = 32;    /* quads per patch side */
+  ushort const TERRAIN_LEVELS  = 5;     /* finest node is CAVE_W / 2^(TERRAIN_LEVELS-1) */
+  float  const TERRAIN_RANGE   = 12.5f; /* visibility range of the finest level: twice its node,
+                                          * so that each range step exceeds a node diagonal */
 }
 
-Cave::Cave() :
-    _plane(CAVE_W, CAVE_H, CAVE_TW, CAVE_TH) {
-  _init_textures(CAVE_TW, CAVE_TH);
+Cave::Cave(uint texWidth, uint texHeight) :
+    _terrain(CAVE_W, TERRAIN_GRID, TERRAIN_LEVELS, TERRAIN_RANGE)
+  , _attachment(-2) {
+  _init_textures(texWidth, texHeight);
   _init_program();
 }
 
-Cave::~Cave() {
-  for (short i = 0; i < 2; ++i)
-    delete _pTexture[i];
-}
-
 void Cave::_init_textures(uint width, uint height) {
   PerlinNoiseGenerator png(width, height,
       "void main() {\n"
@@ -113,17 +43,41 @@ void Cave::_init_textures(uint width, uint height) {
       "}\n"
     );
 
-  for (short i = 0; i < 2; ++i)
-    _pTexture[i] = png.gen(i+1);
+  PostProcess baker("cave heightmap baker", shader_source(SHADER_CAVE_BAKE_FS), width, height);
+  Framebuffer fb;
+
+  /* bake height and normal derivatives so that vertices fetch them once */
+  for (short i = 0; i < 2; ++i) {
+    auto pNoise = png.gen(i+1);
+
+    gTH.bind(Texture::T_2D, _heightmap[i]);
+    gTH.parameter(Texture::P_MIN_FILTER, Texture::PV_LINEAR);
+    gTH.parameter(Texture::P_MAG_FILTER, Texture::PV_LINEAR);
+    gTH.image_2D(width, height, 0, Texture::F_RGBA, Texture::IF_RGBA32F, GLT_FLOAT, 0, nullptr);
+    gTH.unbind();
+
+    gFBH.bind(Framebuffer::DRAW, fb);
+    gFBH.attach_2D_texture(_heightmap[i], Framebuffer::COLOR_ATTACHMENT);
+
+    gTH.unit(0);
+    gTH.bind(Texture::T_2D, *pNoise);
+    baker.start();
+    baker.apply(0.f);
+    baker.end();
+    gTH.unbind();
+    gFBH.unbind();
+
+    delete pNoise;
+  }
 }
 
 void Cave::_init_program() {
   Shader vs(Shader::VERTEX);
   Shader fs(Shader::FRAGMENT);
 
-  vs.source(CAVE_VS_SRC);
+  vs.source(shader_source(SHADER_CAVE_VS));
   vs.compile("cave vertex shader");
-  fs.source(CAVE_FS_SRC);
+  fs.source(shader_source(SHADER_CAVE_FS));
   fs.compile("cave fragment shader");
 
   _sp.attach(vs);
@@ -134,32 +88,94 @@ void Cave::_init_program() {
 }
 
 void Cave::_init_uniforms() {
-  auto heightmapIndex = _sp.map_uniform("heightmap");
+  auto heightmapIndex  = _sp.map_uniform("heightmap");
   auto heightmap2Index = _sp.map_uniform("heightmap2");
-  auto presIndex      = _sp.map_uniform("pres");
-  _projIndex          = _sp.map_uniform("proj");
-  _viewIndex          = _sp.map_uniform("view");
-  _timeIndex          = _sp.map_uniform("t");
+  _projIndex           = _sp.map_uniform("proj");
+  _viewIndex           = _sp.map_uniform("view");
+  _lastViewIndex       = _sp.map_uniform("lastView");
+  _mixingIndex         = _sp.map_uniform("mixing");
+  _nodeIndex           = _sp.map_uniform("node");
+  _morphIndex          = _sp.map_uniform("morph");
+  _eyeIndex            = _sp.map_uniform("eye");
 
   _sp.use();
   heightmapIndex.push(0);
   heightmap2Index.push(1);
-  presIndex.push(CAVE_W, CAVE_H, 1.f / CAVE_W, 1.f / CAVE_H);
   _sp.unuse();
 }
 
-void Cave::render(float time, Mat44 const &proj, Mat44 const &view) const {
-  _sp.use();
+void Cave::select(Mat44 const &proj, Mat44 const &view, vector<Terrain::Node> &nodes) const {
+  _terrain.select(proj, view, CAVE_YMIN, CAVE_YMAX, nodes);
+}
 
-  _projIndex.push(proj);
-  _viewIndex.push(view);
-  _timeIndex.push(time);
+void Cave::render(float mixing, Mat44 const &proj, Mat44 const &view, Mat44 const &lastView, vector<Terrain::Node> const &nodes) const {
+  float eye[3];
 
-  gTH.unit(0);
-  gTH.bind(Texture::T_2D, *_pTexture[0]);
-  gTH.unit(1);
-  gTH.bind(Texture::T_2D, *_pTexture[1]);
-  _plane.va.inst_indexed_render(primitive::TRIANGLE, CAVE_TRES*6, GLT_UINT, 2);
-  _sp.unuse();
+  Terrain::eye_position(view, eye);
+
+  gSC.use(_sp);
+
+  gSC.push(_projIndex, proj);
+  gSC.push(_viewIndex, view);
+  gSC.push(_lastViewIndex, lastView);
+  gSC.push(_mixingIndex, mixing);
+  gSC.push(_eyeIndex, eye[0], eye[1], eye[2]);
+
+  gSC.unit(0);
+  gSC.bind(Texture::T_2D, _heightmap[0]);
+  gSC.unit(1);
+  gSC.bind(Texture::T_2D, _heightmap[1]);
+  _terrain.render(nodes, _nodeIndex, _morphIndex, 2);
+  gSC.unuse();
+}
+
+/* the G-buffer is skyoralis': its draw buffers and a free color attachment
+ * are looked up once */
+bool Cave::_find_attachment() {
+  GLint drawBuffers, attachments, buffer = GL_NONE, type = GL_NONE;
+
+  if (_attachment >= -1)
+    return _attachment >= 0;
+
+  glGetIntegerv(GL_MAX_DRAW_BUFFERS, &drawBuffers);
+  glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &attachments);
+  for (GLint i = 0; i < VELOCITY_OUTPUT; ++i) {
+    glGetIntegerv(GL_DRAW_BUFFER0 + i, &buffer);
+    _outputs[i] = buffer;
+  }
+  if (VELOCITY_OUTPUT < drawBuffers)
+    glGetIntegerv(GL_DRAW_BUFFER0 + VELOCITY_OUTPUT, &buffer);
+
+  _attachment = -1;
+  for (GLint i = 0; i < attachments && _attachment < 0; ++i) {
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    if (type == GL_NONE)
+      _attachment = i;
+  }
+
+  if (VELOCITY_OUTPUT >= drawBuffers || buffer != GL_NONE || _outputs[VELOCITY_OUTPUT-1] == GL_NONE || _attachment < 0) {
+    misc::log << error << "the G-buffer has no room for velocities at output " << VELOCITY_OUTPUT << endl;
+    _attachment = -1;
+    return false;
+  }
+
+  _outputs[VELOCITY_OUTPUT] = GL_COLOR_ATTACHMENT0 + _attachment;
+  return true;
 }
 
+void Cave::begin_velocity(Texture const &velocity) {
+  if (!_find_attachment())
+    return;
+
+  gFBH.attach_2D_texture(velocity, Framebuffer::color_attachment(_attachment));
+  glDrawBuffers(VELOCITY_OUTPUT + 1, _outputs);
+}
+
+/* detached, so that the attachment is free for any other cave */
+void Cave::end_velocity() const {
+  if (_attachment < 0)
+    return;
+
+  glDrawBuffers(VELOCITY_OUTPUT, _outputs);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + _attachment, GL_TEXTURE_2D, 0, 0);
+}
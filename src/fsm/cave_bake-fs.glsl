@@ -0,0 +1,21 @@
+#version 330 core
+
+out vec4 frag;
+
+uniform sampler2D srctex;
+uniform vec4 res;
+
+const vec2 h = vec2(1. / 512.);
+const float maxAmp = 4.; /* max amplitude */
+
+float height(vec2 uv) {
+  return texture(srctex, uv).r * maxAmp;
+}
+
+void main() {
+  vec2 uv = gl_FragCoord.xy * res.zw;
+  float y = height(uv);
+
+  /* height, then forward differences along x and z */
+  frag = vec4(y, height(vec2(uv.x+h.x, uv.y)) - y, height(vec2(uv.x, uv.y+h.y)) - y, 0.);
+}
@@ -0,0 +1,98 @@
+#version 330 core
+
+flat in mat4 reproj;
+
+out vec3 frag;
+
+uniform sampler2D shaded;       /* this frame's lighting, lit blocks only */
+uniform sampler2D velocity;     /* uv motion and view depth */
+uniform sampler2D history;      /* last frame's colors */
+uniform sampler2D lastVelocity;
+uniform mat4 proj;
+uniform vec4 res;               /* size, 1 / size */
+uniform int parity;             /* of the 2x2 blocks lit this frame */
+uniform bool temporal;          /* the last frame can be reprojected */
+
+const float DEPTH_TOLERANCE = 0.02; /* relative */
+const float NORMAL_POWER    = 8.;
+const float TEMPORAL_WEIGHT = 0.5;
+
+/* same place in the four blocks around, all of the other color */
+const ivec2 AROUND[4] = ivec2[4](ivec2(2, 0), ivec2(-2, 0), ivec2(0, 2), ivec2(0, -2));
+
+ivec2 size;
+
+float depth_at(ivec2 p) {
+  return texelFetch(velocity, clamp(p, ivec2(0), size - 1), 0).z;
+}
+
+/* view space */
+vec3 position_at(ivec2 p) {
+  float d = depth_at(p);
+  vec2 ndc = (vec2(p) + .5) * res.zw * 2. - 1.;
+  return vec3(ndc * d / vec2(proj[0][0], proj[1][1]), -d);
+}
+
+/* from the depths around: there is no G-buffer to read it from */
+vec3 normal_at(ivec2 p) {
+  vec3 dx = position_at(p + ivec2(1, 0)) - position_at(p - ivec2(1, 0));
+  vec3 dy = position_at(p + ivec2(0, 1)) - position_at(p - ivec2(0, 1));
+  vec3 n = cross(dx, dy);
+  float l = length(n);
+
+  return l > 0. ? n / l : vec3(0.);
+}
+
+/* no geometry (d = 0): a plain average */
+vec3 reconstruct(ivec2 p, float d) {
+  vec3 n = normal_at(p);
+  vec3 sum = vec3(0.);
+  vec3 plain = vec3(0.);
+  float weights = 0.;
+
+  for (int i = 0; i < 4; ++i) {
+    /* mirrored at the borders, to stay on a lit block */
+    ivec2 q = p + AROUND[i];
+    if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size)))
+      q = p - AROUND[i];
+
+    vec3 c = texelFetch(shaded, q, 0).rgb;
+    float w = d <= 0. ? 0. : exp(-abs(depth_at(q) - d) / (d * DEPTH_TOLERANCE)) * pow(max(dot(normal_at(q), n), 0.), NORMAL_POWER);
+    sum += w * c;
+    plain += c;
+    weights += w;
+  }
+
+  return weights > 1e-4 ? sum / weights : plain * .25;
+}
+
+void main() {
+  ivec2 p = ivec2(gl_FragCoord.xy);
+  ivec2 block = p >> 1;
+
+  size = ivec2(res.xy);
+  if (((block.x + block.y) & 1) == parity) {
+    frag = texelFetch(shaded, p, 0).rgb;
+    return;
+  }
+
+  vec3 v = texelFetch(velocity, p, 0).xyz;
+  vec3 spatial = reconstruct(p, v.z);
+  vec2 uv = gl_FragCoord.xy * res.zw;
+  vec2 last = uv - v.xy;
+
+  if (!temporal || v.z <= 0. || any(lessThan(last, vec2(0.))) || any(greaterThan(last, vec2(1.)))) {
+    frag = spatial;
+    return;
+  }
+
+  /* the last frame lit the other color: take it where the depth agrees */
+  vec2 ndc = uv * 2. - 1.;
+  float expected = -(reproj * vec4(ndc * v.z / vec2(proj[0][0], proj[1][1]), -v.z, 1.)).z;
+  ivec2 texel = clamp(ivec2(last * res.xy), ivec2(0), size - 1);
+
+  if (abs(texelFetch(lastVelocity, texel, 0).z - expected) <= expected * DEPTH_TOLERANCE)
+    frag = mix(spatial, texture(history, last).rgb, TEMPORAL_WEIGHT);
+  else
+    frag = spatial;
+}
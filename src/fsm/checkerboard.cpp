@@ -0,0 +1,64 @@
+#include <fsm/checkerboard.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+
+using namespace sky;
+using namespace core;
+using namespace math;
+
+Checkerboard::Checkerboard(ushort width, ushort height) {
+  _init_program();
+  _init_uniforms(width, height);
+}
+
+/* same full-screen triangle and reprojection matrix as Reprojection */
+void Checkerboard::_init_program() {
+  Shader vs(Shader::VERTEX);
+  Shader fs(Shader::FRAGMENT);
+
+  vs.source(shader_source(SHADER_REPROJECTION_VS));
+  vs.compile("checkerboard vertex shader");
+  fs.source(shader_source(SHADER_CHECKERBOARD_FS));
+  fs.compile("checkerboard fragment shader");
+
+  _sp.attach(vs);
+  _sp.attach(fs);
+  _sp.link();
+}
+
+void Checkerboard::_init_uniforms(ushort width, ushort height) {
+  auto shadedIndex       = _sp.map_uniform("shaded");
+  auto velocityIndex     = _sp.map_uniform("velocity");
+  auto historyIndex      = _sp.map_uniform("history");
+  auto lastVelocityIndex = _sp.map_uniform("lastVelocity");
+  auto resIndex          = _sp.map_uniform("res");
+  _projIndex             = _sp.map_uniform("proj");
+  _viewIndex             = _sp.map_uniform("view");
+  _lastViewIndex         = _sp.map_uniform("lastView");
+  _parityIndex           = _sp.map_uniform("parity");
+  _temporalIndex         = _sp.map_uniform("temporal");
+
+  _sp.use();
+  shadedIndex.push(0);
+  velocityIndex.push(1);
+  historyIndex.push(2);
+  lastVelocityIndex.push(3);
+  resIndex.push(1.f * width, 1.f * height, 1.f / width, 1.f / height);
+  _sp.unuse();
+}
+
+void Checkerboard::render(Mat44 const &proj, Mat44 const &view, Mat44 const &lastView, int parity, bool temporal) const {
+  gSC.use(_sp);
+
+  gSC.push(_projIndex, proj);
+  gSC.push(_viewIndex, view);
+  gSC.push(_lastViewIndex, lastView);
+  gSC.push(_parityIndex, parity);
+  gSC.push(_temporalIndex, temporal ? 1 : 0);
+
+  _va.bind();
+  gSC.render(_va, primitive::TRIANGLE, 0, 3);
+  _va.unbind();
+
+  gSC.unuse();
+}
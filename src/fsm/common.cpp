@@ -3,10 +3,28 @@
 
 using namespace sky;
 using namespace core;
+using namespace math;
 using namespace scene;
 using namespace tech;
 
+Tile::Tile(ushort width, ushort height) :
+    aspect(1.f * width / height)
+  , scale{ 1.f, 1.f }
+  , offset{ 0.f, 0.f } {
+}
+
+/* scaled and offset in clip space, so that w divides the offset too */
+Mat44 Tile::projection() const {
+  Mat44 window = Mat44::trslt(Vec3<float>(offset[0], offset[1], 0.f));
+
+  window[0][0] = scale[0];
+  window[1][1] = scale[1];
+  return window * Mat44::perspective(FOVY, aspect, ZNEAR, ZFAR);
+}
+
 Common::Common(ushort width, ushort height) :
-    drenderer(width, height)
+    tile(width, height)
+  , quality(quality_tier(QUALITY_HIGH))
+  , drenderer(width, height)
   , stringRenderer(width, height, GLPH_index, 90, '!') {
 }
@@ -1,10 +1,14 @@
+#include <gl.hpp>
 #include <core/state.hpp>
 #include <fsm/common.hpp>
 #include <fsm/cube_room.hpp>
+#include <fsm/terrain.hpp>
 #include <math/common.hpp>
 #include <math/matrix.hpp>
 #include <math/quaternion.hpp>
 #include <misc/log.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
 
 using namespace std;
 using namespace sky;
@@ -15,47 +19,39 @@ using namespace scene;
 using namespace tech;
 
 namespace {
-  ushort const LASER_TESS_LEVEL = 13;
   float  const LASER_HHEIGHT    = 0.15f;
   float  const SLAB_SIZE        = 1.f;
   float  const SLAB_THICKNESS   = 0.5f;
   uint   const SLAB_INSTANCES   = 600;
   ushort const LIQUID_WIDTH     = 10;
   ushort const LIQUID_HEIGHT    = 10;
-  ushort const LIQUID_TWIDTH    = 80;
-  ushort const LIQUID_THEIGHT   = 80;
-  ushort const LIQUID_RES       = LIQUID_TWIDTH * LIQUID_THEIGHT;
-  char   const *FADE_FS_SRC     =
-"#version 330 core\n"
-
-"out vec4 frag;"
-
-"uniform vec4 res;"
-"uniform sampler2D srctex;"
-"uniform float t;"
-
-"void main(){"
-  "float fade=clamp(1.-pow(max(0.,mod(t,5.2)-4.),4.),0.,1.);"
-  "frag=texelFetch(srctex,ivec2(gl_FragCoord.xy),0)*fade;"
-  "frag.w=1.;"
-"}";
+  float  const TEXT_FOREVER     = 1e9f;
 }
 
-CubeRoom::CubeRoom(ushort width, ushort height, Common &common, Freefly const &freefly) :
+CubeRoom::CubeRoom(ushort width, ushort height, Common &common, Freefly const &freefly, bool prepass) :
     /* common */
     _width(width)
   , _height(height)
-  , _fbCopier(width, height)
   , _freefly(freefly)
+  , _tile(common.tile)
+  , _quality(common.quality)
   , _drenderer(common.drenderer)
   , _matmgr(common.matmgr)
-  , _stringRenderer(common.stringRenderer)
-  , _fadePP("cube room fade", FADE_FS_SRC, width, height)
+  , _camera(common.timeline.camera("cube_room.camera"))
+  , _fade(common.timeline.scalar("cube_room.fade"))
+  , _textCues(common.timeline.event("cube_room.texts"))
+  , _compositor("cube room compositor", 2)
+  , _prepass(prepass)
+  , _graph(width, height)
   , _slab(width, height, SLAB_SIZE, SLAB_THICKNESS)
-  , _liquid(LIQUID_WIDTH, LIQUID_HEIGHT, LIQUID_TWIDTH, LIQUID_THEIGHT)
-  , _laser(width, height, LASER_TESS_LEVEL, LASER_HHEIGHT) {
+  , _liquid(LIQUID_WIDTH, LIQUID_HEIGHT, _quality.liquidTess, _quality.liquidTess)
+  , _laser(width, height, _quality.laserTessLevel, LASER_HHEIGHT, _quality.laserBlur)
+  , _texts(common.stringRenderer)
+  , _pipeline(common.worker, [this](float time, Frame &frame) { _prepare(time, frame); }) {
   _init_materials(width, height);
-  _init_offscreen(width, height);
+  _init_texts();
+  _init_compositor();
+  _init_graph();
 }
 
 void CubeRoom::_init_materials(ushort width, ushort height) {
@@ -65,118 +61,133 @@ void CubeRoom::_init_materials(ushort width, ushort height) {
   _matmgrLPosIndex   = _matmgr.postprocess().program().map_uniform("lightPos");
 }
 
-void CubeRoom::_init_offscreen(ushort width, ushort height) {
-  /* offscreen texture */
-  gTH.bind(Texture::T_2D, _offTex);
-  gTH.parameter(Texture::P_WRAP_S, Texture::PV_CLAMP);
-  gTH.parameter(Texture::P_WRAP_T, Texture::PV_CLAMP);
-  gTH.parameter(Texture::P_MIN_FILTER, Texture::PV_NEAREST);
-  gTH.parameter(Texture::P_MAG_FILTER, Texture::PV_NEAREST);
-  gTH.parameter(Texture::P_MAX_LEVEL, 0);
-  gTH.image_2D(width, height, 0, Texture::F_RGB, Texture::IF_RGB32F, GLT_FLOAT, 0, nullptr);
-  gTH.unbind();
-
-  /* offscreen renderbuffer */
-  gRBH.bind(Renderbuffer::RENDERBUFFER, _offRB);
-  gRBH.store(width, height, Texture::IF_DEPTH_COMPONENT32F);
-  gRBH.unbind();
-
-  /* offscreen framebuffer */
-  gFBH.bind(Framebuffer::DRAW, _offFB);
-  gFBH.attach_renderbuffer(_offRB, Framebuffer::DEPTH_ATTACHMENT);
-  gFBH.attach_2D_texture(_offTex, Framebuffer::color_attachment(0));
-  gFBH.unbind();
+void CubeRoom::_init_texts() {
+  auto const &t = _textCues;
+
+  /* baked once: later sync file changes don't reach the strings */
+  _texts.add("OHAI EVOKE2013! I AM HAPPY TO PRESENT YOU MY SECOND RELEASE", 1.f, 0.25f, 0.08f, t.time(0), 0.5f, t.time(0), t.time(2));
+  _texts.add("HEAT STATION", 1.f, 0.15f, 0.1f, t.time(1), 0.5f, t.time(0), t.time(2));
+  _texts.add("THIS LITTLE 64K INTRO WAS WRITTEN BY ME SKYPERS", 1.f, -0.35f, 0.08f, t.time(2), 0.5f, t.time(2), TEXT_FOREVER);
+  _texts.add("AND ITS SOUNDTRACK WAS PROVIDED BY GASPODE", 1.f, -0.2f, 0.08f, t.time(3), 0.5f, t.time(2), TEXT_FOREVER);
+  _texts.add("THANK YOU GASPODE!", 1.f, 0.1f, 0.08f, t.time(4), 0.5f, t.time(2), TEXT_FOREVER);
+  _texts.commit();
 }
 
-void CubeRoom::_draw_texts(float t) const {
-  state::enable(state::BLENDING);
-  Framebuffer::blend_func(blending::ONE, blending::ONE);
-  _stringRenderer.start_draw();
-
-  if (t < 41.f) {
-  } else if (t < 61.5f) {
-    _stringRenderer.draw_string("OHAI EVOKE2013! I AM HAPPY TO PRESENT YOU MY SECOND RELEASE", 1.f-(t-41.f)*0.5f, 0.25f, 0.08f);
-    _stringRenderer.draw_string("HEAT STATION", 1.f-(t-51.f)*0.5f, 0.15f, 0.1f);
-  } else {
-    _stringRenderer.draw_string("THIS LITTLE 64K INTRO WAS WRITTEN BY ME SKYPERS", 1.f-(t-61.5f)*0.5f, -0.35f, 0.08f);
-    _stringRenderer.draw_string("AND ITS SOUNDTRACK WAS PROVIDED BY GASPODE", 1.f-(t-65.5f)*0.5f, -0.2f, 0.08f);
-    _stringRenderer.draw_string("THANK YOU GASPODE!", 1.f-(t-70.5f)*0.5f, 0.1f, 0.08f);
-  }
+/* room and laser (s0, s1) in, faded while fading */
+void CubeRoom::_init_compositor() {
+  auto const &frame = _pipeline.front();
 
-  _stringRenderer.end_draw();
-  state::disable(state::BLENDING);
+  _compositor.stage("color = s0 + s1;");
+  _compositor.stage("color *= clamp(1. - pow(max(0., mod(p, 5.2) - 4.), 4.), 0., 1.);"
+                  , [&frame]() { return frame.fade; }
+                  , [&frame]() { return frame.fade >= 0.f; });
+  _compositor.compile();
 }
 
-void CubeRoom::run(float time) {
-  /* projection & view */
-  auto proj = Mat44::perspective(FOVY, 1.f * _width / _height, ZNEAR, ZFAR);
-  auto yaw = Orient(Axis3(0.f, 1.f, 0.f), PI_2).to_matrix();
-  auto pitch = Orient(Axis3(1.f, 0.f, 0.f), -PI_2).to_matrix();
-  bool useFade = true;
-  Mat44 view;
-
-  //misc::log << debug << "CubeRoom::run()" << endl;
-  
-  /* FIXME: WHOOO THAT'S DIRTY!! DO YOU THINK SO?! */
-  if (time <= 5.2f) {
-    view = Mat44::trslt(-Position(1.f, 0.f, 0.f)) * yaw;
-  } else if (time <= 10.4f) {
-    view = Mat44::trslt(-Position(0.f, 1.f, 0.f)) * pitch;
-  } else if (time <= 15.6f) {
-    view = Mat44::trslt(-Position(1.f, 1.f, 1.f)) * Orient(Axis3(0.f, 1.f, 0.f), PI_2 / 3.).to_matrix();// * Orient(Axis3(1.f, 0.f, 0.f), -PI_4).to_matrix();
-  } else if (time <= 20.8f) {
-    view = Mat44::trslt(-Position(0.f, 1.f, 1.f)) * Orient(Axis3(0.f, 1.f, 0.f), PI_2 / 3.).to_matrix() * Orient(Axis3(1.f, 0.f, 0.f), -PI_4).to_matrix();
-  } else {
-    view = Mat44::trslt(-Position(cosf(time), sinf(time), sinf(time))*1.5f) * Orient(Axis3(0.f, 1.f, 0.f), time * PI_2 / 3.).to_matrix() * Orient(Axis3(0.f, 0.f, 1.f), sinf(time)+time*0.5f).to_matrix();
-    if (time <= 75.f)
-      useFade = false;
-  }
+void CubeRoom::_draw_texts(Frame const &frame) const {
+  gSC.enable(state::BLENDING);
+  gSC.blend_func(blending::ONE, blending::ONE);
+  _texts.render(frame.view.time, frame.texts);
+  gSC.disable(state::BLENDING);
+}
 
-  _drenderer.start_geometry();
-  state::enable(state::DEPTH_TEST);
-  state::clear(state::COLOR_BUFFER | state::DEPTH_BUFFER);
-  _slab.render(time, proj, view, SLAB_INSTANCES);
-  _liquid.render(time, proj, view, LIQUID_RES);
-  _drenderer.end_geometry();
-
-  gFBH.bind(Framebuffer::DRAW, _offFB);
-  state::disable(state::DEPTH_TEST);
-  state::enable(state::BLENDING);
-  state::clear(state::COLOR_BUFFER | state::DEPTH_BUFFER);
-
-  _drenderer.start_shading();
-  _matmgr.start();
-
-  _matmgrProjIndex.push(proj);
-  _matmgrViewIndex.push(view);
-  _matmgrLColorIndex.push(0.75f, 0.f, 0.f);
-  _matmgrLPosIndex.push(0.f, 0.f, 0.f);
-  _matmgr.render();
-
-  _matmgr.end();
-  _drenderer.end_shading();
-
-  state::clear(state::DEPTH_BUFFER);
-
-  _laser.render(time, proj, view, LASER_TESS_LEVEL);
-
-  _draw_texts(time);
-  gFBH.unbind();
-  gFBH.unbind(); /* hihi... :DDDD */
-
-  if (useFade) {
-    gFBH.unbind();
-    _fadePP.start();
-    gTH.unit(0);
-    gTH.bind(Texture::T_2D, _offTex);
-    if (time <= 75.f)
-      _fadePP.apply(time);
-    else
-      _fadePP.apply(time-75.f);
-    gTH.unbind();
-    _fadePP.end();
-  } else {
-    _fbCopier.copy(_offTex);
+void CubeRoom::_init_graph() {
+  auto const &frame = _pipeline.front();
+  auto gbuffer = _graph.external("cube room G-buffer", [this]() { _drenderer.start_geometry(); }, [this]() { _drenderer.end_geometry(); });
+  auto shaded = _graph.transient("cube room");
+  uint liquidRes = _quality.liquidTess * _quality.liquidTess;
+
+  /* no color written; the slabs' geometry shader is skipped too */
+  if (_prepass) {
+    _graph.pass("cube room depth", [this, &frame, liquidRes]() {
+      auto const &v = frame.view;
+      gSC.enable(state::DEPTH_TEST);
+      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      _prepassSamples.begin();
+      if (frame.liquidFirst)
+        _liquid.render_depth(v.time, v.proj, v.view, liquidRes);
+      _slab.render_depth(v.proj, v.view, frame.walls, SLAB_INSTANCES);
+      if (!frame.liquidFirst)
+        _liquid.render_depth(v.time, v.proj, v.view, liquidRes);
+      _prepassSamples.end();
+      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }).draws(gbuffer, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
   }
+
+  /* after the pre-pass, only the fragments that won it pass */
+  auto geometry = _graph.pass("cube room geometry", [this, &frame, liquidRes]() {
+    auto const &v = frame.view;
+    gSC.enable(state::DEPTH_TEST);
+    if (_prepass) {
+      glDepthFunc(GL_EQUAL);
+      glDepthMask(GL_FALSE);
+    }
+    _geometrySamples.begin();
+    _slab.render(v.time, v.proj, v.view, SLAB_INSTANCES);
+    _liquid.render(v.time, v.proj, v.view, liquidRes);
+    _geometrySamples.end();
+    if (_prepass) {
+      glDepthMask(GL_TRUE);
+      glDepthFunc(GL_LESS);
+    }
+  });
+
+  if (_prepass)
+    geometry.draws(gbuffer, RenderGraph::LOAD).depth(RenderGraph::LOAD);
+  else
+    geometry.draws(gbuffer, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
+
+  _graph.pass("cube room shading", [this, &frame]() {
+    gSC.disable(state::DEPTH_TEST);
+    gSC.enable(state::BLENDING);
+
+    _drenderer.start_shading();
+    _matmgr.start();
+
+    gSC.push(_matmgrProjIndex, frame.view.proj);
+    gSC.push(_matmgrViewIndex, frame.view.view);
+    gSC.push(_matmgrLColorIndex, 0.75f, 0.f, 0.f);
+    gSC.push(_matmgrLPosIndex, 0.f, 0.f, 0.f);
+    gSC.helper([this]() { _matmgr.render(); });
+
+    _matmgr.end();
+    _drenderer.end_shading();
+    gSC.forget();
+    gSC.disable(state::BLENDING);
+  }).reads(gbuffer).draws(shaded, RenderGraph::CLEAR);
+
+  _graph.pass("cube room texts", [this, &frame]() {
+    _draw_texts(frame);
+  }).draws(shaded, RenderGraph::LOAD);
+
+  auto laser = _laser.add_passes(_graph, frame.view, _quality.laserTessLevel);
+
+  /* one write of the backbuffer, whatever the compositor does */
+  _graph.pass("cube room composite", [this]() {
+    gSC.disable(state::BLENDING);
+    gSC.disable(state::DEPTH_TEST);
+    _compositor.apply();
+  }).reads(shaded).reads(laser).draws(RenderGraph::BACKBUFFER, RenderGraph::DISCARD);
+
+  _graph.prepare();
+}
+
+/* on the frame worker */
+void CubeRoom::_prepare(float time, Frame &frame) const {
+  frame.view.time = time;
+  frame.view.proj = _tile.projection();
+  frame.view.view = _camera.at(time);
+  frame.fade = _fade.at(time);
+
+  /* coarse, by walls: fine enough for the pre-pass */
+  float eye[3];
+  Terrain::eye_position(frame.view.view, eye);
+  _slab.sort_walls(eye, frame.walls);
+  frame.liquidFirst = _liquid.distance(eye) < _slab.wall_distance(eye, frame.walls[0]);
+  frame.texts = _texts.cull(time);
 }
 
+void CubeRoom::run(float time) {
+  _pipeline.update(time);
+  _graph.execute();
+}
@@ -0,0 +1,5 @@
+#version 330 core
+
+/* depth pre-passes: only the depth test and write matter */
+void main() {
+}
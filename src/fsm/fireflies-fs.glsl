@@ -4,8 +4,11 @@ flat in vec3 gcolor;
 in vec2 gco;
 out vec4 frag;
 
+uniform sampler2D audio;
+
 void main() {
   float d = (1. - sqrt(length(gco)));
-  frag = vec4(gcolor, 1.) * d * 2.5;//vec4(2.4, 2., 3.6, 4.);
+  float beat = texelFetch(audio, ivec2(16, 0), 0).g; /* last texel: loudness, beat */
+  frag = vec4(gcolor, 1.) * d * (2.5 + beat * 1.5);//vec4(2.4, 2., 3.6, 4.);
 }
 
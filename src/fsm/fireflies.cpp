@@ -1,101 +1,113 @@
-#include <cstdlib>
-#include <ctime>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <audio_texture.hpp>
 #include <fsm/fireflies.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
 
+using namespace std;
 using namespace sky;
 using namespace core;
 using namespace math;
 using namespace scene;
 
 namespace {
-  char const *FIREFLIES_VS_SRC =
-"#version 330 core\n"
-
-"layout(location=0)in vec3 co;"
-"layout(location=1)in vec3 color;"
-
-"out vec3 vco;"
-"out vec3 vcolor;"
-
-"void main(){"
-  "vco=co;"
-  "vcolor=color;"
-"}";
-  char const *FIREFLIES_GS_SRC =
-"#version 330 core\n"
-
-"layout(points)in;"
-"layout(triangle_strip,max_vertices=6)out;"
-
-"in vec3 vco[];"
-"in vec3 vcolor[];"
-"out vec2 gco;"
-"flat out vec3 gcolor;"
-
-"uniform mat4 proj;"
-"uniform mat4 view;"
-
-"const float s=0.6;"
-
-"const vec2[4] tile=vec2[]("
-    "vec2(-s,s)"
-  ",vec2(s,s)"
-  ",vec2(-s-s)"
-  ",vec2(s,-s)"
-");"
-
-"void emit_vertex(uint i){"
-  "gl_Position=proj*(view*vec4(vco[0],1.)+vec4(tile[i],0.,1.));"
-  "gco=tile[i]/s;"
-  "gcolor=vcolor[0];"
-  "EmitVertex();"
-"}"
-
-"void main(){"
-  "for (uint i=0u;i<4u;++i)"
-    "emit_vertex(i);"
-"}";
-  char const *FIREFLIES_FS_SRC =
-"#version 330 core\n"
-
-"flat in vec3 gcolor;"
-"in vec2 gco;"
-"out vec4 frag;"
-
-"void main(){"
-  "float d=(1.-sqrt(length(gco)));"
-  "frag=vec4(gcolor,1.)*d*2.5;" //vec4(2.4, 2., 3.6, 4.);
-"}";
+  float const SWARM_SIZE = 100.f;
 }
 
-Fireflies::Fireflies() {
+Fireflies::Fireflies(uint nb) :
+    _nb(nb)
+  , _step(0)
+  , _front(0)
+  , _lightsSim(nb) {
   _init_fireflies();
+  _init_va();
+  _init_simulation();
   _init_shader();
-  srand(time(nullptr));
 }
 
 void Fireflies::_init_fireflies() {
-  for (int i = 0; i < FIREFLIES_NB; ++i) {
-    int j = i - FIREFLIES_NB / 2.f;
-    _pos[i] = Position(sinf(i)*j*10.f, (1. - sinf(i)), cosf(i)*j*10.f);
-    _colors[i] = Vec3<float>(0.5f + j/20.f, 1.f - 0.5*(1.+ tanf(j*10.f)), 1.f - pow(j % 5, 2)/30.f);
+  vector<Vec3<float>> colors(_nb);
+
+  for (uint i = 0; i < _nb; ++i) {
+    if (i < FIREFLIES_LIGHTS) {
+      int j = i - FIREFLIES_LIGHTS / 2.f;
+      colors[i] = Vec3<float>(0.5f + j/20.f, 1.f - 0.5*(1.+ tanf(j*10.f)), 1.f - pow(j % 5, 2)/30.f);
+      _colorsLights[i] = colors[i];
+    } else {
+      colors[i] = Vec3<float>(FireflyLights::unit(i*7+3), FireflyLights::unit(i*7+4), FireflyLights::unit(i*7+5)) * 0.5f + Vec3<float>(0.75f, 0.75f, 0.75f);
+    }
   }
 
-  /* init buffer */
-  gBH.bind(Buffer::ARRAY, _vbo);
-  gBH.data(FIREFLIES_NB*(sizeof(Position)+sizeof(Vec3<float>)), Buffer::STATIC_DRAW, &_pos);
+  gBH.bind(Buffer::ARRAY, _colors);
+  gSC.data(_nb*sizeof(Vec3<float>), Buffer::STATIC_DRAW, colors.data());
   gBH.unbind();
 
-  /* init va */
+  _reset();
+}
+
+void Fireflies::_reset() {
+  vector<Position> pos(_nb);
+
+  for (uint i = 0; i < _nb; ++i) {
+    if (i < FIREFLIES_LIGHTS) {
+      pos[i] = FireflyLights::origin(i);
+    } else {
+      pos[i] = Position(FireflyLights::unit(i*7)*SWARM_SIZE, FireflyLights::unit(i*7+1)+1.f, FireflyLights::unit(i*7+2)*SWARM_SIZE);
+    }
+  }
+
+  _step = 0;
+  _front = 0;
+  gBH.bind(Buffer::ARRAY, _pos[0]);
+  gSC.data(_nb*sizeof(Position), Buffer::DYNAMIC_DRAW, pos.data());
+  gBH.bind(Buffer::ARRAY, _pos[1]);
+  gSC.data(_nb*sizeof(Position), Buffer::DYNAMIC_DRAW, nullptr);
+  gBH.unbind();
+}
+
+void Fireflies::_init_va() {
   Program::In co(semantic::CO);
   Program::In color(1);
-  _va.bind();
-  co.enable();
-  color.enable();
-  gBH.bind(Buffer::ARRAY, _vbo);
-  co.pointer(3, GLT_FLOAT, false);
-  color.pointer(3, GLT_FLOAT, false, FIREFLIES_NB*sizeof(Position));
-  _va.unbind();
+
+  for (short i = 0; i < 2; ++i) {
+    /* simulation: positions only */
+    _simVA[i].bind();
+    co.enable();
+    gBH.bind(Buffer::ARRAY, _pos[i]);
+    co.pointer(3, GLT_FLOAT, false);
+    _simVA[i].unbind();
+
+    /* render: positions and colors, in separate buffers */
+    _va[i].bind();
+    co.enable();
+    color.enable();
+    gBH.bind(Buffer::ARRAY, _pos[i]);
+    co.pointer(3, GLT_FLOAT, false);
+    gBH.bind(Buffer::ARRAY, _colors);
+    color.pointer(3, GLT_FLOAT, false);
+    _va[i].unbind();
+  }
+
+  gBH.unbind();
+}
+
+/* the captured output has to be named before linking, which skyoralis
+ * has no call for */
+void Fireflies::_init_simulation() {
+  char const *varyings[] = { "nco" };
+  Shader vs(Shader::VERTEX);
+
+  vs.source(shader_source(SHADER_FIREFLIES_SIM_VS));
+  vs.compile("fireflies simulation shader");
+
+  _simProgram.attach(vs);
+  glTransformFeedbackVaryings(_simProgram.id(), 1, varyings, GL_SEPARATE_ATTRIBS);
+  _simProgram.link();
+
+  _simFirstIndex = _simProgram.map_uniform("firstStep");
+  _simLastIndex  = _simProgram.map_uniform("lastStep");
 }
 
 void Fireflies::_init_shader() {
@@ -103,11 +115,11 @@ void Fireflies::_init_shader() {
   Shader gs(Shader::GEOMETRY);
   Shader fs(Shader::FRAGMENT);
 
-  vs.source(FIREFLIES_VS_SRC);
+  vs.source(shader_source(SHADER_FIREFLIES_VS));
   vs.compile("fireflies vertex shader");
-  gs.source(FIREFLIES_GS_SRC);
+  gs.source(shader_source(SHADER_FIREFLIES_GS));
   gs.compile("fireflies geometry shader");
-  fs.source(FIREFLIES_FS_SRC);
+  fs.source(shader_source(SHADER_FIREFLIES_FS));
   fs.compile("fireflies fragement shader");
   
   _sp.attach(vs);
@@ -119,53 +131,59 @@ void Fireflies::_init_shader() {
 }
 
 void Fireflies::_init_uniforms() {
+  auto audioIndex = _sp.map_uniform("audio");
   _projIndex  = _sp.map_uniform("proj");
   _viewIndex  = _sp.map_uniform("view");
-}
 
-sky::scene::Position const * Fireflies::positions() const {
-  return _pos;
+  _sp.use();
+  audioIndex.push(static_cast<int>(AUDIO_UNIT));
+  _sp.unuse();
 }
 
 sky::math::Vec3<float> const * Fireflies::colors() const {
-  return _colors;
+  return _colorsLights;
 }
 
 void Fireflies::render(Mat44 const &proj, Mat44 const &view) const {
-  _sp.use();
+  gSC.use(_sp);
 
-  _projIndex.push(proj);
-  _viewIndex.push(view);
+  gSC.push(_projIndex, proj);
+  gSC.push(_viewIndex, view);
 
-  _va.bind();
-  _va.render(primitive::POINT, 0, FIREFLIES_NB);
-  _va.unbind();
+  _va[_front].bind();
+  gSC.render(_va[_front], primitive::POINT, 0, _nb);
+  _va[_front].unbind();
 
-  _sp.unuse();
+  gSC.unuse();
 }
 
-void Fireflies::animate(float time) {
-  static float lastTime = 0.f;
-  float elapsed = time - lastTime;
-  float const UPDATE_TIME = 0.3f; /* update every 100ms */
-  static Vec3<float> offset[FIREFLIES_NB];
-
-  for (int i = 0; i < FIREFLIES_NB; ++i) {
-    if (elapsed >= UPDATE_TIME) {
-      float x = (1.f * (rand() % 1000) / 1000.f) - 0.5f;
-      float y = (1.f * (rand() % 1000) / 1000.f) - 0.5f;
-      float z = (1.f * (rand() % 1000) / 1000.f) - 0.5f;
-      offset[i] = Vec3<float>(x, y, z)*0.08f;
-    }
-
-    _pos[i] += offset[i];
-  }
-
-  if (elapsed >= UPDATE_TIME)
-    lastTime = time;
-
-  gBH.bind(Buffer::ARRAY, _vbo);
-  gBH.subdata(0, FIREFLIES_NB*sizeof(Position), &_pos);
-  gBH.unbind();
+void Fireflies::simulate(float time, Position *lights) {
+  _lightsSim.simulate(time, lights);
 }
 
+void Fireflies::animate(float time) {
+  uint target = FireflyLights::steps(time);
+
+  if (target < _step) /* going back in time */
+    _reset();
+  if (target == _step)
+    return;
+
+  /* from the front buffer to the back one */
+  gSC.use(_simProgram);
+  gSC.push(_simFirstIndex, static_cast<int>(_step));
+  gSC.push(_simLastIndex, static_cast<int>(target));
+  glEnable(GL_RASTERIZER_DISCARD);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _pos[1-_front].id());
+  glBeginTransformFeedback(GL_POINTS);
+  _simVA[_front].bind();
+  gSC.render(_simVA[_front], primitive::POINT, 0, _nb);
+  _simVA[_front].unbind();
+  glEndTransformFeedback();
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  glDisable(GL_RASTERIZER_DISCARD);
+  gSC.unuse();
+
+  _front = 1 - _front;
+  _step = target;
+}
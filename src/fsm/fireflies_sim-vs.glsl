@@ -0,0 +1,44 @@
+#version 330 core
+
+layout (location = 0) in vec3 co;
+
+out vec3 nco;
+
+uniform int firstStep;
+uniform int lastStep; /* excluded */
+
+const uint WINDOW_STEPS = 18u;
+const float STEP_OFFSET = 0.08;
+
+uint hash(uint x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+float unit(uint x) {
+  return float(hash(x) >> 8) * (1. / 16777216.) - 0.5;
+}
+
+vec3 heading(uint id, uint w) {
+  uint k = hash(id*0x9e3779b9u ^ hash(w));
+  return vec3(unit(k), unit(k+1u), unit(k+2u)) * STEP_OFFSET;
+}
+
+/* integrate whole windows at once: the heading is constant in a window */
+void main() {
+  uint id = uint(gl_VertexID);
+  uint s = uint(firstStep);
+  uint e = uint(lastStep);
+
+  nco = co;
+  while (s < e) {
+    uint w = s / WINDOW_STEPS;
+    uint n = min(e, (w+1u)*WINDOW_STEPS) - s;
+    nco += heading(id, w) * float(n);
+    s += n;
+  }
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cmath>
+#include <fsm/firefly_lights.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace math;
+using namespace scene;
+
+namespace {
+  float const STEP_RATE    = 60.f; /* simulation steps per second */
+  uint  const WINDOW_STEPS = 18;   /* steps a firefly keeps its heading (0.3s) */
+  float const STEP_OFFSET  = 0.08f;
+
+  /* CPU mirror of the simulation hash; must stay bit-exact with the shader */
+  uint hash32(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+  }
+
+  Vec3<float> heading(uint id, uint w) {
+    uint k = hash32(id*0x9e3779b9u ^ hash32(w));
+    return Vec3<float>(FireflyLights::unit(k), FireflyLights::unit(k+1), FireflyLights::unit(k+2)) * STEP_OFFSET;
+  }
+}
+
+int const FireflyLights::NB;
+
+FireflyLights::FireflyLights(uint nb) :
+    _nb(min<uint>(nb, NB)) {
+  reset();
+}
+
+void FireflyLights::reset() {
+  for (uint i = 0; i < NB; ++i)
+    _lights[i] = origin(i);
+  _step = 0;
+}
+
+void FireflyLights::simulate(float time, Position *lights) {
+  uint target = steps(time);
+
+  if (target < _step) /* going back in time */
+    reset();
+
+  for (uint s = _step; s < target;) {
+    uint w = s / WINDOW_STEPS;
+    uint n = min(target, (w+1)*WINDOW_STEPS) - s;
+
+    for (uint i = 0; i < _nb; ++i)
+      _lights[i] += heading(i, w) * (1.f * n);
+    s += n;
+  }
+  _step = target;
+
+  copy(_lights, _lights + NB, lights);
+}
+
+float FireflyLights::unit(uint x) {
+  return (hash32(x) >> 8) * (1.f / 16777216.f) - 0.5f;
+}
+
+Position FireflyLights::origin(uint i) {
+  int j = i - NB / 2.f;
+  return Position(sinf(i)*j*10.f, (1. - sinf(i)), cosf(i)*j*10.f);
+}
+
+uint FireflyLights::steps(float time) {
+  return static_cast<uint>(max(0.f, time) * STEP_RATE);
+}
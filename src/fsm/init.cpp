@@ -12,7 +12,7 @@ void init_materials(MaterialManager &matmgr) {
 PartState * init_sync(ushort width, ushort height, Common &common, Freefly const &freefly) {
   init_materials(common.matmgr);
 
-  auto cubeRoom = new CubeRoom(width, height, common, freefly);
+  auto cubeRoom = new CubeRoom(width, height, common, freefly, false);
   //auto stairway = new Stairway(width, height, common, freefly);
   return cubeRoom;
 }
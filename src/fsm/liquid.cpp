@@ -1,82 +1,30 @@
+#include <cmath>
 #include <fsm/liquid.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
 
 using namespace sky;
 using namespace core;
 using namespace math;
 
 namespace {
-  char const *LIQUID_VS_SRC =
-"#version 330 core\n"
-
-"precision highp float;"
-
-"layout(location=0)in vec3 co;"
-
-"out vec3 vco;"
-"out vec3 vno;"
-
-"uniform mat4 proj;"
-"uniform mat4 view;"
-"uniform float time;"
-
-"const float h=0.00001;"
-"const float a=0.5;"
-
-"float water(vec2 xy){"
-  "float w="
-      "sin(xy.x*8.+time*3.)"
-    "+sin(xy.y*8.)"
-    "+sin(length(xy+vec2(cos(time*0.5),sin(time*0.5))+1.)*10.+time*6.)"
-    "+sin(xy.x*10.+time*6.)*sin(xy.y*6)"
-    ";"
-  "return w/4.*a;"
-"}"
-
-"vec3 deriv_no(vec2 xz,float h){"
-  "float wxz=water(xz);"
-  "float dx=water(vec2(xz.x+h,xz.y))-wxz;"
-  "float dz=water(vec2(xz.x,xz.y+h))-wxz;"
-
-  "return normalize(vec3(-dx,h,-dz));"
-"}"
-
-"void main(){"
-  "vec2 lookup=co.xy*0.2;"
-  "vco=vec3(co.x,water(lookup)-3.,co.y);"
-  "vno=deriv_no(lookup,h);"
-
-  "gl_Position=proj*view*vec4(vco,1.);"
-"}";
-  char const *LIQUID_FS_SRC =
-"#version 330 core\n"
-
-"in vec3 vco;"
-"in vec3 vno;"
-
-"uniform mat4 view;"
-
-"layout(location=0)out vec3 nofrag;"
-"layout(location=1)out uvec2 matfrag;"
-
-"void main() {"
-  "nofrag=vno;"
-  "matfrag=uvec2(1,1);"
-"}";
+  float const LEVEL = -3.f; /* as in water-vs.glsl */
 }
 
 Liquid::Liquid(uint width, uint height, uint twidth, uint theight) :
     _plane(width, height, twidth, theight) {
   _init_program();
   _init_uniforms();
+  _init_depth_program();
 }
 
 void Liquid::_init_program() {
   Shader vs(Shader::VERTEX);
   Shader fs(Shader::FRAGMENT);
 
-  vs.source(LIQUID_VS_SRC);
+  vs.source(shader_source(SHADER_WATER_VS));
   vs.compile("water vertex shader");
-  fs.source(LIQUID_FS_SRC);
+  fs.source(shader_source(SHADER_WATER_FS));
   fs.compile("water fragment shader");
 
   _sp.attach(vs);
@@ -90,15 +38,48 @@ void Liquid::_init_uniforms() {
   _timeIndex = _sp.map_uniform("time");
 }
 
+void Liquid::_init_depth_program() {
+  Shader vs(Shader::VERTEX);
+  Shader fs(Shader::FRAGMENT);
+
+  vs.source(shader_source(SHADER_WATER_DEPTH_VS));
+  vs.compile("water depth vertex shader");
+  fs.source(shader_source(SHADER_DEPTH_FS));
+  fs.compile("depth fragment shader");
+
+  _depthSp.attach(vs);
+  _depthSp.attach(fs);
+  _depthSp.link();
+
+  _depthProjIndex = _depthSp.map_uniform("proj");
+  _depthViewIndex = _depthSp.map_uniform("view");
+  _depthTimeIndex = _depthSp.map_uniform("time");
+}
+
 void Liquid::render(float time, Mat44 const &proj, Mat44 const &view, uint n) const {
-  _sp.use();
+  gSC.use(_sp);
 
-  _projIndex.push(proj);
-  _viewIndex.push(view);
-  _timeIndex.push(time);
+  gSC.push(_projIndex, proj);
+  gSC.push(_viewIndex, view);
+  gSC.push(_timeIndex, time);
 
-  _plane.va.indexed_render(primitive::TRIANGLE, n*6, GLT_UINT);
+  gSC.indexed_render(_plane.va, primitive::TRIANGLE, n*6, GLT_UINT);
   
-  _sp.unuse();
+  gSC.unuse();
 }
 
+void Liquid::render_depth(float time, Mat44 const &proj, Mat44 const &view, uint n) const {
+  gSC.use(_depthSp);
+
+  gSC.push(_depthProjIndex, proj);
+  gSC.push(_depthViewIndex, view);
+  gSC.push(_depthTimeIndex, time);
+
+  gSC.indexed_render(_plane.va, primitive::TRIANGLE, n*6, GLT_UINT);
+
+  gSC.unuse();
+}
+
+float Liquid::distance(float const *eye) const {
+  return fabs(eye[1] - LEVEL);
+}
@@ -0,0 +1,88 @@
+#version 330 core
+
+flat in mat4 reproj;
+
+out vec3 frag;
+
+uniform sampler2D history;      /* last frame's colors */
+uniform sampler2D velocity;     /* uv motion and view depth */
+uniform sampler2D lastVelocity;
+uniform mat4 proj;
+uniform vec4 res;               /* size, 1 / size */
+
+const float DEPTH_TOLERANCE    = 0.02; /* relative */
+const float VELOCITY_TOLERANCE = 0.5;  /* relative, over 2 texels */
+const int   RINGS              = 3;    /* of the search, 1, 2 and 4 texels out */
+
+ivec2 size;
+float expected;   /* depth of the surface as the last camera saw it */
+vec2 motion;
+
+/* the last frame saw the same surface there, moving the same way */
+bool matches(ivec2 q) {
+  vec3 last = texelFetch(lastVelocity, q, 0).xyz;
+
+  return abs(last.z - expected) <= expected * DEPTH_TOLERANCE &&
+         length((last.xy - motion) * res.xy) <= 2. + VELOCITY_TOLERANCE * length(motion * res.xy);
+}
+
+void main() {
+  vec2 uv = gl_FragCoord.xy * res.zw;
+  vec3 v = texelFetch(velocity, ivec2(gl_FragCoord.xy), 0).xyz;
+  vec2 last = uv - v.xy;
+
+  size = ivec2(res.xy);
+
+  /* no geometry: nothing to check against */
+  if (v.z <= 0.) {
+    frag = texture(history, last).rgb;
+    return;
+  }
+
+  vec2 ndc = uv * 2. - 1.;
+  expected = -(reproj * vec4(ndc * v.z / vec2(proj[0][0], proj[1][1]), -v.z, 1.)).z;
+  motion = v.xy;
+  ivec2 texel = clamp(ivec2(last * res.xy), ivec2(0), size - 1);
+
+  if (matches(texel)) {
+    frag = texture(history, last).rgb;
+    return;
+  }
+
+  /* rejected, disoccluded or off screen last frame: the matching texels
+   * around, averaged, nearest ring first */
+  vec3 sum = vec3(0.);
+  float n = 0.;
+  for (int r = 0; r < RINGS && n == 0.; ++r) {
+    int step = 1 << r;
+
+    for (int y = -1; y <= 1; ++y) {
+      for (int x = -1; x <= 1; ++x) {
+        ivec2 q = texel + ivec2(x, y) * step;
+
+        if ((x != 0 || y != 0) && all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, size)) && matches(q)) {
+          sum += texelFetch(history, q, 0).rgb;
+          n += 1.;
+        }
+      }
+    }
+  }
+
+  /* nothing of it anywhere near: the nearest ring, weighted by depth */
+  if (n == 0.) {
+    for (int y = -1; y <= 1; ++y) {
+      for (int x = -1; x <= 1; ++x) {
+        ivec2 q = clamp(texel + ivec2(x, y), ivec2(0), size - 1);
+        float w = exp(-abs(texelFetch(lastVelocity, q, 0).z - expected) / (expected * DEPTH_TOLERANCE));
+
+        sum += w * texelFetch(history, q, 0).rgb;
+        n += w;
+      }
+    }
+    if (n < 1e-4) {
+      frag = texelFetch(history, texel, 0).rgb;
+      return;
+    }
+  }
+  frag = sum / n;
+}
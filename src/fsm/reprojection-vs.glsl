@@ -0,0 +1,12 @@
+#version 330 core
+
+uniform mat4 view;
+uniform mat4 lastView;
+
+flat out mat4 reproj; /* view space, from this frame's to the last one's */
+
+/* one triangle covering the screen */
+void main() {
+  reproj = lastView * inverse(view);
+  gl_Position = vec4(float(gl_VertexID / 2) * 4. - 1., float(gl_VertexID % 2) * 4. - 1., 0., 1.);
+}
@@ -0,0 +1,57 @@
+#include <fsm/reprojection.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+
+using namespace sky;
+using namespace core;
+using namespace math;
+
+Reprojection::Reprojection(ushort width, ushort height) {
+  _init_program();
+  _init_uniforms(width, height);
+}
+
+void Reprojection::_init_program() {
+  Shader vs(Shader::VERTEX);
+  Shader fs(Shader::FRAGMENT);
+
+  vs.source(shader_source(SHADER_REPROJECTION_VS));
+  vs.compile("reprojection vertex shader");
+  fs.source(shader_source(SHADER_REPROJECTION_FS));
+  fs.compile("reprojection fragment shader");
+
+  _sp.attach(vs);
+  _sp.attach(fs);
+  _sp.link();
+}
+
+void Reprojection::_init_uniforms(ushort width, ushort height) {
+  auto historyIndex      = _sp.map_uniform("history");
+  auto velocityIndex     = _sp.map_uniform("velocity");
+  auto lastVelocityIndex = _sp.map_uniform("lastVelocity");
+  auto resIndex          = _sp.map_uniform("res");
+  _projIndex             = _sp.map_uniform("proj");
+  _viewIndex             = _sp.map_uniform("view");
+  _lastViewIndex         = _sp.map_uniform("lastView");
+
+  _sp.use();
+  historyIndex.push(0);
+  velocityIndex.push(1);
+  lastVelocityIndex.push(2);
+  resIndex.push(1.f * width, 1.f * height, 1.f / width, 1.f / height);
+  _sp.unuse();
+}
+
+void Reprojection::render(Mat44 const &proj, Mat44 const &view, Mat44 const &lastView) const {
+  gSC.use(_sp);
+
+  gSC.push(_projIndex, proj);
+  gSC.push(_viewIndex, view);
+  gSC.push(_lastViewIndex, lastView);
+
+  _va.bind();
+  gSC.render(_va, primitive::TRIANGLE, 0, 3);
+  _va.unbind();
+
+  gSC.unuse();
+}
@@ -3,6 +3,8 @@
 layout (triangles) in;
 layout (triangle_strip, max_vertices = 3) out;
 
+invariant gl_Position; /* the depth pre-pass must find the same depths */
+
 in vec3 vco[];
 in vec3 vno[];
 
@@ -1,14 +1,22 @@
+#include <algorithm>
+#include <cmath>
 #include <core/framebuffer.hpp>
 #include <core/renderbuffer.hpp>
 #include <fsm/slab.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
 #include <tech/post_process.hpp>
 
+using namespace std;
 using namespace sky;
 using namespace core;
 using namespace math;
 using namespace tech;
 
 namespace {
+  float const MARGIN         = 0.05f; /* between slabs, as in room-vs.glsl */
+  uint  const WALL_AXES[]    = { 2, 2, 0, 0, 1, 1 };
+
   uint const ids[] = {
     /* front face */
       0, 1, 2
@@ -29,119 +37,23 @@ namespace {
     , 0, 3, 4
     , 3, 4, 7
   };
-  char const *ROOM_VS_SRC =
-"#version 330 core\n"
-
-"out vec3 vco;" /* space coordinates as vertex shader output */
-"out vec3 vno;" /* normal as vertex shader output */
-
-"uniform float size;"      /* size of the slab */
-"uniform float thickness;" /* thickness of the slab: 0. = 0., 1. = size */
-"uniform float t;"
-
-/* slab vertices */
-"const float margin=0.05;"
-"float offset=size+margin;"
-"float size_2=size/2.;"
-"float depth_2=size_2*thickness;"
-"vec3[8] v=vec3[]("
-    "vec3(-size_2,size_2,depth_2)"
-  ", vec3(size_2,size_2,depth_2)"
-  ", vec3(size_2,-size_2,depth_2)"
-  ", vec3(-size_2,-size_2,depth_2)"
-  ", vec3(-size_2,size_2,-depth_2)"
-  ", vec3(size_2,size_2,-depth_2)"
-  ", vec3(size_2,-size_2,-depth_2)"
-  ", vec3(-size_2,-size_2,-depth_2)"
-");"
-
-"void main(){"
-  "float foo=offset*10.;"
-  "float c=(10*size+9*margin)*0.5;"
-  "vco=v[gl_VertexID];"
-
-  "if(gl_InstanceID<100){"
-    "vco+=vec3(mod(gl_InstanceID,10)*offset,floor(gl_InstanceID/10)*offset,0)-c;"
-  "}else if(gl_InstanceID<200){"
-    "vco+=vec3(mod(gl_InstanceID-100,10)*offset,floor((gl_InstanceID-100)/10)*offset,foo)-c;"
-  "}else if(gl_InstanceID<300){"
-    "vco+=vec3(0.,floor((gl_InstanceID-200)/10)*offset,mod(gl_InstanceID-200,10)*offset)-c;"
-  "}else if(gl_InstanceID<400){"
-    "vco+=vec3(foo,floor((gl_InstanceID-300)/10)*offset,mod(gl_InstanceID-300,10)*offset)-c;"
-  "}else if(gl_InstanceID<500){"
-    "vco+=vec3(mod(gl_InstanceID-400,10)*offset,0.,floor((gl_InstanceID-400)/10)*offset)-c;"
-  "}else{"
-    "vco+=vec3(mod(gl_InstanceID-500,10)*offset,foo,floor((gl_InstanceID-500)/10)*offset)-c;"
-  "}"
-"}";
-  char const *ROOM_GS_SRC =
-"#version 330 core\n"
-
-"layout(triangles)in;"
-"layout(triangle_strip,max_vertices=3)out;"
-
-"in vec3 vco[];"
-"in vec3 vno[];"
-
-"out vec3 gco;"
-"out vec3 gno;"
-"out vec2 guv;"
-
-"uniform mat4 proj;"
-"uniform mat4 view;"
-
-"void emit(int i){"
-  "gco=vco[i];"
-  "gl_Position=proj*view*vec4(gco,1.);"
-  "EmitVertex();"
-"}"
-
-"void main(){"
-  /* cube face ID */
-  "int faceID=gl_PrimitiveIDIn/2;"
-
-  /* compute normal and UV coordinates */
-  "if(faceID<2){"
-    "gno=vec3(0.,0.,1.);"
-  "}else if(faceID<4){"
-    "gno=vec3(0.,1.,0.);"
-  "}else{"
-    "gno=vec3(1.,0.,0.);"
-  "}"
-  "if((faceID&1)==1){"
-    "gno=-gno;"
-  "}"
-
-  /* emit the vertices */
-  "for(int i=0;i<3;++i)"
-    "emit(i);"
-"}";
-  char const *ROOM_FS_SRC =
-"#version 330 core\n"
-
-"in vec3 gco;" /* vertex shader space coordinates */
-"in vec3 gno;" /* vertex shader normal */
-
-"layout(location=0)out vec3 nofrag;"
-"layout(location=1)out uvec2 matfrag;"
-
-"void main(){"
-  "nofrag=gno;"
-  "matfrag=uvec2(1,0);"
-"}";
 }
 
-Slab::Slab(uint width, uint height, float size, float thickness) {
+uint const Slab::WALLS;
+
+Slab::Slab(uint width, uint height, float size, float thickness) :
+    _size(size) {
   _init_ibo();
   _init_va();
   //_init_texture(width, height);
   _init_program();
   _init_uniforms(size, thickness);
+  _init_depth_program(size, thickness);
 }
 
 void Slab::_init_ibo() {
   gBH.bind(Buffer::ELEMENT_ARRAY, _ibo);
-  gBH.data(sizeof(uint)*36, Buffer::STATIC_DRAW, ids);
+  gSC.data(sizeof(uint)*36, Buffer::STATIC_DRAW, ids);
   gBH.unbind();
 }
 
@@ -188,11 +100,11 @@ void Slab::_init_program() {
   Shader gs(Shader::GEOMETRY);
   Shader fs(Shader::FRAGMENT);
 
-  vs.source(ROOM_VS_SRC);
+  vs.source(shader_source(SHADER_ROOM_VS));
   vs.compile("room vertex shader");
-  gs.source(ROOM_GS_SRC);
+  gs.source(shader_source(SHADER_ROOM_GS));
   gs.compile("room geometry shader");
-  fs.source(ROOM_FS_SRC);
+  fs.source(shader_source(SHADER_ROOM_FS));
   fs.compile("room fragment shader");
 
   _sp.attach(vs);
@@ -214,20 +126,81 @@ void Slab::_init_uniforms(float size, float thickness) {
   _sp.unuse();
 }
 
+void Slab::_init_depth_program(float size, float thickness) {
+  Shader vs(Shader::VERTEX);
+  Shader fs(Shader::FRAGMENT);
+
+  vs.source(shader_source(SHADER_SLAB_DEPTH_VS));
+  vs.compile("slab depth vertex shader");
+  fs.source(shader_source(SHADER_DEPTH_FS));
+  fs.compile("depth fragment shader");
+
+  _depthSp.attach(vs);
+  _depthSp.attach(fs);
+  _depthSp.link();
+
+  _depthProjIndex     = _depthSp.map_uniform("proj");
+  _depthViewIndex     = _depthSp.map_uniform("view");
+  _depthWallsIndex    = _depthSp.map_uniform("walls");
+  auto sizeIndex      = _depthSp.map_uniform("size");
+  auto thicknessIndex = _depthSp.map_uniform("thickness");
+
+  _depthSp.use();
+  sizeIndex.push(size);
+  thicknessIndex.push(thickness);
+  _depthSp.unuse();
+}
+
 void Slab::render(float time, Mat44 const &proj, Mat44 const &view, uint n) const {
-  state::enable(state::DEPTH_TEST);
+  gSC.enable(state::DEPTH_TEST);
 
-  _sp.use();
+  gSC.use(_sp);
 
-  _projIndex.push(proj);
-  _viewIndex.push(view);
-  _timeIndex.push(time);
+  gSC.push(_projIndex, proj);
+  gSC.push(_viewIndex, view);
+  gSC.push(_timeIndex, time);
 
-  gTH.bind(Texture::T_2D, _texture);
+  gSC.bind(Texture::T_2D, _texture);
   _va.bind();
-  _va.inst_indexed_render(primitive::TRIANGLE, 36, GLT_UINT, n);
+  gSC.inst_indexed_render(_va, primitive::TRIANGLE, 36, GLT_UINT, n);
   _va.unbind();
-  gTH.unbind();
+  gSC.unbind();
 
-  _sp.unuse();
+  gSC.unuse();
+}
+
+void Slab::render_depth(Mat44 const &proj, Mat44 const &view, uint const *walls, uint n) const {
+  int packed = 0;
+
+  for (uint i = 0; i < WALLS; ++i)
+    packed |= walls[i] << (3 * i);
+
+  gSC.enable(state::DEPTH_TEST);
+
+  gSC.use(_depthSp);
+
+  gSC.push(_depthProjIndex, proj);
+  gSC.push(_depthViewIndex, view);
+  gSC.push(_depthWallsIndex, packed);
+
+  _va.bind();
+  gSC.inst_indexed_render(_va, primitive::TRIANGLE, 36, GLT_UINT, n);
+  _va.unbind();
+
+  gSC.unuse();
+}
+
+float Slab::wall_distance(float const *eye, uint wall) const {
+  /* placement of room-vs.glsl: walls go by pairs, at both ends of an axis */
+  float offset = _size + MARGIN;
+  float c = (10.f * _size + 9.f * MARGIN) * 0.5f;
+  float plane = (wall & 1) ? offset * 10.f - c : -c;
+
+  return fabs(eye[WALL_AXES[wall]] - plane);
+}
+
+void Slab::sort_walls(float const *eye, uint *walls) const {
+  for (uint i = 0; i < WALLS; ++i)
+    walls[i] = i;
+  sort(walls, walls + WALLS, [this, eye](uint a, uint b) { return wall_distance(eye, a) < wall_distance(eye, b); });
 }
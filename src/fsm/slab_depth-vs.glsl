@@ -0,0 +1,50 @@
+#version 330 core
+
+/* position-only room-vs.glsl, for the depth pre-pass: same placement, so
+ * that the G-buffer pass finds the very same depths */
+invariant gl_Position;
+
+uniform mat4 proj;
+uniform mat4 view;
+uniform float size;      /* size of the slab */
+uniform float thickness; /* thickness of the slab: 0. = 0., 1. = size */
+uniform int walls;       /* front to back, 3 bits per wall of 100 instances */
+
+/* slab vertices */
+const float margin = 0.05;
+float offset = size + margin;
+float size_2  = size / 2.;
+float depth_2 = size_2 * thickness;
+vec3[8] v = vec3[] (
+    vec3(-size_2,  size_2,  depth_2)
+  , vec3( size_2,  size_2,  depth_2)
+  , vec3( size_2, -size_2,  depth_2)
+  , vec3(-size_2, -size_2,  depth_2)
+  , vec3(-size_2,  size_2, -depth_2)
+  , vec3( size_2,  size_2, -depth_2)
+  , vec3( size_2, -size_2, -depth_2)
+  , vec3(-size_2, -size_2, -depth_2)
+);
+
+void main() {
+  float foo = offset * 10.;
+  float c = (10*size+9*margin) * 0.5;
+  int id = ((walls >> (3 * (gl_InstanceID / 100))) & 7) * 100 + gl_InstanceID % 100;
+  vec3 vco = v[gl_VertexID];
+
+  if (id < 100) {
+    vco += vec3(mod(id, 10)*offset, floor(id/10)*offset, 0) - c;
+  } else if (id < 200) {
+    vco += vec3(mod(id-100, 10)*offset, floor((id-100)/10)*offset, foo) - c;
+  } else if (id < 300) {
+    vco += vec3(0., floor((id-200)/10)*offset, mod(id-200, 10)*offset) - c;
+  } else if (id < 400) {
+    vco += vec3(foo, floor((id-300)/10)*offset, mod(id-300, 10)*offset) - c;
+  } else if (id < 500) {
+    vco += vec3(mod(id-400, 10)*offset, 0., floor((id-400)/10)*offset) - c;
+  } else {
+    vco += vec3(mod(id-500, 10)*offset, foo, floor((id-500)/10)*offset) - c;
+  }
+
+  gl_Position = proj * view * vec4(vco, 1.);
+}
@@ -1,8 +1,11 @@
+#include <cmath>
+#include <gl.hpp>
 #include <core/state.hpp>
 #include <fsm/common.hpp>
 #include <fsm/stairway.hpp>
 #include <misc/log.hpp>
 #include <scene/common.hpp>
+#include <state_cache.hpp>
 
 using namespace sky;
 using namespace core;
@@ -10,15 +13,41 @@ using namespace math;
 using namespace misc;
 using namespace scene;
 
-Stairway::Stairway(ushort width, ushort height, Common &common, Freefly const &freefly) :
+namespace {
+  float const TEXT_FOREVER  = 1e9f;
+  int   const FULL          = -1;   /* no half: the whole cave is shaded */
+  float const HISTORY_GAP   = 0.1f; /* longest step reprojected over, in s */
+}
+
+Stairway::Stairway(ushort width, ushort height, Common &common, Freefly const &freefly, bool reproject, bool checkerboard) :
     _width(width)
   , _height(height)
   , _freefly(freefly)
+  , _tile(common.tile)
   , _drenderer(common.drenderer)
   , _matmgr(common.matmgr)
-  , _stringRenderer(common.stringRenderer)
+  , _start(common.timeline.event("stairway.start"))
+  , _camera(common.timeline.camera("stairway.camera"))
+  , _caveMorph(common.timeline.scalar("stairway.cave_morph"))
+  , _textCues(common.timeline.event("stairway.texts"))
+  , _cave(common.quality.caveTex, common.quality.caveTex)
+  , _fireflies(common.quality.fireflies)
+  , _texts(common.stringRenderer)
+  , _reproject(reproject)
+  , _reprojection(width, height)
+  , _checkerboard(checkerboard)
+  , _checker(width, height)
+  , _half(FULL)
+  , _parity(0)
+  , _drawn(false)
+  , _continuous(false)
+  , _lastTime(0.f)
+  , _graph(width, height)
+  , _pipeline(common.worker, [this](float time, Frame &frame) { _prepare(time, frame); })
   /*, _fogEffect("fog effect", from_file("../../src/fsm/fog-fs.glsl").c_str(), width, height)*/ {
   _init_materials();
+  _init_texts();
+  _init_graph();
 }
 
 void Stairway::_init_materials() {
@@ -26,82 +55,170 @@ void Stairway::_init_materials() {
   _matmgrViewIndex   = _matmgr.postprocess().program().map_uniform("view");
   _matmgrLColorIndex = _matmgr.postprocess().program().map_uniform("lightColor");
   _matmgrLPosIndex   = _matmgr.postprocess().program().map_uniform("lightPos");
+  _matmgrCheckerIndex = _matmgr.postprocess().program().map_uniform("checker");
 }
 
-void Stairway::_draw_texts(float t) const {
-  state::enable(state::BLENDING);
-  Framebuffer::blend_func(blending::ONE, blending::ONE);
-  _stringRenderer.start_draw();
+void Stairway::_init_texts() {
+  auto const &t = _textCues;
 
-  if (t < 100.8f) {
-  } else if (t < 161.3f) {
-    _stringRenderer.draw_string("I WOULD ALSO LIKE TO THANK ALL FRIENDS OF MINE", 1.f-(t-100.8f)*0.5f, -0.2f, 0.08f); 
-    _stringRenderer.draw_string("WHO GAVE ME THEIR GREAT SUPPORT", 1.f-(t-105.f)*0.5f, -0.35f, 0.08f);
-    _stringRenderer.draw_string("LUV YOU GUYS!", 1.f-(t-110.f)*0.5f, -0.35f, 0.08f);
-  } else {
-    state::disable(state::DEPTH_TEST);
-    _stringRenderer.draw_string("YOU IZ AWESOME EVOKE!", -0.7f, 0.3f, 0.08f);
-    _stringRenderer.draw_string("CHEERS!", -0.25f, 0.f, 0.1f);
-    state::enable(state::DEPTH_TEST);
-  }
-  _stringRenderer.end_draw();
-  state::disable(state::BLENDING);
+  /* baked once: later sync file changes don't reach the strings */
+  _texts.add("I WOULD ALSO LIKE TO THANK ALL FRIENDS OF MINE", 1.f, -0.2f, 0.08f, t.time(0), 0.5f, t.time(0), t.time(3));
+  _texts.add("WHO GAVE ME THEIR GREAT SUPPORT", 1.f, -0.35f, 0.08f, t.time(1), 0.5f, t.time(0), t.time(3));
+  _texts.add("LUV YOU GUYS!", 1.f, -0.35f, 0.08f, t.time(2), 0.5f, t.time(0), t.time(3));
+  _texts.add("YOU IZ AWESOME EVOKE!", -0.7f, 0.3f, 0.08f, 0.f, 0.f, t.time(3), TEXT_FOREVER);
+  _texts.add("CHEERS!", -0.25f, 0.f, 0.1f, 0.f, 0.f, t.time(3), TEXT_FOREVER);
+  _texts.commit();
 }
 
-void Stairway::run(float time) {
-  if (time <= 81.50f) return;
-
-  auto proj = Mat44::perspective(FOVY, 1.f * _width / _height, ZNEAR, ZFAR);
-  auto view = Mat44::trslt(-Position(cosf(time*0.1f)*10.f, sinf(time*0.8f), (81.50f+50.f-time))) * Orient(Axis3(0.f, 0.f, 1.f), PI_2+sinf(time*0.5f)).to_matrix() *
-              Orient(Axis3(0.f, 1.f, 0.f), PI_2*sinf(time*0.5f) / 3.f).to_matrix() *
-              Orient(Axis3(1.f, 0.f, 0.f), PI_4*cosf(time*0.1f)*0.5f).to_matrix();
-
-  gFBH.unbind();
-
-  state::enable(state::DEPTH_TEST);
-  _drenderer.start_geometry();
-  state::clear(state::COLOR_BUFFER | state::DEPTH_BUFFER);
-  _cave.render(time, proj, view);
-  _drenderer.end_geometry();
-
-  state::clear(state::COLOR_BUFFER | state::DEPTH_BUFFER);
-
-  _drenderer.start_shading();
-  _matmgr.start();
-  _matmgrProjIndex.push(proj);
-  _matmgrViewIndex.push(view);
-
-  state::enable(state::BLENDING);
-  Framebuffer::blend_func(blending::ONE, blending::ONE);
-
-  auto lights = _fireflies.positions();
-  auto colors = _fireflies.colors();
-  for (int i = 0; i < _fireflies.FIREFLIES_NB; ++i) {
-    auto p = lights[i];
-    auto l = colors[i];
-    _matmgrLColorIndex.push(l.x, l.y, l.z);
-    _matmgrLPosIndex.push(p.x, p.y, p.z);
-    state::clear(state::DEPTH_BUFFER);
-    _matmgr.render();
-  }
-  _matmgr.end();
-  _drenderer.end_shading();
+void Stairway::_draw_texts(Frame const &frame) const {
+  gSC.disable(state::DEPTH_TEST);
+  gSC.enable(state::BLENDING);
+  gSC.blend_func(blending::ONE, blending::ONE);
+  _texts.render(frame.view.time, frame.texts);
+  gSC.disable(state::BLENDING);
+  gSC.enable(state::DEPTH_TEST);
+}
+
+void Stairway::_scissor(int half) const {
+  int left = _width / 2;
+
+  if (half == FULL)
+    return;
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(half ? left : 0, 0, half ? _width - left : left, _height);
+}
+
+void Stairway::_unscissor() const {
+  glDisable(GL_SCISSOR_TEST);
+}
 
-  Framebuffer::blend_func(blending::SRC_ALPHA, blending::ONE_MINUS_SRC_ALPHA);
-  _fireflies.render(proj, view);
-  state::disable(state::BLENDING);
+void Stairway::_init_graph() {
+  auto const &frame = _pipeline.front();
+  bool history = _reproject || _checkerboard;
+  auto velocity = history ? _graph.history("stairway velocity") : RenderGraph::BACKBUFFER;
+  auto gbuffer = _graph.external("stairway G-buffer", [this, history, velocity]() {
+    _drenderer.start_geometry();
+    if (history)
+      _cave.begin_velocity(_graph.texture(velocity));
+  }, [this, history]() {
+    if (history)
+      _cave.end_velocity();
+    _drenderer.end_geometry();
+  });
+  auto lit = history ? _graph.history("stairway lit") : RenderGraph::BACKBUFFER;
+  auto shaded = _checkerboard ? _graph.transient("stairway shaded") : lit;
+
+  /* always whole, with the velocities: the other half reprojects from
+   * them, and the next frame from their depths */
+  _graph.pass("stairway geometry", [this, &frame]() {
+    gSC.enable(state::DEPTH_TEST);
+    _cave.render(frame.caveMorph, frame.view.proj, frame.view.view, _lastView, frame.caveNodes);
+  }).draws(gbuffer, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
+
+  /* every light clears the depth it tests against */
+  auto shading = _graph.pass("stairway shading", [this, &frame]() {
+    _scissor(_half);
+    _drenderer.start_shading();
+    _matmgr.start();
+    gSC.push(_matmgrProjIndex, frame.view.proj);
+    gSC.push(_matmgrViewIndex, frame.view.view);
+    gSC.push(_matmgrCheckerIndex, _checkerboard ? 1 + _parity : 0);
+
+    gSC.enable(state::BLENDING);
+    gSC.blend_func(blending::ONE, blending::ONE);
+
+    auto colors = _fireflies.colors();
+    for (int i = 0; i < _fireflies.FIREFLIES_LIGHTS; ++i) {
+      auto p = frame.lights[i];
+      auto l = colors[i];
+      gSC.push(_matmgrLColorIndex, l.x, l.y, l.z);
+      gSC.push(_matmgrLPosIndex, p.x, p.y, p.z);
+      state::clear(state::DEPTH_BUFFER);
+      gSC.helper([this]() { _matmgr.render(); });
+    }
+    if (_checkerboard)
+      gSC.push(_matmgrCheckerIndex, 0); /* the cube room shares the program */
+    _matmgr.end();
+    _drenderer.end_shading();
+    gSC.forget();
+    gSC.disable(state::BLENDING);
+    _unscissor();
+  }).reads(gbuffer);
+
+  if (history) {
+    shading.draws(shaded, RenderGraph::CLEAR); /* lights add up */
+
+    if (_checkerboard) {
+      _graph.pass("stairway checkerboard", [this, &frame]() {
+        _scissor(_half);
+        _checker.render(frame.view.proj, frame.view.view, _lastView, _parity, _continuous);
+        _unscissor();
+      }).reads(shaded).reads(velocity).reads(_graph.previous(lit)).reads(_graph.previous(velocity)).draws(lit, RenderGraph::DISCARD);
+    }
+
+    _graph.pass("stairway reprojection", [this, &frame]() {
+      _scissor(1 - _half);
+      _reprojection.render(frame.view.proj, frame.view.view, _lastView);
+      _unscissor();
+    }).reads(_graph.previous(lit)).reads(velocity).reads(_graph.previous(velocity)).draws(lit, RenderGraph::LOAD).when([this]() { return _half != FULL; });
+
+    _graph.copy("stairway present", lit, RenderGraph::BACKBUFFER);
+  } else {
+    shading.draws(RenderGraph::BACKBUFFER, RenderGraph::CLEAR).depth(RenderGraph::DISCARD);
+  }
 
+  _graph.pass("stairway fireflies", [this, &frame]() {
+    gSC.enable(state::BLENDING);
+    gSC.blend_func(blending::SRC_ALPHA, blending::ONE_MINUS_SRC_ALPHA);
+    _fireflies.render(frame.view.proj, frame.view.view);
+    gSC.disable(state::BLENDING);
 
 #if 0 /* shitty fog */
-  state::disable(state::DEPTH_TEST);
-  Framebuffer::blend_func(blending::DST_COLOR, blending::ZERO);
-  _fogEffect.start();
-  _fogEffect.apply(0.f);
-  _fogEffect.end();
+    gSC.disable(state::DEPTH_TEST);
+    gSC.blend_func(blending::DST_COLOR, blending::ZERO);
+    _fogEffect.start();
+    _fogEffect.apply(0.f);
+    _fogEffect.end();
 #endif
+  }).draws(RenderGraph::BACKBUFFER, RenderGraph::LOAD).depth(history ? RenderGraph::CLEAR : RenderGraph::LOAD);
 
-  _draw_texts(time);
+  _graph.pass("stairway texts", [this, &frame]() {
+    _draw_texts(frame);
+  }).draws(RenderGraph::BACKBUFFER, RenderGraph::LOAD);
 
-  _fireflies.animate(time);
+  _graph.prepare();
 }
 
+/* on the frame worker */
+void Stairway::_prepare(float time, Frame &frame) {
+  frame.view.time = time;
+  frame.view.proj = _tile.projection();
+  frame.view.view = _camera.at(time);
+  frame.caveMorph = _caveMorph.at(time);
+  _cave.select(frame.view.proj, frame.view.view, frame.caveNodes);
+  frame.firefliesTime = time - _start.time(0);
+  _fireflies.simulate(frame.firefliesTime, frame.lights);
+  frame.texts = _texts.cull(time);
+}
+
+void Stairway::run(float time) {
+  if (time <= _start.time(0)) return;
+
+  _pipeline.update(time);
+  auto const &frame = _pipeline.front();
+
+  /* halves alternate as long as the last frame is close enough; colors
+   * of the checkerboard too, once both halves had one */
+  _continuous = _drawn && fabs(frame.view.time - _lastTime) <= HISTORY_GAP;
+  _half = _reproject && _continuous ? (_half == 0 ? 1 : 0) : FULL;
+  if (_half != 1)
+    _parity = 1 - _parity;
+
+  /* the GPU fireflies catch up with the lights of the packet */
+  _fireflies.animate(frame.firefliesTime);
+  _graph.execute();
+
+  _drawn = true;
+  _lastTime = frame.view.time;
+  _lastView = frame.view.view;
+}
@@ -0,0 +1,94 @@
+#include <fsm/sync.hpp>
+#include <math/common.hpp>
+#include <scene/common.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace math;
+using namespace scene;
+
+namespace {
+  float const CAMERA_RATE = 60.f;
+  float const CUBE_ROOM   = 0.f;
+  float const STAIRWAY    = 80.2f;
+  float const END         = 163.5f;
+  float const CAVE        = 81.5f;
+
+  void init_parts(Timeline &timeline) {
+    auto &parts = timeline.event("parts");
+
+    parts.clear();
+    parts.key(CUBE_ROOM);
+    parts.key(STAIRWAY);
+    parts.key(END);
+  }
+
+  void init_cube_room(Timeline &timeline) {
+    auto &camera = timeline.camera("cube_room.camera");
+    auto &fade = timeline.scalar("cube_room.fade");
+    auto &texts = timeline.event("cube_room.texts");
+
+    /* four cuts, then an orbit */
+    camera.clear();
+    camera.keys({
+        { 0.f,   Position(1.f, 0.f, 0.f), PI_2,      0.f,    0.f, true }
+      , { 5.2f,  Position(0.f, 1.f, 0.f), 0.f,       -PI_2,  0.f, true }
+      , { 10.4f, Position(1.f, 1.f, 1.f), PI_2 / 3.f, 0.f,    0.f, true }
+      , { 15.6f, Position(0.f, 1.f, 1.f), PI_2 / 3.f, -PI_4,  0.f, true }
+      }, CAMERA_RATE);
+    camera.bake(20.8f, STAIRWAY, CAMERA_RATE, [](float t) {
+      return Mat44::trslt(-Position(cosf(t), sinf(t), sinf(t))*1.5f) *
+             Orient(Axis3(0.f, 1.f, 0.f), t * PI_2 / 3.).to_matrix() *
+             Orient(Axis3(0.f, 0.f, 1.f), sinf(t)+t*0.5f).to_matrix();
+    });
+
+    /* clock of the fade stage; negative when not fading */
+    fade.clear();
+    fade.key(0.f, 0.f);
+    fade.key(20.8f, 20.8f, ScalarTrack::STEP);
+    fade.key(20.8f, -1.f, ScalarTrack::STEP);
+    fade.key(75.f, 0.f);
+    fade.key(STAIRWAY, STAIRWAY - 75.f, ScalarTrack::STEP);
+
+    /* scrolling start of each string */
+    texts.clear();
+    for (float t : { 41.f, 51.f, 61.5f, 65.5f, 70.5f })
+      texts.key(t);
+  }
+
+  void init_stairway(Timeline &timeline) {
+    auto &start = timeline.event("stairway.start");
+    auto &camera = timeline.camera("stairway.camera");
+    auto &morph = timeline.scalar("stairway.cave_morph");
+    auto &texts = timeline.event("stairway.texts");
+
+    start.clear();
+    start.key(CAVE);
+
+    camera.clear();
+    camera.bake(CAVE, END, CAMERA_RATE, [](float t) {
+      return Mat44::trslt(-Position(cosf(t*0.1f)*10.f, sinf(t*0.8f), (CAVE+50.f-t))) *
+             Orient(Axis3(0.f, 0.f, 1.f), PI_2+sinf(t*0.5f)).to_matrix() *
+             Orient(Axis3(0.f, 1.f, 0.f), PI_2*sinf(t*0.5f) / 3.f).to_matrix() *
+             Orient(Axis3(1.f, 0.f, 0.f), PI_4*cosf(t*0.1f)*0.5f).to_matrix();
+    });
+
+    /* from the first heightmap to the second one */
+    morph.clear();
+    morph.key(112.f, 0.f);
+    morph.key(113.f, 1.f, ScalarTrack::STEP);
+
+    /* scrolling start of the three thanks, then the final screen */
+    texts.clear();
+    for (float t : { 100.8f, 105.f, 110.f, 161.3f })
+      texts.key(t);
+  }
+}
+
+void init_timeline(Timeline &timeline) {
+  init_parts(timeline);
+  init_cube_room(timeline);
+  init_stairway(timeline);
+  timeline.load(SYNC_FILE);
+}
+
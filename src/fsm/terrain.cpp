@@ -0,0 +1,216 @@
+#include <cmath>
+#include <fsm/terrain.hpp>
+#include <misc/log.hpp>
+#include <state_cache.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+using namespace math;
+using namespace misc;
+
+namespace {
+  float const MORPH_START_RATIO = 0.66f; /* where morphing starts in a LOD range */
+
+  /* squared distance from p to the box [min;max] */
+  float box_dist2(float const *p, float const *min, float const *max) {
+    float d = 0.f;
+
+    for (int i = 0; i < 3; ++i) {
+      float e = 0.f;
+      if (p[i] < min[i])
+        e = min[i] - p[i];
+      else if (p[i] > max[i])
+        e = p[i] - max[i];
+      d += e * e;
+    }
+
+    return d;
+  }
+
+  /* frustum planes of proj * view (Gribb & Hartmann), column-major matrices */
+  void frustum_planes(Mat44 const &proj, Mat44 const &view, float (*planes)[4]) {
+    auto m = proj * view;
+
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        planes[i*2][j]   = m[j][3] + m[j][i];
+        planes[i*2+1][j] = m[j][3] - m[j][i];
+      }
+    }
+  }
+
+  /* false if the box is entirely behind one of the planes */
+  bool box_in_frustum(float const (*planes)[4], float const *min, float const *max) {
+    for (int i = 0; i < 6; ++i) {
+      auto p = planes[i];
+      float x = p[0] >= 0.f ? max[0] : min[0];
+      float y = p[1] >= 0.f ? max[1] : min[1];
+      float z = p[2] >= 0.f ? max[2] : min[2];
+
+      if (p[0]*x + p[1]*y + p[2]*z + p[3] < 0.f)
+        return false;
+    }
+
+    return true;
+  }
+}
+
+Terrain::Terrain(float size, ushort gridRes, ushort levels, float lodRange) :
+    _size(size)
+  , _gridRes(gridRes)
+  , _levels(levels) {
+  _init_ranges(lodRange);
+  _init_patch();
+}
+
+/* a node only borders nodes one level away, which the morph closes, if
+ * each range step (lodRange * 2^i) exceeds the diagonal of that level's
+ * nodes; else a finer node can meet a coarser quarter with cracks */
+void Terrain::_init_ranges(float lodRange) {
+  float prev = 0.f;
+
+  for (ushort i = 0; i < _levels; ++i) {
+    float end = lodRange * (1 << i);
+    float start = prev + (end - prev) * MORPH_START_RATIO;
+    float diagonal = _size / (1 << (_levels-1-i)) * sqrtf(2.f);
+
+    if (i+1 < _levels && end <= diagonal)
+      misc::log << error << "terrain range " << end << " of level " << i << " within its node diagonal " << diagonal << ": cracks" << endl;
+
+    _ranges.push_back(end);
+    _morphs.push_back(start);
+    _morphs.push_back(1.f / (end - start));
+    prev = end;
+  }
+}
+
+void Terrain::_init_patch() {
+  vector<float> vertices;
+  vector<uint> indices[FULL+1];
+  Program::In co(semantic::CO);
+
+  gen_patch(_gridRes, vertices, indices);
+
+  gBH.bind(Buffer::ARRAY, _vbo);
+  gSC.data(vertices.size()*sizeof(float), Buffer::STATIC_DRAW, vertices.data());
+  gBH.unbind();
+
+  for (ushort i = 0; i <= FULL; ++i) {
+    _indicesNb[i] = indices[i].size();
+
+    gBH.bind(Buffer::ELEMENT_ARRAY, _ibo[i]);
+    gSC.data(indices[i].size()*sizeof(uint), Buffer::STATIC_DRAW, indices[i].data());
+    gBH.unbind();
+
+    _va[i].bind();
+    co.enable();
+    gBH.bind(Buffer::ARRAY, _vbo);
+    co.pointer(2, GLT_FLOAT, false);
+    gBH.bind(Buffer::ELEMENT_ARRAY, _ibo[i]);
+    _va[i].unbind();
+    gBH.unbind();
+  }
+}
+
+void Terrain::gen_patch(ushort res, vector<float> &vertices, vector<uint> (&indices)[FULL+1]) {
+  uint const stride = res + 1;
+  ushort const half = res / 2;
+
+  vertices.resize(stride * stride * 2);
+  for (uint j = 0; j <= res; ++j) {
+    for (uint i = 0; i <= res; ++i) {
+      vertices[(j*stride+i)*2]   = 1.f * i / res;
+      vertices[(j*stride+i)*2+1] = 1.f * j / res;
+    }
+  }
+
+  for (ushort q = 0; q <= FULL; ++q) {
+    indices[q].clear();
+    indices[q].reserve((q == FULL ? res*res : half*half) * 6);
+  }
+
+  for (uint j = 0; j < res; ++j) {
+    for (uint i = 0; i < res; ++i) {
+      uint a = j*stride + i;
+      uint b = a + 1;
+      uint c = a + stride;
+      uint d = c + 1;
+      uint const quad[] = { a, c, b, b, c, d };
+      auto &quarter = indices[(j >= half)*2 + (i >= half)];
+
+      quarter.insert(quarter.end(), quad, quad+6);
+      indices[FULL].insert(indices[FULL].end(), quad, quad+6);
+    }
+  }
+}
+
+void Terrain::eye_position(Mat44 const &view, float *eye) {
+  /* inverse of the rigid transform: -R^T t */
+  for (int i = 0; i < 3; ++i)
+    eye[i] = -(view[i][0]*view[3][0] + view[i][1]*view[3][1] + view[i][2]*view[3][2]);
+}
+
+bool Terrain::_select(float x, float z, float size, ushort level, float const *eye, float const (*planes)[4], float ymin, float ymax, vector<Node> &selection) const {
+  float const min[] = { x, ymin, z };
+  float const max[] = { x+size, ymax, z+size };
+  float d = box_dist2(eye, min, max);
+
+  if (d > _ranges[level]*_ranges[level])
+    return false;
+
+  /* culled nodes are still considered handled */
+  if (!box_in_frustum(planes, min, max))
+    return true;
+
+  if (level == 0 || d > _ranges[level-1]*_ranges[level-1]) {
+    selection.push_back({ x, z, size, level, FULL });
+  } else {
+    float half = size * 0.5f;
+
+    for (ushort q = 0; q < QUARTERS; ++q) {
+      float cx = x + half * (q & 1);
+      float cz = z + half * (q >> 1);
+
+      if (!_select(cx, cz, half, level-1, eye, planes, ymin, ymax, selection))
+        selection.push_back({ x, z, size, level, q });
+    }
+  }
+
+  return true;
+}
+
+void Terrain::select(Mat44 const &proj, Mat44 const &view, float ymin, float ymax, vector<Node> &selection) const {
+  float eye[3];
+  float planes[6][4];
+  float half = _size * 0.5f;
+
+  eye_position(view, eye);
+  frustum_planes(proj, view, planes);
+
+  selection.clear();
+  if (!_select(-half, -half, _size, _levels-1, eye, planes, ymin, ymax, selection)) {
+    /* out of the coarsest range: keep it, at the coarsest level */
+    float const min[] = { -half, ymin, -half };
+    float const max[] = { half, ymax, half };
+
+    if (box_in_frustum(planes, min, max))
+      selection.push_back({ -half, -half, _size, static_cast<ushort>(_levels-1), FULL });
+  }
+}
+
+void Terrain::render(vector<Node> const &selection, Program::Uniform const &nodeIndex, Program::Uniform const &morphIndex, uint inst) const {
+  for (auto const &node : selection) {
+    gSC.push(nodeIndex, node.x, node.z, node.size, 1.f * _gridRes);
+    gSC.push(morphIndex, _morphs[node.level*2], _morphs[node.level*2+1]);
+
+    _va[node.part].bind();
+    gSC.inst_indexed_render(_va[node.part], primitive::TRIANGLE, _indicesNb[node.part], GLT_UINT, inst);
+    _va[node.part].unbind();
+  }
+}
+
+ushort Terrain::grid_res() const {
+  return _gridRes;
+}
+
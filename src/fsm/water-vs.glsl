@@ -2,6 +2,8 @@
 
 precision highp float;
 
+invariant gl_Position; /* the depth pre-pass must find the same depths */
+
 layout (location = 0) in vec3 co;
 
 out vec3 vco;
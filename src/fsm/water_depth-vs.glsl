@@ -0,0 +1,31 @@
+#version 330 core
+
+precision highp float;
+
+/* position-only water-vs.glsl, for the depth pre-pass */
+invariant gl_Position;
+
+layout (location = 0) in vec3 co;
+
+uniform mat4 proj;
+uniform mat4 view;
+uniform float time;
+
+const float a = 0.5;
+
+float water(vec2 xy) {
+  float w =
+      sin(xy.x*8.+time*3.)
+    + sin(xy.y*8.)
+    + sin(length(xy+vec2(cos(time*0.5), sin(time*0.5))+1.)*10.+time*6.)
+    + sin(xy.x*10.+time*6.) * sin(xy.y*6)
+    ;
+  return w / 4. * a;
+}
+
+void main() {
+  vec2 lookup = co.xy*0.2;
+  vec3 vco = vec3(co.x, water(lookup) - 3., co.y);
+
+  gl_Position = proj * view * vec4(vco, 1.);
+}
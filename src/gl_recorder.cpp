@@ -0,0 +1,1250 @@
+#include <dlfcn.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gl.hpp>
+#include <gl_trace.hpp>
+
+using namespace std;
+
+/* libgltrace.so: stands in for the GL entry points of gl_trace.hpp, each
+ * writing its call down before or after passing it on to libGL, the one
+ * found next to it. FrameCapture preloads it. GL is called from a single
+ * thread, so nothing here is locked. */
+
+namespace {
+  size_t const FILE_BUFFER = 1 << 22;
+
+  vector<char> gPending;       /* calls made before the file is named */
+  FILE *gFile       = nullptr;
+  bool gRecording   = true;
+
+  /* what tells client memory from buffer offsets, and image sizes */
+  GLuint gUnpackBuffer = 0, gPackBuffer = 0;
+  GLint gUnpackAlignment = 4, gUnpackRowLength = 0;
+  GLint gPackAlignment = 4, gPackRowLength = 0;
+
+  struct Mapping {
+    GLenum target;
+    char const *data;
+    size_t size;
+    bool written;
+  };
+
+  vector<Mapping> gMappings;
+
+  /* as the call found next, the same type as ours */
+  template <typename F> F next(F, char const *name) {
+    return reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+  }
+
+#define REAL(name) static auto const real = next(&name, #name)
+
+  void write(void const *data, size_t size) {
+    char const *bytes = static_cast<char const *>(data);
+
+    if (gFile)
+      fwrite(data, 1, size, gFile);
+    else
+      gPending.insert(gPending.end(), bytes, bytes + size);
+  }
+
+  template <typename T> void raw(T v) {
+    write(&v, sizeof(v));
+  }
+
+  /* the arguments, by C type, as the kinds of gl_trace.hpp say */
+  struct Offset {
+    void const *at;
+  };
+
+  struct Data {
+    void const *bytes;
+    size_t size;
+    bool offset; /* into the buffer bound, bytes being one */
+  };
+
+  struct Output {
+    void const *bytes;
+    size_t size;
+    bool offset;
+  };
+
+  struct Names {
+    GLsizei n;
+    GLuint const *names;
+  };
+
+  void arg(GLenum v) {
+    raw<uint32_t>(v);
+  }
+
+  void arg(GLint v) {
+    raw<int32_t>(v);
+  }
+
+  void arg(GLboolean v) {
+    raw<uint32_t>(v);
+  }
+
+  void arg(GLfloat v) {
+    raw(v);
+  }
+
+  void arg(GLdouble v) {
+    raw(v);
+  }
+
+  void arg(GLintptr v) {
+    raw<int64_t>(v);
+  }
+
+  void arg(GLuint64 v) {
+    raw<uint64_t>(v);
+  }
+
+  void arg(GLsync v) {
+    raw(reinterpret_cast<uint64_t>(v));
+  }
+
+  void arg(Offset v) {
+    raw(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(v.at)));
+  }
+
+  void arg(char const *v) {
+    uint32_t size = strlen(v) + 1;
+
+    raw(size);
+    write(v, size);
+  }
+
+  void arg(Data v) {
+    if (v.offset) {
+      raw<uint8_t>(1);
+      raw(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(v.bytes)));
+    } else if (!v.bytes) {
+      raw<uint8_t>(0);
+    } else {
+      raw<uint8_t>(2);
+      raw(static_cast<uint32_t>(v.size));
+      write(v.bytes, v.size);
+    }
+  }
+
+  void arg(Output v) {
+    if (v.offset) {
+      raw<uint8_t>(1);
+      raw(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(v.bytes)));
+    } else if (!v.bytes) {
+      raw<uint8_t>(0);
+    } else {
+      raw<uint8_t>(2);
+      raw(static_cast<uint32_t>(v.size));
+    }
+  }
+
+  void arg(Names v) {
+    raw(static_cast<uint32_t>(v.n));
+    write(v.names, v.n * sizeof(GLuint));
+  }
+
+  void args(void) {
+  }
+
+  template <typename T, typename... A> void args(T const &v, A const &... rest) {
+    arg(v);
+    args(rest...);
+  }
+
+  template <typename... A> void record(TraceCall call, A const &... a) {
+    if (!gRecording)
+      return;
+    raw(static_cast<uint16_t>(call));
+    args(a...);
+  }
+
+  /* bytes of an image as glTex*Image and glReadPixels take it */
+  size_t image_size(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, GLint alignment, GLint rowLength) {
+    size_t components = 4, pixel, row;
+
+    switch (format) {
+      case GL_RED : case GL_GREEN : case GL_BLUE : case GL_ALPHA : case GL_RED_INTEGER :
+      case GL_DEPTH_COMPONENT : case GL_STENCIL_INDEX :
+        components = 1;
+        break;
+
+      case GL_RG : case GL_RG_INTEGER : case GL_DEPTH_STENCIL :
+        components = 2;
+        break;
+
+      case GL_RGB : case GL_BGR : case GL_RGB_INTEGER : case GL_BGR_INTEGER :
+        components = 3;
+        break;
+    }
+
+    switch (type) {
+      case GL_UNSIGNED_BYTE : case GL_BYTE :
+        pixel = components;
+        break;
+
+      case GL_UNSIGNED_SHORT : case GL_SHORT : case GL_HALF_FLOAT :
+        pixel = components * 2;
+        break;
+
+      case GL_UNSIGNED_BYTE_3_3_2 : case GL_UNSIGNED_BYTE_2_3_3_REV :
+        pixel = 1;
+        break;
+
+      case GL_UNSIGNED_SHORT_5_6_5 : case GL_UNSIGNED_SHORT_5_6_5_REV :
+      case GL_UNSIGNED_SHORT_4_4_4_4 : case GL_UNSIGNED_SHORT_4_4_4_4_REV :
+      case GL_UNSIGNED_SHORT_5_5_5_1 : case GL_UNSIGNED_SHORT_1_5_5_5_REV :
+        pixel = 2;
+        break;
+
+      case GL_FLOAT_32_UNSIGNED_INT_24_8_REV :
+        pixel = 8;
+        break;
+
+      case GL_UNSIGNED_INT : case GL_INT : case GL_FLOAT :
+        pixel = components * 4;
+        break;
+
+      default : /* packed in 32 bits */
+        pixel = 4;
+    }
+
+    if (width <= 0 || height <= 0 || depth <= 0)
+      return 0;
+    row = (pixel * (rowLength > 0 ? rowLength : width) + alignment - 1) / alignment * alignment;
+    return row * (height * depth - 1) + pixel * width;
+  }
+
+  Data pixels(void const *data, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type) {
+    return { data, image_size(width, height, depth, format, type, gUnpackAlignment, gUnpackRowLength), gUnpackBuffer != 0 };
+  }
+
+  /* of what glTexParameter*v and glClearBuffer*v read */
+  size_t parameter_size(GLenum pname) {
+    return pname == GL_TEXTURE_BORDER_COLOR || pname == GL_TEXTURE_SWIZZLE_RGBA ? 16 : 4;
+  }
+
+  size_t clear_size(GLenum buffer) {
+    return buffer == GL_COLOR ? 16 : 4;
+  }
+
+  void mapped(GLenum target, void const *data, size_t size, bool written) {
+    for (auto &m : gMappings) {
+      if (m.target == target) {
+        m = { target, static_cast<char const *>(data), size, written };
+        return;
+      }
+    }
+    gMappings.push_back({ target, static_cast<char const *>(data), size, written });
+  }
+
+  Data unmapped(GLenum target) {
+    for (auto &m : gMappings) {
+      if (m.target == target) {
+        Data data = { m.written ? m.data : nullptr, m.size, false };
+
+        m.target = 0;
+        return data;
+      }
+    }
+    return { nullptr, 0, false };
+  }
+
+  void unbound(GLsizei n, GLuint const *buffers) {
+    for (GLsizei i = 0; i < n; ++i) {
+      if (buffers[i] == gUnpackBuffer)
+        gUnpackBuffer = 0;
+      if (buffers[i] == gPackBuffer)
+        gPackBuffer = 0;
+    }
+  }
+}
+
+/* FrameCapture's end: see gl_trace.hpp */
+extern "C" bool gl_trace_open(char const *path, uint16_t width, uint16_t height) {
+  TraceHeader header = { { 0 }, TRACE_VERSION, width, height };
+
+  if (gFile || !gRecording || !(gFile = fopen(path, "wb")))
+    return false;
+  setvbuf(gFile, nullptr, _IOFBF, FILE_BUFFER);
+  memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  fwrite(&header, sizeof(header), 1, gFile);
+  fwrite(gPending.data(), 1, gPending.size(), gFile);
+  vector<char>().swap(gPending);
+  return true;
+}
+
+extern "C" void gl_trace_frame(float time) {
+  record(CALL_FRAME, time);
+}
+
+/* none when a pass ends */
+extern "C" void gl_trace_pass(char const *name) {
+  record(CALL_PASS, name ? name : "");
+}
+
+extern "C" void gl_trace_close(void) {
+  gRecording = false;
+  vector<char>().swap(gPending);
+  if (gFile)
+    fclose(gFile);
+  gFile = nullptr;
+}
+
+/* the calls, in the order of gl_trace.hpp */
+void glActiveTexture(GLenum texture) {
+  REAL(glActiveTexture);
+  real(texture);
+  record(CALL_glActiveTexture, texture);
+}
+
+void glAttachShader(GLuint program, GLuint shader) {
+  REAL(glAttachShader);
+  real(program, shader);
+  record(CALL_glAttachShader, program, shader);
+}
+
+void glBeginConditionalRender(GLuint id, GLenum mode) {
+  REAL(glBeginConditionalRender);
+  real(id, mode);
+  record(CALL_glBeginConditionalRender, id, mode);
+}
+
+void glBeginQuery(GLenum target, GLuint id) {
+  REAL(glBeginQuery);
+  real(target, id);
+  record(CALL_glBeginQuery, target, id);
+}
+
+void glBeginTransformFeedback(GLenum primitiveMode) {
+  REAL(glBeginTransformFeedback);
+  real(primitiveMode);
+  record(CALL_glBeginTransformFeedback, primitiveMode);
+}
+
+void glBindAttribLocation(GLuint program, GLuint index, GLchar const *name) {
+  REAL(glBindAttribLocation);
+  real(program, index, name);
+  record(CALL_glBindAttribLocation, program, index, name);
+}
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+  REAL(glBindBuffer);
+  real(target, buffer);
+  if (target == GL_PIXEL_UNPACK_BUFFER)
+    gUnpackBuffer = buffer;
+  else if (target == GL_PIXEL_PACK_BUFFER)
+    gPackBuffer = buffer;
+  record(CALL_glBindBuffer, target, buffer);
+}
+
+void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  REAL(glBindBufferBase);
+  real(target, index, buffer);
+  record(CALL_glBindBufferBase, target, index, buffer);
+}
+
+void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+  REAL(glBindBufferRange);
+  real(target, index, buffer, offset, size);
+  record(CALL_glBindBufferRange, target, index, buffer, offset, size);
+}
+
+void glBindFragDataLocation(GLuint program, GLuint color, GLchar const *name) {
+  REAL(glBindFragDataLocation);
+  real(program, color, name);
+  record(CALL_glBindFragDataLocation, program, color, name);
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+  REAL(glBindFramebuffer);
+  real(target, framebuffer);
+  record(CALL_glBindFramebuffer, target, framebuffer);
+}
+
+void glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+  REAL(glBindRenderbuffer);
+  real(target, renderbuffer);
+  record(CALL_glBindRenderbuffer, target, renderbuffer);
+}
+
+void glBindSampler(GLuint unit, GLuint sampler) {
+  REAL(glBindSampler);
+  real(unit, sampler);
+  record(CALL_glBindSampler, unit, sampler);
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+  REAL(glBindTexture);
+  real(target, texture);
+  record(CALL_glBindTexture, target, texture);
+}
+
+void glBindVertexArray(GLuint array) {
+  REAL(glBindVertexArray);
+  real(array);
+  record(CALL_glBindVertexArray, array);
+}
+
+void glBlendColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  REAL(glBlendColor);
+  real(red, green, blue, alpha);
+  record(CALL_glBlendColor, red, green, blue, alpha);
+}
+
+void glBlendEquation(GLenum mode) {
+  REAL(glBlendEquation);
+  real(mode);
+  record(CALL_glBlendEquation, mode);
+}
+
+void glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+  REAL(glBlendEquationSeparate);
+  real(modeRGB, modeAlpha);
+  record(CALL_glBlendEquationSeparate, modeRGB, modeAlpha);
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+  REAL(glBlendFunc);
+  real(sfactor, dfactor);
+  record(CALL_glBlendFunc, sfactor, dfactor);
+}
+
+void glBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha) {
+  REAL(glBlendFuncSeparate);
+  real(sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha);
+  record(CALL_glBlendFuncSeparate, sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha);
+}
+
+void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {
+  REAL(glBlitFramebuffer);
+  real(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+  record(CALL_glBlitFramebuffer, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, void const *data, GLenum usage) {
+  REAL(glBufferData);
+  real(target, size, data, usage);
+  record(CALL_glBufferData, target, size, Data{ data, static_cast<size_t>(size), false }, usage);
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void const *data) {
+  REAL(glBufferSubData);
+  real(target, offset, size, data);
+  record(CALL_glBufferSubData, target, offset, size, Data{ data, static_cast<size_t>(size), false });
+}
+
+void glClear(GLbitfield mask) {
+  REAL(glClear);
+  real(mask);
+  record(CALL_glClear, mask);
+}
+
+void glClearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil) {
+  REAL(glClearBufferfi);
+  real(buffer, drawbuffer, depth, stencil);
+  record(CALL_glClearBufferfi, buffer, drawbuffer, depth, stencil);
+}
+
+void glClearBufferfv(GLenum buffer, GLint drawbuffer, GLfloat const *value) {
+  REAL(glClearBufferfv);
+  real(buffer, drawbuffer, value);
+  record(CALL_glClearBufferfv, buffer, drawbuffer, Data{ value, clear_size(buffer), false });
+}
+
+void glClearBufferiv(GLenum buffer, GLint drawbuffer, GLint const *value) {
+  REAL(glClearBufferiv);
+  real(buffer, drawbuffer, value);
+  record(CALL_glClearBufferiv, buffer, drawbuffer, Data{ value, clear_size(buffer), false });
+}
+
+void glClearBufferuiv(GLenum buffer, GLint drawbuffer, GLuint const *value) {
+  REAL(glClearBufferuiv);
+  real(buffer, drawbuffer, value);
+  record(CALL_glClearBufferuiv, buffer, drawbuffer, Data{ value, clear_size(buffer), false });
+}
+
+void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  REAL(glClearColor);
+  real(red, green, blue, alpha);
+  record(CALL_glClearColor, red, green, blue, alpha);
+}
+
+void glClearDepth(GLdouble depth) {
+  REAL(glClearDepth);
+  real(depth);
+  record(CALL_glClearDepth, depth);
+}
+
+void glClearStencil(GLint s) {
+  REAL(glClearStencil);
+  real(s);
+  record(CALL_glClearStencil, s);
+}
+
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+  REAL(glClientWaitSync);
+  GLenum status = real(sync, flags, timeout);
+
+  record(CALL_glClientWaitSync, sync, flags, timeout, status);
+  return status;
+}
+
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+  REAL(glColorMask);
+  real(red, green, blue, alpha);
+  record(CALL_glColorMask, red, green, blue, alpha);
+}
+
+void glCompileShader(GLuint shader) {
+  REAL(glCompileShader);
+  real(shader);
+  record(CALL_glCompileShader, shader);
+}
+
+void glCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) {
+  REAL(glCopyBufferSubData);
+  real(readTarget, writeTarget, readOffset, writeOffset, size);
+  record(CALL_glCopyBufferSubData, readTarget, writeTarget, readOffset, writeOffset, size);
+}
+
+void glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height) {
+  REAL(glCopyTexSubImage2D);
+  real(target, level, xoffset, yoffset, x, y, width, height);
+  record(CALL_glCopyTexSubImage2D, target, level, xoffset, yoffset, x, y, width, height);
+}
+
+GLuint glCreateProgram(void) {
+  REAL(glCreateProgram);
+  GLuint program = real();
+
+  record(CALL_glCreateProgram, program);
+  return program;
+}
+
+GLuint glCreateShader(GLenum type) {
+  REAL(glCreateShader);
+  GLuint shader = real(type);
+
+  record(CALL_glCreateShader, type, shader);
+  return shader;
+}
+
+void glCullFace(GLenum mode) {
+  REAL(glCullFace);
+  real(mode);
+  record(CALL_glCullFace, mode);
+}
+
+void glDeleteBuffers(GLsizei n, GLuint const *buffers) {
+  REAL(glDeleteBuffers);
+  record(CALL_glDeleteBuffers, n, Names{ n, buffers });
+  unbound(n, buffers);
+  real(n, buffers);
+}
+
+void glDeleteFramebuffers(GLsizei n, GLuint const *framebuffers) {
+  REAL(glDeleteFramebuffers);
+  record(CALL_glDeleteFramebuffers, n, Names{ n, framebuffers });
+  real(n, framebuffers);
+}
+
+void glDeleteProgram(GLuint program) {
+  REAL(glDeleteProgram);
+  real(program);
+  record(CALL_glDeleteProgram, program);
+}
+
+void glDeleteQueries(GLsizei n, GLuint const *ids) {
+  REAL(glDeleteQueries);
+  record(CALL_glDeleteQueries, n, Names{ n, ids });
+  real(n, ids);
+}
+
+void glDeleteRenderbuffers(GLsizei n, GLuint const *renderbuffers) {
+  REAL(glDeleteRenderbuffers);
+  record(CALL_glDeleteRenderbuffers, n, Names{ n, renderbuffers });
+  real(n, renderbuffers);
+}
+
+void glDeleteSamplers(GLsizei count, GLuint const *samplers) {
+  REAL(glDeleteSamplers);
+  record(CALL_glDeleteSamplers, count, Names{ count, samplers });
+  real(count, samplers);
+}
+
+void glDeleteShader(GLuint shader) {
+  REAL(glDeleteShader);
+  real(shader);
+  record(CALL_glDeleteShader, shader);
+}
+
+void glDeleteSync(GLsync sync) {
+  REAL(glDeleteSync);
+  real(sync);
+  record(CALL_glDeleteSync, sync);
+}
+
+void glDeleteTextures(GLsizei n, GLuint const *textures) {
+  REAL(glDeleteTextures);
+  record(CALL_glDeleteTextures, n, Names{ n, textures });
+  real(n, textures);
+}
+
+void glDeleteVertexArrays(GLsizei n, GLuint const *arrays) {
+  REAL(glDeleteVertexArrays);
+  record(CALL_glDeleteVertexArrays, n, Names{ n, arrays });
+  real(n, arrays);
+}
+
+void glDepthFunc(GLenum func) {
+  REAL(glDepthFunc);
+  real(func);
+  record(CALL_glDepthFunc, func);
+}
+
+void glDepthMask(GLboolean flag) {
+  REAL(glDepthMask);
+  real(flag);
+  record(CALL_glDepthMask, flag);
+}
+
+void glDepthRange(GLdouble n, GLdouble f) {
+  REAL(glDepthRange);
+  real(n, f);
+  record(CALL_glDepthRange, n, f);
+}
+
+void glDetachShader(GLuint program, GLuint shader) {
+  REAL(glDetachShader);
+  real(program, shader);
+  record(CALL_glDetachShader, program, shader);
+}
+
+void glDisable(GLenum cap) {
+  REAL(glDisable);
+  real(cap);
+  record(CALL_glDisable, cap);
+}
+
+void glDisableVertexAttribArray(GLuint index) {
+  REAL(glDisableVertexAttribArray);
+  real(index);
+  record(CALL_glDisableVertexAttribArray, index);
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+  REAL(glDrawArrays);
+  real(mode, first, count);
+  record(CALL_glDrawArrays, mode, first, count);
+}
+
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+  REAL(glDrawArraysInstanced);
+  real(mode, first, count, instancecount);
+  record(CALL_glDrawArraysInstanced, mode, first, count, instancecount);
+}
+
+void glDrawBuffer(GLenum buf) {
+  REAL(glDrawBuffer);
+  real(buf);
+  record(CALL_glDrawBuffer, buf);
+}
+
+void glDrawBuffers(GLsizei n, GLenum const *bufs) {
+  REAL(glDrawBuffers);
+  real(n, bufs);
+  record(CALL_glDrawBuffers, n, Data{ bufs, n * sizeof(GLenum), false });
+}
+
+/* indices come from the element buffer in a core profile */
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, void const *indices) {
+  REAL(glDrawElements);
+  real(mode, count, type, indices);
+  record(CALL_glDrawElements, mode, count, type, Offset{ indices });
+}
+
+void glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, void const *indices, GLint basevertex) {
+  REAL(glDrawElementsBaseVertex);
+  real(mode, count, type, indices, basevertex);
+  record(CALL_glDrawElementsBaseVertex, mode, count, type, Offset{ indices }, basevertex);
+}
+
+void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, void const *indices, GLsizei instancecount) {
+  REAL(glDrawElementsInstanced);
+  real(mode, count, type, indices, instancecount);
+  record(CALL_glDrawElementsInstanced, mode, count, type, Offset{ indices }, instancecount);
+}
+
+void glDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, void const *indices) {
+  REAL(glDrawRangeElements);
+  real(mode, start, end, count, type, indices);
+  record(CALL_glDrawRangeElements, mode, start, end, count, type, Offset{ indices });
+}
+
+void glEnable(GLenum cap) {
+  REAL(glEnable);
+  real(cap);
+  record(CALL_glEnable, cap);
+}
+
+void glEnableVertexAttribArray(GLuint index) {
+  REAL(glEnableVertexAttribArray);
+  real(index);
+  record(CALL_glEnableVertexAttribArray, index);
+}
+
+void glEndConditionalRender(void) {
+  REAL(glEndConditionalRender);
+  real();
+  record(CALL_glEndConditionalRender);
+}
+
+void glEndQuery(GLenum target) {
+  REAL(glEndQuery);
+  real(target);
+  record(CALL_glEndQuery, target);
+}
+
+void glEndTransformFeedback(void) {
+  REAL(glEndTransformFeedback);
+  real();
+  record(CALL_glEndTransformFeedback);
+}
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+  REAL(glFenceSync);
+  GLsync sync = real(condition, flags);
+
+  record(CALL_glFenceSync, condition, flags, sync);
+  return sync;
+}
+
+void glFinish(void) {
+  REAL(glFinish);
+  real();
+  record(CALL_glFinish);
+}
+
+void glFlush(void) {
+  REAL(glFlush);
+  real();
+  record(CALL_glFlush);
+}
+
+void glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length) {
+  REAL(glFlushMappedBufferRange);
+  real(target, offset, length);
+  record(CALL_glFlushMappedBufferRange, target, offset, length);
+}
+
+void glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+  REAL(glFramebufferRenderbuffer);
+  real(target, attachment, renderbuffertarget, renderbuffer);
+  record(CALL_glFramebufferRenderbuffer, target, attachment, renderbuffertarget, renderbuffer);
+}
+
+void glFramebufferTexture(GLenum target, GLenum attachment, GLuint texture, GLint level) {
+  REAL(glFramebufferTexture);
+  real(target, attachment, texture, level);
+  record(CALL_glFramebufferTexture, target, attachment, texture, level);
+}
+
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+  REAL(glFramebufferTexture2D);
+  real(target, attachment, textarget, texture, level);
+  record(CALL_glFramebufferTexture2D, target, attachment, textarget, texture, level);
+}
+
+void glFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer) {
+  REAL(glFramebufferTextureLayer);
+  real(target, attachment, texture, level, layer);
+  record(CALL_glFramebufferTextureLayer, target, attachment, texture, level, layer);
+}
+
+void glFrontFace(GLenum mode) {
+  REAL(glFrontFace);
+  real(mode);
+  record(CALL_glFrontFace, mode);
+}
+
+void glGenBuffers(GLsizei n, GLuint *buffers) {
+  REAL(glGenBuffers);
+  real(n, buffers);
+  record(CALL_glGenBuffers, n, Names{ n, buffers });
+}
+
+void glGenFramebuffers(GLsizei n, GLuint *framebuffers) {
+  REAL(glGenFramebuffers);
+  real(n, framebuffers);
+  record(CALL_glGenFramebuffers, n, Names{ n, framebuffers });
+}
+
+void glGenQueries(GLsizei n, GLuint *ids) {
+  REAL(glGenQueries);
+  real(n, ids);
+  record(CALL_glGenQueries, n, Names{ n, ids });
+}
+
+void glGenRenderbuffers(GLsizei n, GLuint *renderbuffers) {
+  REAL(glGenRenderbuffers);
+  real(n, renderbuffers);
+  record(CALL_glGenRenderbuffers, n, Names{ n, renderbuffers });
+}
+
+void glGenSamplers(GLsizei count, GLuint *samplers) {
+  REAL(glGenSamplers);
+  real(count, samplers);
+  record(CALL_glGenSamplers, count, Names{ count, samplers });
+}
+
+void glGenTextures(GLsizei n, GLuint *textures) {
+  REAL(glGenTextures);
+  real(n, textures);
+  record(CALL_glGenTextures, n, Names{ n, textures });
+}
+
+void glGenVertexArrays(GLsizei n, GLuint *arrays) {
+  REAL(glGenVertexArrays);
+  real(n, arrays);
+  record(CALL_glGenVertexArrays, n, Names{ n, arrays });
+}
+
+void glGenerateMipmap(GLenum target) {
+  REAL(glGenerateMipmap);
+  real(target);
+  record(CALL_glGenerateMipmap, target);
+}
+
+GLuint glGetUniformBlockIndex(GLuint program, GLchar const *uniformBlockName) {
+  REAL(glGetUniformBlockIndex);
+  GLuint index = real(program, uniformBlockName);
+
+  record(CALL_glGetUniformBlockIndex, program, uniformBlockName, index);
+  return index;
+}
+
+GLint glGetUniformLocation(GLuint program, GLchar const *name) {
+  REAL(glGetUniformLocation);
+  GLint location = real(program, name);
+
+  record(CALL_glGetUniformLocation, program, name, location);
+  return location;
+}
+
+void glHint(GLenum target, GLenum mode) {
+  REAL(glHint);
+  real(target, mode);
+  record(CALL_glHint, target, mode);
+}
+
+void glLineWidth(GLfloat width) {
+  REAL(glLineWidth);
+  real(width);
+  record(CALL_glLineWidth, width);
+}
+
+void glLinkProgram(GLuint program) {
+  REAL(glLinkProgram);
+  real(program);
+  record(CALL_glLinkProgram, program);
+}
+
+void * glMapBuffer(GLenum target, GLenum access) {
+  REAL(glMapBuffer);
+  void *data = real(target, access);
+  GLint64 size = 0;
+
+  glGetBufferParameteri64v(target, GL_BUFFER_SIZE, &size);
+  mapped(target, data, size, access != GL_READ_ONLY);
+  record(CALL_glMapBuffer, target, access);
+  return data;
+}
+
+void * glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+  REAL(glMapBufferRange);
+  void *data = real(target, offset, length, access);
+
+  mapped(target, data, length, access & GL_MAP_WRITE_BIT);
+  record(CALL_glMapBufferRange, target, offset, length, access);
+  return data;
+}
+
+void glPixelStorei(GLenum pname, GLint param) {
+  REAL(glPixelStorei);
+  real(pname, param);
+  if (pname == GL_UNPACK_ALIGNMENT)
+    gUnpackAlignment = param;
+  else if (pname == GL_UNPACK_ROW_LENGTH)
+    gUnpackRowLength = param;
+  else if (pname == GL_PACK_ALIGNMENT)
+    gPackAlignment = param;
+  else if (pname == GL_PACK_ROW_LENGTH)
+    gPackRowLength = param;
+  record(CALL_glPixelStorei, pname, param);
+}
+
+void glPointSize(GLfloat size) {
+  REAL(glPointSize);
+  real(size);
+  record(CALL_glPointSize, size);
+}
+
+void glPolygonMode(GLenum face, GLenum mode) {
+  REAL(glPolygonMode);
+  real(face, mode);
+  record(CALL_glPolygonMode, face, mode);
+}
+
+void glPolygonOffset(GLfloat factor, GLfloat units) {
+  REAL(glPolygonOffset);
+  real(factor, units);
+  record(CALL_glPolygonOffset, factor, units);
+}
+
+void glPrimitiveRestartIndex(GLuint index) {
+  REAL(glPrimitiveRestartIndex);
+  real(index);
+  record(CALL_glPrimitiveRestartIndex, index);
+}
+
+void glProvokingVertex(GLenum mode) {
+  REAL(glProvokingVertex);
+  real(mode);
+  record(CALL_glProvokingVertex, mode);
+}
+
+void glQueryCounter(GLuint id, GLenum target) {
+  REAL(glQueryCounter);
+  real(id, target);
+  record(CALL_glQueryCounter, id, target);
+}
+
+void glReadBuffer(GLenum src) {
+  REAL(glReadBuffer);
+  real(src);
+  record(CALL_glReadBuffer, src);
+}
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+  REAL(glReadPixels);
+  real(x, y, width, height, format, type, pixels);
+  record(CALL_glReadPixels, x, y, width, height, format, type,
+         Output{ pixels, image_size(width, height, 1, format, type, gPackAlignment, gPackRowLength), gPackBuffer != 0 });
+}
+
+void glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+  REAL(glRenderbufferStorage);
+  real(target, internalformat, width, height);
+  record(CALL_glRenderbufferStorage, target, internalformat, width, height);
+}
+
+void glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) {
+  REAL(glRenderbufferStorageMultisample);
+  real(target, samples, internalformat, width, height);
+  record(CALL_glRenderbufferStorageMultisample, target, samples, internalformat, width, height);
+}
+
+void glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param) {
+  REAL(glSamplerParameterf);
+  real(sampler, pname, param);
+  record(CALL_glSamplerParameterf, sampler, pname, param);
+}
+
+void glSamplerParameteri(GLuint sampler, GLenum pname, GLint param) {
+  REAL(glSamplerParameteri);
+  real(sampler, pname, param);
+  record(CALL_glSamplerParameteri, sampler, pname, param);
+}
+
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  REAL(glScissor);
+  real(x, y, width, height);
+  record(CALL_glScissor, x, y, width, height);
+}
+
+/* the strings joined, as one */
+void glShaderSource(GLuint shader, GLsizei count, GLchar const * const *string, GLint const *length) {
+  REAL(glShaderSource);
+  std::string source;
+
+  real(shader, count, string, length);
+  for (GLsizei i = 0; i < count; ++i) {
+    if (length && length[i] >= 0)
+      source.append(string[i], length[i]);
+    else
+      source.append(string[i]);
+  }
+  record(CALL_glShaderSource, shader, source.c_str());
+}
+
+void glStencilFunc(GLenum func, GLint ref, GLuint mask) {
+  REAL(glStencilFunc);
+  real(func, ref, mask);
+  record(CALL_glStencilFunc, func, ref, mask);
+}
+
+void glStencilMask(GLuint mask) {
+  REAL(glStencilMask);
+  real(mask);
+  record(CALL_glStencilMask, mask);
+}
+
+void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {
+  REAL(glStencilOp);
+  real(fail, zfail, zpass);
+  record(CALL_glStencilOp, fail, zfail, zpass);
+}
+
+void glTexBuffer(GLenum target, GLenum internalformat, GLuint buffer) {
+  REAL(glTexBuffer);
+  real(target, internalformat, buffer);
+  record(CALL_glTexBuffer, target, internalformat, buffer);
+}
+
+void glTexImage1D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLint border, GLenum format, GLenum type, void const *data) {
+  REAL(glTexImage1D);
+  real(target, level, internalformat, width, border, format, type, data);
+  record(CALL_glTexImage1D, target, level, internalformat, width, border, format, type, pixels(data, width, 1, 1, format, type));
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, void const *data) {
+  REAL(glTexImage2D);
+  real(target, level, internalformat, width, height, border, format, type, data);
+  record(CALL_glTexImage2D, target, level, internalformat, width, height, border, format, type, pixels(data, width, height, 1, format, type));
+}
+
+void glTexImage2DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations) {
+  REAL(glTexImage2DMultisample);
+  real(target, samples, internalformat, width, height, fixedsamplelocations);
+  record(CALL_glTexImage2DMultisample, target, samples, internalformat, width, height, fixedsamplelocations);
+}
+
+void glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, void const *data) {
+  REAL(glTexImage3D);
+  real(target, level, internalformat, width, height, depth, border, format, type, data);
+  record(CALL_glTexImage3D, target, level, internalformat, width, height, depth, border, format, type, pixels(data, width, height, depth, format, type));
+}
+
+void glTexParameterf(GLenum target, GLenum pname, GLfloat param) {
+  REAL(glTexParameterf);
+  real(target, pname, param);
+  record(CALL_glTexParameterf, target, pname, param);
+}
+
+void glTexParameterfv(GLenum target, GLenum pname, GLfloat const *params) {
+  REAL(glTexParameterfv);
+  real(target, pname, params);
+  record(CALL_glTexParameterfv, target, pname, Data{ params, parameter_size(pname), false });
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+  REAL(glTexParameteri);
+  real(target, pname, param);
+  record(CALL_glTexParameteri, target, pname, param);
+}
+
+void glTexParameteriv(GLenum target, GLenum pname, GLint const *params) {
+  REAL(glTexParameteriv);
+  real(target, pname, params);
+  record(CALL_glTexParameteriv, target, pname, Data{ params, parameter_size(pname), false });
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, void const *data) {
+  REAL(glTexSubImage2D);
+  real(target, level, xoffset, yoffset, width, height, format, type, data);
+  record(CALL_glTexSubImage2D, target, level, xoffset, yoffset, width, height, format, type, pixels(data, width, height, 1, format, type));
+}
+
+void glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, void const *data) {
+  REAL(glTexSubImage3D);
+  real(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+  record(CALL_glTexSubImage3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels(data, width, height, depth, format, type));
+}
+
+/* the names one after the other, each ended by its NUL */
+void glTransformFeedbackVaryings(GLuint program, GLsizei count, GLchar const * const *varyings, GLenum bufferMode) {
+  REAL(glTransformFeedbackVaryings);
+  std::string names;
+
+  real(program, count, varyings, bufferMode);
+  for (GLsizei i = 0; i < count; ++i)
+    names.append(varyings[i], strlen(varyings[i]) + 1);
+  record(CALL_glTransformFeedbackVaryings, program, count, Data{ names.data(), names.size(), false }, bufferMode);
+}
+
+void glUniform1f(GLint location, GLfloat v0) {
+  REAL(glUniform1f);
+  real(location, v0);
+  record(CALL_glUniform1f, location, v0);
+}
+
+void glUniform1fv(GLint location, GLsizei count, GLfloat const *value) {
+  REAL(glUniform1fv);
+  real(location, count, value);
+  record(CALL_glUniform1fv, location, count, Data{ value, count * sizeof(GLfloat), false });
+}
+
+void glUniform1i(GLint location, GLint v0) {
+  REAL(glUniform1i);
+  real(location, v0);
+  record(CALL_glUniform1i, location, v0);
+}
+
+void glUniform1iv(GLint location, GLsizei count, GLint const *value) {
+  REAL(glUniform1iv);
+  real(location, count, value);
+  record(CALL_glUniform1iv, location, count, Data{ value, count * sizeof(GLint), false });
+}
+
+void glUniform1ui(GLint location, GLuint v0) {
+  REAL(glUniform1ui);
+  real(location, v0);
+  record(CALL_glUniform1ui, location, v0);
+}
+
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+  REAL(glUniform2f);
+  real(location, v0, v1);
+  record(CALL_glUniform2f, location, v0, v1);
+}
+
+void glUniform2fv(GLint location, GLsizei count, GLfloat const *value) {
+  REAL(glUniform2fv);
+  real(location, count, value);
+  record(CALL_glUniform2fv, location, count, Data{ value, 2 * count * sizeof(GLfloat), false });
+}
+
+void glUniform2i(GLint location, GLint v0, GLint v1) {
+  REAL(glUniform2i);
+  real(location, v0, v1);
+  record(CALL_glUniform2i, location, v0, v1);
+}
+
+void glUniform2iv(GLint location, GLsizei count, GLint const *value) {
+  REAL(glUniform2iv);
+  real(location, count, value);
+  record(CALL_glUniform2iv, location, count, Data{ value, 2 * count * sizeof(GLint), false });
+}
+
+void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+  REAL(glUniform3f);
+  real(location, v0, v1, v2);
+  record(CALL_glUniform3f, location, v0, v1, v2);
+}
+
+void glUniform3fv(GLint location, GLsizei count, GLfloat const *value) {
+  REAL(glUniform3fv);
+  real(location, count, value);
+  record(CALL_glUniform3fv, location, count, Data{ value, 3 * count * sizeof(GLfloat), false });
+}
+
+void glUniform3i(GLint location, GLint v0, GLint v1, GLint v2) {
+  REAL(glUniform3i);
+  real(location, v0, v1, v2);
+  record(CALL_glUniform3i, location, v0, v1, v2);
+}
+
+void glUniform3iv(GLint location, GLsizei count, GLint const *value) {
+  REAL(glUniform3iv);
+  real(location, count, value);
+  record(CALL_glUniform3iv, location, count, Data{ value, 3 * count * sizeof(GLint), false });
+}
+
+void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+  REAL(glUniform4f);
+  real(location, v0, v1, v2, v3);
+  record(CALL_glUniform4f, location, v0, v1, v2, v3);
+}
+
+void glUniform4fv(GLint location, GLsizei count, GLfloat const *value) {
+  REAL(glUniform4fv);
+  real(location, count, value);
+  record(CALL_glUniform4fv, location, count, Data{ value, 4 * count * sizeof(GLfloat), false });
+}
+
+void glUniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3) {
+  REAL(glUniform4i);
+  real(location, v0, v1, v2, v3);
+  record(CALL_glUniform4i, location, v0, v1, v2, v3);
+}
+
+void glUniform4iv(GLint location, GLsizei count, GLint const *value) {
+  REAL(glUniform4iv);
+  real(location, count, value);
+  record(CALL_glUniform4iv, location, count, Data{ value, 4 * count * sizeof(GLint), false });
+}
+
+void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+  REAL(glUniformBlockBinding);
+  real(program, uniformBlockIndex, uniformBlockBinding);
+  record(CALL_glUniformBlockBinding, program, uniformBlockIndex, uniformBlockBinding);
+}
+
+void glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+  REAL(glUniformMatrix2fv);
+  real(location, count, transpose, value);
+  record(CALL_glUniformMatrix2fv, location, count, transpose, Data{ value, 4 * count * sizeof(GLfloat), false });
+}
+
+void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+  REAL(glUniformMatrix3fv);
+  real(location, count, transpose, value);
+  record(CALL_glUniformMatrix3fv, location, count, transpose, Data{ value, 9 * count * sizeof(GLfloat), false });
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+  REAL(glUniformMatrix4fv);
+  real(location, count, transpose, value);
+  record(CALL_glUniformMatrix4fv, location, count, transpose, Data{ value, 16 * count * sizeof(GLfloat), false });
+}
+
+/* what was written to the mapping goes with it, read before it's gone */
+GLboolean glUnmapBuffer(GLenum target) {
+  REAL(glUnmapBuffer);
+
+  record(CALL_glUnmapBuffer, target, unmapped(target));
+  return real(target);
+}
+
+void glUseProgram(GLuint program) {
+  REAL(glUseProgram);
+  real(program);
+  record(CALL_glUseProgram, program);
+}
+
+void glVertexAttribDivisor(GLuint index, GLuint divisor) {
+  REAL(glVertexAttribDivisor);
+  real(index, divisor);
+  record(CALL_glVertexAttribDivisor, index, divisor);
+}
+
+void glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, void const *pointer) {
+  REAL(glVertexAttribIPointer);
+  real(index, size, type, stride, pointer);
+  record(CALL_glVertexAttribIPointer, index, size, type, stride, Offset{ pointer });
+}
+
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, void const *pointer) {
+  REAL(glVertexAttribPointer);
+  real(index, size, type, normalized, stride, pointer);
+  record(CALL_glVertexAttribPointer, index, size, type, normalized, stride, Offset{ pointer });
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  REAL(glViewport);
+  real(x, y, width, height);
+  record(CALL_glViewport, x, y, width, height);
+}
+
+void glWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+  REAL(glWaitSync);
+  real(sync, flags, timeout);
+  record(CALL_glWaitSync, sync, flags, timeout);
+}
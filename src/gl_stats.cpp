@@ -0,0 +1,118 @@
+#include <gl_stats.hpp>
+
+using namespace std;
+using namespace sky;
+
+GLStats gStats;
+
+namespace {
+  void csv_row(ostream &out, float time, char const *name, GLCounters const &c) {
+    out << time << ',' << name << ',' << c.draws << ',' << c.programs << ',' << c.textures << ',' << c.framebuffers
+        << ',' << c.uniforms << ',' << c.elided << ',' << c.uploaded << ',' << c.samples << '\n';
+  }
+}
+
+GLStats::GLStats() :
+    _frame()
+  , _inPass(false)
+  , _sampling(false)
+  , _marker(nullptr) {
+}
+
+void GLStats::mark_passes(PassMarker marker) {
+  _marker = marker;
+}
+
+void GLStats::count_samples(bool on) {
+  _sampling = on;
+}
+
+bool GLStats::counting_samples() const {
+  return _sampling;
+}
+
+void GLStats::_add(uint GLCounters::*counter, uint n) {
+  _frame.*counter += n;
+  if (_inPass)
+    _passes.back().counters.*counter += n;
+}
+
+void GLStats::begin_frame() {
+  _frame = GLCounters();
+  _passes.clear();
+  _inPass = false;
+}
+
+void GLStats::begin_pass(char const *name) {
+  if (_marker)
+    _marker(name);
+  _passes.push_back({ name, GLCounters() });
+  _inPass = true;
+}
+
+void GLStats::end_pass() {
+  if (_marker && _inPass)
+    _marker(nullptr);
+  _inPass = false;
+}
+
+void GLStats::draw(uint n) {
+  _add(&GLCounters::draws, n);
+}
+
+void GLStats::program() {
+  _add(&GLCounters::programs, 1);
+}
+
+void GLStats::texture() {
+  _add(&GLCounters::textures, 1);
+}
+
+void GLStats::framebuffer() {
+  _add(&GLCounters::framebuffers, 1);
+}
+
+void GLStats::uniform() {
+  _add(&GLCounters::uniforms, 1);
+}
+
+void GLStats::elided() {
+  _add(&GLCounters::elided, 1);
+}
+
+void GLStats::samples(uint n) {
+  _add(&GLCounters::samples, n);
+}
+
+void GLStats::upload(size_t bytes) {
+  _frame.uploaded += bytes;
+  if (_inPass)
+    _passes.back().counters.uploaded += bytes;
+}
+
+GLCounters const & GLStats::frame() const {
+  return _frame;
+}
+
+uint GLStats::passes() const {
+  return _passes.size();
+}
+
+char const * GLStats::pass_name(uint i) const {
+  return _passes[i].name;
+}
+
+GLCounters const & GLStats::pass(uint i) const {
+  return _passes[i].counters;
+}
+
+void GLStats::csv_header(ostream &out) {
+  out << "time,pass,draws,programs,textures,framebuffers,uniforms,elided,uploaded,samples\n";
+}
+
+void GLStats::csv(ostream &out, float time) const {
+  for (auto const &p : _passes)
+    csv_row(out, time, p.name, p.counters);
+  csv_row(out, time, "frame", _frame);
+}
+
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <glyph_atlas.hpp>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace sky;
+
+namespace {
+  float const EDT_INF = 1e20f;
+
+  /* 1D squared euclidean distance transform (Felzenszwalb & Huttenlocher) */
+  void edt_1d(float const *f, float *d, int n, int *v, float *z) {
+    int k = 0;
+
+    v[0] = 0;
+    z[0] = -EDT_INF;
+    z[1] = EDT_INF;
+    for (int q = 1; q < n; ++q) {
+      float s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+      while (s <= z[k]) {
+        --k;
+        s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k+1] = EDT_INF;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+      while (z[k+1] < q)
+        ++k;
+      d[q] = (q - v[k])*(q - v[k]) + f[v[k]];
+    }
+  }
+
+  /* 2D squared distance transform, in place; f is 0 on seeds, EDT_INF elsewhere */
+  void edt_2d(float *f, int w, int h) {
+    int n = max(w, h);
+    vector<float> tmp(n), d(n), z(n+1);
+    vector<int> v(n);
+
+    for (int x = 0; x < w; ++x) {
+      for (int y = 0; y < h; ++y)
+        tmp[y] = f[y*w + x];
+      edt_1d(tmp.data(), d.data(), h, v.data(), z.data());
+      for (int y = 0; y < h; ++y)
+        f[y*w + x] = d[y];
+    }
+
+    for (int y = 0; y < h; ++y) {
+      edt_1d(f + y*w, d.data(), w, v.data(), z.data());
+      copy(d.begin(), d.begin()+w, f + y*w);
+    }
+  }
+
+  /* 8 pixels out of each of the 256 bytes */
+  struct SpreadTable {
+    uint64_t pixels[256];
+
+    SpreadTable(void) {
+      for (uint b = 0; b < 256; ++b) {
+        ubyte px[8];
+        for (uint j = 0; j < 8; ++j)
+          px[j] = (b & (0x80 >> j)) ? 0xFF : 0x00;
+        memcpy(&pixels[b], px, 8);
+      }
+    }
+  };
+}
+
+void unpack_glyph(ubyte const *packed, ubyte *dst) {
+  uint bits = packed[0] * packed[1];
+  uint bytes = (bits + 7) / 8;
+  ubyte const *src = packed + 2;
+  uint i = 0;
+
+#ifdef __SSE2__
+  /* 16 pixels out of 2 bytes at once: broadcast, mask one bit per lane, compare */
+  __m128i const masks = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+  for (; i + 2 <= bytes; i += 2) {
+    __m128i b = _mm_unpacklo_epi64(_mm_set1_epi8(src[i]), _mm_set1_epi8(src[i+1]));
+    __m128i p = _mm_cmpeq_epi8(_mm_and_si128(b, masks), masks);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i*8), p);
+  }
+#endif
+
+  /* remaining bytes through the table */
+  static SpreadTable const table;
+
+  for (; i < bytes; ++i)
+    memcpy(dst + i*8, &table.pixels[src[i]], 8);
+}
+
+void glyph_sdf(ubyte const *bitmap, ushort w, ushort h, ushort spread, ubyte *dst) {
+  int const cw = w + 2*spread;
+  int const ch = h + 2*spread;
+  vector<float> outside(cw*ch, EDT_INF);
+  vector<float> inside(cw*ch, 0.f);
+
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      if (bitmap[y*w + x]) {
+        int c = (y+spread)*cw + x + spread;
+        outside[c] = 0.f;
+        inside[c] = EDT_INF;
+      }
+    }
+  }
+
+  edt_2d(outside.data(), cw, ch);
+  edt_2d(inside.data(), cw, ch);
+
+  /* 0.5 on the edge, 1 spread pixels inside, 0 spread pixels outside */
+  for (int i = 0; i < cw*ch; ++i) {
+    float d = outside[i] > 0.f ? sqrtf(outside[i]) - 0.5f : 0.5f - sqrtf(inside[i]);
+    float v = 0.5f - d / (2.f * spread);
+    dst[i] = static_cast<ubyte>(min(max(v, 0.f), 1.f) * 255.f + 0.5f);
+  }
+}
+
+GlyphAtlas::GlyphAtlas(ubyte const * const *index, ushort nb, ushort spread, ushort width) :
+    width(width)
+  , height(0)
+  , spread(spread)
+  , glyphs(nb) {
+  ushort x = 0, y = 0, rowHeight = 0;
+
+  /* shelf packing */
+  for (ushort i = 0; i < nb; ++i) {
+    auto &g = glyphs[i];
+
+    g.w = g.h = 0;
+    if (!index[i])
+      continue;
+
+    g.w = index[i][0];
+    g.h = index[i][1];
+    ushort cw = g.w + 2*spread;
+    ushort ch = g.h + 2*spread;
+
+    if (x + cw > width) {
+      x = 0;
+      y += rowHeight;
+      rowHeight = 0;
+    }
+    g.x = x;
+    g.y = y;
+    x += cw;
+    rowHeight = max(rowHeight, ch);
+  }
+
+  height = 1;
+  while (height < y + rowHeight)
+    height <<= 1;
+  pixels.assign(width*height, 0);
+
+  /* SDFs, one glyph at a time per thread */
+  atomic<ushort> next(0);
+  auto worker = [&]() {
+    vector<ubyte> bitmap, sdf;
+
+    for (ushort i = next++; i < nb; i = next++) {
+      auto const &g = glyphs[i];
+      if (!g.w)
+        continue;
+
+      ushort cw = g.w + 2*spread;
+      ushort ch = g.h + 2*spread;
+      bitmap.resize(g.w*g.h + 15);
+      sdf.resize(cw*ch);
+      unpack_glyph(index[i], bitmap.data());
+      glyph_sdf(bitmap.data(), g.w, g.h, spread, sdf.data());
+
+      /* bitmaps are top-down, textures bottom-up */
+      for (ushort r = 0; r < ch; ++r)
+        memcpy(&pixels[(g.y + ch-1-r)*width + g.x], &sdf[r*cw], cw);
+    }
+  };
+  uint threadsNb = max(1u, min<uint>(thread::hardware_concurrency(), nb));
+  vector<thread> threads;
+
+  for (uint i = 1; i < threadsNb; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads)
+    t.join();
+}
+
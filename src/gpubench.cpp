@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <gl.hpp>
+#include <core/context.hpp>
+#include <core/state.hpp>
+#include <fsm/cave.hpp>
+#include <fsm/common.hpp>
+#include <fsm/fireflies.hpp>
+#include <fsm/firefly_lights.hpp>
+#include <fsm/laser.hpp>
+#include <fsm/liquid.hpp>
+#include <fsm/reprojection.hpp>
+#include <fsm/slab.hpp>
+#include <gl_stats.hpp>
+#include <math/common.hpp>
+#include <math/matrix.hpp>
+#include <math/quaternion.hpp>
+#include <misc/log.hpp>
+#include <render_graph.hpp>
+#include <scene/common.hpp>
+#include <scene/material.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+using namespace math;
+using namespace misc;
+using namespace scene;
+
+namespace {
+  char   const TITLE[]        = "gpubench";
+  uint   const WARMUP         = 10;    /* frames drawn before timing */
+  uint   const FRAMES         = 61;    /* timed frames per case */
+  float  const FRAME          = 1.f / 60.f;
+  /* defaults, as in the parts */
+  ushort const LASER_TESS     = 13;
+  float  const LASER_HHEIGHT  = 0.15f;
+  ushort const LASER_BLUR     = 1;
+  float  const SLAB_SIZE      = 1.f;
+  float  const SLAB_THICKNESS = 0.5f;
+  uint   const LIQUID_WIDTH   = 10;
+  uint   const LIQUID_HEIGHT  = 10;
+  uint   const CAVE_TEX       = 600;   /* heightmaps side */
+  float  const CAVE_MORPH     = 0.5f;
+  /* sweeps */
+  ushort const LASER_TESS_SWEEP[]     = { 4, 8, 13, 26, 52, 104 };
+  ushort const LASER_BLUR_SWEEP[]     = { 0, 1, 2, 4, 8 };
+  uint   const SLAB_INSTANCES_SWEEP[] = { 100, 200, 300, 400, 500, 600 };
+  uint   const LIQUID_TESS_SWEEP[]    = { 20, 40, 80, 160, 320 }; /* quads per side */
+  uint   const CAVE_TEX_SWEEP[]       = { 150, 300, 600, 1200, 2400 };
+  uint   const FIREFLIES_SWEEP[]      = { 20, 1000, 10000, 100000 };
+  uint   const LIGHTS_SWEEP[]         = { 1, 5, 10, 20, 40, 80 };
+
+  typedef chrono::steady_clock Clock;
+
+  /* what every case of a run shares */
+  struct Bench {
+    ushort width, height;
+    char const *renderer;
+    char const *filter;
+    Common *common;
+  };
+
+  /* ms per frame, medians over FRAMES */
+  struct Timing {
+    double gpu, wall;
+  };
+
+  double ms_since(Clock::time_point t0) {
+    return chrono::duration<double, milli>(Clock::now() - t0).count();
+  }
+
+  double median(vector<double> &v) {
+    sort(v.begin(), v.end());
+    return v[v.size() / 2];
+  }
+
+  /* the cube room orbit and the stairway flight, as in the sync */
+  Mat44 orbit(float t) {
+    return Mat44::trslt(-Position(cosf(t), sinf(t), sinf(t))*1.5f) *
+           Orient(Axis3(0.f, 1.f, 0.f), t * PI_2 / 3.).to_matrix() *
+           Orient(Axis3(0.f, 0.f, 1.f), sinf(t)+t*0.5f).to_matrix();
+  }
+
+  Mat44 flight(float t) {
+    return Mat44::trslt(-Position(cosf(t*0.1f)*10.f, sinf(t*0.8f), 50.f-t)) *
+           Orient(Axis3(0.f, 0.f, 1.f), PI_2+sinf(t*0.5f)).to_matrix() *
+           Orient(Axis3(0.f, 1.f, 0.f), PI_2*sinf(t*0.5f) / 3.f).to_matrix() *
+           Orient(Axis3(1.f, 0.f, 0.f), PI_4*cosf(t*0.1f)*0.5f).to_matrix();
+  }
+
+  bool wanted(Bench const &b, char const *effect) {
+    return !b.filter || strstr(effect, b.filter);
+  }
+
+  /* update moves the frame on, off the clock; the GPU time is that of the
+   * whole graph, the wall time runs until the GPU is done with it */
+  Timing time_frames(RenderGraph &graph, FrameView &view, function<void (void)> const &update) {
+    vector<double> gpu(FRAMES), wall(FRAMES);
+    GLuint query;
+
+    glGenQueries(1, &query);
+    for (uint i = 0; i < WARMUP + FRAMES; ++i) {
+      GLuint64 ns;
+
+      view.time += FRAME;
+      update();
+      glFinish();
+
+      auto t0 = Clock::now();
+      gStats.begin_frame();
+      gSC.forget();
+      glBeginQuery(GL_TIME_ELAPSED, query);
+      graph.execute();
+      glEndQuery(GL_TIME_ELAPSED);
+      glFinish();
+      double w = ms_since(t0);
+
+      glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+      if (i >= WARMUP) {
+        gpu[i - WARMUP] = ns * 1e-6;
+        wall[i - WARMUP] = w;
+      }
+    }
+    glDeleteQueries(1, &query);
+
+    return { median(gpu), median(wall) };
+  }
+
+  void report(Bench const &b, char const *effect, char const *parameter, uint value, double setup, Timing const &t) {
+    printf("\"%s\",%s,%s,%u,%u,%u,%.3f,%.4f,%.4f\n", b.renderer, effect, parameter, value, b.width, b.height, setup, t.gpu, t.wall);
+    fflush(stdout);
+  }
+
+  RenderGraph::Target gbuffer(Bench const &b, RenderGraph &graph) {
+    auto &drenderer = b.common->drenderer;
+
+    return graph.external("bench G-buffer", [&drenderer]() { drenderer.start_geometry(); }, [&drenderer]() { drenderer.end_geometry(); });
+  }
+
+  /* draw into the G-buffer, which nothing else reads: an empty pass
+   * reading it keeps the draw from being culled */
+  void geometry(Bench const &b, RenderGraph &graph, char const *name, RenderGraph::Callback const &draw) {
+    auto target = gbuffer(b, graph);
+
+    graph.pass(name, [draw]() {
+      gSC.enable(state::DEPTH_TEST);
+      draw();
+    }).draws(target, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
+    graph.pass("bench sink", []() {}).reads(target).draws(RenderGraph::BACKBUFFER, RenderGraph::LOAD);
+    graph.prepare();
+  }
+
+  void bench_laser(Bench const &b, char const *parameter, ushort tess, ushort blur, uint value) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), orbit(0.f) };
+    auto t0 = Clock::now();
+    Laser laser(b.width, b.height, tess, LASER_HHEIGHT, blur);
+    glFinish();
+    double setup = ms_since(t0);
+    RenderGraph graph(b.width, b.height);
+
+    graph.copy("bench laser", laser.add_passes(graph, view, tess), RenderGraph::BACKBUFFER, true);
+    graph.prepare();
+    report(b, "laser", parameter, value, setup, time_frames(graph, view, [&view]() { view.view = orbit(view.time); }));
+  }
+
+  void bench_slab(Bench const &b, uint instances) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), orbit(0.f) };
+    auto t0 = Clock::now();
+    Slab slab(b.width, b.height, SLAB_SIZE, SLAB_THICKNESS);
+    glFinish();
+    double setup = ms_since(t0);
+    RenderGraph graph(b.width, b.height);
+
+    RenderGraph::Callback draw = [&slab, &view, instances]() { slab.render(view.time, view.proj, view.view, instances); };
+
+    geometry(b, graph, "bench slab", draw);
+    report(b, "slab", "instances", instances, setup, time_frames(graph, view, [&view]() { view.view = orbit(view.time); }));
+  }
+
+  void bench_liquid(Bench const &b, uint tess) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), orbit(0.f) };
+    auto t0 = Clock::now();
+    Liquid liquid(LIQUID_WIDTH, LIQUID_HEIGHT, tess, tess);
+    glFinish();
+    double setup = ms_since(t0);
+    RenderGraph graph(b.width, b.height);
+
+    RenderGraph::Callback draw = [&liquid, &view, tess]() { liquid.render(view.time, view.proj, view.view, tess * tess); };
+
+    geometry(b, graph, "bench liquid", draw);
+    report(b, "liquid", "tess", tess, setup, time_frames(graph, view, [&view]() { view.view = orbit(view.time); }));
+  }
+
+  void bench_cave(Bench const &b, uint tex) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), flight(0.f) };
+    vector<Terrain::Node> nodes;
+    auto t0 = Clock::now();
+    Cave cave(tex, tex);
+    glFinish();
+    double setup = ms_since(t0);
+    RenderGraph graph(b.width, b.height);
+
+    RenderGraph::Callback draw = [&cave, &view, &nodes]() { cave.render(CAVE_MORPH, view.proj, view.view, view.view, nodes); };
+
+    geometry(b, graph, "bench cave", draw);
+    report(b, "cave", "tex", tex, setup, time_frames(graph, view, [&cave, &view, &nodes]() {
+      view.view = flight(view.time);
+      cave.select(view.proj, view.view, nodes);
+    }));
+  }
+
+  void bench_fireflies(Bench const &b, uint nb) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), flight(0.f) };
+    auto t0 = Clock::now();
+    Fireflies fireflies(nb);
+    glFinish();
+    double setup = ms_since(t0);
+    RenderGraph graph(b.width, b.height);
+
+    /* the simulation steps with the frame, on the GPU as well */
+    graph.pass("bench fireflies", [&fireflies, &view]() {
+      fireflies.animate(view.time);
+      gSC.enable(state::DEPTH_TEST);
+      gSC.enable(state::BLENDING);
+      gSC.blend_func(blending::SRC_ALPHA, blending::ONE_MINUS_SRC_ALPHA);
+      fireflies.render(view.proj, view.view);
+      gSC.disable(state::BLENDING);
+    }).draws(RenderGraph::BACKBUFFER, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
+    graph.prepare();
+    report(b, "fireflies", "count", nb, setup, time_frames(graph, view, [&view]() { view.view = flight(view.time); }));
+  }
+
+  /* one additive pass per light over the G-buffer, as in the stairway;
+   * lights past the simulated ones reuse their positions */
+  RenderGraph::Callback shading(Bench const &b, FrameView const &view, Position const *positions, uint lights) {
+    auto &drenderer = b.common->drenderer;
+    auto &matmgr = b.common->matmgr;
+    auto &program = matmgr.postprocess().program();
+    auto projIndex   = program.map_uniform("proj");
+    auto viewIndex   = program.map_uniform("view");
+    auto lColorIndex = program.map_uniform("lightColor");
+    auto lPosIndex   = program.map_uniform("lightPos");
+
+    return [=, &drenderer, &matmgr, &view]() {
+      drenderer.start_shading();
+      matmgr.start();
+      gSC.push(projIndex, view.proj);
+      gSC.push(viewIndex, view.view);
+
+      gSC.enable(state::BLENDING);
+      gSC.blend_func(blending::ONE, blending::ONE);
+
+      for (uint i = 0; i < lights; ++i) {
+        auto p = positions[i % FireflyLights::NB];
+        gSC.push(lColorIndex, 0.75f, 0.5f, 0.25f);
+        gSC.push(lPosIndex, p.x, p.y, p.z);
+        state::clear(state::DEPTH_BUFFER);
+        gSC.helper([&matmgr]() { matmgr.render(); });
+      }
+      matmgr.end();
+      drenderer.end_shading();
+      gSC.forget();
+      gSC.disable(state::BLENDING);
+    };
+  }
+
+  /* half the backbuffer, as the stairway's halves */
+  void scissor(Bench const &b, int half) {
+    int left = b.width / 2;
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(half ? left : 0, 0, half ? b.width - left : left, b.height);
+  }
+
+  /* the cave into the G-buffer, then the lights */
+  void bench_shading(Bench const &b, uint lights) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), flight(0.f) };
+    vector<Terrain::Node> nodes;
+    FireflyLights simulation(FireflyLights::NB);
+    Position positions[FireflyLights::NB];
+    Cave cave(CAVE_TEX, CAVE_TEX);
+    RenderGraph graph(b.width, b.height);
+    auto target = gbuffer(b, graph);
+
+    graph.pass("bench geometry", [&cave, &view, &nodes]() {
+      gSC.enable(state::DEPTH_TEST);
+      cave.render(CAVE_MORPH, view.proj, view.view, view.view, nodes);
+    }).draws(target, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
+
+    graph.pass("bench shading", shading(b, view, positions, lights))
+      .reads(target).draws(RenderGraph::BACKBUFFER, RenderGraph::CLEAR).depth(RenderGraph::DISCARD);
+    graph.prepare();
+    /* nothing of its own to set up: the material manager is shared */
+    report(b, "shading", "lights", lights, 0., time_frames(graph, view, [&]() {
+      view.view = flight(view.time);
+      cave.select(view.proj, view.view, nodes);
+      simulation.simulate(view.time, positions);
+    }));
+  }
+
+  /* the same with the stairway's --reproject: velocities out of the
+   * geometry pass, the lights over one half and the other half from the
+   * last frame, the halves alternating; against shading, what it saves */
+  void bench_reprojection(Bench const &b, uint lights) {
+    FrameView view = { 0.f, Mat44::perspective(FOVY, 1.f * b.width / b.height, ZNEAR, ZFAR), flight(0.f) };
+    auto &drenderer = b.common->drenderer;
+    vector<Terrain::Node> nodes;
+    FireflyLights simulation(FireflyLights::NB);
+    Position positions[FireflyLights::NB];
+    Cave cave(CAVE_TEX, CAVE_TEX);
+    auto t0 = Clock::now();
+    Reprojection reprojection(b.width, b.height);
+    glFinish();
+    double setup = ms_since(t0);
+    Mat44 lastView = view.view;
+    int half = 0;
+    RenderGraph graph(b.width, b.height);
+    auto velocity = graph.history("bench velocity");
+    auto lit = graph.history("bench lit");
+    auto target = graph.external("bench G-buffer", [&]() {
+      drenderer.start_geometry();
+      cave.begin_velocity(graph.texture(velocity));
+    }, [&]() {
+      cave.end_velocity();
+      drenderer.end_geometry();
+    });
+    auto shade = shading(b, view, positions, lights);
+
+    graph.pass("bench geometry", [&]() {
+      gSC.enable(state::DEPTH_TEST);
+      cave.render(CAVE_MORPH, view.proj, view.view, lastView, nodes);
+    }).draws(target, RenderGraph::CLEAR).depth(RenderGraph::CLEAR);
+
+    graph.pass("bench shading", [&]() {
+      scissor(b, half);
+      shade();
+      glDisable(GL_SCISSOR_TEST);
+    }).reads(target).draws(lit, RenderGraph::CLEAR);
+
+    graph.pass("bench reprojection", [&]() {
+      scissor(b, 1 - half);
+      reprojection.render(view.proj, view.view, lastView);
+      glDisable(GL_SCISSOR_TEST);
+    }).reads(graph.previous(lit)).reads(velocity).reads(graph.previous(velocity)).draws(lit, RenderGraph::LOAD);
+
+    graph.copy("bench present", lit, RenderGraph::BACKBUFFER);
+    graph.prepare();
+    report(b, "reprojection", "lights", lights, setup, time_frames(graph, view, [&]() {
+      lastView = view.view;
+      view.view = flight(view.time);
+      half = 1 - half;
+      cave.select(view.proj, view.view, nodes);
+      simulation.simulate(view.time, positions);
+    }));
+  }
+
+  /* each parameter of an effect swept with the others at their defaults */
+  void run(Bench const &b) {
+    if (wanted(b, "laser")) {
+      for (auto tess : LASER_TESS_SWEEP)
+        bench_laser(b, "tess", tess, LASER_BLUR, tess);
+      for (auto blur : LASER_BLUR_SWEEP)
+        bench_laser(b, "blur", LASER_TESS, blur, blur);
+    }
+    if (wanted(b, "slab")) {
+      for (auto instances : SLAB_INSTANCES_SWEEP)
+        bench_slab(b, instances);
+    }
+    if (wanted(b, "liquid")) {
+      for (auto tess : LIQUID_TESS_SWEEP)
+        bench_liquid(b, tess);
+    }
+    if (wanted(b, "cave")) {
+      for (auto tex : CAVE_TEX_SWEEP)
+        bench_cave(b, tex);
+    }
+    if (wanted(b, "fireflies")) {
+      for (auto nb : FIREFLIES_SWEEP)
+        bench_fireflies(b, nb);
+    }
+    if (wanted(b, "shading")) {
+      for (auto lights : LIGHTS_SWEEP)
+        bench_shading(b, lights);
+    }
+    if (wanted(b, "reprojection")) {
+      for (auto lights : LIGHTS_SWEEP)
+        bench_reprojection(b, lights);
+    }
+  }
+}
+
+/* Times each effect of the intro on its own, at one resolution per run,
+ * across sweeps of its parameters: one CSV row per case, with the setup
+ * time of the effect, and the median GPU time (timer queries) and wall
+ * time (until glFinish) of a frame drawing it. Effects whose name contains
+ * the filter only. LIBGL_ALWAYS_SOFTWARE=1 runs it on llvmpipe; the
+ * resolution sweep is the gpubench-sweep make target. */
+int main(int argc, char **argv) {
+  Bench b;
+
+  if (argc < 3 || (b.width = atoi(argv[1])) == 0 || (b.height = atoi(argv[2])) == 0) {
+    misc::log << error << "usage: " << argv[0] << " WIDTH HEIGHT [FILTER]" << endl;
+    return 1;
+  }
+  b.filter = argc > 3 ? argv[3] : nullptr;
+
+  Context cntxt(b.width, b.height, false, TITLE);
+  Common common(b.width, b.height);
+  Material matPlastic;
+
+  /* as the intro does */
+  common.matmgr.register_material(shader_source(SHADER_MATERIAL_PLASTIC), matPlastic);
+  common.matmgr.register_material(shader_source(SHADER_MATERIAL_TERRAIN));
+  common.matmgr.commit_materials(b.width, b.height, shader_source(SHADER_MATERIAL_HEADER));
+
+  b.renderer = reinterpret_cast<char const *>(glGetString(GL_RENDERER));
+  b.common = &common;
+
+  printf("renderer,effect,parameter,value,width,height,setup_ms,gpu_ms,wall_ms\n");
+  run(b);
+
+  return 0;
+}
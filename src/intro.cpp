@@ -1,103 +1,352 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <audio_analyzer.hpp>
+#include <gl.hpp>
+#include <gl_stats.hpp>
 #include <intro.hpp>
+#include <payload.hpp>
+#include <quality.hpp>
 #ifdef SKY_DEBUG
 # include <misc/clock.hpp>
-# include <misc/log.hpp>
 #endif
+#include <misc/log.hpp>
 #include <scene/material.hpp>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+#include <video_export.hpp>
 
 /* include fsm parts here */
 #include <fsm/cube_room.hpp>
 #include <fsm/stairway.hpp>
+#include <fsm/sync.hpp>
 
 using namespace sky;
 using namespace core;
-#ifdef SKY_DEBUG
 using namespace misc;
-#endif
 using namespace scene;
 using namespace sync;
 
-Intro::Intro(ushort width, ushort height, bool full, char const *title) :
-    _cntxt(width, height, full, title)
-  , _com(width, height)
-  , _pFSM(nullptr) {
+namespace {
+  uint  const STATS_LINE         = 128;
+  float const STATS_LEFT         = -0.98f;
+  float const STATS_TOP          = 0.9f;
+  float const STATS_SIZE         = 0.03f; /* capitals height, NDC */
+  uint  const LASER_REACH        = 36;    /* px a laser blur pass spreads it */
+  uint  const GUARD_MARGIN       = 12;    /* px past that reach */
+  uint  const AUDIO_RATE         = 44100; /* as the synthesizer's */
+  uint  const PATH_SIZE          = 1024;
+  uint  const CALIBRATION_WARMUP = 10;    /* frames drawn before timing */
+  uint  const CALIBRATION_FRAMES = 31;    /* timed frames per part */
+  float const CALIBRATION_SHARE  = 0.8f;  /* of a refresh a frame may take */
+
+  typedef std::chrono::steady_clock WallClock;
+
+  /* tiles' guard band, past the laser blur's reach at the tier they are
+   * drawn with: tiles are offline, where auto is high */
+  uint tile_guard(Options const &options) {
+    int tier = options.quality == QUALITY_AUTO ? QUALITY_HIGH : options.quality;
+
+    return LASER_REACH * std::max<uint>(quality_tier(tier).laserBlur, 1) + GUARD_MARGIN;
+  }
+
+  /* of the last hop heard at time, as the synthesizer picks them */
+  AudioFeatures const & features_at(std::vector<AudioFeatures> const &song, float time) {
+    std::uint64_t heard = static_cast<std::uint64_t>(std::max(time, 0.f) * AUDIO_RATE) / ANALYSIS_HOP;
+
+    return song[std::min<std::uint64_t>(std::max<std::uint64_t>(heard, 1), song.size()) - 1];
+  }
+}
+
+Intro::Intro(ushort width, ushort height, bool full, char const *title, Options const &options) :
+    _options(options)
+  , _image(width, height, options.columns * options.rows > 1 ? tile_guard(options) : 0, options.columns, options.rows)
+  , _cntxt(_image.drawn_width(), _image.drawn_height(), full, title)
+  , _com(_image.drawn_width(), _image.drawn_height())
+  , _pFSM(nullptr)
+  , _capture(nullptr) {
+  bool tiled = _image.tiles() > 1;
+  int tier = options.quality;
+
+  /* everything is drawn at the size of a tile, guard band included */
+  width = _image.drawn_width();
+  height = _image.drawn_height();
+
   /* common initialization here */
   _init_materials(width, height);
+  _load_song();
+  _com.timeline.song(_synth.module());
+  init_timeline(_com.timeline);
+
+  /* texts are laid out for the aspect of the whole image */
+  _place_tile(0);
 
-  /* init parts FSM here */
-  auto cubeRoom = new CubeRoom(width, height, _com, _freefly);
-  auto stairway = new Stairway(width, height, _com, _freefly);
-  cubeRoom->transition(stairway, 80.2f);
+  /* offline, frames take what they take, and must not depend on it */
+  if (tier == QUALITY_AUTO)
+    tier = options.render || options.video ? QUALITY_HIGH : _calibrate(width, height);
+  _com.quality = quality_tier(tier);
+  _options.quality = tier;
+  _com.worker.lockstep(options.render || options.video);
+
+  /* init parts FSM here; tiles have no last frame to reproject from */
+  auto const &parts = _com.timeline.event("parts");
+  auto cubeRoom = new CubeRoom(width, height, _com, _freefly, options.prepass);
+  auto stairway = new Stairway(width, height, _com, _freefly, options.reproject && !tiled, options.checkerboard && !tiled);
+  cubeRoom->transition(stairway, parts.time(1));
   stairway->transition(nullptr, 180.f);
   _pFSM = new PartsFSM(cubeRoom);
+
+  gStats.count_samples(options.stats || options.bench);
+  if (options.bench) {
+    _bench.open(options.bench);
+    if (_bench)
+      GLStats::csv_header(_bench);
+    else
+      misc::log << error << "unable to open " << options.bench << std::endl;
+  }
+
+  if (options.capture)
+    _capture = new FrameCapture(_options, width, height);
 }
 
 Intro::~Intro() {
   delete _pFSM;
+  delete _capture;
+}
+
+void Intro::_load_song() {
+  char const *var = getenv(PAYLOAD_SONG_FD);
+  int fd = var ? atoi(var) : -1;
+  struct stat st;
+
+  /* the descriptor is closed below: no child may take the number for it */
+  unsetenv(PAYLOAD_SONG_FD);
+
+  /* unpacked in memory by the loader, or next to the binary */
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    _synth.load("CentralStation.xm");
+    return;
+  }
+
+  void *song = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (song != MAP_FAILED) {
+    _synth.load(static_cast<ubyte const *>(song), st.st_size);
+    munmap(song, st.st_size);
+  }
+  close(fd);
 }
 
 void Intro::_init_materials(ushort width, ushort height) {
   Material matPlastic;
 
-  char const *matHeader =
-    "uniform mat4 proj;\n"
-    "uniform mat4 view;\n"
-    "uniform vec3 lightColor;\n"
-    "uniform vec3 lightPos;\n"
-    
-    "vec2 get_uv() {\n"
-      "return gl_FragCoord.xy*res.zw;\n"
-    "}\n"
-    "vec3 get_co() {\n"
-      "vec2 uv = get_uv();\n"
-      "vec4 p = inverse(proj * view) * vec4(2. * vec3(uv, texture(depthmap, uv).r) - 1., 1.);\n"
-      "return p.xyz/p.w;\n"
-    "}\n"
-    "vec3 get_eye() {\n"
-      "return inverse(proj)[3].xyz;\n"
-    "}\n";
-  _com.matmgr.register_material(
-    "vec3 no = normalize(texture(normalmap, get_uv()).xyz);\n"
-    "vec3 co = get_co();\n"
-    "vec4 matColor;// = texture(propmap, get_uv());\n"
-    "matColor = vec4(.4);\n"
-    "vec3 ldir = vec3((lightPos - co).xy, 0.);\n"
-    "vec3 nldir = normalize(ldir);\n"
-    "vec3 eyedir = normalize(get_eye() - co);\n"
-    "vec3 h = ldir + eyedir;\n"
-    "vec3 nh = normalize(h);\n"
-    "float diffk = max(0., dot(nldir, no));\n"
-    "float bspeck = pow(dot(nh,no), 10.);\n" /* blinn-phong */
-    
-    "vec4 mixedColor = matColor + vec4(lightColor, 1.);\n"
-    "vec4 f = mixedColor * diffk;\n"
-    "f += mixedColor * bspeck;\n"
-    "f /= pow(length(ldir)*0.5, 2.);\n"
-    "return clamp(f, 0., 1.);\n"
-  , matPlastic);
-  _com.matmgr.register_material( /* terrain material */
-    //"return texture(normalmap, get_uv());\n"
-    "vec4 terrainColor = vec4(0.4);\n"
-    "vec3 no = texture(normalmap, get_uv()).xyz;\n"
-    "vec3 co = get_co();\n"
-    "vec3 ldir = normalize(lightPos - co);\n"
-    "float atten = distance(co, lightPos);\n" /* FIXME: with above line */
-    "atten = pow(atten*0.6, 2.);\n"
-    "atten = 1. / atten;\n"
-    "return (terrainColor+vec4(lightColor, 1.)) * max(0., dot(no, ldir)) * atten;\n"
-  );
-
-  _com.matmgr.commit_materials(width, height, matHeader);
+  _com.matmgr.register_material(shader_source(SHADER_MATERIAL_PLASTIC), matPlastic);
+  _com.matmgr.register_material(shader_source(SHADER_MATERIAL_TERRAIN));
+  _com.matmgr.commit_materials(width, height, shader_source(SHADER_MATERIAL_HEADER));
+}
+
+void Intro::_draw_stats() const {
+  GLCounters frame = gStats.frame(); /* before the overlay adds to it */
+  auto const &text = _com.stringRenderer;
+  char line[STATS_LINE];
+  float y = STATS_TOP;
+
+  gSC.disable(state::DEPTH_TEST);
+  gSC.enable(state::BLENDING);
+  gSC.blend_func(blending::ONE, blending::ONE);
+  text.start_draw();
+
+  for (uint i = 0; i <= gStats.passes(); ++i) {
+    bool total = i == gStats.passes();
+    auto const &c = total ? frame : gStats.pass(i);
+
+    snprintf(line, sizeof(line), "%s  D %u  P %u  T %u  FB %u  U %u  E %u  %u KB  S %u", total ? "frame" : gStats.pass_name(i)
+           , c.draws, c.programs, c.textures, c.framebuffers, c.uniforms, c.elided, static_cast<uint>(c.uploaded >> 10), c.samples);
+    for (char *p = line; *p; ++p) /* the font only has capitals */
+      *p = toupper(*p);
+    text.draw_string(line, STATS_LEFT, y, STATS_SIZE);
+    y -= STATS_SIZE * 2.f;
+  }
+
+  text.end_draw();
+  gSC.disable(state::BLENDING);
+}
+
+void Intro::_place_tile(uint i) {
+  auto const &tile = _com.tile;
+
+  _com.worker.invalidate(); /* the packets take the tile */
+  _image.place(i, _com.tile);
+  _com.stringRenderer.window(tile.aspect, tile.scale, tile.offset);
+}
+
+/* highest tier whose heaviest frame, once warm, fits in the refresh: the
+ * parts are built for each tier in turn, from the highest, and draw a few
+ * frames from the middle of each without showing them */
+int Intro::_calibrate(ushort width, ushort height) {
+  auto const &parts = _com.timeline.event("parts");
+  auto song = analyze_song(_synth.module(), AUDIO_RATE);
+  float times[] = { 0.5f * (parts.time(0) + parts.time(1)), 0.5f * (parts.time(1) + parts.time(2)) };
+  double budget = 1000. / _options.refresh * CALIBRATION_SHARE;
+  int tier;
+
+  for (tier = QUALITY_TIERS - 1; tier > QUALITY_LOW; --tier) {
+    double ms;
+
+    _com.quality = quality_tier(tier);
+    ms = _time_tier(width, height, times, song);
+    misc::log << debug << "quality " << quality_name(tier) << ": " << ms << " ms a frame, " << budget << " ms budget" << std::endl;
+    if (ms <= budget)
+      break;
+  }
+
+  return tier;
+}
+
+/* ms, of the heavier part */
+double Intro::_time_tier(ushort width, ushort height, float const *times, std::vector<AudioFeatures> const &song) {
+  CubeRoom cubeRoom(width, height, _com, _freefly, _options.prepass);
+  Stairway stairway(width, height, _com, _freefly, _options.reproject, _options.checkerboard);
+
+  return std::max(_time_frames(cubeRoom, times[0], song), _time_frames(stairway, times[1], song));
+}
+
+/* ms, median over the timed frames; each is waited for */
+double Intro::_time_frames(PartState &part, float time, std::vector<AudioFeatures> const &song) {
+  std::vector<double> ms;
+
+  for (uint i = 0; i < CALIBRATION_WARMUP + CALIBRATION_FRAMES; ++i) {
+    float t = time + i / _options.refresh;
+    auto t0 = WallClock::now();
+
+    gStats.begin_frame();
+    gSC.forget();
+    _com.audio.update(features_at(song, t));
+    part.run(t);
+    glFinish();
+    if (i >= CALIBRATION_WARMUP)
+      ms.push_back(std::chrono::duration<double, std::milli>(WallClock::now() - t0).count());
+  }
+
+  std::sort(ms.begin(), ms.end());
+  return ms[ms.size() / 2];
+}
+
+/* offline frames of --render-at */
+int Intro::_first_frame() const {
+  return frame_at(_options.renderFrom, _options.fps, 1);
+}
+
+int Intro::_last_frame() {
+  auto const &parts = _com.timeline.event("parts");
+
+  if (_options.renderFrom == _options.renderTo)
+    return _first_frame();
+  return frame_at(std::min(_options.renderTo, parts.time(2)), _options.fps, -1);
+}
+
+/* at the offline clock's step; audio features come from the song analysed
+ * up front */
+void Intro::_offline_frame(int frame, std::vector<AudioFeatures> const &song) {
+  float time = 1.f * frame / _options.fps;
+
+  if (_capture)
+    _capture->frame(time);
+  gStats.begin_frame();
+  gSC.forget();
+  _com.audio.update(features_at(song, time));
+  _pFSM->exec(time);
+}
+
+/* false once the intro is over, or on an error */
+bool Intro::_render_range(int first, int last, std::vector<AudioFeatures> const &song, bool stream) {
+  char path[PATH_SIZE];
+
+  /* warm-up frames are drawn once, whatever the tiles: only what carries
+   * over to the next frame matters */
+  for (int f = std::max(first - _options.warmup, 0); f <= last; ++f) {
+    bool kept = f >= first;
+
+    if (_pFSM->over())
+      return false;
+    snprintf(path, sizeof(path), _options.render, f);
+    if (kept && !stream && !_image.open(path))
+      return false;
+
+    for (uint i = 0; i < (kept ? _image.tiles() : 1); ++i) {
+      if (_image.tiles() > 1)
+        _place_tile(i);
+      _offline_frame(f, song);
+      if (kept)
+        _image.read(i);
+    }
+    if (!stream)
+      _image.close();
+  }
+  return true;
+}
+
+/* frames however long they take, read back instead of shown */
+void Intro::_render() {
+  auto song = analyze_song(_synth.module(), AUDIO_RATE);
+  int first = _first_frame(), last = _last_frame();
+  bool stream = !strchr(_options.render, '%');
+
+  if (stream && !_image.open(_options.render))
+    return;
+
+  if (_options.renderFeed) {
+    /* a RenderFarm worker: ranges until the farm closes the pipe */
+    while (scanf("%d %d", &first, &last) == 2 && _render_range(first, last, song, stream))
+      ;
+  } else {
+    _render_range(first, last, song, stream);
+  }
+  _image.close();
+}
+
+/* as _render, to a video: the readback doesn't wait for the frame */
+void Intro::_export() {
+  auto song = analyze_song(_synth.module(), AUDIO_RATE);
+  int first = _first_frame(), last = _last_frame();
+  VideoExport video(_options, _image.drawn_width(), _image.drawn_height(), _synth.module(), first);
+
+  if (!video.ok())
+    return;
+
+  for (int f = std::max(first - _options.warmup, 0); f <= last && !_pFSM->over() && video.ok(); ++f) {
+    _offline_frame(f, song);
+    if (f >= first)
+      video.read(f);
+  }
+  video.finish();
 }
 
 void Intro::run() {
   bool loop = true;
+  auto const &parts = _com.timeline.event("parts");
 #ifdef SKY_DEBUG
   bool leftClick = false;
   SDL_Event event;
 #endif
 
-  _synth.play("CentralStation.xm");
+  if (_options.video) {
+    _export();
+    return;
+  }
+  if (_options.render) {
+    _render();
+    return;
+  }
+
+  _synth.play();
 #ifdef SKY_DEBUG
   _synth.advance_cursor(150.f);
 #endif
@@ -107,12 +356,21 @@ void Intro::run() {
   Clock clock;
   SDL_EnableKeyRepeat(10, 10);
 #endif
-  for (auto time = 0.f; !_pFSM->over() && time <= 163.5f && loop; time = _synth.cursor()) {
+  for (auto time = 0.f; !_pFSM->over() && time <= parts.time(2) && loop; time = _synth.cursor()) {
 #ifdef SKY_DEBUG
     clock.reset();
     misc::log << debug << "time: " << time << std::endl;
 #endif
+    if (_capture)
+      _capture->frame(time);
+    gStats.begin_frame();
+    gSC.forget();
+    _com.audio.update(_synth.features());
     _pFSM->exec(time);
+    if (_bench)
+      gStats.csv(_bench, time);
+    if (_options.stats)
+      _draw_stats();
     _cntxt.swap_buffers();
 
 #ifdef SKY_DEBUG /* freefly management */
@@ -132,6 +390,10 @@ void Intro::run() {
         case SDL_KEYUP :
           if (event.key.keysym.sym == SDLK_ESCAPE)
             loop = false;
+          else if (event.key.keysym.sym == SDLK_r) { /* reload the sync file; texts keep their cues */
+            _com.worker.wait(); /* the worker reads the tracks */
+            init_timeline(_com.timeline);
+          }
           break;
 
         case SDL_MOUSEBUTTONDOWN :
@@ -177,4 +439,8 @@ void Intro::run() {
     }
 #endif
   }
+
+#ifdef SKY_DEBUG
+  misc::log << debug << "state cache: " << gSC.elided() << " calls elided, " << gSC.issued() << " issued" << std::endl;
+#endif
 }
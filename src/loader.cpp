@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <lzma.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <payload.hpp>
+
+/* Release entry point: unpacks the intro and its song from the xz stream
+ * appended to this very file straight into anonymous memory files, then
+ * runs the intro from memory. Nothing is written to the disk, so the
+ * release runs from read-only or shared directories too; startup is
+ * bound by decompression alone. */
+
+namespace {
+  std::uint64_t const MEMLIMIT = UINT64_MAX;
+
+  void fail(char const *what) {
+    fprintf(stderr, "loader: %s\n", what);
+    exit(1);
+  }
+
+  /* decode the next size bytes of the stream into out */
+  bool inflate(lzma_stream &strm, void *out, size_t size) {
+    strm.next_out = static_cast<uint8_t *>(out);
+    strm.avail_out = size;
+
+    while (strm.avail_out) {
+      lzma_ret r = lzma_code(&strm, LZMA_FINISH);
+      if (r == LZMA_STREAM_END)
+        break;
+      if (r != LZMA_OK)
+        return false;
+    }
+    return !strm.avail_out;
+  }
+
+  /* memory file of size bytes, filled by the decoder through a mapping */
+  int inflate_memfd(lzma_stream &strm, char const *name, size_t size, unsigned flags) {
+    int fd = memfd_create(name, flags);
+    if (fd < 0 || ftruncate(fd, size) < 0)
+      fail("no memory file");
+
+    void *map = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+      fail("memory file not mappable");
+    if (!inflate(strm, map, size))
+      fail("corrupted payload");
+    munmap(map, size);
+
+    return fd;
+  }
+}
+
+int main(int, char **argv) {
+  int self = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+  struct stat st;
+
+  if (self < 0 || fstat(self, &st) < 0)
+    fail("can't read myself");
+
+  /* the page cache feeds the decoder as it goes */
+  auto file = static_cast<uint8_t const *>(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, self, 0));
+  if (file == MAP_FAILED)
+    fail("can't map myself");
+
+  PayloadTrailer trailer;
+  if (static_cast<size_t>(st.st_size) < sizeof(trailer))
+    fail("no payload");
+  memcpy(&trailer, file + st.st_size - sizeof(trailer), sizeof(trailer));
+  if (memcmp(trailer.magic, PAYLOAD_MAGIC, sizeof(PAYLOAD_MAGIC)) || trailer.size > st.st_size - sizeof(trailer))
+    fail("no payload");
+
+  lzma_stream strm = LZMA_STREAM_INIT;
+  if (lzma_stream_decoder(&strm, MEMLIMIT, 0) != LZMA_OK)
+    fail("no decoder");
+  strm.next_in = file + st.st_size - sizeof(trailer) - trailer.size;
+  strm.avail_in = trailer.size;
+
+  PayloadHeader header;
+  if (!inflate(strm, &header, sizeof(header)))
+    fail("corrupted payload");
+
+  /* the song must outlive exec, the binary must not */
+  int binary = inflate_memfd(strm, "evoke2013_64k", header.binarySize, MFD_CLOEXEC);
+  int song = inflate_memfd(strm, "CentralStation.xm", header.songSize, 0);
+  lzma_end(&strm);
+  munmap(const_cast<uint8_t *>(file), st.st_size);
+  close(self);
+
+  char fd[16];
+  snprintf(fd, sizeof(fd), "%d", song);
+  setenv(PAYLOAD_SONG_FD, fd, 1);
+
+  extern char **environ;
+  fexecve(binary, argv, environ);
+  fail("can't run the intro");
+
+  return 1;
+}
+
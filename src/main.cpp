@@ -1,7 +1,11 @@
+#include <vector>
+#include <frame_capture.hpp>
 #include <lang/primtypes.hpp>
 #include <intro.hpp>
 #include <misc/cli.hpp>
 #include <misc/log.hpp>
+#include <options.hpp>
+#include <render_farm.hpp>
 
 using namespace sky;
 using namespace std;
@@ -15,13 +19,21 @@ int main(int argc, char **argv) {
   ushort width, height;
   bool full;
   bool loop;
+  Options options;
+  vector<char *> args(argv, argv + argc + 1); /* before the options are taken out */
 
-  if (!scan_cli(argc, argv, width, height, full)) {
+  if (!parse_options(argc, argv, options) || !scan_cli(argc, argv, width, height, full)) {
     misc::log << error << "CLI misformed" << endl;
     return 1;
   }
 
-  Intro intro(width, height, full, TITLE);
+  if (options.capture && !FrameCapture::preload(args.data()))
+    return 1;
+
+  if (options.render && options.workers > 0)
+    return RenderFarm(options, argc, argv).run() ? 0 : 1;
+
+  Intro intro(width, height, full, TITLE, options);
   intro.run();
 
   return 0;
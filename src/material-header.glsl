@@ -0,0 +1,26 @@
+/* shared by all materials, after the declarations of the material manager */
+uniform mat4 proj;
+uniform mat4 view;
+uniform vec3 lightColor;
+uniform vec3 lightPos;
+uniform int checker; /* 0: all pixels lit, else 1 + parity of the blocks lit */
+
+/* blocks of 2x2 pixels, whole quads: skipping them saves the GPU the work */
+bool checker_skip() {
+  ivec2 block = ivec2(gl_FragCoord.xy) >> 1;
+  return checker > 0 && ((block.x + block.y) & 1) != checker - 1;
+}
+
+vec2 get_uv() {
+  return gl_FragCoord.xy * res.zw;
+}
+
+vec3 get_co() {
+  vec2 uv = get_uv();
+  vec4 p = inverse(proj * view) * vec4(2. * vec3(uv, texture(depthmap, uv).r) - 1., 1.);
+  return p.xyz / p.w;
+}
+
+vec3 get_eye() {
+  return inverse(proj)[3].xyz;
+}
@@ -0,0 +1,19 @@
+/* body of the plastic material */
+if (checker_skip()) discard;
+vec3 no = normalize(texture(normalmap, get_uv()).xyz);
+vec3 co = get_co();
+vec4 matColor; // = texture(propmap, get_uv());
+matColor = vec4(.4);
+vec3 ldir = vec3((lightPos - co).xy, 0.);
+vec3 nldir = normalize(ldir);
+vec3 eyedir = normalize(get_eye() - co);
+vec3 h = ldir + eyedir;
+vec3 nh = normalize(h);
+float diffk = max(0., dot(nldir, no));
+float bspeck = pow(dot(nh, no), 10.); /* blinn-phong */
+
+vec4 mixedColor = matColor + vec4(lightColor, 1.);
+vec4 f = mixedColor * diffk;
+f += mixedColor * bspeck;
+f /= pow(length(ldir) * 0.5, 2.);
+return clamp(f, 0., 1.);
@@ -0,0 +1,11 @@
+/* body of the terrain material */
+if (checker_skip()) discard;
+//return texture(normalmap, get_uv());
+vec4 terrainColor = vec4(0.4);
+vec3 no = texture(normalmap, get_uv()).xyz;
+vec3 co = get_co();
+vec3 ldir = normalize(lightPos - co);
+float atten = distance(co, lightPos); /* FIXME: with above line */
+atten = pow(atten * 0.6, 2.);
+atten = 1. / atten;
+return (terrainColor + vec4(lightColor, 1.)) * max(0., dot(no, ldir)) * atten;
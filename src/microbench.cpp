@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <audio_analyzer.hpp>
+#include <font.hpp>
+#include <fsm/firefly_lights.hpp>
+#include <fsm/terrain.hpp>
+#include <glyph_atlas.hpp>
+#include <math/common.hpp>
+#include <math/matrix.hpp>
+#include <scene/common.hpp>
+#include <timeline.hpp>
+#include <yuv420.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace math;
+using namespace scene;
+
+namespace {
+  uint   const SAMPLES       = 21;    /* timed samples per benchmark */
+  double const SAMPLE_TIME   = 0.01;  /* s, at least, per sample */
+  ushort const GLYPHS_NB     = 90;    /* as in Common */
+  char   const GLYPHS_FIRST  = '!';
+  ushort const SDF_SPREAD    = 6;     /* as in TextRenderer */
+  float  const CAMERA_RATE   = 60.f;  /* as in the sync */
+  float  const CAMERA_LENGTH = 60.f;  /* s of baked orbit */
+  ushort const TERRAIN_GRID  = 32;    /* as in Cave */
+  float  const FRAME         = 1.f / 60.f;
+  float  const SEEK          = 180.f; /* s, the whole intro */
+  uint   const AUDIO_RATE    = 44100;
+  uint   const VIDEO_WIDTH   = 1920;  /* of an exported frame */
+  uint   const VIDEO_HEIGHT  = 1080;
+
+  typedef chrono::steady_clock Clock;
+
+  /* results go there, so that the work can't be optimized away */
+  volatile float sink;
+
+  struct Benchmark {
+    char const *name;
+    char const *unit;    /* of what an op processes */
+    double items;        /* per op */
+    function<void (void)> op;
+  };
+
+  struct Result {
+    double median, mad, min; /* ns per op */
+  };
+
+  double run(Benchmark const &b, uint iterations) {
+    auto t0 = Clock::now();
+
+    for (uint i = 0; i < iterations; ++i)
+      b.op();
+
+    return chrono::duration<double>(Clock::now() - t0).count();
+  }
+
+  /* enough iterations per sample to outlast the clock's resolution, then
+   * the median of SAMPLES samples and its median absolute deviation */
+  Result measure(Benchmark const &b) {
+    uint iterations = 1;
+    vector<double> ns(SAMPLES), dev(SAMPLES);
+    Result r;
+
+    while (run(b, iterations) < SAMPLE_TIME)
+      iterations *= 2;
+
+    for (uint i = 0; i < SAMPLES; ++i)
+      ns[i] = run(b, iterations) * 1e9 / iterations;
+
+    sort(ns.begin(), ns.end());
+    r.median = ns[SAMPLES / 2];
+    r.min = ns[0];
+    for (uint i = 0; i < SAMPLES; ++i)
+      dev[i] = fabs(ns[i] - r.median);
+    sort(dev.begin(), dev.end());
+    r.mad = dev[SAMPLES / 2];
+
+    return r;
+  }
+
+  ubyte const * glyph(char c) {
+    return GLPH_index[c - GLYPHS_FIRST];
+  }
+
+  Mat44 orbit(float t) {
+    return Mat44::trslt(-Position(cosf(t), sinf(t), sinf(t))*1.5f) *
+           Orient(Axis3(0.f, 1.f, 0.f), t * PI_2 / 3.).to_matrix() *
+           Orient(Axis3(0.f, 0.f, 1.f), sinf(t)+t*0.5f).to_matrix();
+  }
+
+  void add_glyphs(vector<Benchmark> &benchmarks) {
+    static vector<ubyte> bitmap;
+    static vector<ubyte> sdf;
+    auto const *a = glyph('A');
+    uint glyphs = 0;
+    uint w = a[0], h = a[1];
+
+    for (ushort i = 0; i < GLYPHS_NB; ++i) {
+      if (GLPH_index[i])
+        ++glyphs;
+    }
+    bitmap.resize(256 * 256 + 15);
+    sdf.resize((w + 2*SDF_SPREAD) * (h + 2*SDF_SPREAD));
+
+    benchmarks.push_back({ "glyph unpack", "glyphs", 1. * glyphs, []() {
+      for (ushort i = 0; i < GLYPHS_NB; ++i) {
+        if (GLPH_index[i])
+          unpack_glyph(GLPH_index[i], bitmap.data());
+      }
+      sink = bitmap[0];
+    }});
+    benchmarks.push_back({ "glyph sdf", "px", 1. * sdf.size(), [w, h]() {
+      unpack_glyph(glyph('A'), bitmap.data());
+      glyph_sdf(bitmap.data(), w, h, SDF_SPREAD, sdf.data());
+      sink = sdf[0];
+    }});
+    benchmarks.push_back({ "glyph atlas", "atlases", 1., []() {
+      GlyphAtlas atlas(GLPH_index, GLYPHS_NB, SDF_SPREAD);
+      sink = atlas.pixels[0];
+    }});
+  }
+
+  void add_camera(vector<Benchmark> &benchmarks) {
+    static CameraTrack track;
+    static float time = 0.f;
+
+    track.bake(0.f, CAMERA_LENGTH, CAMERA_RATE, orbit);
+
+    benchmarks.push_back({ "camera chain", "matrices", 1., []() {
+      time += FRAME;
+      auto m = Mat44::perspective(PI*70.f/180.f, 16.f / 9.f, 0.0001f, 10.f) * orbit(time);
+      sink = m[3][2];
+    }});
+    benchmarks.push_back({ "camera key view", "matrices", 1., []() {
+      time += FRAME;
+      auto m = CameraTrack::key_view({ time, Position(1.f, time, 0.f), time, -time, 0.f, false });
+      sink = m[3][2];
+    }});
+    benchmarks.push_back({ "camera bake", "samples", CAMERA_LENGTH * CAMERA_RATE, []() {
+      CameraTrack t;
+      t.bake(0.f, CAMERA_LENGTH, CAMERA_RATE, orbit);
+      sink = t.at(1.f)[3][2];
+    }});
+    /* a new time every call: the track caches the last lookup */
+    benchmarks.push_back({ "camera lookup", "lookups", 1., []() {
+      time = time + FRAME > CAMERA_LENGTH ? 0.f : time + FRAME;
+      sink = track.at(time)[3][2];
+    }});
+  }
+
+  void add_terrain(vector<Benchmark> &benchmarks) {
+    static vector<float> vertices;
+    static vector<uint> indices[Terrain::FULL+1];
+
+    /* same count twice: quarters and full patch */
+    benchmarks.push_back({ "terrain patch", "indices", 2. * TERRAIN_GRID * TERRAIN_GRID * 6, []() {
+      Terrain::gen_patch(TERRAIN_GRID, vertices, indices);
+      sink = vertices[1];
+    }});
+  }
+
+  void add_fireflies(vector<Benchmark> &benchmarks) {
+    static FireflyLights lights(FireflyLights::NB);
+    static Position out[FireflyLights::NB];
+    static float time = 0.f;
+
+    benchmarks.push_back({ "firefly lights frame", "frames", 1., []() {
+      time += FRAME;
+      lights.simulate(time, out);
+      sink = out[0].x;
+    }});
+    benchmarks.push_back({ "firefly lights seek", "steps", 1. * FireflyLights::steps(SEEK), []() {
+      FireflyLights seeking(FireflyLights::NB);
+      seeking.simulate(SEEK, out);
+      sink = out[0].x;
+    }});
+  }
+
+  void add_audio(vector<Benchmark> &benchmarks) {
+    static vector<float> re(ANALYSIS_WINDOW / 2), im(ANALYSIS_WINDOW / 2), power(ANALYSIS_WINDOW / 2);
+    static vector<AudioFrame> hop(ANALYSIS_HOP);
+    static AudioAnalyzer analyzer(AUDIO_RATE);
+    static AudioFeatures features;
+    uint seed = 1;
+
+    for (auto &f : hop) {
+      seed = seed * 1664525u + 1013904223u;
+      f.l = static_cast<int16_t>(seed >> 16);
+      f.r = static_cast<int16_t>(seed >> 8);
+    }
+
+    benchmarks.push_back({ "fft", "samples", 1. * ANALYSIS_WINDOW, []() {
+      for (uint i = 0; i < ANALYSIS_WINDOW / 2; ++i) {
+        re[i] = hop[i].l;
+        im[i] = hop[i].r;
+      }
+      real_fft_power(re.data(), im.data(), power.data());
+      sink = power[1];
+    }});
+    benchmarks.push_back({ "audio analyze", "frames", 1. * ANALYSIS_HOP, []() {
+      analyzer.analyze(hop.data(), features);
+      sink = features.loudness;
+    }});
+  }
+
+  void add_video(vector<Benchmark> &benchmarks) {
+    static vector<ubyte> bgra(VIDEO_WIDTH * VIDEO_HEIGHT * 4);
+    static vector<ubyte> yuv(VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2);
+    uint seed = 1;
+
+    for (auto &c : bgra) {
+      seed = seed * 1664525u + 1013904223u;
+      c = seed >> 24;
+    }
+
+    benchmarks.push_back({ "yuv420", "px", 1. * VIDEO_WIDTH * VIDEO_HEIGHT, []() {
+      uint luma = VIDEO_WIDTH * VIDEO_HEIGHT;
+
+      bgra_to_yuv420(bgra.data(), VIDEO_WIDTH, VIDEO_HEIGHT, &yuv[0], &yuv[luma], &yuv[luma + luma / 4]);
+      sink = yuv[0];
+    }});
+  }
+}
+
+/* Times the CPU code the intro runs at startup and every frame, with no GL
+ * context: median ns per op over SAMPLES samples, its median absolute
+ * deviation, the fastest sample, and throughput. Benchmarks whose name
+ * contains the filter only; --csv for machine-readable output. */
+int main(int argc, char **argv) {
+  vector<Benchmark> benchmarks;
+  char const *filter = nullptr;
+  bool csv = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--csv"))
+      csv = true;
+    else
+      filter = argv[i];
+  }
+
+  add_glyphs(benchmarks);
+  add_camera(benchmarks);
+  add_terrain(benchmarks);
+  add_fireflies(benchmarks);
+  add_audio(benchmarks);
+  add_video(benchmarks);
+
+  if (csv)
+    printf("benchmark,median_ns,mad_ns,min_ns,throughput,unit\n");
+  else
+    printf("%-22s %14s %8s %14s %16s\n", "benchmark", "ns/op", "mad", "min ns/op", "throughput/s");
+
+  for (auto const &b : benchmarks) {
+    if (filter && !strstr(b.name, filter))
+      continue;
+
+    Result r = measure(b);
+    double throughput = b.items * 1e9 / r.median;
+
+    if (csv)
+      printf("%s,%.1f,%.1f,%.1f,%.0f,%s\n", b.name, r.median, r.mad, r.min, throughput, b.unit);
+    else
+      printf("%-22s %14.1f %7.1f%% %14.1f %16.4g %s\n", b.name, r.median, 100. * r.mad / r.median, r.min, throughput, b.unit);
+  }
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <misc/log.hpp>
+#include <options.hpp>
+#include <quality.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  /* from[:to], to being from when missing; not before from */
+  bool parse_range(char const *arg, float &from, float &to) {
+    char *end;
+
+    from = to = strtof(arg, &end);
+    if (end == arg)
+      return false;
+    if (*end == ':')
+      to = strtof(end + 1, &end);
+    return !*end && to >= from;
+  }
+
+  /* <columns>x<rows> */
+  bool parse_tiles(char const *arg, uint &columns, uint &rows) {
+    char *end;
+
+    columns = strtoul(arg, &end, 10);
+    if (*end != 'x')
+      return false;
+    rows = strtoul(end + 1, &end, 10);
+    return !*end && columns > 0 && rows > 0;
+  }
+}
+
+Options::Options() :
+    stats(false)
+  , bench(nullptr)
+  , reproject(false)
+  , checkerboard(false)
+  , prepass(false)
+  , capture(nullptr)
+  , captureFrom(0.f)
+  , captureTo(1e9f)
+  , render(nullptr)
+  , renderFrom(0.f)
+  , renderTo(1e9f)
+  , renderFeed(false)
+  , fps(60)
+  , columns(1)
+  , rows(1)
+  , warmup(0)
+  , workers(0)
+  , video(nullptr)
+  , audio(nullptr)
+  , quality(QUALITY_HIGH)
+  , refresh(60.f) {
+}
+
+bool parse_options(int &argc, char **argv, Options &options) {
+  int kept = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    char const *arg = argv[i];
+    bool last = i + 1 == argc;
+
+    if (!strcmp(arg, "--stats")) {
+      options.stats = true;
+    } else if (!strcmp(arg, "--bench")) {
+      if (last) {
+        misc::log << error << arg << " needs a file" << endl;
+        return false;
+      }
+      options.bench = argv[++i];
+    } else if (!strcmp(arg, "--reproject")) {
+      options.reproject = true;
+    } else if (!strcmp(arg, "--checkerboard")) {
+      options.checkerboard = true;
+    } else if (!strcmp(arg, "--prepass")) {
+      options.prepass = true;
+    } else if (!strcmp(arg, "--render-feed")) {
+      options.renderFeed = true;
+    } else if (!strcmp(arg, "--capture")) {
+      if (last) {
+        misc::log << error << arg << " needs a file" << endl;
+        return false;
+      }
+      options.capture = argv[++i];
+    } else if (!strcmp(arg, "--capture-at") || !strcmp(arg, "--render-at")) {
+      bool capture = !strcmp(arg, "--capture-at");
+
+      if (last) {
+        misc::log << error << arg << " needs a time" << endl;
+        return false;
+      }
+      if (!parse_range(argv[++i], capture ? options.captureFrom : options.renderFrom, capture ? options.captureTo : options.renderTo)) {
+        misc::log << error << arg << " misformed: " << argv[i] << endl;
+        return false;
+      }
+    } else if (!strcmp(arg, "--render")) {
+      if (last) {
+        misc::log << error << arg << " needs a file" << endl;
+        return false;
+      }
+      options.render = argv[++i];
+    } else if (!strcmp(arg, "--fps")) {
+      if (last || (options.fps = atoi(argv[++i])) <= 0) {
+        misc::log << error << arg << " needs a frame rate" << endl;
+        return false;
+      }
+    } else if (!strcmp(arg, "--warmup") || !strcmp(arg, "--workers")) {
+      int &n = !strcmp(arg, "--warmup") ? options.warmup : options.workers;
+
+      if (last || (n = atoi(argv[++i])) < 0) {
+        misc::log << error << arg << " needs a count" << endl;
+        return false;
+      }
+    } else if (!strcmp(arg, "--video") || !strcmp(arg, "--audio")) {
+      char const *&file = !strcmp(arg, "--video") ? options.video : options.audio;
+
+      if (last) {
+        misc::log << error << arg << " needs a file" << endl;
+        return false;
+      }
+      file = argv[++i];
+    } else if (!strcmp(arg, "--quality")) {
+      if (last || (options.quality = quality_from_name(argv[++i])) == QUALITY_TIERS) {
+        misc::log << error << arg << " needs low, medium, high, ultra or auto" << endl;
+        return false;
+      }
+    } else if (!strcmp(arg, "--refresh")) {
+      if (last || (options.refresh = strtof(argv[++i], nullptr)) <= 0.f) {
+        misc::log << error << arg << " needs a rate" << endl;
+        return false;
+      }
+    } else if (!strcmp(arg, "--tiles")) {
+      if (last || !parse_tiles(argv[++i], options.columns, options.rows)) {
+        misc::log << error << arg << " needs <columns>x<rows>" << endl;
+        return false;
+      }
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+
+  argv[kept] = nullptr;
+  argc = kept;
+
+  if (options.video && options.columns * options.rows > 1) {
+    misc::log << error << "--video draws no tiles" << endl;
+    return false;
+  }
+  /* on screen, a tile would be all there is to see, and auto quality
+   * could pick more blur than its guard band holds */
+  if (!options.render && options.columns * options.rows > 1) {
+    misc::log << error << "--tiles needs --render" << endl;
+    return false;
+  }
+  if (options.capture && options.render && options.workers > 0) {
+    misc::log << error << "--capture records a single process: no --workers" << endl;
+    return false;
+  }
+  return true;
+}
+
+int frame_at(float time, int fps, int side) {
+  float f = time * fps - side * 1e-3f;
+
+  return static_cast<int>(side > 0 ? ceilf(f) : floorf(f));
+}
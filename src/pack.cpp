@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <lzma.h>
+#include <payload.hpp>
+
+using namespace std;
+
+/* Builds a release: copies the loader, then appends the xz stream of the
+ * intro binary and its song, and the trailer the loader looks for. */
+
+namespace {
+  bool slurp(char const *path, vector<uint8_t> &data) {
+    ifstream file(path, ios::binary);
+    if (!file)
+      return false;
+    data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    return true;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 6) {
+    fprintf(stderr, "usage: %s <loader> <intro> <song.xm> <preset> <out>\n", argv[0]);
+    return 1;
+  }
+
+  vector<uint8_t> loader, binary, song;
+  if (!slurp(argv[1], loader) || !slurp(argv[2], binary) || !slurp(argv[3], song)) {
+    fprintf(stderr, "pack: can't read the inputs\n");
+    return 1;
+  }
+
+  PayloadHeader header = { binary.size(), song.size() };
+  vector<uint8_t> raw(sizeof(header));
+  memcpy(raw.data(), &header, sizeof(header));
+  raw.insert(raw.end(), binary.begin(), binary.end());
+  raw.insert(raw.end(), song.begin(), song.end());
+
+  /* CRC32 only: the loader checks what it decodes anyway */
+  vector<uint8_t> xz(lzma_stream_buffer_bound(raw.size()));
+  size_t xzSize = 0;
+  uint32_t preset = static_cast<uint32_t>(atoi(argv[4])) | LZMA_PRESET_EXTREME;
+  if (lzma_easy_buffer_encode(preset, LZMA_CHECK_CRC32, nullptr, raw.data(), raw.size(), xz.data(), &xzSize, xz.size()) != LZMA_OK) {
+    fprintf(stderr, "pack: compression failed\n");
+    return 1;
+  }
+
+  PayloadTrailer trailer;
+  trailer.size = xzSize;
+  memcpy(trailer.magic, PAYLOAD_MAGIC, sizeof(PAYLOAD_MAGIC));
+
+  ofstream out(argv[5], ios::binary);
+  out.write(reinterpret_cast<char const *>(loader.data()), loader.size());
+  out.write(reinterpret_cast<char const *>(xz.data()), xzSize);
+  out.write(reinterpret_cast<char const *>(&trailer), sizeof(trailer));
+  if (!out) {
+    fprintf(stderr, "pack: can't write %s\n", argv[5]);
+    return 1;
+  }
+
+  printf("%zu + %zu bytes packed into %zu\n", binary.size(), song.size(), loader.size() + xzSize + sizeof(trailer));
+  return 0;
+}
+
@@ -0,0 +1,35 @@
+#include <cstring>
+#include <quality.hpp>
+
+using namespace sky;
+
+namespace {
+  Quality const TIERS[QUALITY_TIERS] = {
+    /* tess, blur, liquid, cave, fireflies */
+    {  6, 0,  40,  300,  20 },
+    {  9, 1,  60,  450,  20 },
+    { 13, 1,  80,  600,  20 },
+    { 26, 2, 160, 1200, 200 }
+  };
+
+  char const * const NAMES[QUALITY_TIERS] = { "low", "medium", "high", "ultra" };
+}
+
+Quality const & quality_tier(int tier) {
+  return TIERS[tier];
+}
+
+char const * quality_name(int tier) {
+  return tier == QUALITY_AUTO ? "auto" : NAMES[tier];
+}
+
+int quality_from_name(char const *name) {
+  if (!strcmp(name, "auto"))
+    return QUALITY_AUTO;
+
+  for (int i = 0; i < QUALITY_TIERS; ++i) {
+    if (!strcmp(name, NAMES[i]))
+      return i;
+  }
+  return QUALITY_TIERS;
+}
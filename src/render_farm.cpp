@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fsm/sync.hpp>
+#include <misc/log.hpp>
+#include <payload.hpp>
+#include <quality.hpp>
+#include <render_farm.hpp>
+#include <timeline.hpp>
+#include <xm_module.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  float      const CHUNK_TIME = 2.f;     /* s of frames fed at once */
+  int        const WARMUP     = 2;       /* frames drawn before a chunk */
+  uint       const AHEAD      = 2;       /* chunks a worker past the output */
+  uint       const LINE_SIZE  = 32;
+  useconds_t const POLL       = 20000;   /* us between looks for a frame */
+  uint       const PATH_SIZE  = 1024;
+  uint       const COPY_SIZE  = 1 << 16;
+  char const SONG[] = "CentralStation.xm";
+  char const SELF[] = "/proc/self/exe";
+
+  string frame_path(string const &dir, int frame) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "/%06d.ppm", frame);
+    return dir + name;
+  }
+
+  bool copy(char const *path, FILE *out) {
+    FILE *in = fopen(path, "rb");
+    vector<char> buffer(COPY_SIZE);
+    size_t n;
+    bool ok;
+
+    if (!in)
+      return false;
+    while ((n = fread(buffer.data(), 1, buffer.size(), in)) > 0 && fwrite(buffer.data(), 1, n, out) == n)
+      ;
+    ok = !ferror(in) && !ferror(out);
+    fclose(in);
+    return ok;
+  }
+}
+
+RenderFarm::RenderFarm(Options const &options, int argc, char **argv) :
+    _options(options)
+  , _args(argv, argv + argc)
+  , _out(nullptr)
+  , _song(getenv(PAYLOAD_SONG_FD) ? atoi(getenv(PAYLOAD_SONG_FD)) : -1) {
+  unsetenv(PAYLOAD_SONG_FD);
+  if (_song >= 0 && fcntl(_song, F_SETFD, FD_CLOEXEC) < 0)
+    _song = -1;
+}
+
+RenderFarm::~RenderFarm() {
+  DIR *dir = _dir.empty() ? nullptr : opendir(_dir.c_str());
+  dirent *entry;
+
+  _stop();
+  if (_out == stdout)
+    fflush(_out);
+  else if (_out)
+    fclose(_out);
+  if (_song >= 0)
+    close(_song);
+
+  /* what is left of a failed run */
+  while (dir && (entry = readdir(dir))) {
+    if (entry->d_name[0] != '.')
+      unlink((_dir + "/" + entry->d_name).c_str());
+  }
+  if (dir) {
+    closedir(dir);
+    rmdir(_dir.c_str());
+  }
+}
+
+/* as Intro::_load_song, but keeping the loader's descriptor for workers */
+float RenderFarm::_song_end() const {
+  struct stat st;
+  XMModule module;
+  Timeline timeline;
+  bool loaded;
+
+  if (_song >= 0 && fstat(_song, &st) == 0) {
+    void *song = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, _song, 0);
+
+    loaded = song != MAP_FAILED && module.load(static_cast<ubyte const *>(song), st.st_size);
+    if (song != MAP_FAILED)
+      munmap(song, st.st_size);
+  } else {
+    loaded = module.load(SONG);
+  }
+  if (!loaded) {
+    misc::log << error << "unable to load the song" << endl;
+    return -1.f;
+  }
+
+  timeline.song(module);
+  init_timeline(timeline);
+  return timeline.event("parts").time(2);
+}
+
+/* the intro again, with the command line it was given but for the farm's
+ * switches; its stdin is the feed, its stdout goes to stderr, stdout may
+ * be the output */
+bool RenderFarm::_start(Worker &worker) {
+  string pattern = _dir + "/%06d.ppm";
+  char fps[16], warmup[16], tiles[32], song[16];
+  vector<char const *> argv = { _args[0].c_str(), "--render", pattern.c_str(), "--render-feed",
+                                "--fps", fps, "--warmup", warmup };
+  int feed[2];
+
+  snprintf(fps, sizeof(fps), "%d", _options.fps);
+  snprintf(warmup, sizeof(warmup), "%d", WARMUP);
+  snprintf(tiles, sizeof(tiles), "%ux%u", _options.columns, _options.rows);
+  snprintf(song, sizeof(song), "%d", _song);
+  if (_options.reproject)
+    argv.push_back("--reproject");
+  if (_options.checkerboard)
+    argv.push_back("--checkerboard");
+  if (_options.prepass)
+    argv.push_back("--prepass");
+  if (_options.quality != QUALITY_AUTO) {
+    argv.push_back("--quality");
+    argv.push_back(quality_name(_options.quality));
+  }
+  if (_options.columns * _options.rows > 1) {
+    argv.push_back("--tiles");
+    argv.push_back(tiles);
+  }
+  for (size_t i = 1; i < _args.size(); ++i)
+    argv.push_back(_args[i].c_str());
+  argv.push_back(nullptr);
+
+  /* no other worker may keep the pipe open, or this one never sees its end */
+  if (pipe2(feed, O_CLOEXEC) < 0) {
+    misc::log << error << "unable to make a pipe to a worker" << endl;
+    return false;
+  }
+
+  worker.pid = fork();
+  if (worker.pid == 0) {
+    dup2(feed[0], STDIN_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    signal(SIGPIPE, SIG_DFL);
+    if (_song >= 0 && fcntl(_song, F_SETFD, 0) == 0)
+      setenv(PAYLOAD_SONG_FD, song, 1);
+    execv(SELF, const_cast<char * const *>(argv.data()));
+    _exit(127);
+  }
+  close(feed[0]);
+  worker.feed = feed[1];
+  if (worker.pid < 0) {
+    misc::log << error << "unable to start a worker" << endl;
+    return false;
+  }
+  return true;
+}
+
+/* a few bytes, that the pipe takes at once; a worker that ended, the
+ * intro being over, leaves them unread, and so do the frames after */
+void RenderFarm::_feed(uint chunk) {
+  auto const &c = _chunks[chunk];
+  Worker const &w = _workers[chunk % _workers.size()];
+  char line[LINE_SIZE];
+  int n = snprintf(line, sizeof(line), "%d %d\n", c.first, c.last);
+
+  if (w.feed >= 0 && write(w.feed, line, n) != n && errno != EPIPE)
+    misc::log << error << "unable to feed frames " << c.first << " to " << c.last << " to a worker" << endl;
+}
+
+/* a worker that ended, if any, else waits a bit; false if it failed */
+bool RenderFarm::_reap() {
+  int status;
+  pid_t pid = waitpid(-1, &status, WNOHANG);
+
+  if (pid <= 0) {
+    usleep(POLL);
+    return true;
+  }
+
+  for (uint i = 0; i < _workers.size(); ++i) {
+    if (_workers[i].pid != pid)
+      continue;
+    _workers[i].pid = -1;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      misc::log << error << "worker " << i << " failed" << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RenderFarm::_ready(int frame) const {
+  return !access(frame_path(_dir, frame).c_str(), F_OK);
+}
+
+/* moved to its name, or copied when on another file system */
+bool RenderFarm::_emit(int frame) {
+  string path = frame_path(_dir, frame);
+  char name[PATH_SIZE];
+  FILE *out;
+  bool ok;
+
+  if (_out) {
+    ok = copy(path.c_str(), _out);
+  } else {
+    snprintf(name, sizeof(name), _options.render, frame);
+    ok = !rename(path.c_str(), name);
+    if (!ok && (out = fopen(name, "wb"))) {
+      ok = copy(path.c_str(), out);
+      ok = !fclose(out) && ok;
+    }
+  }
+  unlink(path.c_str());
+
+  if (!ok)
+    misc::log << error << "unable to write frame " << frame << endl;
+  return ok;
+}
+
+/* done or not: their input ends, then they are stopped */
+void RenderFarm::_stop() {
+  for (auto &w : _workers) {
+    if (w.feed >= 0)
+      close(w.feed);
+    w.feed = -1;
+  }
+  for (auto &w : _workers) {
+    if (w.pid > 0) {
+      kill(w.pid, SIGTERM);
+      waitpid(w.pid, nullptr, 0);
+    }
+    w.pid = -1;
+  }
+}
+
+bool RenderFarm::run() {
+  int fps = _options.fps;
+  float end = _song_end();
+  int first = frame_at(_options.renderFrom, fps, 1);
+  int last = frame_at(std::min(_options.renderTo, end), fps, -1);
+  int size = std::max(static_cast<int>(CHUNK_TIME * fps), 1);
+  uint workers = _options.workers;
+  char const *tmp = getenv("TMPDIR");
+  char dir[PATH_SIZE], threads[16];
+  uint fed = 0;
+
+  if (end < 0.f)
+    return false;
+  if (_options.renderFrom == _options.renderTo)
+    last = first;
+  if (first > last) {
+    misc::log << error << "no frame to render between " << _options.renderFrom << " and " << std::min(_options.renderTo, end) << " s" << endl;
+    return false;
+  }
+  for (int f = first; f <= last; f += size)
+    _chunks.push_back({ f, std::min(f + size - 1, last) });
+  workers = std::min<uint>(workers, _chunks.size());
+
+  snprintf(dir, sizeof(dir), "%s/evoke2013-XXXXXX", tmp ? tmp : "/tmp");
+  if (!mkdtemp(dir)) {
+    misc::log << error << "unable to make a scratch directory in " << (tmp ? tmp : "/tmp") << endl;
+    return false;
+  }
+  _dir = dir;
+
+  if (!strchr(_options.render, '%')) {
+    _out = strcmp(_options.render, "-") ? fopen(_options.render, "wb") : stdout;
+    if (!_out) {
+      misc::log << error << "unable to open " << _options.render << endl;
+      return false;
+    }
+  }
+
+  /* a software GL spreads each context over every core: share them out */
+  snprintf(threads, sizeof(threads), "%ld", std::max(sysconf(_SC_NPROCESSORS_ONLN) / workers, 1L));
+  setenv("LP_NUM_THREADS", threads, 0);
+
+  /* a worker gone is found out by its frames missing, not by a signal */
+  signal(SIGPIPE, SIG_IGN);
+  _workers.resize(workers, { -1, -1 });
+  for (auto &w : _workers) {
+    if (!_start(w))
+      return false;
+  }
+
+  for (int f = first; f <= last;) {
+    uint chunk = (f - first) / size;
+
+    for (; fed < _chunks.size() && fed < chunk + AHEAD * workers; ++fed)
+      _feed(fed);
+
+    if (_ready(f)) {
+      if (!_emit(f++))
+        return false;
+    } else if (_workers[chunk % workers].pid < 0) {
+      /* the worker ended before the frame: so does the intro there */
+      break;
+    } else if (!_reap()) {
+      return false;
+    }
+  }
+
+  return true;
+}
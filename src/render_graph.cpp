@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <core/state.hpp>
+#include <misc/log.hpp>
+#include <gl_stats.hpp>
+#include <render_graph.hpp>
+#include <state_cache.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+using namespace misc;
+using namespace tech;
+
+namespace {
+  uint const MAX_PASSES = 64; /* enabled passes are a 64-bit mask */
+
+  /* framebuffer a step draws into; aliased targets share their slot's */
+  long binding(int slot, RenderGraph::Target output) {
+    return slot >= 0 ? slot : -1L - output;
+  }
+}
+
+RenderGraph::Pass::Pass(RenderGraph &graph, uint index) :
+    _graph(graph)
+  , _index(index) {
+}
+
+/* nullptr for a pass past MAX_PASSES: its declaration goes nowhere */
+RenderGraph::PassDesc * RenderGraph::Pass::_desc() const {
+  return _index < _graph._passes.size() ? &_graph._passes[_index] : nullptr;
+}
+
+RenderGraph::Pass & RenderGraph::Pass::reads(Target target) {
+  PassDesc *p = _desc();
+
+  if (!p)
+    return *this;
+  if (target == BACKBUFFER)
+    misc::log << error << p->name << ": the backbuffer can't be sampled" << endl;
+  else
+    p->reads.push_back(target);
+  return *this;
+}
+
+RenderGraph::Pass & RenderGraph::Pass::draws(Target target, Load color) {
+  PassDesc *p = _desc();
+
+  if (!p)
+    return *this;
+  if (_graph._targets[target].previous)
+    misc::log << error << p->name << ": the last frame of " << _graph._targets[target].name << " can't be drawn" << endl;
+  p->output = target;
+  p->color = color;
+  return *this;
+}
+
+RenderGraph::Pass & RenderGraph::Pass::depth(Load depth) {
+  PassDesc *p = _desc();
+
+  if (p) {
+    p->hasDepth = true;
+    p->depth = depth;
+  }
+  return *this;
+}
+
+RenderGraph::Pass & RenderGraph::Pass::when(Condition const &condition) {
+  PassDesc *p = _desc();
+
+  if (p) {
+    p->condition = condition;
+    _graph._plans.clear();
+  }
+  return *this;
+}
+
+RenderGraph::RenderGraph(ushort width, ushort height) :
+    _width(width)
+  , _height(height)
+  , _copier(width, height)
+  , _flipped(false) {
+  _targets.push_back({ "backbuffer", width, height, false, nullptr, nullptr, -1, false });
+}
+
+RenderGraph::Target RenderGraph::transient(char const *name) {
+  return transient(name, _width, _height);
+}
+
+RenderGraph::Target RenderGraph::transient(char const *name, ushort width, ushort height) {
+  _targets.push_back({ name, width, height, false, nullptr, nullptr, -1, false });
+  return _targets.size() - 1;
+}
+
+RenderGraph::Target RenderGraph::external(char const *name, Callback const &begin, Callback const &end) {
+  _targets.push_back({ name, 0, 0, true, begin, end, -1, false });
+  return _targets.size() - 1;
+}
+
+RenderGraph::Target RenderGraph::history(char const *name, bool hasDepth) {
+  int current = _new_slot(_width, _height, hasDepth);
+  int last = _new_slot(_width, _height, hasDepth);
+
+  _slots[current].pair = last;
+  _slots[last].pair = current;
+  _targets.push_back({ name, _width, _height, false, nullptr, nullptr, current, false });
+  _targets.push_back({ name, _width, _height, false, nullptr, nullptr, last, true });
+  return _targets.size() - 2;
+}
+
+RenderGraph::Target RenderGraph::previous(Target history) const {
+  if (_targets[history].slot < 0 || _targets[history].previous)
+    misc::log << error << _targets[history].name << ": not a history target" << endl;
+  return history + 1;
+}
+
+Texture const & RenderGraph::texture(Target history) const {
+  if (_targets[history].slot < 0 || _targets[history].previous)
+    misc::log << error << _targets[history].name << ": not a history target" << endl;
+  return _resolve(std::max(_targets[history].slot, 0)).color;
+}
+
+RenderGraph::Pass RenderGraph::pass(char const *name, Callback const &execute) {
+  if (_passes.size() == MAX_PASSES) {
+    misc::log << error << name << ": more than " << MAX_PASSES << " passes, left out" << endl;
+    return Pass(*this, MAX_PASSES);
+  }
+
+  _passes.push_back({ name, DRAW, execute, nullptr, {}, BACKBUFFER, LOAD, false, DISCARD });
+  _plans.clear();
+  return Pass(*this, _passes.size() - 1);
+}
+
+RenderGraph::Pass RenderGraph::copy(char const *name, Target src, Target dst, bool additive) {
+  if (src == BACKBUFFER || _targets[src].external)
+    misc::log << error << name << ": only transient and history targets can be copied" << endl;
+
+  if (_passes.size() == MAX_PASSES)
+    return pass(name, nullptr);
+
+  Pass p = pass(name, nullptr);
+  _passes.back().kind = additive ? ADD : COPY;
+  p.reads(src).draws(dst, additive ? LOAD : DISCARD);
+  return p;
+}
+
+int RenderGraph::_new_slot(ushort width, ushort height, bool hasDepth) {
+  _slots.emplace_back();
+
+  Slot &s = _slots.back();
+  s.width = width;
+  s.height = height;
+  s.hasDepth = hasDepth;
+  s.pair = -1;
+
+  gTH.bind(Texture::T_2D, s.color);
+  gTH.parameter(Texture::P_WRAP_S, Texture::PV_CLAMP_TO_BORDER);
+  gTH.parameter(Texture::P_WRAP_T, Texture::PV_CLAMP_TO_BORDER);
+  gTH.parameter(Texture::P_MIN_FILTER, Texture::PV_LINEAR);
+  gTH.parameter(Texture::P_MAG_FILTER, Texture::PV_LINEAR);
+  gTH.parameter(Texture::P_MAX_LEVEL, 0);
+  gTH.image_2D(width, height, 0, Texture::F_RGB, Texture::IF_RGB32F, GLT_FLOAT, 0, nullptr);
+  gTH.unbind();
+
+  if (hasDepth) {
+    gRBH.bind(Renderbuffer::RENDERBUFFER, s.depth);
+    gRBH.store(width, height, Texture::IF_DEPTH_COMPONENT32F);
+    gRBH.unbind();
+  }
+
+  gFBH.bind(Framebuffer::DRAW, s.fb);
+  gFBH.attach_2D_texture(s.color, Framebuffer::color_attachment(0));
+  if (hasDepth)
+    gFBH.attach_renderbuffer(s.depth, Framebuffer::DEPTH_ATTACHMENT);
+  gFBH.unbind();
+
+  return _slots.size() - 1;
+}
+
+/* history slots are never shared */
+int RenderGraph::_slot(ushort width, ushort height, bool hasDepth, vector<int> &busyUntil, int first, int last) {
+  for (uint i = 0; i < _slots.size(); ++i) {
+    auto const &s = _slots[i];
+    if (s.pair < 0 && s.width == width && s.height == height && s.hasDepth == hasDepth && busyUntil[i] < first) {
+      busyUntil[i] = last;
+      return i;
+    }
+  }
+
+  int i = _new_slot(width, height, hasDepth);
+  busyUntil.push_back(last);
+  return i;
+}
+
+RenderGraph::Slot const & RenderGraph::_resolve(int slot) const {
+  auto const &s = _slots[slot];
+  return _flipped && s.pair >= 0 ? _slots[s.pair] : s;
+}
+
+RenderGraph::Plan RenderGraph::_compile(uint64_t enabled) {
+  uint n = _passes.size();
+  vector<bool> needed(n, false);
+  vector<int> clears(n, 0);
+  vector<bool> liveColor(_targets.size(), false);
+  vector<bool> liveDepth(_targets.size(), false);
+
+  /* backward: keep the passes whose output is used later, or shown, or
+   * kept for the next frame */
+  liveColor[BACKBUFFER] = true;
+  for (uint t = 1; t < _targets.size(); ++t)
+    liveColor[t] = _targets[t].slot >= 0 && !_targets[t].previous;
+  for (uint i = n; i-- > 0;) {
+    auto const &p = _passes[i];
+    bool color = liveColor[p.output];
+
+    if (!((enabled >> i) & 1) || !(color || (p.hasDepth && liveDepth[p.output])))
+      continue;
+
+    needed[i] = true;
+    if (p.color == CLEAR && color)
+      clears[i] |= state::COLOR_BUFFER;
+    if (p.hasDepth && p.depth == CLEAR)
+      clears[i] |= state::DEPTH_BUFFER;
+
+    liveColor[p.output] = color && p.color == LOAD;
+    if (p.hasDepth)
+      liveDepth[p.output] = p.depth == LOAD;
+    for (auto r : p.reads)
+      liveColor[r] = true;
+  }
+
+  /* a final plain copy of a full-size target: draw that target in place */
+  vector<Target> alias(_targets.size());
+  for (uint t = 0; t < alias.size(); ++t)
+    alias[t] = t;
+
+  int last = -1;
+  for (uint i = 0; i < n; ++i) {
+    if (needed[i] && _passes[i].output == BACKBUFFER)
+      last = i;
+  }
+  if (last >= 0 && _passes[last].kind == COPY) {
+    Target src = _passes[last].reads[0];
+    bool inPlace = _targets[src].slot < 0 && _targets[src].width == _width && _targets[src].height == _height;
+
+    for (uint i = 0; i < n; ++i) {
+      if (!needed[i] || static_cast<int>(i) == last)
+        continue;
+      auto const &p = _passes[i];
+      inPlace = inPlace && find(p.reads.begin(), p.reads.end(), src) == p.reads.end();
+      inPlace = inPlace && p.output != BACKBUFFER;
+    }
+
+    if (inPlace) {
+      needed[last] = false;
+      alias[src] = BACKBUFFER;
+    }
+  }
+
+  Plan plan;
+  for (uint i = 0; i < n; ++i) {
+    if (needed[i])
+      plan.push_back({ i, alias[_passes[i].output], -1, clears[i], {} });
+  }
+
+  /* lifetimes of the transient targets, in steps */
+  uint steps = plan.size();
+  vector<int> first(_targets.size(), -1), lastUse(_targets.size(), -1);
+  vector<bool> hasDepth(_targets.size(), false);
+  for (uint s = 0; s < steps; ++s) {
+    auto const &p = _passes[plan[s].pass];
+    vector<Target> used(p.reads);
+
+    used.push_back(plan[s].output);
+    for (auto t : used) {
+      if (first[t] < 0)
+        first[t] = s;
+      lastUse[t] = s;
+    }
+    hasDepth[plan[s].output] = hasDepth[plan[s].output] || p.hasDepth;
+  }
+
+  vector<Target> transients;
+  for (uint t = 1; t < _targets.size(); ++t) {
+    if (first[t] >= 0 && !_targets[t].external && _targets[t].slot < 0)
+      transients.push_back(t);
+  }
+  stable_sort(transients.begin(), transients.end(), [&](Target a, Target b) { return first[a] < first[b]; });
+
+  vector<int> slots(_targets.size(), -1);
+  vector<int> busyUntil(_slots.size(), -1);
+  for (uint t = 1; t < _targets.size(); ++t)
+    slots[t] = _targets[t].slot;
+  for (auto t : transients)
+    slots[t] = _slot(_targets[t].width, _targets[t].height, hasDepth[t], busyUntil, first[t], lastUse[t]);
+
+  for (auto &step : plan) {
+    step.slot = slots[step.output];
+    for (auto r : _passes[step.pass].reads)
+      step.inputs.push_back(slots[r]);
+  }
+
+  return plan;
+}
+
+void RenderGraph::prepare() {
+  vector<uint> conditional;
+  uint64_t always = 0;
+
+  for (uint i = 0; i < _passes.size(); ++i) {
+    if (_passes[i].condition)
+      conditional.push_back(i);
+    else
+      always |= uint64_t(1) << i;
+  }
+
+  for (uint64_t c = 0; c < (uint64_t(1) << conditional.size()); ++c) {
+    uint64_t enabled = always;
+    for (uint j = 0; j < conditional.size(); ++j) {
+      if ((c >> j) & 1)
+        enabled |= uint64_t(1) << conditional[j];
+    }
+    if (!_plans.count(enabled))
+      _plans[enabled] = _compile(enabled);
+  }
+}
+
+void RenderGraph::_switch(Step const *from, Step const *to) const {
+  if (from && to && binding(from->slot, from->output) == binding(to->slot, to->output))
+    return;
+
+  if (from) {
+    if (from->slot >= 0) {
+      if (to && to->slot >= 0) {
+        gFBH.lazy_unbind();
+      } else {
+        gFBH.unbind();
+        gStats.framebuffer();
+      }
+    } else if (from->output != BACKBUFFER) {
+      _targets[from->output].end();
+    }
+  }
+
+  if (to && to->output != BACKBUFFER) {
+    if (to->slot >= 0)
+      gFBH.bind(Framebuffer::DRAW, _resolve(to->slot).fb);
+    else
+      _targets[to->output].begin();
+    gStats.framebuffer();
+  }
+}
+
+void RenderGraph::_run(Plan const &plan) const {
+  Step const *previous = nullptr;
+
+  for (auto const &step : plan) {
+    auto const &p = _passes[step.pass];
+
+    gStats.begin_pass(p.name.c_str());
+    _switch(previous, &step);
+    gSC.forget();
+    if (step.clear)
+      state::clear(step.clear);
+
+    switch (p.kind) {
+      case COPY :
+        gSC.helper([&]() { _copier.copy(_resolve(step.inputs[0]).color); });
+        break;
+
+      case ADD :
+        gSC.enable(state::BLENDING);
+        gSC.blend_func(blending::ONE, blending::ONE);
+        gSC.helper([&]() { _copier.copy(_resolve(step.inputs[0]).color); });
+        gSC.disable(state::BLENDING);
+        break;
+
+      default :
+        for (uint u = 0; u < step.inputs.size(); ++u) {
+          if (step.inputs[u] >= 0) {
+            gSC.unit(u);
+            gSC.bind(Texture::T_2D, _resolve(step.inputs[u]).color);
+          }
+        }
+        p.execute();
+
+        /* a later pass may draw into what this one read */
+        gSC.forget();
+        for (uint u = 0; u < step.inputs.size(); ++u) {
+          if (step.inputs[u] >= 0) {
+            gSC.unit(u);
+            gSC.release();
+          }
+        }
+    }
+
+    previous = &step;
+  }
+
+  _switch(previous, nullptr);
+  gStats.end_pass();
+}
+
+void RenderGraph::execute() {
+  uint64_t enabled = 0;
+
+  for (uint i = 0; i < _passes.size(); ++i) {
+    auto const &c = _passes[i].condition;
+    if (!c || c())
+      enabled |= uint64_t(1) << i;
+  }
+
+  auto plan = _plans.find(enabled);
+  if (plan == _plans.end())
+    plan = _plans.emplace(enabled, _compile(enabled)).first;
+  _run(plan->second);
+  _flipped = !_flipped;
+}
@@ -0,0 +1,598 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <gl.hpp>
+#include <core/context.hpp>
+#include <gl_trace.hpp>
+#include <misc/log.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+using namespace misc;
+
+namespace {
+  char const TITLE[]   = "replay";
+  char const NO_PASS[] = "(no pass)";
+  uint const LOOPS     = 100;
+  uint const TOP       = 20; /* costliest draws listed */
+  uint const ARGS      = 12; /* most arguments of a call */
+
+  typedef chrono::steady_clock Clock;
+
+  /* an argument as GL takes it */
+  struct Value {
+    union {
+      uint64_t u;
+      double d;
+      void const *ptr;
+    };
+    size_t size; /* of the data pointed to */
+  };
+
+  template <typename T> typename enable_if<is_pointer<T>::value, T>::type as(Value const &v) {
+    return reinterpret_cast<T>(const_cast<void *>(v.ptr));
+  }
+
+  template <typename T> typename enable_if<is_floating_point<T>::value, T>::type as(Value const &v) {
+    return static_cast<T>(v.d);
+  }
+
+  template <typename T> typename enable_if<is_integral<T>::value, T>::type as(Value const &v) {
+    return static_cast<T>(v.u);
+  }
+
+  Value value(void const *ptr) {
+    Value v = Value();
+
+    v.ptr = ptr;
+    return v;
+  }
+
+  template <typename T> typename enable_if<is_integral<T>::value, Value>::type value(T u) {
+    Value v = Value();
+
+    v.u = static_cast<uint64_t>(u);
+    return v;
+  }
+
+  template <size_t...> struct Indices {};
+  template <size_t N, size_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+  template <size_t... I> struct MakeIndices<0, I...> {
+    typedef Indices<I...> type;
+  };
+
+  template <typename... A, size_t... I> Value invoke(void (*f)(A...), Value const *v, Indices<I...>) {
+    (void) v;
+    f(as<A>(v[I])...);
+    return Value();
+  }
+
+  template <typename R, typename... A, size_t... I> Value invoke(R (*f)(A...), Value const *v, Indices<I...>) {
+    (void) v;
+    return value(f(as<A>(v[I])...));
+  }
+
+  /* f with the values as its arguments, in order */
+  template <typename R, typename... A> Value invoke(R (*f)(A...), Value const *v) {
+    return invoke(f, v, typename MakeIndices<sizeof...(A)>::type());
+  }
+
+  struct Entry {
+    char const *name;
+    char const *kinds;
+    Value (*issue)(Value const *v);
+  };
+
+  /* by TraceCall */
+#define TRACE_ENTRY(name, kinds) { #name, kinds, [](Value const *v) { return invoke(&name, v); } },
+  Entry const CALLS[] = {
+    GL_TRACE_CALLS(TRACE_ENTRY)
+    { "frame", "f", nullptr },
+    { "pass",  "z", nullptr }
+  };
+#undef TRACE_ENTRY
+
+  struct Record {
+    uint16_t call;
+    size_t args; /* where its arguments start in the trace */
+  };
+
+  /* a call as decoded, names mapped to the player's */
+  struct Decoded {
+    Value v[ARGS];
+    char arrayKind;         /* of the names in the array, if any */
+    char const *recorded;   /* them, as recorded */
+    uint32_t count;
+    char resultKind;        /* of what it returns, if kept */
+    uint64_t result;        /* as recorded */
+    uint32_t program;       /* passed, as recorded */
+  };
+
+  /* Issues the calls of a trace, mapping the names, uniform locations and
+   * syncs it holds to those this process gets. */
+  class Player {
+    vector<char> _trace;
+    map<pair<char, uint64_t>, uint64_t> _names;                 /* by kind, recorded */
+    map<tuple<uint32_t, char, int32_t>, int32_t> _locations;    /* by program, kind, recorded */
+    map<GLenum, void *> _mapped;                                /* by target */
+    uint32_t _program;                                          /* in use, recorded */
+    vector<GLuint> _array;
+    vector<char> _output;                                       /* what calls write to memory */
+
+    template <typename T> T _get(size_t &at) const;
+    uint64_t _name(char kind, uint64_t recorded) const;
+    int32_t _location(uint32_t program, char kind, int32_t recorded) const;
+    size_t _decode(size_t at, char const *kinds, Decoded &d);
+
+  public :
+    Player(void);
+    ~Player(void) = default;
+
+    /* the header, and where each call is */
+    bool load(char const *path, TraceHeader &header, vector<Record> &records);
+    /* GL time of the call only */
+    Clock::duration issue(Record const &r);
+    /* of a marker */
+    float time(Record const &r);
+    char const * name(Record const &r);
+  };
+
+  Player::Player() :
+      _program(0) {
+  }
+
+  /* past the end reads as zeros; load() checks the size */
+  template <typename T> T Player::_get(size_t &at) const {
+    T v = T();
+
+    if (at + sizeof(T) <= _trace.size())
+      memcpy(&v, &_trace[at], sizeof(T));
+    at += sizeof(T);
+    return v;
+  }
+
+  uint64_t Player::_name(char kind, uint64_t recorded) const {
+    auto n = _names.find(make_pair(kind, recorded));
+
+    return n == _names.end() ? recorded : n->second;
+  }
+
+  int32_t Player::_location(uint32_t program, char kind, int32_t recorded) const {
+    auto l = _locations.find(make_tuple(program, kind, recorded));
+
+    return l == _locations.end() ? recorded : l->second;
+  }
+
+  /* where the next call starts */
+  size_t Player::_decode(size_t at, char const *kinds, Decoded &d) {
+    Value *v = d.v;
+
+    d.arrayKind = d.resultKind = 0;
+    d.program = 0;
+    for (char const *k = kinds; *k; ++k) {
+      uint32_t name;
+      uint8_t tag;
+
+      *v = Value();
+      switch (*k) {
+        case '!' : case '+' :
+          continue;
+
+        case '=' :
+          d.resultKind = *++k;
+          d.result = d.resultKind == 'Y' ? _get<uint64_t>(at) : _get<uint32_t>(at);
+          continue;
+
+        case 'i' :
+          v->u = _get<uint32_t>(at);
+          break;
+
+        case 'f' :
+          v->d = _get<float>(at);
+          break;
+
+        case 'd' :
+          v->d = _get<double>(at);
+          break;
+
+        case 'p' :
+          v->u = _get<uint64_t>(at);
+          break;
+
+        case 'Y' :
+          v->ptr = reinterpret_cast<void const *>(_name('Y', _get<uint64_t>(at)));
+          break;
+
+        case 'L' :
+          v->u = static_cast<uint32_t>(_location(_program, 'L', _get<int32_t>(at)));
+          break;
+
+        case 'K' :
+          v->u = static_cast<uint32_t>(_location(d.program, 'K', _get<int32_t>(at)));
+          break;
+
+        case '[' :
+          d.arrayKind = *++k;
+          d.count = _get<uint32_t>(at);
+          if (d.count > (_trace.size() - min(at, _trace.size())) / sizeof(uint32_t)) {
+            d.count = 0;
+            at = _trace.size() + 1; /* truncated */
+          }
+          d.recorded = _trace.data() + min(at, _trace.size());
+          _array.resize(d.count);
+          for (uint32_t i = 0; i < d.count; ++i)
+            _array[i] = _name(d.arrayKind, _get<uint32_t>(at));
+          v->ptr = _array.data();
+          break;
+
+        case '*' : case '>' :
+          tag = _get<uint8_t>(at);
+          if (tag == 1) {
+            v->u = _get<uint64_t>(at);
+          } else if (tag == 2) {
+            v->size = _get<uint32_t>(at);
+            if (*k == '>') {
+              _output.resize(v->size);
+              v->ptr = _output.data();
+            } else {
+              v->ptr = _trace.data() + min(at, _trace.size());
+              at += v->size;
+            }
+          }
+          break;
+
+        case 'z' :
+          v->size = _get<uint32_t>(at);
+          v->ptr = _trace.data() + min(at, _trace.size());
+          at += v->size;
+          break;
+
+        default : /* names */
+          name = _get<uint32_t>(at);
+          v->u = _name(*k, name);
+          if (*k == 'P')
+            d.program = name;
+      }
+      ++v;
+    }
+    return at;
+  }
+
+  bool Player::load(char const *path, TraceHeader &header, vector<Record> &records) {
+    FILE *file = fopen(path, "rb");
+    Decoded d;
+    size_t at;
+    long size;
+
+    if (!file) {
+      misc::log << error << "unable to open " << path << endl;
+      return false;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+    _trace.resize(max(size, 0L));
+    if (fread(_trace.data(), 1, _trace.size(), file) != _trace.size())
+      _trace.clear();
+    fclose(file);
+
+    if (_trace.size() < sizeof(header) || (memcpy(&header, _trace.data(), sizeof(header)), memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC))) ||
+        header.version != TRACE_VERSION) {
+      misc::log << error << path << " is not a GL trace of this build" << endl;
+      return false;
+    }
+
+    records.clear();
+    for (at = sizeof(header); at < _trace.size();) {
+      uint16_t call = _get<uint16_t>(at);
+
+      if (call >= TRACE_CALLS) {
+        misc::log << error << path << ": unknown call " << call << endl;
+        return false;
+      }
+      records.push_back({ call, at });
+      at = _decode(at, CALLS[call].kinds, d);
+    }
+    if (at > _trace.size()) {
+      misc::log << error << path << " is truncated" << endl;
+      return false;
+    }
+    _array.clear();
+    _output.clear();
+    return true;
+  }
+
+  Clock::duration Player::issue(Record const &r) {
+    Decoded d;
+    Value result = Value();
+    GLenum target;
+    Clock::time_point t0;
+    Clock::duration t;
+
+    if (r.call >= CALL_FRAME)
+      return Clock::duration::zero();
+    _decode(r.args, CALLS[r.call].kinds, d);
+    target = d.v[0].u;
+
+    t0 = Clock::now();
+    switch (r.call) {
+      case CALL_glShaderSource : {
+        GLchar const *source = as<GLchar const *>(d.v[1]);
+
+        glShaderSource(d.v[0].u, 1, &source, nullptr);
+        break;
+      }
+
+      case CALL_glTransformFeedbackVaryings : {
+        vector<GLchar const *> names;
+
+        for (char const *n = as<char const *>(d.v[2]); n < as<char const *>(d.v[2]) + d.v[2].size; n += strlen(n) + 1)
+          names.push_back(n);
+        glTransformFeedbackVaryings(d.v[0].u, names.size(), names.data(), d.v[3].u);
+        break;
+      }
+
+      case CALL_glUnmapBuffer :
+        if (d.v[1].size && _mapped[target])
+          memcpy(_mapped[target], d.v[1].ptr, d.v[1].size);
+        glUnmapBuffer(target);
+        break;
+
+      default :
+        result = CALLS[r.call].issue(d.v);
+    }
+    t = Clock::now() - t0;
+
+    if (r.call == CALL_glUseProgram)
+      _program = d.program;
+    else if (r.call == CALL_glMapBuffer || r.call == CALL_glMapBufferRange)
+      _mapped[target] = const_cast<void *>(result.ptr);
+    else if (r.call == CALL_glUnmapBuffer)
+      _mapped.erase(target);
+
+    if (CALLS[r.call].kinds[0] == '+') {
+      for (uint32_t i = 0; i < d.count; ++i) {
+        uint32_t name;
+
+        memcpy(&name, d.recorded + i * sizeof(name), sizeof(name));
+        _names[make_pair(d.arrayKind, name)] = _array[i];
+      }
+    }
+    if (d.resultKind == 'Y')
+      _names[make_pair('Y', d.result)] = reinterpret_cast<uintptr_t>(result.ptr);
+    else if (d.resultKind == 'H' || d.resultKind == 'P')
+      _names[make_pair(d.resultKind, d.result)] = static_cast<uint32_t>(result.u);
+    else if (d.resultKind == 'L' || d.resultKind == 'K')
+      _locations[make_tuple(d.program, d.resultKind, static_cast<int32_t>(d.result))] = static_cast<int32_t>(result.u);
+
+    return t;
+  }
+
+  float Player::time(Record const &r) {
+    size_t at = r.args;
+
+    return _get<float>(at);
+  }
+
+  char const * Player::name(Record const &r) {
+    return _trace.data() + r.args + sizeof(uint32_t);
+  }
+
+  /* a call of the frames looped over */
+  struct Call {
+    Record record;
+    uint frame;
+    uint pass;
+    int draw;                /* number among draws, -1 if it isn't one */
+    bool skipped;
+    vector<double> gpu, cpu; /* ms, per loop */
+  };
+
+  struct PassTimes {
+    string name;
+    uint runs, calls, draws;  /* per loop */
+    double gpu, cpu;          /* ms, in the current loop */
+    vector<double> gpuMs, cpuMs;
+  };
+
+  double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    return v.empty() ? 0. : v[v.size() / 2];
+  }
+
+  uint pass_of(vector<PassTimes> &passes, string const &name) {
+    for (uint i = 0; i < passes.size(); ++i) {
+      if (passes[i].name == name)
+        return i;
+    }
+    passes.push_back({ name, 0, 0, 0, 0., 0., vector<double>(), vector<double>() });
+    return passes.size() - 1;
+  }
+
+  void usage(char const *name) {
+    misc::log << error << "usage: " << name << " TRACE [--loops N] [--skip PASS]... [--skip-draw N]... [--csv]" << endl;
+  }
+}
+
+/* Replays a GL trace made with --capture, without the intro: what came
+ * before the first frame captured is issued once, to set things up, then
+ * the frames in a loop. Then, per pass, what it issued and the median GPU
+ * and CPU time of a loop, and the costliest draws; with --csv, every
+ * call of a loop with its median times instead.
+ *
+ * Draws, and the other calls doing GPU work (clears, blits, read-backs)
+ * counted as draws here, are timed by a timestamp query before and after
+ * each; CPU time is that of the call. --skip leaves out the draws of the passes of a name,
+ * --skip-draw a single one, by its number as listed; every other call
+ * still goes, for what follows to hold.
+ *
+ * Frames keep what the last one left (history targets, simulation
+ * buffers), so a single frame replays as if it followed itself. */
+int main(int argc, char **argv) {
+  char const *path = nullptr;
+  uint loops = LOOPS;
+  bool csv = false;
+  vector<string> skippedPasses;
+  vector<int> skippedDraws;
+  TraceHeader header;
+  Player player;
+  vector<Record> records;
+
+  for (int i = 1; i < argc; ++i) {
+    bool last = i + 1 == argc;
+
+    if (!strcmp(argv[i], "--loops") && !last) {
+      loops = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--skip") && !last) {
+      skippedPasses.push_back(argv[++i]);
+    } else if (!strcmp(argv[i], "--skip-draw") && !last) {
+      skippedDraws.push_back(atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--csv")) {
+      csv = true;
+    } else if (!path && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!path || loops == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (!player.load(path, header, records))
+    return 1;
+
+  auto first = find_if(records.begin(), records.end(), [](Record const &r) { return r.call == CALL_FRAME; });
+
+  if (first == records.end()) {
+    misc::log << error << path << " holds no frame" << endl;
+    return 1;
+  }
+
+  /* what the calls looped over are, in which frame and pass */
+  vector<Call> calls;
+  vector<PassTimes> passes;
+  uint frames = 0, draws = 0;
+  uint pass = pass_of(passes, NO_PASS);
+
+  for (auto r = first; r != records.end(); ++r) {
+    if (r->call == CALL_FRAME) {
+      ++frames;
+      pass = pass_of(passes, NO_PASS);
+    } else if (r->call == CALL_PASS) {
+      pass = pass_of(passes, *player.name(*r) ? player.name(*r) : NO_PASS);
+      if (*player.name(*r))
+        ++passes[pass].runs;
+    } else {
+      bool gpu = CALLS[r->call].kinds[0] == '!';
+      int draw = gpu ? draws++ : -1;
+      bool skipped = gpu && (find(skippedPasses.begin(), skippedPasses.end(), passes[pass].name) != skippedPasses.end() ||
+                             find(skippedDraws.begin(), skippedDraws.end(), draw) != skippedDraws.end());
+
+      calls.push_back({ *r, frames - 1, pass, draw, skipped, vector<double>(), vector<double>() });
+      ++passes[pass].calls;
+      passes[pass].draws += gpu;
+    }
+  }
+  for (int d : skippedDraws) {
+    if (d < 0 || d >= static_cast<int>(draws)) {
+      misc::log << error << "no draw " << d << ": " << draws << " of them a loop" << endl;
+      return 1;
+    }
+  }
+
+  Context cntxt(header.width, header.height, false, TITLE);
+  vector<GLuint> stamps(2 * max(draws, 1u));
+  vector<double> wall;
+
+  for (auto r = records.begin(); r != first; ++r)
+    player.issue(*r);
+  glGenQueries(stamps.size(), stamps.data());
+
+  for (uint l = 0; l < loops; ++l) {
+    auto t0 = Clock::now();
+
+    for (auto &c : calls) {
+      if (c.skipped)
+        continue;
+      if (c.draw >= 0)
+        glQueryCounter(stamps[2 * c.draw], GL_TIMESTAMP);
+      c.cpu.push_back(chrono::duration<double, milli>(player.issue(c.record)).count());
+      if (c.draw >= 0)
+        glQueryCounter(stamps[2 * c.draw + 1], GL_TIMESTAMP);
+    }
+
+    /* waits for the loop; no swap, vsync would pace it */
+    glFinish();
+    wall.push_back(chrono::duration<double, milli>(Clock::now() - t0).count());
+    for (auto &c : calls) {
+      GLuint64 begin, end;
+
+      if (c.skipped)
+        continue;
+      passes[c.pass].cpu += c.cpu.back();
+      if (c.draw < 0)
+        continue;
+      glGetQueryObjectui64v(stamps[2 * c.draw], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(stamps[2 * c.draw + 1], GL_QUERY_RESULT, &end);
+      c.gpu.push_back((end - begin) * 1e-6);
+      passes[c.pass].gpu += c.gpu.back();
+    }
+    for (auto &p : passes) {
+      p.gpuMs.push_back(p.gpu);
+      p.cpuMs.push_back(p.cpu);
+      p.gpu = p.cpu = 0.;
+    }
+  }
+  glDeleteQueries(stamps.size(), stamps.data());
+
+  if (csv) {
+    printf("call,frame,pass,name,draw,gpu_ms,cpu_ms\n");
+    for (uint i = 0; i < calls.size(); ++i) {
+      auto const &c = calls[i];
+
+      printf("%u,%u,%s,%s,", i, c.frame, passes[c.pass].name.c_str(), CALLS[c.record.call].name);
+      if (c.draw >= 0)
+        printf("%d,%.4f,%.4f\n", c.draw, c.skipped ? 0. : median(c.gpu), median(c.cpu));
+      else
+        printf(",,%.4f\n", median(c.cpu));
+    }
+    return 0;
+  }
+
+  printf("%u frames from %.3f s, %ux%u, %u calls a loop, %u of them draws, %u loops\n%-28s %6s %8s %8s %10s %10s\n",
+         frames, player.time(*first), header.width, header.height, static_cast<uint>(calls.size()), draws, loops,
+         "pass", "runs", "calls", "draws", "GPU ms", "CPU ms");
+  for (auto const &p : passes) {
+    if (p.calls)
+      printf("%-28s %6u %8u %8u %10.4f %10.4f\n", p.name.c_str(), p.runs, p.calls, p.draws, median(p.gpuMs), median(p.cpuMs));
+  }
+  printf("%-28s %6u %8u %8u %10s %10.4f (wall)\n", "loop", frames, static_cast<uint>(calls.size()), draws, "", median(wall));
+
+  vector<pair<double, Call const *>> costliest;
+
+  for (auto const &c : calls) {
+    if (c.draw >= 0 && !c.skipped)
+      costliest.push_back(make_pair(median(c.gpu), &c));
+  }
+  sort(costliest.begin(), costliest.end(), [](pair<double, Call const *> const &a, pair<double, Call const *> const &b) { return a.first > b.first; });
+  costliest.resize(min<size_t>(costliest.size(), TOP));
+
+  printf("\n%6s %6s %-28s %-24s %10s %10s\n", "draw", "frame", "pass", "call", "GPU ms", "CPU ms");
+  for (auto const &c : costliest)
+    printf("%6d %6u %-28s %-24s %10.4f %10.4f\n", c.second->draw, c.second->frame, passes[c.second->pass].name.c_str(),
+           CALLS[c.second->record.call].name, c.first, median(c.second->cpu));
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+#include <gl_stats.hpp>
+#include <sample_query.hpp>
+
+using namespace sky;
+
+SampleQuery::SampleQuery() :
+    _issued()
+  , _current(0)
+  , _begun(false)
+  , _samples(0) {
+  glGenQueries(RING, _queries);
+}
+
+SampleQuery::~SampleQuery() {
+  glDeleteQueries(RING, _queries);
+}
+
+/* a query of the slot still pending is replaced, its count is lost */
+void SampleQuery::begin() {
+  _begun = gStats.counting_samples();
+  if (_begun)
+    glBeginQuery(GL_SAMPLES_PASSED, _queries[_current]);
+}
+
+void SampleQuery::end() {
+  if (!_begun)
+    return;
+
+  glEndQuery(GL_SAMPLES_PASSED);
+  _issued[_current] = true;
+  _current = (_current + 1) % RING;
+  _begun = false;
+
+  /* oldest first; results come in in order */
+  for (uint i = 0; i < RING; ++i) {
+    uint q = (_current + i) % RING;
+    GLuint available;
+
+    if (!_issued[q])
+      continue;
+    glGetQueryObjectuiv(_queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+      break;
+    glGetQueryObjectuiv(_queries[q], GL_QUERY_RESULT, &_samples);
+    _issued[q] = false;
+  }
+  gStats.samples(_samples);
+}
@@ -0,0 +1,82 @@
+#include <cstring>
+#include <string>
+#include <misc/log.hpp>
+#include <shader_store.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  uint const MIN_MATCH = 4;
+
+  /* false if the length runs past end */
+  bool read_length(ubyte const *&in, ubyte const *end, uint &n) {
+    if (n < 15)
+      return true;
+    for (ubyte b = 255; b == 255; n += b) {
+      if (in == end)
+        return false;
+      b = *in++;
+    }
+    return true;
+  }
+
+  /* the dictionary, then the program, so that matches reach both; every
+   * length and back-reference is checked against the input left and the
+   * output made so far */
+  bool expand(ShaderEntry const &entry, string &out) {
+    ubyte const *in = SHADER_DATA + entry.offset;
+    ubyte const *end = in + entry.size;
+    uint size = SHADER_DICT_SIZE + entry.rawSize;
+    string window(size, '\0');
+    uint at = SHADER_DICT_SIZE;
+
+    memcpy(&window[0], SHADER_DICT, SHADER_DICT_SIZE);
+    while (in < end) {
+      ubyte token = *in++;
+      uint literals = token >> 4;
+
+      if (!read_length(in, end, literals) || literals > size - at || literals > static_cast<uint>(end - in))
+        return false;
+      memcpy(&window[at], in, literals);
+      in += literals;
+      at += literals;
+      if (in == end)
+        break;
+
+      if (end - in < 2)
+        return false;
+      uint offset = in[0] | (in[1] << 8);
+      uint match = token & 0xF;
+      in += 2;
+      if (!read_length(in, end, match) || !offset || offset > at || match + MIN_MATCH > size - at)
+        return false;
+      match += MIN_MATCH;
+
+      /* byte by byte: matches may overlap their own output */
+      for (uint from = at - offset; match--;)
+        window[at++] = window[from++];
+    }
+
+    if (at != size)
+      return false;
+    out = window.substr(SHADER_DICT_SIZE);
+    return true;
+  }
+
+  string sources[SHADER_COUNT];
+}
+
+char const * shader_source(ShaderId id) {
+  auto &src = sources[id];
+
+  if (src.empty() && !expand(SHADER_ENTRIES[id], src))
+    misc::log << error << "shader " << id << " is corrupted: " << SHADER_ENTRIES[id].size << " packed bytes don't expand to " << SHADER_ENTRIES[id].rawSize << endl;
+  return src.c_str();
+}
+
+uint shader_hash(ShaderId id) {
+  return SHADER_ENTRIES[id].hash;
+}
+
@@ -0,0 +1,529 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <lang/primtypes.hpp>
+
+using namespace std;
+using namespace sky;
+
+/* Build-time shader compiler: minifies the .glsl sources and packs them
+ * into one LZ blob against a shared dictionary (see shader_store.hpp for
+ * the format). Generates shader_ids.hpp, the ids of the programs named
+ * after their files, and shader_blob.cpp, the data.
+ *
+ * Minification strips comments and whitespace, shortens numbers, drops
+ * code after block level returns, unused functions and constants, and
+ * renames the names declared in the shader itself; uniforms, inputs and
+ * outputs keep theirs. Sources without #version are snippets pasted into
+ * other programs: they only lose comments and whitespace. */
+
+namespace {
+  uint const DICT_SIZE = 512;
+  uint const MIN_MATCH = 4;
+  uint const MAX_OFFSET = 65535;
+
+  set<string> const TYPES = {
+    "void", "bool", "int", "uint", "float", "double"
+  , "vec2", "vec3", "vec4", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4", "bvec2", "bvec3", "bvec4"
+  , "mat2", "mat3", "mat4", "mat2x2", "mat2x3", "mat2x4", "mat3x2", "mat3x3", "mat3x4", "mat4x2", "mat4x3", "mat4x4"
+  , "sampler1D", "sampler2D", "sampler3D", "samplerCube", "sampler2DShadow", "sampler2DArray", "samplerBuffer", "isampler2D", "usampler2D"
+  };
+
+  /* qualifiers of names other stages or the application refer to */
+  set<string> const INTERFACE = {
+    "uniform", "in", "out", "inout", "attribute", "varying", "flat", "smooth", "noperspective", "centroid", "layout", "buffer", "shared", "struct"
+  };
+
+  /* never generated as new names */
+  set<string> const RESERVED = {
+    "do", "if", "in", "or", "as", "is"
+  };
+
+  /* as ShaderEntry, which needs the ids generated here */
+  struct Entry {
+    uint offset, size, rawSize, hash;
+  };
+
+  struct Token {
+    enum Kind { WORD, NUMBER, SYMBOL, DIRECTIVE } kind;
+    string text;
+  };
+
+  bool word_char(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '_';
+  }
+
+  vector<Token> tokenize(string const &src) {
+    static char const *ops[] = {
+      "<<=", ">>=", "++", "--", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "==", "!=", "<=", ">=", "&&", "||", "^^", "<<", ">>"
+    };
+    vector<Token> tokens;
+    size_t i = 0;
+    bool lineStart = true;
+
+    while (i < src.size()) {
+      char c = src[i];
+
+      if (c == '\n') {
+        lineStart = true;
+        ++i;
+      } else if (isspace(static_cast<unsigned char>(c))) {
+        ++i;
+      } else if (!src.compare(i, 2, "//")) {
+        i = src.find('\n', i);
+        if (i == string::npos)
+          i = src.size();
+      } else if (!src.compare(i, 2, "/*")) {
+        i = src.find("*/", i);
+        i = i == string::npos ? src.size() : i + 2;
+      } else if (c == '#' && lineStart) {
+        size_t end = src.find('\n', i);
+        end = end == string::npos ? src.size() : end;
+        string line = src.substr(i, end - i);
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        tokens.push_back({ Token::DIRECTIVE, line });
+        i = end;
+      } else if (isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < src.size() && isdigit(static_cast<unsigned char>(src[i+1])))) {
+        size_t j = i;
+        while (j < src.size() && (isalnum(static_cast<unsigned char>(src[j])) || src[j] == '.' ||
+               ((src[j] == '+' || src[j] == '-') && (src[j-1] == 'e' || src[j-1] == 'E'))))
+          ++j;
+        tokens.push_back({ Token::NUMBER, src.substr(i, j - i) });
+        i = j;
+        lineStart = false;
+      } else if (word_char(c)) {
+        size_t j = i;
+        while (j < src.size() && word_char(src[j]))
+          ++j;
+        tokens.push_back({ Token::WORD, src.substr(i, j - i) });
+        i = j;
+        lineStart = false;
+      } else {
+        size_t n = 1;
+        for (auto op : ops) {
+          if (!src.compare(i, strlen(op), op)) {
+            n = strlen(op);
+            break;
+          }
+        }
+        tokens.push_back({ Token::SYMBOL, src.substr(i, n) });
+        i += n;
+        lineStart = false;
+      }
+    }
+
+    return tokens;
+  }
+
+  /* 0.50 -> .5, 2.0 -> 2. */
+  string shorten(string n) {
+    if (n.find('.') == string::npos || n.find_first_of("eExXuUfF") != string::npos)
+      return n;
+    while (n.back() == '0')
+      n.pop_back();
+    if (n.size() > 2 && n[0] == '0' && n[1] == '.')
+      n.erase(0, 1);
+    return n == "." ? "0." : n;
+  }
+
+  bool is(vector<Token> const &t, size_t i, char const *text) {
+    return i < t.size() && t[i].text == text;
+  }
+
+  /* index past the group opened at i */
+  size_t skip_group(vector<Token> const &t, size_t i, char const *open, char const *close) {
+    int depth = 0;
+    do {
+      if (is(t, i, open))
+        ++depth;
+      else if (is(t, i, close))
+        --depth;
+      ++i;
+    } while (i < t.size() && depth > 0);
+    return i;
+  }
+
+  /* labels of a switch its code can be entered by */
+  bool is_label(vector<Token> const &t, size_t i) {
+    return is(t, i, "case") || is(t, i, "default");
+  }
+
+  /* statements after a return at block level never run, up to the end of
+   * the block or the next label of a switch */
+  void drop_unreachable(vector<Token> &t) {
+    for (size_t i = 1; i < t.size(); ++i) {
+      if (t[i].text != "return" || !(is(t, i-1, ";") || is(t, i-1, "{") || is(t, i-1, "}")))
+        continue;
+
+      size_t end = i;
+      while (end < t.size() && t[end].text != ";")
+        ++end;
+      size_t from = end + 1, to = from;
+      for (int depth = 0; to < t.size() && (depth > 0 || (t[to].text != "}" && !is_label(t, to))); ++to) {
+        if (t[to].text == "{")
+          ++depth;
+        else if (t[to].text == "}")
+          --depth;
+      }
+      t.erase(t.begin() + from, t.begin() + to);
+    }
+  }
+
+  size_t uses(vector<Token> const &t, string const &name) {
+    size_t n = 0;
+    for (size_t i = 0; i < t.size(); ++i)
+      n += t[i].kind == Token::WORD && t[i].text == name && !is(t, i-1, ".");
+    return n;
+  }
+
+  /* functions and constants of the global scope nobody refers to */
+  void drop_unused(vector<Token> &t) {
+    for (bool dropped = true; dropped;) {
+      dropped = false;
+
+      for (size_t i = 0, depth = 0; i < t.size(); ++i) {
+        if (t[i].text == "{")
+          ++depth;
+        else if (t[i].text == "}")
+          --depth;
+        if (depth || (i && !is(t, i-1, ";") && !is(t, i-1, "}") && t[i-1].kind != Token::DIRECTIVE))
+          continue;
+
+        size_t at = i + (t[i].text == "const");
+        if (at >= t.size() || !TYPES.count(t[at].text))
+          continue;
+        size_t name = at + 1;
+        if (is(t, name, "["))
+          name = skip_group(t, name, "[", "]");
+        if (name >= t.size() || t[name].kind != Token::WORD || t[name].text == "main" || uses(t, t[name].text) > 1)
+          continue;
+
+        size_t end;
+        if (is(t, name + 1, "(") && at == i) {
+          end = skip_group(t, name + 1, "(", ")");
+          if (!is(t, end, "{"))
+            continue;
+          end = skip_group(t, end, "{", "}");
+        } else if (at != i && is(t, name + 1, "=")) {
+          end = name;
+          while (end < t.size() && t[end].text != ";")
+            ++end;
+          ++end;
+        } else {
+          continue;
+        }
+        t.erase(t.begin() + i, t.begin() + end);
+        dropped = true;
+        break;
+      }
+    }
+  }
+
+  string nth_name(size_t n) {
+    static string const letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    string name;
+    do {
+      name += letters[n % letters.size()];
+      n /= letters.size();
+    } while (n--);
+    return name;
+  }
+
+  /* shortest names to the names declared here and used most */
+  void rename(vector<Token> &t) {
+    set<string> declared, kept;
+
+    for (size_t i = 0; i < t.size(); ++i) {
+      if (t[i].kind != Token::WORD || !TYPES.count(t[i].text))
+        continue;
+      size_t name = i + 1;
+      if (is(t, name, "["))
+        name = skip_group(t, name, "[", "]");
+      if (name >= t.size() || t[name].kind != Token::WORD || TYPES.count(t[name].text) || t[name].text == "main")
+        continue;
+
+      /* qualifiers of the declaration */
+      bool interface = false;
+      for (size_t j = i; j-- > 0 && t[j].text != ";" && t[j].text != "{" && t[j].text != "}" && t[j].kind != Token::DIRECTIVE;)
+        interface |= INTERFACE.count(t[j].text) > 0;
+      (interface ? kept : declared).insert(t[name].text);
+    }
+
+    map<string, size_t> counts;
+    for (size_t i = 0; i < t.size(); ++i) {
+      if (t[i].kind != Token::WORD)
+        continue;
+      if (declared.count(t[i].text) && !kept.count(t[i].text))
+        counts[t[i].text] += !is(t, i-1, ".");
+      else if (!is(t, i-1, "."))
+        kept.insert(t[i].text);
+    }
+
+    vector<pair<size_t, string>> order;
+    for (auto const &c : counts)
+      order.push_back({ c.second, c.first });
+    sort(order.begin(), order.end(), [](pair<size_t, string> const &a, pair<size_t, string> const &b) {
+      return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    map<string, string> names;
+    size_t next = 0;
+    for (auto const &o : order) {
+      string name;
+      do {
+        name = nth_name(next++);
+      } while (kept.count(name) || RESERVED.count(name));
+      names[o.second] = name;
+    }
+
+    for (size_t i = 0; i < t.size(); ++i) {
+      auto n = names.find(t[i].text);
+      if (t[i].kind == Token::WORD && n != names.end() && !is(t, i-1, "."))
+        t[i].text = n->second;
+    }
+  }
+
+  string emit(vector<Token> const &t) {
+    string out;
+
+    for (size_t i = 0; i < t.size(); ++i) {
+      if (t[i].kind == Token::DIRECTIVE) {
+        if (!out.empty() && out.back() != '\n')
+          out += '\n';
+        out += t[i].text + '\n';
+        continue;
+      }
+
+      if (i && t[i-1].kind != Token::DIRECTIVE) {
+        bool words = t[i-1].kind != Token::SYMBOL && t[i].kind != Token::SYMBOL;
+        bool ops = (out.back() == '+' || out.back() == '-') && out.back() == t[i].text[0];
+        if (words || ops)
+          out += ' ';
+      }
+      out += t[i].kind == Token::NUMBER ? shorten(t[i].text) : t[i].text;
+    }
+
+    return out;
+  }
+
+  string minify(string const &src) {
+    auto tokens = tokenize(src);
+
+    if (src.find("#version") != string::npos) {
+      drop_unreachable(tokens);
+      drop_unused(tokens);
+      rename(tokens);
+    }
+    return emit(tokens);
+  }
+
+  /* frequent substrings shared by several programs */
+  string build_dictionary(vector<string> const &sources) {
+    map<string, set<size_t>> seen;
+
+    for (size_t s = 0; s < sources.size(); ++s) {
+      for (size_t len : { 6, 8, 12, 16, 24, 32 }) {
+        for (size_t i = 0; i + len <= sources[s].size(); ++i)
+          seen[sources[s].substr(i, len)].insert(s);
+      }
+    }
+
+    vector<pair<size_t, string>> candidates;
+    for (auto const &c : seen) {
+      if (c.second.size() > 1)
+        candidates.push_back({ (c.second.size() - 1) * (c.first.size() - 3), c.first });
+    }
+    sort(candidates.begin(), candidates.end(), [](pair<size_t, string> const &a, pair<size_t, string> const &b) {
+      return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    /* best candidates last, nearest to the data */
+    string dict;
+    for (auto const &c : candidates) {
+      if (dict.size() + c.second.size() > DICT_SIZE)
+        continue;
+      if (dict.find(c.second) == string::npos)
+        dict = c.second + dict;
+    }
+    return dict;
+  }
+
+  void put_length(vector<ubyte> &out, size_t n) {
+    for (; n >= 255; n -= 255)
+      out.push_back(255);
+    out.push_back(static_cast<ubyte>(n));
+  }
+
+  /* greedy LZ over the dictionary followed by the source */
+  vector<ubyte> compress(string const &dict, string const &src) {
+    string window = dict + src;
+    vector<ubyte> out;
+    map<uint, vector<size_t>> chains;
+    auto key = [&](size_t i) {
+      uint k;
+      memcpy(&k, window.data() + i, 4);
+      return k;
+    };
+
+    for (size_t i = 0; i + MIN_MATCH <= dict.size(); ++i)
+      chains[key(i)].push_back(i);
+
+    size_t lit = dict.size();
+    for (size_t i = dict.size(); i <= window.size();) {
+      size_t bestLen = 0, bestAt = 0;
+
+      if (i + MIN_MATCH <= window.size()) {
+        auto c = chains.find(key(i));
+        if (c != chains.end()) {
+          for (auto at = c->second.rbegin(); at != c->second.rend() && i - *at <= MAX_OFFSET; ++at) {
+            size_t len = 0;
+            while (i + len < window.size() && window[*at + len] == window[i + len])
+              ++len;
+            if (len > bestLen) {
+              bestLen = len;
+              bestAt = *at;
+            }
+          }
+        }
+      }
+
+      bool last = i == window.size();
+      if (bestLen < MIN_MATCH && !last) {
+        chains[key(i)].push_back(i);
+        ++i;
+        continue;
+      }
+
+      size_t literals = i - lit;
+      size_t match = last ? 0 : bestLen - MIN_MATCH;
+      out.push_back(static_cast<ubyte>((min<size_t>(literals, 15) << 4) | min<size_t>(match, 15)));
+      if (literals >= 15)
+        put_length(out, literals - 15);
+      out.insert(out.end(), window.begin() + lit, window.begin() + i);
+      if (last)
+        break;
+
+      size_t offset = i - bestAt;
+      out.push_back(static_cast<ubyte>(offset & 0xFF));
+      out.push_back(static_cast<ubyte>(offset >> 8));
+      if (match >= 15)
+        put_length(out, match - 15);
+
+      for (size_t end = i + bestLen; i < end; ++i) {
+        if (i + MIN_MATCH <= window.size())
+          chains[key(i)].push_back(i);
+      }
+      lit = i;
+    }
+
+    return out;
+  }
+
+  uint fnv1a(string const &s) {
+    uint h = 2166136261u;
+    for (char c : s) {
+      h ^= static_cast<ubyte>(c);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  /* fsm/laser_hblur-fs.glsl -> SHADER_LASER_HBLUR_FS */
+  string id_of(string path) {
+    path = path.substr(path.find_last_of('/') + 1);
+    path = path.substr(0, path.rfind(".glsl"));
+    string id = "SHADER_";
+    for (char c : path)
+      id += c == '-' ? '_' : static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    return id;
+  }
+
+  void bytes(ostream &out, char const *name, ubyte const *data, size_t size) {
+    out << "sky::ubyte const " << name << "[] = {";
+    for (size_t i = 0; i < size; ++i)
+      out << (i % 20 ? "" : "\n ") << " " << static_cast<unsigned>(data[i]) << ",";
+    out << "\n  0\n};\n\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <output dir> <shader.glsl>...\n", argv[0]);
+    return 1;
+  }
+
+  vector<string> ids, sources;
+  size_t raw = 0;
+  for (int i = 2; i < argc; ++i) {
+    ifstream file(argv[i]);
+    if (!file) {
+      fprintf(stderr, "shaderc: can't read %s\n", argv[i]);
+      return 1;
+    }
+    string src((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    raw += src.size();
+    ids.push_back(id_of(argv[i]));
+    sources.push_back(minify(src));
+  }
+
+  string dict = build_dictionary(sources);
+  vector<ubyte> data;
+  vector<Entry> entries;
+  size_t minified = 0;
+
+  for (size_t i = 0; i < sources.size(); ++i) {
+    auto const &s = sources[i];
+    auto same = find(sources.begin(), sources.begin() + i, s);
+
+    /* identical programs share their data */
+    if (same != sources.begin() + i) {
+      entries.push_back(entries[same - sources.begin()]);
+      continue;
+    }
+
+    auto packed = compress(dict, s);
+    entries.push_back({ static_cast<uint>(data.size()), static_cast<uint>(packed.size()), static_cast<uint>(s.size()), fnv1a(s) });
+    data.insert(data.end(), packed.begin(), packed.end());
+    minified += s.size();
+  }
+
+  string dir = argv[1];
+  ofstream hpp(dir + "/shader_ids.hpp");
+  hpp << "/* generated by shaderc, do not edit */\n"
+      << "#ifndef __SHADER_IDS_HPP\n#define __SHADER_IDS_HPP\n\n"
+      << "enum ShaderId {\n";
+  for (size_t i = 0; i < ids.size(); ++i)
+    hpp << (i ? "  , " : "    ") << ids[i] << "\n";
+  hpp << "  , SHADER_COUNT\n};\n\n#endif /* guard */\n";
+
+  ofstream cpp(dir + "/shader_blob.cpp");
+  cpp << "/* generated by shaderc, do not edit */\n"
+      << "#include <shader_store.hpp>\n\n"
+      << "sky::uint const SHADER_DICT_SIZE = " << dict.size() << ";\n\n";
+  bytes(cpp, "SHADER_DICT", reinterpret_cast<ubyte const *>(dict.data()), dict.size());
+  bytes(cpp, "SHADER_DATA", data.data(), data.size());
+  cpp << "ShaderEntry const SHADER_ENTRIES[] = {\n";
+  for (size_t i = 0; i < entries.size(); ++i) {
+    cpp << (i ? "  , " : "    ") << "{ " << entries[i].offset << ", " << entries[i].size << ", "
+        << entries[i].rawSize << ", 0x" << hex << entries[i].hash << dec << " } /* " << ids[i] << " */\n";
+  }
+  cpp << "};\n";
+
+  if (!hpp || !cpp) {
+    fprintf(stderr, "shaderc: can't write to %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("%zu shaders: %zu bytes, %zu minified, %zu packed with a %zu bytes dictionary\n",
+         ids.size(), raw, minified, data.size(), dict.size());
+  return 0;
+}
+
@@ -0,0 +1,176 @@
+#include <gl_stats.hpp>
+#include <state_cache.hpp>
+
+using namespace sky;
+using namespace core;
+
+StateCache gSC;
+
+StateCache::StateCache() :
+    _issued(0)
+  , _elided(0) {
+  forget();
+}
+
+bool StateCache::_count(bool redundant) {
+  if (redundant) {
+    ++_elided;
+    gStats.elided();
+  } else {
+    ++_issued;
+  }
+  return redundant;
+}
+
+void StateCache::_cap(state::Cap cap, bool on) {
+  uint i = 0;
+
+  while (i < _capsNb && _caps[i].cap != cap)
+    ++i;
+  if (_count(i < _capsNb && _caps[i].on == on))
+    return;
+
+  if (on)
+    state::enable(cap);
+  else
+    state::disable(cap);
+
+  if (i < _capsNb)
+    _caps[i].on = on;
+  else if (_capsNb < MAX_CAPS)
+    _caps[_capsNb++] = { cap, on };
+}
+
+void StateCache::enable(state::Cap cap) {
+  _cap(cap, true);
+}
+
+void StateCache::disable(state::Cap cap) {
+  _cap(cap, false);
+}
+
+void StateCache::blend_func(blending::Func src, blending::Func dst) {
+  if (_count(_blendKnown && _blendSrc == src && _blendDst == dst))
+    return;
+
+  Framebuffer::blend_func(src, dst);
+  _blendKnown = true;
+  _blendSrc = src;
+  _blendDst = dst;
+}
+
+/* a pending unuse is dropped for good once another use takes its place */
+void StateCache::use(Program const &program) {
+  if (_unusePending)
+    _count(true);
+  _unusePending = false;
+  if (_count(_programKnown && _program == &program))
+    return;
+
+  program.use();
+  gStats.program();
+  _programKnown = true;
+  _program = &program;
+}
+
+void StateCache::unuse() {
+  _unusePending = true;
+}
+
+void StateCache::unit(uint unit) {
+  if (_count(_unit == static_cast<int>(unit)))
+    return;
+
+  gTH.unit(unit);
+  _unit = unit;
+}
+
+void StateCache::bind(Texture::Target target, Texture const &texture) {
+  bool known = _unit >= 0 && static_cast<uint>(_unit) < MAX_UNITS;
+
+  if (known && _unbindPending[_unit])
+    _count(true);
+  if (known)
+    _unbindPending[_unit] = false;
+  if (_count(known && _textureKnown[_unit] && _texture[_unit] == &texture))
+    return;
+
+  gTH.bind(target, texture);
+  gStats.texture();
+  if (known) {
+    _textureKnown[_unit] = true;
+    _texture[_unit] = &texture;
+  }
+}
+
+void StateCache::unbind() {
+  if (_unit >= 0 && static_cast<uint>(_unit) < MAX_UNITS)
+    _unbindPending[_unit] = true;
+}
+
+void StateCache::release() {
+  bool known = _unit >= 0 && static_cast<uint>(_unit) < MAX_UNITS;
+
+  if (_count(known && _textureKnown[_unit] && !_texture[_unit]))
+    return;
+
+  gTH.unbind();
+  if (known) {
+    _textureKnown[_unit] = true;
+    _texture[_unit] = nullptr;
+    _unbindPending[_unit] = false;
+  }
+}
+
+/* pending unbinds are left uncounted: whoever binds next is unknown */
+void StateCache::forget() {
+  _capsNb = 0;
+  _blendKnown = false;
+  _programKnown = false;
+  _unusePending = false;
+  _unit = -1;
+  for (uint i = 0; i < MAX_UNITS; ++i) {
+    _textureKnown[i] = false;
+    _unbindPending[i] = false;
+  }
+}
+
+void StateCache::render(VertexArray const &va, primitive::Primitive primitive, int first, int count) {
+  va.render(primitive, first, count);
+  gStats.draw();
+}
+
+void StateCache::indexed_render(VertexArray const &va, primitive::Primitive primitive, int count, GLT type) {
+  va.indexed_render(primitive, count, type);
+  gStats.draw();
+}
+
+void StateCache::inst_indexed_render(VertexArray const &va, primitive::Primitive primitive, int count, GLT type, int inst) {
+  va.inst_indexed_render(primitive, count, type, inst);
+  gStats.draw();
+}
+
+void StateCache::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count, GLsizei inst) {
+  glDrawArraysInstanced(mode, first, count, inst);
+  gStats.draw();
+}
+
+void StateCache::data(size_t size, Buffer::Usage usage, void const *data) {
+  gBH.data(size, usage, data);
+  if (data)
+    gStats.upload(size);
+}
+
+void StateCache::subimage_2D(GLsizei width, GLsizei height, GLenum format, GLenum type, void const *texels, size_t size) {
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, texels);
+  gStats.upload(size);
+}
+
+uint StateCache::issued() const {
+  return _issued;
+}
+
+uint StateCache::elided() const {
+  return _elided;
+}
+
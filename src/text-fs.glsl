@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 vuv;
+
+out vec4 frag;
+
+uniform sampler2D atlas;
+
+void main() {
+  float d = texture(atlas, vuv).r;
+  float w = fwidth(d) * 0.75;
+
+  frag = vec4(smoothstep(0.5 - w, 0.5 + w, d));
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec4 rect;
+layout (location = 1) in vec4 uv;
+
+out vec2 vuv;
+
+uniform vec4 window; /* scale, then offset, of the NDC of the image */
+
+void main() {
+  vec2 c = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+  vuv = mix(uv.xy, uv.zw, c);
+  gl_Position = vec4(mix(rect.xy, rect.zw, c) * window.xy + window.zw, 0., 1.);
+}
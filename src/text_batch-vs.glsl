@@ -0,0 +1,19 @@
+#version 330 core
+
+layout (location = 0) in vec4 rect;
+layout (location = 1) in vec4 uv;
+layout (location = 2) in vec4 scroll; /* origin, speed, shown from, shown until */
+
+out vec2 vuv;
+
+uniform float t;
+uniform vec4 window; /* scale, then offset, of the NDC of the image */
+
+void main() {
+  vec2 c = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  vec2 p = mix(rect.xy, rect.zw, c);
+
+  p.x -= (t - scroll.x) * scroll.y;
+  vuv = mix(uv.xy, uv.zw, c);
+  gl_Position = (t >= scroll.z && t < scroll.w) ? vec4(p * window.xy + window.zw, 0., 1.) : vec4(0., 0., 2., 1.);
+}
@@ -0,0 +1,108 @@
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+#include <text_batch.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+
+TextBatch::TextBatch(TextRenderer const &renderer) :
+    _renderer(renderer) {
+  _init_va();
+  _init_program();
+}
+
+void TextBatch::_init_va() {
+  _va.bind();
+  for (GLuint i = 0; i < 3; ++i) {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+  _va.unbind();
+}
+
+void TextBatch::_init_program() {
+  Shader vs(Shader::VERTEX);
+  Shader fs(Shader::FRAGMENT);
+
+  vs.source(shader_source(SHADER_TEXT_BATCH_VS));
+  vs.compile("text batch vertex shader");
+  fs.source(shader_source(SHADER_TEXT_FS));
+  fs.compile("text batch fragment shader");
+
+  _sp.attach(vs);
+  _sp.attach(fs);
+  _sp.link();
+
+  auto atlasIndex = _sp.map_uniform("atlas");
+  _timeIndex      = _sp.map_uniform("t");
+  _windowIndex    = _sp.map_uniform("window");
+
+  _sp.use();
+  atlasIndex.push(0);
+  _sp.unuse();
+}
+
+/* GL 3.3 has no base instance: point the attributes at the first one */
+void TextBatch::_point_instances(uint first) const {
+  auto offset = first * sizeof(Instance);
+
+  gBH.bind(Buffer::ARRAY, _vbo);
+  for (GLuint i = 0; i < 3; ++i)
+    glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<void *>(offset + i*4*sizeof(float)));
+  gBH.unbind();
+}
+
+void TextBatch::add(char const *str, float x, float y, float size, float t0, float speed, float start, float end) {
+  vector<TextRenderer::GlyphInstance> glyphs;
+  float width = _renderer.layout(str, x, y, size, glyphs);
+
+  _entries.push_back({ x, y, size, width, t0, speed, start, end, static_cast<uint>(_instances.size()), static_cast<uint>(glyphs.size()) });
+  for (auto const &g : glyphs)
+    _instances.push_back({ g, t0, speed, start, end });
+}
+
+void TextBatch::commit() {
+  gBH.bind(Buffer::ARRAY, _vbo);
+  gSC.data(_instances.size()*sizeof(Instance), Buffer::STATIC_DRAW, _instances.data());
+  gBH.unbind();
+}
+
+TextBatch::Span TextBatch::cull(float time) const {
+  Span span = { static_cast<uint>(_instances.size()), 0 };
+
+  /* cull whole strings; the span of the visible ones is drawn at once */
+  for (auto const &e : _entries) {
+    float x = e.x - (time - e.t0) * e.speed;
+
+    if (time < e.start || time >= e.end || x >= 1.f || x + e.width <= -1.f || e.y >= 1.f || e.y + e.size*2.f <= -1.f || !e.count)
+      continue;
+
+    span.first = min(span.first, e.first);
+    span.last = max(span.last, e.first + e.count);
+  }
+
+  return span;
+}
+
+void TextBatch::render(float time, Span const &span) const {
+  auto window = _renderer.window();
+
+  if (span.first >= span.last)
+    return;
+
+  gSC.use(_sp);
+  gSC.push(_timeIndex, time);
+  gSC.push(_windowIndex, window[0], window[1], window[2], window[3]);
+  gSC.unit(0);
+  gSC.bind(Texture::T_2D, _renderer.atlas());
+
+  _va.bind();
+  _point_instances(span.first);
+  gSC.draw_arrays_instanced(GL_TRIANGLE_STRIP, 0, 4, span.last - span.first);
+  _va.unbind();
+
+  gSC.unbind();
+  gSC.unuse();
+}
+
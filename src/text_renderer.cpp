@@ -0,0 +1,147 @@
+#include <cstring>
+#include <shader_store.hpp>
+#include <state_cache.hpp>
+#include <text_renderer.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace core;
+
+namespace {
+  ushort const SDF_SPREAD    = 6;  /* distance range, in font pixels */
+  float  const CAP_HEIGHT    = 27; /* capitals height, in font pixels */
+  float  const TRACKING      = 2;  /* space between glyphs, in font pixels */
+  float  const SPACE_ADVANCE = 14;
+  char   const *DESCENDERS   = "gjpqyQ,;";
+  float  const DESCENT       = 7;
+}
+
+TextRenderer::TextRenderer(ushort width, ushort height, ubyte const * const *index, ushort nb, char first) :
+    _aspect(1.f * width / height)
+  , _window{ 1.f, 1.f, 0.f, 0.f }
+  , _first(first)
+  , _atlas(index, nb, SDF_SPREAD) {
+  _init_texture();
+  _init_va();
+  _init_program();
+}
+
+void TextRenderer::_init_texture() {
+  gTH.bind(Texture::T_2D, _texture);
+  gTH.parameter(Texture::P_WRAP_S, Texture::PV_CLAMP_TO_EDGE);
+  gTH.parameter(Texture::P_WRAP_T, Texture::PV_CLAMP_TO_EDGE);
+  gTH.parameter(Texture::P_MIN_FILTER, Texture::PV_LINEAR);
+  gTH.parameter(Texture::P_MAG_FILTER, Texture::PV_LINEAR);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, _atlas.width, _atlas.height, 0, GL_RED, GL_UNSIGNED_BYTE, _atlas.pixels.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  gTH.unbind();
+
+  /* only the metrics are needed from now on */
+  vector<ubyte>().swap(_atlas.pixels);
+}
+
+void TextRenderer::_init_va() {
+  /* per-glyph instances: rect then uv */
+  _va.bind();
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  gBH.bind(Buffer::ARRAY, _vbo);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), reinterpret_cast<void *>(0));
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), reinterpret_cast<void *>(4*sizeof(float)));
+  glVertexAttribDivisor(0, 1);
+  glVertexAttribDivisor(1, 1);
+  _va.unbind();
+  gBH.unbind();
+}
+
+void TextRenderer::_init_program() {
+  Shader vs(Shader::VERTEX);
+  Shader fs(Shader::FRAGMENT);
+
+  vs.source(shader_source(SHADER_TEXT_VS));
+  vs.compile("text vertex shader");
+  fs.source(shader_source(SHADER_TEXT_FS));
+  fs.compile("text fragment shader");
+
+  _sp.attach(vs);
+  _sp.attach(fs);
+  _sp.link();
+
+  auto atlasIndex = _sp.map_uniform("atlas");
+  _windowIndex    = _sp.map_uniform("window");
+
+  _sp.use();
+  atlasIndex.push(0);
+  _sp.unuse();
+}
+
+float TextRenderer::layout(char const *str, float x, float y, float size, vector<GlyphInstance> &instances) const {
+  float const sy = size / CAP_HEIGHT;
+  float const sx = sy / _aspect;
+  float const su = 1.f / _atlas.width;
+  float const sv = 1.f / _atlas.height;
+  float const spread = _atlas.spread;
+  float const x0 = x;
+
+  for (; *str; ++str) {
+    int i = *str - _first;
+
+    if (i < 0 || i >= static_cast<int>(_atlas.glyphs.size()) || !_atlas.glyphs[i].w) {
+      x += SPACE_ADVANCE * sx;
+      continue;
+    }
+
+    auto const &g = _atlas.glyphs[i];
+    float base = y - (strchr(DESCENDERS, *str) ? DESCENT * sy : 0.f);
+
+    instances.push_back({
+        x - spread*sx, base - spread*sy, x + (g.w+spread)*sx, base + (g.h+spread)*sy
+      , g.x*su, g.y*sv, (g.x + g.w + 2*spread)*su, (g.y + g.h + 2*spread)*sv
+    });
+    x += (g.w + TRACKING) * sx;
+  }
+
+  return x - x0;
+}
+
+void TextRenderer::window(float aspect, float const *scale, float const *offset) {
+  _aspect = aspect;
+  _window[0] = scale[0];
+  _window[1] = scale[1];
+  _window[2] = offset[0];
+  _window[3] = offset[1];
+}
+
+float const * TextRenderer::window() const {
+  return _window;
+}
+
+Texture const & TextRenderer::atlas() const {
+  return _texture;
+}
+
+void TextRenderer::start_draw() const {
+  gSC.use(_sp);
+  gSC.push(_windowIndex, _window[0], _window[1], _window[2], _window[3]);
+  gSC.unit(0);
+  gSC.bind(Texture::T_2D, _texture);
+  _va.bind();
+}
+
+void TextRenderer::draw_string(char const *str, float x, float y, float size) const {
+  _instances.clear();
+  layout(str, x, y, size, _instances);
+
+  gBH.bind(Buffer::ARRAY, _vbo);
+  gSC.data(_instances.size()*sizeof(GlyphInstance), Buffer::STREAM_DRAW, _instances.data());
+  gBH.unbind();
+  gSC.draw_arrays_instanced(GL_TRIANGLE_STRIP, 0, 4, _instances.size());
+}
+
+void TextRenderer::end_draw() const {
+  _va.unbind();
+  gSC.unbind();
+  gSC.unuse();
+}
+
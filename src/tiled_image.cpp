@@ -0,0 +1,102 @@
+#include <cstring>
+#include <gl.hpp>
+#include <misc/log.hpp>
+#include <tiled_image.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+TiledImage::TiledImage(ushort tileWidth, ushort tileHeight, ushort guard, uint columns, uint rows) :
+    _tileWidth(tileWidth)
+  , _tileHeight(tileHeight)
+  , _guard(guard)
+  , _columns(columns)
+  , _rows(rows)
+  , _file(nullptr) {
+}
+
+TiledImage::~TiledImage() {
+  close();
+}
+
+ushort TiledImage::drawn_width() const {
+  return _tileWidth + 2*_guard;
+}
+
+ushort TiledImage::drawn_height() const {
+  return _tileHeight + 2*_guard;
+}
+
+uint TiledImage::width() const {
+  return _columns * _tileWidth;
+}
+
+uint TiledImage::height() const {
+  return _rows * _tileHeight;
+}
+
+uint TiledImage::tiles() const {
+  return _columns * _rows;
+}
+
+/* drawn pixels start at x0, y0 of the image (from its bottom left, guard
+ * included); NDC of the image x map to those of the tile x * W/w + o,
+ * o being such that x0 lands on the tile's left edge */
+void TiledImage::place(uint i, Tile &tile) const {
+  float w = drawn_width(), h = drawn_height();
+  float x0 = 1.f * (i % _columns) * _tileWidth - _guard;
+  float y0 = 1.f * (_rows - 1 - i / _columns) * _tileHeight - _guard;
+
+  tile.aspect = 1.f * width() / height();
+  tile.scale[0] = width() / w;
+  tile.scale[1] = height() / h;
+  tile.offset[0] = (width() - 2.f*x0) / w - 1.f;
+  tile.offset[1] = (height() - 2.f*y0) / h - 1.f;
+}
+
+/* written to a .part file, renamed when closed */
+bool TiledImage::open(char const *path) {
+  bool toStdout = !strcmp(path, "-");
+
+  close();
+  _path = toStdout ? "" : path;
+  _file = toStdout ? stdout : fopen((_path + ".part").c_str(), "wb");
+  if (!_file) {
+    misc::log << error << "unable to open " << path << endl;
+    return false;
+  }
+
+  _strip.resize(static_cast<size_t>(width()) * _tileHeight * 3);
+  return true;
+}
+
+void TiledImage::read(uint i) {
+  uint column = i % _columns;
+  size_t stride = static_cast<size_t>(width()) * 3;
+
+  if (_file && i == 0)
+    fprintf(_file, "P6\n%u %u\n255\n", width(), height());
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glPixelStorei(GL_PACK_ROW_LENGTH, width());
+  glReadPixels(_guard, _guard, _tileWidth, _tileHeight, GL_RGB, GL_UNSIGNED_BYTE, &_strip[column * _tileWidth * 3]);
+  glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+  /* GL rows go up, PPM ones down */
+  if (_file && column == _columns - 1) {
+    for (uint y = _tileHeight; y-- > 0;)
+      fwrite(&_strip[y * stride], 1, stride, _file);
+  }
+}
+
+void TiledImage::close() {
+  if (_file && _path.empty()) {
+    fflush(_file);
+  } else if (_file) {
+    fclose(_file);
+    if (rename((_path + ".part").c_str(), _path.c_str()))
+      misc::log << error << "unable to name " << _path << endl;
+  }
+  _file = nullptr;
+}
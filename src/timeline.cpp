@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <misc/log.hpp>
+#include <timeline.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace math;
+using namespace misc;
+using namespace scene;
+
+namespace {
+  float const CAMERA_RATE = 60.f; /* samples per second of cameras read from sync files */
+  float const DEG         = 3.14159265f / 180.f;
+
+  ushort pattern_rows(XMModule const &module, ushort order) {
+    ubyte index = module.orders[order];
+    return index < module.patterns.size() && module.patterns[index].rows ? module.patterns[index].rows : 64;
+  }
+
+  Position catmull_rom(Position const &p0, Position const &p1, Position const &p2, Position const &p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return (p1 * 2.f + (p2 - p0) * t + (p0 * 2.f - p1 * 5.f + p2 * 4.f - p3) * t2 + (p1 * 3.f - p0 - p2 * 3.f + p3) * t3) * 0.5f;
+  }
+
+  Mat44 lerp(Mat44 const &a, Mat44 const &b, float t) {
+    Mat44 m;
+
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j)
+        m[i][j] = a[i][j] + (b[i][j] - a[i][j]) * t;
+    }
+
+    return m;
+  }
+}
+
+SongMap::SongMap(XMModule const &module) :
+    _rows(module.songLength) {
+  for (ushort o = 0; o < module.songLength; ++o)
+    _rows[o].assign(pattern_rows(module, o), -1.f);
+
+  ushort order = 0, row = 0;
+  ushort speed = module.tempo ? module.tempo : 6;
+  ushort bpm = module.bpm ? module.bpm : 125;
+  double t = 0.;
+
+  /* walk the song once, until it comes back to a row already timed */
+  while (order < module.songLength && _rows[order][row] < 0.f) {
+    ubyte index = module.orders[order];
+    bool jump = false;
+    ushort nextOrder = order + 1, nextRow = 0;
+    uint delay = 0;
+
+    _rows[order][row] = static_cast<float>(t);
+    if (index < module.patterns.size() && row < module.patterns[index].rows) {
+      for (ushort c = 0; c < module.channels; ++c) {
+        auto const &cell = module.patterns[index].cells[row * module.channels + c];
+
+        switch (cell.effect) {
+          case 0xB :
+            jump = true;
+            nextOrder = cell.param;
+            break;
+
+          case 0xD :
+            if (!jump)
+              nextOrder = order + 1;
+            jump = true;
+            nextRow = (cell.param >> 4) * 10 + (cell.param & 0xF);
+            break;
+
+          case 0xE :
+            if ((cell.param >> 4) == 0xE)
+              delay = cell.param & 0xF;
+            break;
+
+          case 0xF :
+            if (cell.param && cell.param < 32)
+              speed = cell.param;
+            else if (cell.param)
+              bpm = cell.param;
+            break;
+
+          default :;
+        }
+      }
+    }
+
+    t += speed * (1 + delay) * 2.5 / bpm;
+    if (jump) {
+      order = nextOrder;
+      row = nextRow;
+    } else if (++row >= _rows[order].size()) {
+      row = 0;
+      ++order;
+    }
+    if (order < module.songLength && row >= _rows[order].size())
+      row = 0;
+  }
+}
+
+float SongMap::time(ushort order, ushort row) const {
+  if (order >= _rows.size() || row >= _rows[order].size())
+    return -1.f;
+  return _rows[order][row];
+}
+
+void ScalarTrack::clear() {
+  _keys.clear();
+}
+
+void ScalarTrack::key(float time, float value, Interp interp) {
+  auto at = upper_bound(_keys.begin(), _keys.end(), time, [](float t, Key const &k) { return t < k.time; });
+  _keys.insert(at, Key{ time, value, interp });
+}
+
+float ScalarTrack::at(float time) const {
+  if (_keys.empty())
+    return 0.f;
+
+  auto next = upper_bound(_keys.begin(), _keys.end(), time, [](float t, Key const &k) { return t < k.time; });
+  if (next == _keys.begin())
+    return next->value;
+  auto const &k = *(next - 1);
+  if (next == _keys.end() || k.interp == STEP)
+    return k.value;
+
+  float t = (time - k.time) / (next->time - k.time);
+  if (k.interp == SMOOTH)
+    t = t * t * (3.f - 2.f * t);
+  return k.value + (next->value - k.value) * t;
+}
+
+void EventTrack::clear() {
+  _times.clear();
+}
+
+void EventTrack::key(float time) {
+  _times.insert(upper_bound(_times.begin(), _times.end(), time), time);
+}
+
+int EventTrack::index(float time) const {
+  return static_cast<int>(upper_bound(_times.begin(), _times.end(), time) - _times.begin()) - 1;
+}
+
+float EventTrack::time(uint i) const {
+  return i < _times.size() ? _times[i] : FLT_MAX;
+}
+
+uint EventTrack::size() const {
+  return _times.size();
+}
+
+CameraTrack::CameraTrack() :
+    _cachedTime(0.f)
+  , _cacheValid(false) {
+}
+
+Mat44 CameraTrack::key_view(CameraKey const &key) {
+  return Mat44::trslt(-key.pos) *
+         Orient(Axis3(0.f, 1.f, 0.f), key.yaw).to_matrix() *
+         Orient(Axis3(1.f, 0.f, 0.f), key.pitch).to_matrix() *
+         Orient(Axis3(0.f, 0.f, 1.f), key.roll).to_matrix();
+}
+
+void CameraTrack::clear() {
+  _segments.clear();
+  _cacheValid = false;
+}
+
+void CameraTrack::hold(float start, Mat44 const &view) {
+  _segments.push_back({ start, 0.f, { view } });
+  _cacheValid = false;
+}
+
+void CameraTrack::bake(float start, float end, float rate, Path const &path) {
+  uint n = static_cast<uint>(ceilf((end - start) * rate)) + 1;
+  Segment segment{ start, rate, {} };
+
+  segment.views.reserve(n);
+  for (uint i = 0; i < n; ++i)
+    segment.views.push_back(path(start + i / rate));
+  _segments.push_back(move(segment));
+  _cacheValid = false;
+}
+
+void CameraTrack::keys(vector<CameraKey> const &keys, float rate) {
+  uint n = keys.size();
+
+  for (uint i = 0; i < n; ++i) {
+    auto const &k = keys[i];
+
+    if (k.cut || i + 1 == n) {
+      hold(k.time, key_view(k));
+      continue;
+    }
+
+    auto const &p0 = keys[i ? i-1 : i].pos;
+    auto const &p3 = keys[min(i+2, n-1)].pos;
+    auto const &next = keys[i+1];
+    bake(k.time, next.time, rate, [&](float t) {
+      float u = (t - k.time) / (next.time - k.time);
+      CameraKey c = {
+        t, catmull_rom(p0, k.pos, next.pos, p3, u)
+      , k.yaw + (next.yaw - k.yaw) * u, k.pitch + (next.pitch - k.pitch) * u, k.roll + (next.roll - k.roll) * u
+      , false
+      };
+      return key_view(c);
+    });
+  }
+}
+
+Mat44 const & CameraTrack::at(float time) const {
+  if ((_cacheValid && time == _cachedTime) || _segments.empty())
+    return _cached;
+
+  auto next = upper_bound(_segments.begin(), _segments.end(), time, [](float t, Segment const &s) { return t < s.start; });
+  auto const &s = next == _segments.begin() ? *next : *(next - 1);
+  float f = max(time - s.start, 0.f) * s.rate;
+  uint i = min(static_cast<uint>(f), static_cast<uint>(s.views.size() - 1));
+
+  _cached = i + 1 < s.views.size() ? lerp(s.views[i], s.views[i+1], f - i) : s.views[i];
+  _cachedTime = time;
+  _cacheValid = true;
+  return _cached;
+}
+
+void Timeline::song(XMModule const &module) {
+  _song = SongMap(module);
+}
+
+float Timeline::row_time(ushort order, ushort row) const {
+  return _song.time(order, row);
+}
+
+ScalarTrack & Timeline::scalar(char const *name) {
+  return _scalars[name];
+}
+
+EventTrack & Timeline::event(char const *name) {
+  return _events[name];
+}
+
+CameraTrack & Timeline::camera(char const *name) {
+  return _cameras[name];
+}
+
+bool Timeline::load(char const *path) {
+  ifstream file(path);
+  if (!file)
+    return false;
+
+  map<string, vector<CameraKey>> cameras;
+  vector<string> cleared;
+  string line;
+  uint lineNb = 0;
+
+  while (getline(file, line)) {
+    ++lineNb;
+    line = line.substr(0, line.find('#'));
+
+    istringstream in(line);
+    string type, name, when, mode;
+    if (!(in >> type))
+      continue;
+    in >> name >> when;
+
+    /* seconds, or order:row */
+    float time;
+    auto colon = when.find(':');
+    if (colon != string::npos)
+      time = _song.time(atoi(when.c_str()), atoi(when.c_str() + colon + 1));
+    else
+      time = static_cast<float>(atof(when.c_str()));
+
+    bool first = find(cleared.begin(), cleared.end(), type + name) == cleared.end();
+    if (first)
+      cleared.push_back(type + name);
+
+    if (type == "scalar") {
+      float value;
+      in >> value >> mode;
+      auto &track = scalar(name.c_str());
+      if (first)
+        track.clear();
+      track.key(time, value, mode == "step" ? ScalarTrack::STEP : mode == "smooth" ? ScalarTrack::SMOOTH : ScalarTrack::LINEAR);
+    } else if (type == "event") {
+      auto &track = event(name.c_str());
+      if (first)
+        track.clear();
+      track.key(time);
+    } else if (type == "camera") {
+      CameraKey k;
+      in >> k.pos.x >> k.pos.y >> k.pos.z >> k.yaw >> k.pitch >> k.roll >> mode;
+      k.time = time;
+      k.yaw *= DEG;
+      k.pitch *= DEG;
+      k.roll *= DEG;
+      k.cut = mode == "cut";
+      cameras[name].push_back(k);
+    } else {
+      misc::log << error << path << ":" << lineNb << ": unknown track type " << type << endl;
+    }
+
+    if (time < 0.f)
+      misc::log << error << path << ":" << lineNb << ": " << when << " is never played" << endl;
+  }
+
+  for (auto &c : cameras) {
+    auto &keys = c.second;
+    stable_sort(keys.begin(), keys.end(), [](CameraKey const &a, CameraKey const &b) { return a.time < b.time; });
+
+    auto &track = camera(c.first.c_str());
+    track.clear();
+    track.keys(keys, CAMERA_RATE);
+  }
+
+  return true;
+}
+
@@ -0,0 +1,166 @@
+#include <cstring>
+#include <misc/log.hpp>
+#include <video_export.hpp>
+#include <yuv420.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  uint     const RING          = 4;          /* pixel buffers */
+  uint     const LAG           = 2;          /* frames from a read to its mapping */
+  uint     const AUDIO_RATE    = 44100;      /* as the synthesizer's */
+  GLuint64 const FENCE_TIMEOUT = 1000000000; /* ns, per wait */
+  uint     const FENCE_WAITS   = 10;         /* before giving the frame up */
+
+  bool raw_path(char const *path) {
+    size_t n = strlen(path);
+
+    return n >= 4 && !strcmp(path + n - 4, ".yuv");
+  }
+
+  FILE * open_output(char const *path) {
+    FILE *file = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+
+    if (!file)
+      misc::log << error << "unable to open " << path << endl;
+    return file;
+  }
+}
+
+VideoExport::VideoExport(Options const &options, ushort width, ushort height, XMModule const &module, int first) :
+    _width(width)
+  , _height(height)
+  , _fps(options.fps)
+  , _raw(raw_path(options.video))
+  , _video(open_output(options.video))
+  , _audio(options.audio ? new WavWriter(options.audio, AUDIO_RATE) : nullptr)
+  , _slots(RING)
+  , _read(0)
+  , _posted(0)
+  , _failed(false)
+  , _player(module, AUDIO_RATE)
+  , _samples(static_cast<uint64_t>(first) * AUDIO_RATE / options.fps)
+  , _planes(static_cast<size_t>(width) * height + 2 * ((width + 1) / 2) * ((height + 1) / 2))
+  , _slot(nullptr)
+  , _job([this]() { _write(); }) {
+  _player.skip(_samples);
+
+  for (auto &s : _slots) {
+    glGenBuffers(1, &s.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, nullptr, GL_STREAM_READ);
+    s.fence = nullptr;
+    s.mapped = nullptr;
+    s.frame = 0;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (_video && !_raw)
+    fprintf(_video, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n", width, height, _fps);
+}
+
+VideoExport::~VideoExport() {
+  finish();
+  for (auto &s : _slots)
+    glDeleteBuffers(1, &s.pbo);
+
+  if (_video && _video != stdout)
+    fclose(_video);
+  delete _audio;
+}
+
+bool VideoExport::ok() const {
+  return _video && !_failed && (!_audio || _audio->ok());
+}
+
+/* the fence is LAG frames old: it has passed, unless the GPU lags further
+ * behind, which waiting on it then makes up for; a frame whose fence never
+ * passes is not written, rather than read unfinished, and the export has
+ * failed */
+void VideoExport::_post(Slot &slot) {
+  GLenum status = GL_TIMEOUT_EXPIRED;
+
+  for (uint i = 0; i < FENCE_WAITS && status == GL_TIMEOUT_EXPIRED; ++i)
+    status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    slot.mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 * _width * _height, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!slot.mapped)
+      misc::log << error << "unable to map frame " << slot.frame << endl;
+  } else {
+    _failed = true;
+    misc::log << error << "frame " << slot.frame << (status == GL_WAIT_FAILED ? ": waiting on its fence failed" : ": its fence never passed") << endl;
+  }
+
+  _worker.wait();
+  _slot = &slot;
+  ++_posted;
+  _worker.post(_job);
+}
+
+/* once the worker is done with it */
+void VideoExport::_release(Slot &slot) {
+  if (!slot.mapped)
+    return;
+
+  _worker.wait();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.mapped = nullptr;
+}
+
+/* worker thread: the frame, then the song up to the next one */
+void VideoExport::_write() {
+  size_t luma = static_cast<size_t>(_width) * _height;
+  size_t chroma = (_planes.size() - luma) / 2;
+  uint64_t end = static_cast<uint64_t>(_slot->frame + 1) * AUDIO_RATE / _fps;
+  ubyte *y = _planes.data();
+
+  if (_video && _slot->mapped) {
+    bgra_to_yuv420(static_cast<ubyte const *>(_slot->mapped), _width, _height, y, y + luma, y + luma + chroma);
+    if (!_raw)
+      fputs("FRAME\n", _video);
+    fwrite(_planes.data(), 1, _planes.size(), _video);
+  }
+
+  if (_audio && end > _samples) {
+    _pcm.resize(end - _samples);
+    _player.render(_pcm.data(), _pcm.size());
+    _audio->write(_pcm.data(), _pcm.size());
+    _samples = end;
+  }
+}
+
+void VideoExport::read(int frame) {
+  Slot &slot = _slots[_read % RING];
+
+  /* read RING frames ago, posted LAG frames after that */
+  _release(slot);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, _width, _height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frame = frame;
+
+  if (++_read > LAG)
+    _post(_slots[_posted % RING]);
+}
+
+void VideoExport::finish() {
+  while (_posted < _read)
+    _post(_slots[_posted % RING]);
+  for (auto &s : _slots)
+    _release(s);
+
+  if (_video)
+    fflush(_video);
+}
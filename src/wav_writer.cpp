@@ -0,0 +1,69 @@
+#include <misc/log.hpp>
+#include <wav_writer.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  void put16(FILE *file, uint v) {
+    fputc(v & 0xFF, file);
+    fputc((v >> 8) & 0xFF, file);
+  }
+
+  void put32(FILE *file, uint v) {
+    put16(file, v & 0xFFFF);
+    put16(file, v >> 16);
+  }
+}
+
+WavWriter::WavWriter(char const *path, uint rate) :
+    _file(fopen(path, "wb"))
+  , _rate(rate)
+  , _frames(0) {
+  if (!_file) {
+    misc::log << error << "unable to open " << path << endl;
+    return;
+  }
+  _header();
+}
+
+WavWriter::~WavWriter() {
+  if (!_file)
+    return;
+
+  fseek(_file, 0, SEEK_SET);
+  _header();
+  fclose(_file);
+}
+
+void WavWriter::_header() {
+  uint data = static_cast<uint>(_frames * sizeof(AudioFrame));
+
+  fwrite("RIFF", 1, 4, _file);
+  put32(_file, 36 + data);
+  fwrite("WAVEfmt ", 1, 8, _file);
+  put32(_file, 16);
+  put16(_file, 1); /* PCM */
+  put16(_file, 2);
+  put32(_file, _rate);
+  put32(_file, _rate * sizeof(AudioFrame));
+  put16(_file, sizeof(AudioFrame));
+  put16(_file, 16);
+  fwrite("data", 1, 4, _file);
+  put32(_file, data);
+}
+
+bool WavWriter::ok() const {
+  return _file != nullptr;
+}
+
+void WavWriter::write(AudioFrame const *frames, uint n) {
+  if (!_file)
+    return;
+
+  /* frames are little endian already on every target of the intro */
+  fwrite(frames, sizeof(AudioFrame), n, _file);
+  _frames += n;
+}
+
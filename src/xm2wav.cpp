@@ -0,0 +1,51 @@
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include <misc/log.hpp>
+#include <wav_writer.hpp>
+#include <xm_module.hpp>
+#include <xm_player.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  uint const RATE  = 44100;
+  uint const CHUNK = 4096;
+}
+
+/* Renders a module to a WAV file as fast as possible, once through the
+ * song or for the given number of seconds, and reports the speed. */
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    misc::log << error << "usage: " << argv[0] << " <module.xm> <out.wav> [seconds]" << endl;
+    return 1;
+  }
+
+  XMModule module;
+  if (!module.load(argv[1]))
+    return 1;
+
+  WavWriter wav(argv[2], RATE);
+  if (!wav.ok())
+    return 1;
+
+  uint64_t const frames = argc > 3 ? static_cast<uint64_t>(atof(argv[3]) * RATE) : ~uint64_t(0);
+  XMPlayer player(module, RATE);
+  vector<AudioFrame> chunk(CHUNK);
+  double mixing = 0.;
+
+  while (player.frames() < frames && !player.loops()) {
+    uint n = static_cast<uint>(min<uint64_t>(CHUNK, frames - player.frames()));
+    auto t0 = chrono::steady_clock::now();
+    player.render(chunk.data(), n);
+    mixing += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    wav.write(chunk.data(), n);
+  }
+
+  double seconds = static_cast<double>(player.frames()) / RATE;
+  misc::log << debug << seconds << " s rendered in " << mixing << " s (" << seconds / mixing << "x real time)" << endl;
+
+  return 0;
+}
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <misc/log.hpp>
+#include <xm_module.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  char   const XM_MAGIC[]    = "Extended Module: ";
+  size_t const XM_MAGIC_LEN  = 17;
+  uint   const GUARD_SAMPLES = 4;
+
+  /* bounds checked little endian reader; sticks to failure once out of data */
+  class Reader {
+    ubyte const *_data;
+    size_t _size;
+    size_t _at;
+    bool _ok;
+
+  public :
+    Reader(ubyte const *data, size_t size) :
+        _data(data)
+      , _size(size)
+      , _at(0)
+      , _ok(true) {
+    }
+
+    bool ok() const {
+      return _ok;
+    }
+
+    size_t at() const {
+      return _at;
+    }
+
+    void seek(size_t at) {
+      _ok = _ok && at <= _size;
+      _at = _ok ? at : _size;
+    }
+
+    ubyte const * take(size_t n) {
+      if (!_ok || _size - _at < n) {
+        _ok = false;
+        return nullptr;
+      }
+      _at += n;
+      return _data + _at - n;
+    }
+
+    void read(void *dst, size_t n) {
+      auto p = take(n);
+      if (p)
+        memcpy(dst, p, n);
+      else
+        memset(dst, 0, n);
+    }
+
+    ubyte u8() {
+      auto p = take(1);
+      return p ? p[0] : 0;
+    }
+
+    ushort u16() {
+      auto p = take(2);
+      return p ? p[0] | p[1] << 8 : 0;
+    }
+
+    uint u32() {
+      auto p = take(4);
+      return p ? p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint>(p[3]) << 24 : 0;
+    }
+  };
+
+  bool read_pattern(Reader &r, ushort channels, XMPattern &pattern) {
+    size_t start = r.at();
+    uint headerLength = r.u32();
+    r.u8(); /* packing type, always 0 */
+    pattern.rows = r.u16();
+    ushort packedSize = r.u16();
+    r.seek(start + headerLength);
+
+    pattern.cells.assign(pattern.rows * channels, XMCell{ 0, 0, 0, 0, 0 });
+    auto packed = r.take(packedSize);
+    if (!r.ok())
+      return false;
+
+    /* MSB set: bits 0-4 tell which fields follow; otherwise all five do */
+    ubyte const *p = packed;
+    ubyte const *end = packed + packedSize;
+    for (auto &cell : pattern.cells) {
+      if (p >= end)
+        break;
+
+      ubyte what = 0x1F;
+      if (*p & 0x80)
+        what = *p++ & 0x1F;
+
+      ubyte *fields = &cell.note;
+      for (uint i = 0; i < 5; ++i) {
+        if ((what & (1 << i)) && p < end)
+          fields[i] = *p++;
+      }
+    }
+
+    return true;
+  }
+
+  bool read_envelope(Reader &r, XMEnvelope &env) {
+    for (uint i = 0; i < 12; ++i) {
+      env.x[i] = r.u16();
+      env.y[i] = r.u16();
+    }
+    return r.ok();
+  }
+
+  /* delta decoding, then ping-pong unrolling and guard samples */
+  bool read_sample_data(Reader &r, uint bytes, bool wide, ubyte loopType, XMSample &smp) {
+    auto p = r.take(bytes);
+    if (!r.ok())
+      return false;
+
+    uint n = wide ? bytes/2 : bytes;
+    smp.data.resize(n);
+    if (wide) {
+      int16_t acc = 0;
+      for (uint i = 0; i < n; ++i) {
+        acc += static_cast<int16_t>(p[2*i] | p[2*i+1] << 8);
+        smp.data[i] = acc / 32768.f;
+      }
+    } else {
+      int8_t acc = 0;
+      for (uint i = 0; i < n; ++i) {
+        acc += static_cast<int8_t>(p[i]);
+        smp.data[i] = acc / 128.f;
+      }
+    }
+
+    if (wide) {
+      smp.loopStart /= 2;
+      smp.loopLength /= 2;
+    }
+    smp.loopStart = min(smp.loopStart, n);
+    smp.loopLength = min(smp.loopLength, n - smp.loopStart);
+    if (!loopType)
+      smp.loopLength = 0;
+
+    if (smp.loopLength) {
+      /* nothing past the loop is ever played */
+      smp.data.resize(smp.loopStart + smp.loopLength);
+      if (loopType == 2) {
+        vector<float> back(smp.data.rbegin(), smp.data.rbegin() + smp.loopLength);
+        smp.data.insert(smp.data.end(), back.begin(), back.end());
+        smp.loopLength *= 2;
+      }
+    }
+    smp.length = smp.data.size();
+
+    for (uint i = 0; i < GUARD_SAMPLES; ++i)
+      smp.data.push_back(smp.loopLength ? smp.data[smp.loopStart + i % smp.loopLength] : 0.f);
+
+    return true;
+  }
+
+  bool read_instrument(Reader &r, XMInstrument &ins) {
+    size_t start = r.at();
+    uint size = r.u32();
+    r.take(22); /* name */
+    r.u8(); /* type */
+    ushort samplesNb = r.u16();
+
+    memset(ins.keymap, 0, sizeof(ins.keymap));
+    memset(&ins.volEnv, 0, sizeof(ins.volEnv));
+    memset(&ins.panEnv, 0, sizeof(ins.panEnv));
+    ins.vibType = ins.vibSweep = ins.vibDepth = ins.vibRate = 0;
+    ins.fadeout = 0;
+
+    uint sampleHeaderSize = 40;
+    if (samplesNb) {
+      sampleHeaderSize = r.u32();
+      r.read(ins.keymap, 96);
+      read_envelope(r, ins.volEnv);
+      read_envelope(r, ins.panEnv);
+      ins.volEnv.nb        = min<ubyte>(r.u8(), 12);
+      ins.panEnv.nb        = min<ubyte>(r.u8(), 12);
+      ins.volEnv.sustain   = r.u8();
+      ins.volEnv.loopStart = r.u8();
+      ins.volEnv.loopEnd   = r.u8();
+      ins.panEnv.sustain   = r.u8();
+      ins.panEnv.loopStart = r.u8();
+      ins.panEnv.loopEnd   = r.u8();
+      ins.volEnv.flags     = r.u8();
+      ins.panEnv.flags     = r.u8();
+      ins.vibType          = r.u8();
+      ins.vibSweep         = r.u8();
+      ins.vibDepth         = r.u8();
+      ins.vibRate          = r.u8();
+      ins.fadeout          = r.u16();
+    }
+    r.seek(start + size);
+    if (!r.ok())
+      return false;
+
+    /* all headers first, then all the data */
+    vector<uint> bytes(samplesNb);
+    vector<ubyte> types(samplesNb);
+    ins.samples.resize(samplesNb);
+    for (ushort i = 0; i < samplesNb; ++i) {
+      auto &smp = ins.samples[i];
+      size_t header = r.at();
+
+      bytes[i]         = r.u32();
+      smp.loopStart    = r.u32();
+      smp.loopLength   = r.u32();
+      smp.volume       = min<ubyte>(r.u8(), 64);
+      smp.finetune     = static_cast<int8_t>(r.u8());
+      types[i]         = r.u8();
+      smp.panning      = r.u8();
+      smp.relativeNote = static_cast<int8_t>(r.u8());
+      r.seek(header + sampleHeaderSize);
+    }
+
+    for (ushort i = 0; i < samplesNb; ++i) {
+      if (!read_sample_data(r, bytes[i], types[i] & 0x10, types[i] & 0x03, ins.samples[i]))
+        return false;
+    }
+
+    return r.ok();
+  }
+}
+
+bool XMModule::load(char const *path) {
+  ifstream file(path, ios::binary);
+
+  if (!file) {
+    misc::log << error << "unable to open module " << path << endl;
+    return false;
+  }
+
+  vector<ubyte> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  return load(data.data(), data.size());
+}
+
+bool XMModule::load(ubyte const *data, size_t size) {
+  Reader r(data, size);
+
+  auto magic = r.take(XM_MAGIC_LEN);
+  if (!magic || memcmp(magic, XM_MAGIC, XM_MAGIC_LEN)) {
+    misc::log << error << "not an extended module" << endl;
+    return false;
+  }
+
+  r.seek(60);
+  uint headerSize = r.u32();
+  songLength      = min<ushort>(r.u16(), 256);
+  restart         = r.u16();
+  channels        = r.u16();
+  ushort patternsNb    = r.u16();
+  ushort instrumentsNb = r.u16();
+  flags           = r.u16();
+  tempo           = r.u16();
+  bpm             = r.u16();
+  r.read(orders, 256);
+  r.seek(60 + headerSize);
+
+  if (!r.ok() || !channels || channels > 32 || !songLength) {
+    misc::log << error << "malformed module header" << endl;
+    return false;
+  }
+  if (restart >= songLength)
+    restart = 0;
+
+  patterns.resize(patternsNb);
+  for (auto &pattern : patterns) {
+    if (!read_pattern(r, channels, pattern)) {
+      misc::log << error << "malformed module pattern" << endl;
+      return false;
+    }
+  }
+
+  instruments.resize(instrumentsNb);
+  for (auto &ins : instruments) {
+    if (!read_instrument(r, ins)) {
+      misc::log << error << "malformed module instrument" << endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
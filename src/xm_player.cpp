@@ -0,0 +1,783 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <xm_player.hpp>
+
+using namespace std;
+using namespace sky;
+
+namespace {
+  uint  const MIX_FRAMES  = 1024; /* frames mixed at once */
+  uint  const RAMP_FRAMES = 64;   /* gain changes are spread over that many frames */
+  float const MASTER_GAIN = 0.3f;
+  int   const MAX_PERIOD  = 32000;
+  int   const KEY_OFF     = 97;
+  ubyte const SINE[32]    = {
+    0, 24, 49, 74, 97, 120, 141, 161, 180, 197, 212, 224, 235, 244, 250, 253
+  , 255, 253, 250, 244, 235, 224, 212, 197, 180, 161, 141, 120, 97, 74, 49, 24
+  };
+
+  /* effects, by their tracker letter */
+  enum {
+    FX_ARPEGGIO, FX_PORTA_UP, FX_PORTA_DOWN, FX_TONE_PORTA, FX_VIBRATO, FX_TONE_PORTA_VOL, FX_VIBRATO_VOL, FX_TREMOLO
+  , FX_PAN, FX_OFFSET, FX_VOL_SLIDE, FX_JUMP, FX_VOLUME, FX_BREAK, FX_EXTENDED, FX_SPEED
+  , FX_GLOBAL_VOLUME = 16, FX_GLOBAL_SLIDE = 17, FX_KEY_OFF = 20, FX_ENV_POS = 21
+  , FX_PAN_SLIDE = 25, FX_MULTI_RETRIG = 27, FX_EXTRA_FINE = 33
+  };
+
+  /* linear frequency table: 64 period units per semitone, C-4 at 8363 Hz */
+  int note_period(int note, int finetune) {
+    return 7680 - note*64 - finetune/2;
+  }
+
+  float period_frequency(int period) {
+    return 8363.f * exp2f((4608 - period) / 768.f);
+  }
+
+  /* vibrato and tremolo waveforms, 0-255 over half a period */
+  int waveform(ubyte pos, ubyte wave) {
+    switch (wave & 3) {
+      case 1 :
+        return (pos & 0x80) ? 255 - ((pos >> 2) & 0x1F) * 8 : ((pos >> 2) & 0x1F) * 8;
+      case 2 :
+        return 255;
+      default :
+        return SINE[(pos >> 2) & 0x1F];
+    }
+  }
+
+  int envelope_value(XMEnvelope const &env, uint tick) {
+    if (!env.nb)
+      return 0;
+    if (tick >= env.x[env.nb-1])
+      return env.y[env.nb-1];
+
+    uint i = 0;
+    while (i + 2 < env.nb && tick >= env.x[i+1])
+      ++i;
+    int dx = env.x[i+1] - env.x[i];
+    int t = static_cast<int>(tick) - env.x[i];
+    return dx > 0 ? env.y[i] + (env.y[i+1] - env.y[i]) * t / dx : env.y[i+1];
+  }
+
+  void envelope_advance(XMEnvelope const &env, uint &tick, bool keyOn) {
+    if (!env.nb)
+      return;
+    if (keyOn && (env.flags & XMEnvelope::SUSTAIN) && env.sustain < env.nb && tick == env.x[env.sustain])
+      return;
+
+    ++tick;
+    if ((env.flags & XMEnvelope::LOOP) && env.loopEnd < env.nb && tick >= env.x[env.loopEnd])
+      tick = env.x[min(env.loopStart, env.loopEnd)];
+  }
+}
+
+XMPlayer::XMPlayer(XMModule const &module, uint rate) :
+    _module(module)
+  , _rate(rate)
+  , _channels(module.channels, Channel())
+  , _order(0)
+  , _row(0)
+  , _speed(module.tempo ? module.tempo : 6)
+  , _bpm(module.bpm ? module.bpm : 125)
+  , _tick(0)
+  , _globalVolume(64)
+  , _globalSlide(0)
+  , _patternDelay(0)
+  , _delaying(false)
+  , _jump(false)
+  , _breakSet(false)
+  , _jumpOrder(0)
+  , _breakRow(0)
+  , _tickLeft(0)
+  , _tickFrac(0)
+  , _frames(0)
+  , _loops(0)
+  , _mix(2*MIX_FRAMES) {
+  _blank.rows = 64;
+  _blank.cells.assign(64 * module.channels, XMCell{ 0, 0, 0, 0, 0 });
+
+  for (auto &ch : _channels)
+    ch.panning = 128;
+}
+
+XMPattern const * XMPlayer::_pattern() const {
+  ubyte index = _module.orders[_order];
+  return index < _module.patterns.size() && _module.patterns[index].rows ? &_module.patterns[index] : &_blank;
+}
+
+void XMPlayer::_start_tick() {
+  if (!_tick && !_delaying) {
+    auto pattern = _pattern();
+    _jump = _breakSet = false;
+    for (uint i = 0; i < _channels.size(); ++i)
+      _row_channel(_channels[i], pattern->cells[_row * _module.channels + i]);
+  } else {
+    for (auto &ch : _channels)
+      _effect_tick(ch);
+  }
+
+  for (auto &ch : _channels)
+    _update(ch);
+
+  /* a tick lasts 2.5 / bpm seconds */
+  uint frames = _rate * 5 + _tickFrac;
+  _tickLeft = frames / (2 * _bpm);
+  _tickFrac = frames % (2 * _bpm);
+
+  if (++_tick >= _speed) {
+    _tick = 0;
+    if (_patternDelay) {
+      --_patternDelay;
+      _delaying = true;
+    } else {
+      _delaying = false;
+      _next_row();
+    }
+  }
+}
+
+void XMPlayer::_next_row() {
+  ushort order = _order;
+
+  if (_jump) {
+    _order = _jumpOrder;
+    _row = _breakRow;
+  } else if (++_row >= _pattern()->rows) {
+    _row = 0;
+    ++_order;
+  }
+
+  /* past the end or backwards: the song loops */
+  if (_order >= _module.songLength || _order < order) {
+    if (_order >= _module.songLength)
+      _order = _module.restart;
+    ++_loops;
+  }
+  if (_row >= _pattern()->rows)
+    _row = 0;
+}
+
+void XMPlayer::_row_channel(Channel &ch, XMCell const &cell) {
+  ch.cell = cell;
+  ch.arpDelta = 0;
+  if (cell.effect != FX_VIBRATO && cell.effect != FX_VIBRATO_VOL && (cell.volume >> 4) != 0xB)
+    ch.vibDelta = 0;
+  if (cell.effect != FX_TREMOLO)
+    ch.tremDelta = 0;
+
+  /* delayed notes are triggered by _effect_tick */
+  if (cell.effect != FX_EXTENDED || (cell.param >> 4) != 0xD || !(cell.param & 0xF)) {
+    _trigger(ch, cell);
+    _volume_row(ch, cell.volume);
+  }
+  _effect_row(ch);
+}
+
+void XMPlayer::_trigger(Channel &ch, XMCell const &cell) {
+  bool porta = cell.effect == FX_TONE_PORTA || cell.effect == FX_TONE_PORTA_VOL || (cell.volume >> 4) == 0xF;
+
+  if (cell.instrument)
+    ch.instrument = cell.instrument <= _module.instruments.size() ? &_module.instruments[cell.instrument-1] : nullptr;
+
+  if (cell.note == KEY_OFF) {
+    _key_off(ch);
+    return;
+  }
+
+  if (cell.note) {
+    if (!ch.instrument) {
+      ch.active = false;
+      return;
+    }
+
+    ubyte index = ch.instrument->keymap[min(cell.note-1, 95)];
+    if (index >= ch.instrument->samples.size()) {
+      ch.active = false;
+      return;
+    }
+
+    auto const &smp = ch.instrument->samples[index];
+    int period = note_period(cell.note - 1 + smp.relativeNote, smp.finetune);
+
+    if (porta && ch.active) {
+      ch.portaTarget = period;
+    } else {
+      if (cell.effect == FX_OFFSET && cell.param)
+        ch.offset = cell.param;
+
+      ch.sample = &smp;
+      ch.finetune = smp.finetune;
+      ch.period = ch.portaTarget = period;
+      ch.pos = cell.effect == FX_OFFSET ? static_cast<uint64_t>(ch.offset) << 40 : 0;
+      ch.active = (ch.pos >> 32) < smp.length;
+      ch.gainL = ch.gainR = 0.f;
+      if (ch.vibWave < 4)
+        ch.vibPos = 0;
+      if (ch.tremWave < 4)
+        ch.tremPos = 0;
+    }
+  }
+
+  /* instruments and fresh notes retrigger the envelopes */
+  if (ch.sample && (cell.instrument || (cell.note && !porta))) {
+    if (cell.instrument) {
+      ch.volume = ch.sample->volume;
+      ch.panning = ch.sample->panning;
+    }
+    ch.keyOn = true;
+    ch.fadeout = 65536;
+    ch.volEnvTick = ch.panEnvTick = 0;
+    ch.autoVibPos = ch.autoVibAmp = 0;
+  }
+}
+
+void XMPlayer::_volume_row(Channel &ch, ubyte v) {
+  ubyte lo = v & 0xF;
+
+  switch (v >> 4) {
+    case 0x1 : case 0x2 : case 0x3 : case 0x4 : case 0x5 :
+      ch.volume = min(v - 0x10, 64);
+      break;
+
+    case 0x8 :
+      ch.volume = max(ch.volume - lo, 0);
+      break;
+
+    case 0x9 :
+      ch.volume = min(ch.volume + lo, 64);
+      break;
+
+    case 0xA :
+      ch.vibSpeed = lo * 4;
+      break;
+
+    case 0xB :
+      if (lo)
+        ch.vibDepth = lo;
+      break;
+
+    case 0xC :
+      ch.panning = lo << 4;
+      break;
+
+    case 0xF :
+      if (lo)
+        ch.portaSpeed = lo << 4;
+      break;
+
+    default :;
+  }
+}
+
+void XMPlayer::_effect_row(Channel &ch) {
+  ubyte p = ch.cell.param;
+  ubyte hi = p >> 4;
+  ubyte lo = p & 0xF;
+
+  switch (ch.cell.effect) {
+    case FX_PORTA_UP :
+      if (p)
+        ch.portaUp = p;
+      break;
+
+    case FX_PORTA_DOWN :
+      if (p)
+        ch.portaDown = p;
+      break;
+
+    case FX_TONE_PORTA :
+      if (p)
+        ch.portaSpeed = p;
+      break;
+
+    case FX_VIBRATO :
+      if (hi)
+        ch.vibSpeed = hi * 4;
+      if (lo)
+        ch.vibDepth = lo;
+      break;
+
+    case FX_TONE_PORTA_VOL :
+    case FX_VIBRATO_VOL :
+    case FX_VOL_SLIDE :
+      if (p)
+        ch.volSlide = p;
+      break;
+
+    case FX_TREMOLO :
+      if (hi)
+        ch.tremSpeed = hi * 4;
+      if (lo)
+        ch.tremDepth = lo;
+      break;
+
+    case FX_PAN :
+      ch.panning = p;
+      break;
+
+    case FX_JUMP :
+      _jump = true;
+      _jumpOrder = p;
+      if (!_breakSet)
+        _breakRow = 0;
+      break;
+
+    case FX_VOLUME :
+      ch.volume = min<int>(p, 64);
+      break;
+
+    case FX_BREAK :
+      if (!_jump)
+        _jumpOrder = _order + 1;
+      _jump = _breakSet = true;
+      _breakRow = hi * 10 + lo;
+      break;
+
+    case FX_EXTENDED :
+      switch (hi) {
+        case 0x1 :
+          if (lo)
+            ch.fineUp = lo;
+          ch.period = max(ch.period - ch.fineUp * 4, 1);
+          break;
+
+        case 0x2 :
+          if (lo)
+            ch.fineDown = lo;
+          ch.period = min(ch.period + ch.fineDown * 4, MAX_PERIOD);
+          break;
+
+        case 0x4 :
+          ch.vibWave = lo;
+          break;
+
+        case 0x6 :
+          if (!lo) {
+            ch.loopRow = _row;
+          } else if (!ch.loopCount || --ch.loopCount) {
+            if (!ch.loopCount)
+              ch.loopCount = lo;
+            _jump = _breakSet = true;
+            _jumpOrder = _order;
+            _breakRow = ch.loopRow;
+          }
+          break;
+
+        case 0x7 :
+          ch.tremWave = lo;
+          break;
+
+        case 0x8 :
+          ch.panning = lo << 4;
+          break;
+
+        case 0xA :
+          if (lo)
+            ch.fineVolUp = lo;
+          ch.volume = min(ch.volume + ch.fineVolUp, 64);
+          break;
+
+        case 0xB :
+          if (lo)
+            ch.fineVolDown = lo;
+          ch.volume = max(ch.volume - ch.fineVolDown, 0);
+          break;
+
+        case 0xC :
+          if (!lo)
+            ch.volume = 0;
+          break;
+
+        case 0xE :
+          _patternDelay = lo;
+          break;
+
+        default :;
+      }
+      break;
+
+    case FX_SPEED :
+      if (p && p < 32)
+        _speed = p;
+      else if (p)
+        _bpm = p;
+      break;
+
+    case FX_GLOBAL_VOLUME :
+      _globalVolume = min<int>(p, 64);
+      break;
+
+    case FX_GLOBAL_SLIDE :
+      if (p)
+        _globalSlide = p;
+      break;
+
+    case FX_KEY_OFF :
+      if (!p)
+        _key_off(ch);
+      break;
+
+    case FX_ENV_POS :
+      ch.volEnvTick = ch.panEnvTick = p;
+      break;
+
+    case FX_PAN_SLIDE :
+      if (p)
+        ch.panSlide = p;
+      break;
+
+    case FX_MULTI_RETRIG :
+      if (p)
+        ch.retrig = p;
+      break;
+
+    case FX_EXTRA_FINE :
+      if (hi == 1) {
+        if (lo)
+          ch.xfineUp = lo;
+        ch.period = max(ch.period - ch.xfineUp, 1);
+      } else if (hi == 2) {
+        if (lo)
+          ch.xfineDown = lo;
+        ch.period = min(ch.period + ch.xfineDown, MAX_PERIOD);
+      }
+      break;
+
+    default :;
+  }
+}
+
+void XMPlayer::_effect_tick(Channel &ch) {
+  ubyte p = ch.cell.param;
+  ubyte hi = p >> 4;
+  ubyte lo = p & 0xF;
+
+  _volume_tick(ch, ch.cell.volume);
+
+  switch (ch.cell.effect) {
+    case FX_ARPEGGIO :
+      if (p)
+        ch.arpDelta = _tick % 3 == 1 ? hi : _tick % 3 == 2 ? lo : 0;
+      break;
+
+    case FX_PORTA_UP :
+      ch.period = max(ch.period - ch.portaUp * 4, 1);
+      break;
+
+    case FX_PORTA_DOWN :
+      ch.period = min(ch.period + ch.portaDown * 4, MAX_PERIOD);
+      break;
+
+    case FX_TONE_PORTA :
+      _tone_porta(ch);
+      break;
+
+    case FX_VIBRATO :
+      _vibrato(ch);
+      break;
+
+    case FX_TONE_PORTA_VOL :
+      _tone_porta(ch);
+      _volume_slide(ch, ch.volSlide);
+      break;
+
+    case FX_VIBRATO_VOL :
+      _vibrato(ch);
+      _volume_slide(ch, ch.volSlide);
+      break;
+
+    case FX_TREMOLO : {
+      int delta = (waveform(ch.tremPos, ch.tremWave) * ch.tremDepth) >> 6;
+      ch.tremDelta = (ch.tremPos & 0x80) ? -delta : delta;
+      ch.tremPos += ch.tremSpeed;
+      break;
+    }
+
+    case FX_VOL_SLIDE :
+      _volume_slide(ch, ch.volSlide);
+      break;
+
+    case FX_EXTENDED :
+      switch (hi) {
+        case 0x9 :
+          if (lo && !(_tick % lo) && ch.sample) {
+            ch.pos = 0;
+            ch.active = ch.sample->length > 0;
+          }
+          break;
+
+        case 0xC :
+          if (_tick == lo)
+            ch.volume = 0;
+          break;
+
+        case 0xD :
+          if (_tick == lo) {
+            _trigger(ch, ch.cell);
+            _volume_row(ch, ch.cell.volume);
+          }
+          break;
+
+        default :;
+      }
+      break;
+
+    case FX_GLOBAL_SLIDE :
+      if (_globalSlide >> 4)
+        _globalVolume = min(_globalVolume + (_globalSlide >> 4), 64);
+      else
+        _globalVolume = max(_globalVolume - (_globalSlide & 0xF), 0);
+      break;
+
+    case FX_KEY_OFF :
+      if (_tick == p)
+        _key_off(ch);
+      break;
+
+    case FX_PAN_SLIDE :
+      if (ch.panSlide >> 4)
+        ch.panning = min(ch.panning + (ch.panSlide >> 4), 255);
+      else
+        ch.panning = max(ch.panning - (ch.panSlide & 0xF), 0);
+      break;
+
+    case FX_MULTI_RETRIG : {
+      ubyte interval = ch.retrig & 0xF;
+
+      if (interval && !(_tick % interval) && ch.sample) {
+        int &v = ch.volume;
+        switch (ch.retrig >> 4) {
+          case 0x1 : case 0x2 : case 0x3 : case 0x4 : case 0x5 :
+            v -= 1 << ((ch.retrig >> 4) - 1);
+            break;
+          case 0x6 : v = v * 2 / 3; break;
+          case 0x7 : v /= 2; break;
+          case 0x9 : case 0xA : case 0xB : case 0xC : case 0xD :
+            v += 1 << ((ch.retrig >> 4) - 9);
+            break;
+          case 0xE : v = v * 3 / 2; break;
+          case 0xF : v *= 2; break;
+          default :;
+        }
+        v = min(max(v, 0), 64);
+        ch.pos = 0;
+        ch.active = ch.sample->length > 0;
+      }
+      break;
+    }
+
+    default :;
+  }
+}
+
+void XMPlayer::_volume_tick(Channel &ch, ubyte v) {
+  ubyte lo = v & 0xF;
+
+  switch (v >> 4) {
+    case 0x6 :
+      ch.volume = max(ch.volume - lo, 0);
+      break;
+
+    case 0x7 :
+      ch.volume = min(ch.volume + lo, 64);
+      break;
+
+    case 0xB :
+      _vibrato(ch);
+      break;
+
+    case 0xD :
+      ch.panning = max(ch.panning - lo, 0);
+      break;
+
+    case 0xE :
+      ch.panning = min(ch.panning + lo, 255);
+      break;
+
+    case 0xF :
+      _tone_porta(ch);
+      break;
+
+    default :;
+  }
+}
+
+void XMPlayer::_tone_porta(Channel &ch) {
+  int speed = ch.portaSpeed * 4;
+
+  if (ch.period < ch.portaTarget)
+    ch.period = min(ch.period + speed, ch.portaTarget);
+  else
+    ch.period = max(ch.period - speed, ch.portaTarget);
+}
+
+void XMPlayer::_vibrato(Channel &ch) {
+  int delta = (waveform(ch.vibPos, ch.vibWave) * ch.vibDepth) >> 5;
+
+  ch.vibDelta = (ch.vibPos & 0x80) ? -delta : delta;
+  ch.vibPos += ch.vibSpeed;
+}
+
+void XMPlayer::_volume_slide(Channel &ch, ubyte param) {
+  if (param >> 4)
+    ch.volume = min(ch.volume + (param >> 4), 64);
+  else
+    ch.volume = max(ch.volume - (param & 0xF), 0);
+}
+
+void XMPlayer::_key_off(Channel &ch) {
+  ch.keyOn = false;
+  if (!ch.instrument || !(ch.instrument->volEnv.flags & XMEnvelope::ON))
+    ch.volume = 0;
+}
+
+/* envelopes, fadeout, auto vibrato, then the final pitch and gains */
+void XMPlayer::_update(Channel &ch) {
+  ch.rampLeft = RAMP_FRAMES;
+  if (!ch.active || !ch.sample) {
+    ch.targetL = ch.targetR = 0.f;
+    return;
+  }
+
+  auto ins = ch.instrument;
+  int volEnv = 64;
+  int panEnv = 32;
+  int autoVib = 0;
+
+  if (ins && (ins->volEnv.flags & XMEnvelope::ON)) {
+    volEnv = envelope_value(ins->volEnv, ch.volEnvTick);
+    envelope_advance(ins->volEnv, ch.volEnvTick, ch.keyOn);
+    if (!ch.keyOn)
+      ch.fadeout = max(ch.fadeout - ins->fadeout, 0);
+  }
+
+  if (ins && (ins->panEnv.flags & XMEnvelope::ON)) {
+    panEnv = envelope_value(ins->panEnv, ch.panEnvTick);
+    envelope_advance(ins->panEnv, ch.panEnvTick, ch.keyOn);
+  }
+
+  if (ins && ins->vibDepth) {
+    uint full = ins->vibDepth << 8;
+    ch.autoVibAmp = ins->vibSweep ? min(ch.autoVibAmp + full / ins->vibSweep, full) : full;
+
+    ubyte pos = ch.autoVibPos;
+    int v;
+    switch (ins->vibType) {
+      case 1 : v = pos < 128 ? 64 : -64; break;
+      case 2 : v = 64 - (pos >> 1); break;
+      case 3 : v = (pos >> 1) - 64; break;
+      default : v = static_cast<int>(64.f * sinf(pos * 6.2831853f / 256.f));
+    }
+    autoVib = (v * static_cast<int>(ch.autoVibAmp)) >> 14;
+    ch.autoVibPos = (ch.autoVibPos + ins->vibRate) & 0xFF;
+  }
+
+  int period = max(ch.period + ch.vibDelta + autoVib - ch.arpDelta * 64, 1);
+  ch.step = max<uint64_t>(static_cast<uint64_t>(static_cast<double>(period_frequency(period)) / _rate * 4294967296.), 1);
+
+  int volume = min(max(ch.volume + ch.tremDelta, 0), 64);
+  float gain = MASTER_GAIN * volume / 64.f * volEnv / 64.f * ch.fadeout / 65536.f * _globalVolume / 64.f;
+  int pan = min(max(ch.panning + (panEnv - 32) * (128 - abs(ch.panning - 128)) / 32, 0), 255);
+
+  ch.targetL = gain * sqrtf((256 - pan) / 256.f);
+  ch.targetR = gain * sqrtf(pan / 256.f);
+
+  /* faded out: done once the gains reach 0 */
+  if (!ch.fadeout && !ch.gainL && !ch.gainR)
+    ch.active = false;
+}
+
+/* mix n frames of a channel into out, or only advance it if out is null */
+void XMPlayer::_play(Channel &ch, float *out, uint n) {
+  if (!ch.active)
+    return;
+
+  auto const &smp = *ch.sample;
+  uint64_t const end = static_cast<uint64_t>(smp.length) << 32;
+
+  for (uint done = 0; done < n && ch.active;) {
+    /* up to the end of the sample or loop */
+    uint k = n - done;
+    if (ch.pos < end)
+      k = static_cast<uint>(min<uint64_t>(k, (end - ch.pos + ch.step - 1) / ch.step));
+    else
+      k = 0;
+
+    uint r = min(k, ch.rampLeft);
+    if (out) {
+      float *o = out + 2*done;
+      uint64_t pos = ch.pos;
+
+      if (r) {
+        float dl = (ch.targetL - ch.gainL) / ch.rampLeft;
+        float dr = (ch.targetR - ch.gainR) / ch.rampLeft;
+        pos = mix_resample(smp.data.data(), pos, ch.step, r, ch.gainL, ch.gainR, dl, dr, o);
+        ch.gainL += dl * r;
+        ch.gainR += dr * r;
+      }
+      if (ch.rampLeft == r) {
+        ch.gainL = ch.targetL;
+        ch.gainR = ch.targetR;
+      }
+      mix_resample(smp.data.data(), pos, ch.step, k - r, ch.gainL, ch.gainR, 0.f, 0.f, o + 2*r);
+    } else if (ch.rampLeft == r) {
+      ch.gainL = ch.targetL;
+      ch.gainR = ch.targetR;
+    }
+    ch.rampLeft -= r;
+    ch.pos += ch.step * k;
+    done += k;
+
+    if (ch.pos >= end) {
+      if (smp.loopLength)
+        ch.pos = (static_cast<uint64_t>(smp.loopStart) << 32) + (ch.pos - end) % (static_cast<uint64_t>(smp.loopLength) << 32);
+      else
+        ch.active = false;
+    }
+  }
+}
+
+void XMPlayer::_frames_loop(AudioFrame *out, uint frames) {
+  while (frames) {
+    if (!_tickLeft)
+      _start_tick();
+
+    uint n = min(min(frames, _tickLeft), MIX_FRAMES);
+    if (out) {
+      fill(_mix.begin(), _mix.begin() + 2*n, 0.f);
+      for (auto &ch : _channels)
+        _play(ch, _mix.data(), n);
+      mix_to_frames(_mix.data(), n, out);
+      out += n;
+    } else {
+      for (auto &ch : _channels)
+        _play(ch, nullptr, n);
+    }
+
+    _tickLeft -= n;
+    frames -= n;
+    _frames += n;
+  }
+}
+
+void XMPlayer::render(AudioFrame *out, uint frames) {
+  _frames_loop(out, frames);
+}
+
+void XMPlayer::skip(uint frames) {
+  _frames_loop(nullptr, frames);
+}
+
+uint64_t XMPlayer::frames() const {
+  return _frames;
+}
+
+uint XMPlayer::rate() const {
+  return _rate;
+}
+
+uint XMPlayer::loops() const {
+  return _loops;
+}
+
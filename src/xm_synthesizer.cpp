@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <vector>
+#include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <misc/log.hpp>
+#include <xm_synthesizer.hpp>
+
+using namespace std;
+using namespace sky;
+using namespace misc;
+
+namespace {
+  uint    const RATE              = 44100;
+  uint    const RING_FRAMES       = 8192; /* how far the mixer may run ahead */
+  uint    const MIX_CHUNK         = ANALYSIS_HOP; /* one analysis per chunk */
+  uint    const DEVICE_PERIOD     = 512;
+  uint    const LATENCY_US        = 50000;
+  int64_t const MAX_EXTRAPOLATION = 50000000; /* ns past the last device write */
+}
+
+XMSynthesizer::XMSynthesizer() :
+    _module()
+  , _player(nullptr)
+  , _pcm(nullptr)
+  , _ring(RING_FRAMES)
+  , _analyzer(RATE)
+  , _featureRing(RING_FRAMES / MIX_CHUNK + 1)
+  , _quit(false)
+  , _seek(0)
+  , _skipped(0)
+  , _clockSeq(0)
+  , _clockFrames(0)
+  , _clockStamp(-1)
+  , _last(0.f)
+  , _start(chrono::steady_clock::now()) {
+}
+
+XMSynthesizer::~XMSynthesizer() {
+  _quit = true;
+  if (_mixer.joinable())
+    _mixer.join();
+  if (_device.joinable())
+    _device.join();
+
+  if (_pcm) {
+    snd_pcm_drop(_pcm);
+    snd_pcm_close(_pcm);
+  }
+  delete _player;
+}
+
+int64_t XMSynthesizer::_now() const {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - _start).count();
+}
+
+bool XMSynthesizer::load(char const *path) {
+  if (_module.load(path))
+    return true;
+
+  /* nothing to play, the cursor follows the wall clock */
+  _module = XMModule();
+  return false;
+}
+
+bool XMSynthesizer::load(ubyte const *data, size_t size) {
+  if (_module.load(data, size))
+    return true;
+
+  _module = XMModule();
+  return false;
+}
+
+XMModule const & XMSynthesizer::module() const {
+  return _module;
+}
+
+void XMSynthesizer::play() {
+  _start = chrono::steady_clock::now();
+  if (!_module.channels)
+    return;
+
+  if (snd_pcm_open(&_pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0 ||
+      snd_pcm_set_params(_pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, 2, RATE, 1, LATENCY_US) < 0) {
+    misc::log << error << "no audio device, following the wall clock" << endl;
+    if (_pcm)
+      snd_pcm_close(_pcm);
+    _pcm = nullptr;
+    _songFeatures = analyze_song(_module, RATE);
+    _start = chrono::steady_clock::now();
+    return;
+  }
+
+  /* start with a full ring so that the device never waits on the first mix */
+  _player = new XMPlayer(_module, RATE);
+  vector<AudioFrame> chunk(MIX_CHUNK);
+  while (_ring.writable() >= MIX_CHUNK)
+    _mix_chunk(chunk.data());
+
+  _start = chrono::steady_clock::now();
+  _mixer = thread(&XMSynthesizer::_mix_loop, this);
+  _device = thread(&XMSynthesizer::_device_loop, this);
+}
+
+void XMSynthesizer::_mix_chunk(AudioFrame *chunk) {
+  AudioFeatures features;
+
+  /* features first: the device must never read frames it has no features for */
+  _player->render(chunk, MIX_CHUNK);
+  _analyzer.analyze(chunk, features);
+  _featureRing.write(&features, 1);
+  _ring.write(chunk, MIX_CHUNK);
+}
+
+void XMSynthesizer::_mix_loop() {
+  vector<AudioFrame> chunk(MIX_CHUNK);
+
+  while (!_quit.load(memory_order_relaxed)) {
+    uint seek = _seek.exchange(0);
+    if (seek) {
+      _player->skip(seek);
+      _skipped += seek;
+    }
+
+    if (_ring.writable() < MIX_CHUNK) {
+      this_thread::sleep_for(chrono::milliseconds(2));
+      continue;
+    }
+    _mix_chunk(chunk.data());
+  }
+}
+
+void XMSynthesizer::_device_loop() {
+  vector<AudioFrame> period(DEVICE_PERIOD);
+  uint64_t written = 0;
+  AudioFeatures next;
+  bool pending = false; /* next is read but not heard yet */
+  sched_param param;
+
+  /* best effort: real-time scheduling needs the rtprio limit */
+  param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+  while (!_quit.load(memory_order_relaxed)) {
+    /* underruns play silence, the song waits for the mixer */
+    size_t n = _ring.read(period.data(), DEVICE_PERIOD);
+    fill(period.begin() + n, period.end(), AudioFrame{ 0, 0 });
+
+    snd_pcm_sframes_t r = snd_pcm_writei(_pcm, period.data(), DEVICE_PERIOD);
+    if (r < 0) {
+      snd_pcm_recover(_pcm, r, 1);
+      continue;
+    }
+    written += n;
+
+    snd_pcm_sframes_t delay = 0;
+    if (snd_pcm_delay(_pcm, &delay) < 0)
+      delay = 0;
+
+    uint seq = _clockSeq.load(memory_order_relaxed);
+    _clockSeq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    uint64_t heard = written - min<uint64_t>(written, max<snd_pcm_sframes_t>(delay, 0));
+    _clockFrames.store(heard, memory_order_relaxed);
+    _clockStamp.store(_now(), memory_order_relaxed);
+    _clockSeq.store(seq + 2, memory_order_release);
+
+    /* publish the features of the last hop fully heard */
+    bool fresh = false;
+    while (pending || _featureRing.read(&next, 1)) {
+      pending = next.end > heard;
+      if (pending)
+        break;
+      _features.back() = next;
+      fresh = true;
+    }
+    if (fresh)
+      _features.publish();
+  }
+}
+
+float XMSynthesizer::cursor() const {
+  int64_t now = _now();
+  float skipped = static_cast<float>(_skipped.load()) / RATE;
+
+  if (!_pcm)
+    return now * 1e-9f + skipped;
+
+  uint seq;
+  uint64_t frames;
+  int64_t stamp;
+  do {
+    seq = _clockSeq.load(memory_order_acquire);
+    frames = _clockFrames.load(memory_order_relaxed);
+    stamp = _clockStamp.load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+  } while ((seq & 1) || seq != _clockSeq.load(memory_order_relaxed));
+
+  if (stamp < 0)
+    return skipped;
+
+  /* the device clock only ticks once per period: extrapolate, never go back */
+  float t = static_cast<float>(frames) / RATE + min(now - stamp, MAX_EXTRAPOLATION) * 1e-9f + skipped;
+  _last = max(_last, t);
+  return _last;
+}
+
+AudioFeatures const & XMSynthesizer::features() {
+  static AudioFeatures const silence = AudioFeatures();
+
+  if (_pcm) {
+    _features.update();
+    return _features.front();
+  }
+  if (_songFeatures.empty())
+    return silence;
+
+  /* last hop fully heard */
+  uint64_t heard = static_cast<uint64_t>(max(cursor(), 0.f) * RATE) / MIX_CHUNK;
+  if (!heard)
+    return silence;
+  return _songFeatures[min<uint64_t>(heard, _songFeatures.size()) - 1];
+}
+
+void XMSynthesizer::advance_cursor(float seconds) {
+  uint frames = static_cast<uint>(seconds * RATE);
+
+  if (_pcm)
+    _seek += frames;
+  else
+    _skipped += frames;
+}
+
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <yuv420.hpp>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace sky;
+
+namespace {
+  /* BT.601, 8-bit fixed point */
+  inline ubyte luma(int b, int g, int r) {
+    return ((66*r + 129*g + 25*b + 128) >> 8) + 16;
+  }
+
+  inline ubyte chroma_u(int b, int g, int r) {
+    return ((-38*r - 74*g + 112*b + 128) >> 8) + 128;
+  }
+
+  inline ubyte chroma_v(int b, int g, int r) {
+    return ((112*r - 94*g - 18*b + 128) >> 8) + 128;
+  }
+
+#if defined(__SSE2__)
+  /* a, b hold two 32-bit halves per pixel: their sums, pixel per lane */
+  inline __m128i sum_halves(__m128i a, __m128i b) {
+    __m128 fa = _mm_castsi128_ps(a), fb = _mm_castsi128_ps(b);
+
+    return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0))),
+                         _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1))));
+  }
+
+  /* 4 BGRA pixels weighted by BGRA weights, rounded, shifted and biased */
+  inline void weigh4(__m128i pixels, __m128i weights, int bias, ubyte *out) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i s = sum_halves(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights),
+                           _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights));
+    int32_t packed;
+
+    s = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(s, _mm_set1_epi32(128)), 8), _mm_set1_epi32(bias));
+    s = _mm_packs_epi32(s, s);
+    packed = _mm_cvtsi128_si32(_mm_packus_epi16(s, s));
+    memcpy(out, &packed, sizeof(packed));
+  }
+
+  /* 2 BGRA pixels of a row and 2 of the next, in 16-bit lanes: the
+   * rounded BGRA average of the block in the low 4 lanes */
+  inline __m128i block_average(__m128i top, __m128i bottom) {
+    __m128i s = _mm_add_epi16(top, bottom);
+
+    s = _mm_add_epi16(s, _mm_srli_si128(s, 8));
+    return _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16(2)), 2);
+  }
+
+  /* 4 blocks, 2 rows of 8 pixels, to their averages as 4 BGRA pixels;
+   * summed in 16 bits then rounded once, as the scalar path does */
+  inline __m128i average4(ubyte const *top, ubyte const *bottom) {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i t0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(top));
+    __m128i t1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(top + 16));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(bottom));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(bottom + 16));
+    __m128i a01 = _mm_unpacklo_epi64(block_average(_mm_unpacklo_epi8(t0, zero), _mm_unpacklo_epi8(b0, zero)),
+                                     block_average(_mm_unpackhi_epi8(t0, zero), _mm_unpackhi_epi8(b0, zero)));
+    __m128i a23 = _mm_unpacklo_epi64(block_average(_mm_unpacklo_epi8(t1, zero), _mm_unpacklo_epi8(b1, zero)),
+                                     block_average(_mm_unpackhi_epi8(t1, zero), _mm_unpackhi_epi8(b1, zero)));
+
+    return _mm_packus_epi16(a01, a23);
+  }
+#endif
+
+  void luma_row(ubyte const *src, uint width, ubyte *out, bool simd) {
+    uint x = 0;
+
+#if defined(__SSE2__)
+    /* 4 pixels at once */
+    __m128i const weights = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+
+    for (; simd && x + 4 <= width; x += 4)
+      weigh4(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + 4*x)), weights, 16, out + x);
+#else
+    (void)simd;
+#endif
+
+    for (; x < width; ++x)
+      out[x] = luma(src[4*x], src[4*x+1], src[4*x+2]);
+  }
+
+  /* top and bottom rows of the blocks */
+  void chroma_row(ubyte const *top, ubyte const *bottom, uint width, ubyte *u, ubyte *v, bool simd) {
+    uint x = 0;
+
+#if defined(__SSE2__)
+    /* 4 blocks at once */
+    __m128i const uWeights = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+    __m128i const vWeights = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+
+    for (; simd && 2*x + 8 <= width; x += 4) {
+      __m128i blocks = average4(top + 8*x, bottom + 8*x);
+
+      weigh4(blocks, uWeights, 128, u + x);
+      weigh4(blocks, vWeights, 128, v + x);
+    }
+#else
+    (void)simd;
+#endif
+
+    for (; 2*x < width; ++x) {
+      uint x0 = 8*x, x1 = 4 * min(2*x + 1, width - 1);
+      int b = (top[x0]   + top[x1]   + bottom[x0]   + bottom[x1]   + 2) >> 2;
+      int g = (top[x0+1] + top[x1+1] + bottom[x0+1] + bottom[x1+1] + 2) >> 2;
+      int r = (top[x0+2] + top[x1+2] + bottom[x0+2] + bottom[x1+2] + 2) >> 2;
+
+      u[x] = chroma_u(b, g, r);
+      v[x] = chroma_v(b, g, r);
+    }
+  }
+
+  void convert(ubyte const *bgra, uint width, uint height, ubyte *y, ubyte *u, ubyte *v, bool simd) {
+    size_t stride = static_cast<size_t>(width) * 4;
+    uint chromaWidth = (width + 1) / 2;
+
+    for (uint row = 0; row < height; ++row)
+      luma_row(bgra + (height - 1 - row) * stride, width, y + static_cast<size_t>(row) * width, simd);
+
+    for (uint row = 0; 2*row < height; ++row) {
+      ubyte const *top = bgra + (height - 1 - 2*row) * stride;
+      ubyte const *bottom = 2*row + 1 < height ? top - stride : top;
+
+      chroma_row(top, bottom, width, u + static_cast<size_t>(row) * chromaWidth, v + static_cast<size_t>(row) * chromaWidth, simd);
+    }
+  }
+}
+
+void bgra_to_yuv420(ubyte const *bgra, uint width, uint height, ubyte *y, ubyte *u, ubyte *v) {
+  convert(bgra, width, height, y, u, v, true);
+}
+
+void bgra_to_yuv420_scalar(ubyte const *bgra, uint width, uint height, ubyte *y, ubyte *u, ubyte *v) {
+  convert(bgra, width, height, y, u, v, false);
+}
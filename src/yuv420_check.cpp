@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <yuv420.hpp>
+
+using namespace std;
+using namespace sky;
+
+namespace {
+  uint const SEED  = 2013;
+  uint const SIZES[][2] = { { 1, 1 }, { 2, 2 }, { 7, 5 }, { 8, 2 }, { 15, 9 }, { 16, 16 }, { 17, 3 }, { 33, 31 }, { 640, 360 }, { 1921, 1081 } };
+
+  /* noise, then the extremes the rounding is most likely to split on */
+  void fill(vector<ubyte> &bgra, uint pattern) {
+    for (size_t i = 0; i < bgra.size(); ++i) {
+      switch (pattern) {
+        case 0 :  bgra[i] = rand() & 0xff; break;
+        case 1 :  bgra[i] = (i / 4 + i / 7) & 1 ? 0xff : 0x00; break;
+        default : bgra[i] = (rand() & 3) + 0xfc * (rand() & 1); break;
+      }
+    }
+  }
+}
+
+/* The SSE2 conversion of exported frames against the scalar one, on
+ * images of odd and even sizes: both must give the same bytes. Exits with
+ * 1 and the first mismatch otherwise. */
+int main() {
+  uint failed = 0;
+
+  srand(SEED);
+  for (auto const &s : SIZES) {
+    uint width = s[0], height = s[1];
+    size_t luma = static_cast<size_t>(width) * height;
+    size_t chroma = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+    vector<ubyte> bgra(luma * 4), simd(luma + 2 * chroma), scalar(simd.size());
+
+    for (uint pattern = 0; pattern < 3; ++pattern) {
+      fill(bgra, pattern);
+      bgra_to_yuv420(bgra.data(), width, height, &simd[0], &simd[luma], &simd[luma + chroma]);
+      bgra_to_yuv420_scalar(bgra.data(), width, height, &scalar[0], &scalar[luma], &scalar[luma + chroma]);
+
+      for (size_t i = 0; i < simd.size(); ++i) {
+        if (simd[i] != scalar[i]) {
+          printf("%ux%u, pattern %u: byte %zu of the %s plane is %u, not %u\n", width, height, pattern,
+                 i < luma ? i : (i - luma) % chroma, i < luma ? "y" : i < luma + chroma ? "u" : "v", simd[i], scalar[i]);
+          ++failed;
+          break;
+        }
+      }
+    }
+  }
+
+  printf("yuv420: %s\n", failed ? "FAILED" : "ok");
+  return failed ? 1 : 0;
+}